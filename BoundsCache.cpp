@@ -0,0 +1,96 @@
+#include "BoundsCache.h"
+
+
+void BoundsCache::MarkDirty(BoundsKey key, Slot& slot)
+{
+	if (!slot.dirty)
+	{
+		slot.dirty = true;
+		_dirty.push_back(key);
+	}
+	_changeCounter++;
+}
+
+void BoundsCache::OnAdded(BoundsKey key)
+{
+	MarkDirty(key, _slots[key]);
+}
+
+void BoundsCache::OnRemoved(BoundsKey key)
+{
+	// The key may still be in _dirty, Update() skips keys that are gone
+	if (_slots.erase(key))
+	{
+		_changeCounter++;
+		_structureCounter++;
+	}
+}
+
+void BoundsCache::OnChanged(BoundsKey key)
+{
+	auto it = _slots.find(key);
+	if (it != _slots.end())
+	{
+		MarkDirty(key, it->second);
+	}
+}
+
+void BoundsCache::InvalidateAll()
+{
+	for (auto& it : _slots)
+	{
+		MarkDirty(it.first, it.second);
+	}
+}
+
+size_t BoundsCache::Update(BoundsSource& source)
+{
+	size_t fetched = 0;
+
+	for (BoundsKey key : _dirty)
+	{
+		auto it = _slots.find(key);
+		if (it == _slots.end() || !it->second.dirty)
+			continue;
+
+		Slot& slot = it->second;
+		if (source.FetchBounds(key, slot.entry))
+		{
+			if (!slot.valid)
+				_structureCounter++;
+
+			slot.valid = true;
+			slot.dirty = false;
+			_updated.push_back(key);
+			fetched++;
+		}
+		else
+		{
+			if (slot.valid)
+				_structureCounter++;
+
+			_slots.erase(it);
+			_changeCounter++;
+		}
+	}
+	_dirty.clear();
+
+	return fetched;
+}
+
+const BoundsEntry* BoundsCache::Find(BoundsKey key) const
+{
+	auto it = _slots.find(key);
+	if (it == _slots.end() || !it->second.valid)
+		return nullptr;
+	return &it->second.entry;
+}
+
+void BoundsCache::Clear()
+{
+	_slots.clear();
+	_dirty.clear();
+	_updated.clear();
+	_changeCounter++;
+	_structureCounter++;
+}
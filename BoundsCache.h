@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+// Identifies one DAG instance of a shape. The Maya side packs the node hash in the
+// upper 32 bits and the instance number in the lower 32 bits, see SceneBounds.cpp.
+using BoundsKey = uint64_t;
+
+inline BoundsKey MakeBoundsKey(uint32_t nodeHash, uint32_t instance)
+{
+	return ((BoundsKey)nodeHash << 32) | instance;
+}
+
+inline uint32_t BoundsKeyNode(BoundsKey key)
+{
+	return (uint32_t)(key >> 32);
+}
+
+enum ShapeType : unsigned char
+{
+	kShapeMesh,
+	kShapeNurbsSurface,
+	kShapeSubdiv,
+	kShapeTypeCount
+};
+
+enum BoundsFlags : unsigned char
+{
+	kBoundsVisible = 1 << 0,
+	kBoundsTemplated = 1 << 1,
+};
+
+struct BoundsEntry
+{
+	// Object-space bounding box
+	float minPt[3];
+	float maxPt[3];
+
+	// Inclusive (world) matrix in Maya's MMatrix layout
+	double world[4][4];
+
+	ShapeType type;
+	unsigned char flags;
+};
+
+
+// Where the cache gets fresh data from when an entry is dirty. Maya implements it in
+// SceneBounds, a headless test can feed synthetic entries.
+class BoundsSource
+{
+public:
+	virtual ~BoundsSource() {}
+
+	// Returns false if the object no longer exists, the entry is then dropped.
+	virtual bool FetchBounds(BoundsKey key, BoundsEntry& entry) = 0;
+};
+
+
+// Scene-side cache of object bounds and world matrices. Scene events only mark entries
+// dirty, Update() then asks the source for the dirty entries, so the per-frame cost is
+// proportional to what changed and not to the size of the scene.
+class BoundsCache
+{
+public:
+	// Scene events
+	void OnAdded(BoundsKey key);
+	void OnRemoved(BoundsKey key);
+	void OnChanged(BoundsKey key);
+	void InvalidateAll();
+
+	// Refetch the dirty entries, returns how many were fetched. New entries only become
+	// valid (and count as added for StructureCounter) once fetched.
+	size_t Update(BoundsSource& source);
+
+	// Returns nullptr for unknown entries and entries that were never fetched. Dirty
+	// entries keep returning their last fetched data until the next Update().
+	const BoundsEntry* Find(BoundsKey key) const;
+	inline bool Contains(BoundsKey key) const { return _slots.find(key) != _slots.end(); }
+
+	inline size_t Size() const { return _slots.size(); }
+	inline size_t DirtyCount() const { return _dirty.size(); }
+
+	// Incremented whenever an entry is added, changed or removed
+	inline uint64_t ChangeCounter() const { return _changeCounter; }
+
+	// Incremented only when entries are added or removed
+	inline uint64_t StructureCounter() const { return _structureCounter; }
+
+	// Entries fetched since the last ClearUpdated(), for the consumer of the cache that
+	// keeps derived data (e.g. the culling BVH) in sync.
+	inline const std::vector<BoundsKey>& Updated() const { return _updated; }
+	inline void ClearUpdated() { _updated.clear(); }
+
+	// Calls func(key, entry) for every valid entry
+	template<class Func>
+	void ForEach(Func func) const
+	{
+		for (const auto& it : _slots)
+		{
+			if (it.second.valid)
+				func(it.first, it.second.entry);
+		}
+	}
+
+	void Clear();
+
+protected:
+	struct Slot
+	{
+		BoundsEntry entry;
+		bool valid = false;
+		bool dirty = false;
+	};
+
+	void MarkDirty(BoundsKey key, Slot& slot);
+
+	std::unordered_map<BoundsKey, Slot> _slots;
+	std::vector<BoundsKey> _dirty;
+	std::vector<BoundsKey> _updated;
+	uint64_t _changeCounter = 0;
+	uint64_t _structureCounter = 0;
+};
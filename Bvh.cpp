@@ -0,0 +1,284 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Leaves hold a few primitives, a box test is cheaper than descending further
+static const uint32_t kMaxLeafSize = 4;
+
+
+static inline void Grow(Aabb& box, const Aabb& other)
+{
+	for (int a = 0; a < 3; a++)
+	{
+		box.minPt[a] = std::min(box.minPt[a], other.minPt[a]);
+		box.maxPt[a] = std::max(box.maxPt[a], other.maxPt[a]);
+	}
+}
+
+static inline Aabb EmptyAabb()
+{
+	Aabb box;
+	for (int a = 0; a < 3; a++)
+	{
+		box.minPt[a] = INFINITY;
+		box.maxPt[a] = -INFINITY;
+	}
+	return box;
+}
+
+Aabb TransformAabb(const float minPt[3], const float maxPt[3], const double world[4][4])
+{
+	// Transform the center and project the half extents onto the world axes
+	Aabb box;
+	for (int c = 0; c < 3; c++)
+	{
+		double center = world[3][c];
+		double extent = 0.0;
+		for (int r = 0; r < 3; r++)
+		{
+			double mid = 0.5 * ((double)maxPt[r] + (double)minPt[r]);
+			double half = 0.5 * ((double)maxPt[r] - (double)minPt[r]);
+			center += mid * world[r][c];
+			extent += half * fabs(world[r][c]);
+		}
+		box.minPt[c] = (float)(center - extent);
+		box.maxPt[c] = (float)(center + extent);
+	}
+	return box;
+}
+
+Frustum Frustum::FromViewProjection(const float m[4][4])
+{
+	// clip = p * m, so the planes are combinations of the columns of m. The near plane
+	// uses the OpenGL clip range (z >= -w), which also contains the D3D one (z >= 0),
+	// so the test stays conservative whatever convention the projection uses.
+	Frustum f;
+	for (int r = 0; r < 4; r++)
+	{
+		f.planes[0][r] = m[r][3] + m[r][0];	// left
+		f.planes[1][r] = m[r][3] - m[r][0];	// right
+		f.planes[2][r] = m[r][3] + m[r][1];	// bottom
+		f.planes[3][r] = m[r][3] - m[r][1];	// top
+		f.planes[4][r] = m[r][3] + m[r][2];	// near
+		f.planes[5][r] = m[r][3] - m[r][2];	// far
+	}
+	return f;
+}
+
+void Bvh::Clear()
+{
+	_nodes.clear();
+	_prims.clear();
+	_primLeaf.clear();
+	_boxes.clear();
+	_dirty.clear();
+	_dirtyNodes.clear();
+}
+
+void Bvh::Build(const Aabb* boxes, size_t count)
+{
+	Clear();
+	if (count == 0)
+		return;
+
+	_boxes.assign(boxes, boxes + count);
+	_primLeaf.resize(count);
+	_prims.resize(count);
+
+	std::vector<float> centers(count * 3);
+	for (size_t i = 0; i < count; i++)
+	{
+		_prims[i] = (uint32_t)i;
+		for (int a = 0; a < 3; a++)
+			centers[i * 3 + a] = boxes[i].minPt[a] + boxes[i].maxPt[a];
+	}
+
+	_nodes.reserve(2 * count / kMaxLeafSize + 1);
+	BuildNode(0, (uint32_t)count, 0, centers);
+	_dirty.assign(_nodes.size(), 0);
+}
+
+uint32_t Bvh::BuildNode(uint32_t first, uint32_t count, uint32_t parent, std::vector<float>& centers)
+{
+	uint32_t index = (uint32_t)_nodes.size();
+	_nodes.push_back(Node());
+
+	Aabb box = EmptyAabb();
+	Aabb centerBox = EmptyAabb();
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		uint32_t prim = _prims[i];
+		Grow(box, _boxes[prim]);
+		for (int a = 0; a < 3; a++)
+		{
+			centerBox.minPt[a] = std::min(centerBox.minPt[a], centers[prim * 3 + a]);
+			centerBox.maxPt[a] = std::max(centerBox.maxPt[a], centers[prim * 3 + a]);
+		}
+	}
+
+	uint32_t left = 0, right = 0;
+	if (count > kMaxLeafSize)
+	{
+		// Median split along the longest axis of the centers
+		int axis = 0;
+		float longest = -1.0f;
+		for (int a = 0; a < 3; a++)
+		{
+			float length = centerBox.maxPt[a] - centerBox.minPt[a];
+			if (length > longest)
+			{
+				longest = length;
+				axis = a;
+			}
+		}
+
+		uint32_t half = count / 2;
+		std::nth_element(_prims.begin() + first, _prims.begin() + first + half, _prims.begin() + first + count,
+			[&centers, axis](uint32_t a, uint32_t b) { return centers[a * 3 + axis] < centers[b * 3 + axis]; });
+
+		left = BuildNode(first, half, index, centers);
+		right = BuildNode(first + half, count - half, index, centers);
+	}
+	else
+	{
+		for (uint32_t i = first; i < first + count; i++)
+			_primLeaf[_prims[i]] = index;
+	}
+
+	Node& node = _nodes[index];
+	node.box = box;
+	node.first = first;
+	node.count = count;
+	node.left = left;
+	node.right = right;
+	node.parent = parent;
+	return index;
+}
+
+void Bvh::Update(uint32_t prim, const Aabb& box)
+{
+	if (prim >= _boxes.size())
+		return;
+
+	_boxes[prim] = box;
+
+	// Mark the path to the root, stop at the first node that is already marked
+	uint32_t index = _primLeaf[prim];
+	while (!_dirty[index])
+	{
+		_dirty[index] = 1;
+		_dirtyNodes.push_back(index);
+		if (index == 0)
+			break;
+		index = _nodes[index].parent;
+	}
+}
+
+void Bvh::RecomputeNode(uint32_t index)
+{
+	Node& node = _nodes[index];
+	if (node.left)
+	{
+		node.box = _nodes[node.left].box;
+		Grow(node.box, _nodes[node.right].box);
+	}
+	else
+	{
+		node.box = EmptyAabb();
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+			Grow(node.box, _boxes[_prims[i]]);
+	}
+}
+
+void Bvh::Refit()
+{
+	// Children are stored after their parent, so going from the highest index down
+	// recomputes every child before its parent
+	std::sort(_dirtyNodes.begin(), _dirtyNodes.end(), [](uint32_t a, uint32_t b) { return a > b; });
+	for (uint32_t index : _dirtyNodes)
+	{
+		RecomputeNode(index);
+		_dirty[index] = 0;
+	}
+	_dirtyNodes.clear();
+}
+
+void Bvh::Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	size_t base = visible.size();
+	visible.resize(base + PrimCount());
+	visible.resize(base + Cull(frustum, visible.data() + base));
+}
+
+size_t Bvh::Cull(const Frustum& frustum, uint32_t* visible) const
+{
+	size_t count = 0;
+	if (_nodes.empty())
+		return count;
+
+	uint32_t stack[64];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node& node = _nodes[stack[--top]];
+
+		bool outside = false;
+		bool inside = true;
+		for (int p = 0; p < 6 && !outside; p++)
+		{
+			const float* plane = frustum.planes[p];
+			float dist = plane[3];
+			float radius = 0.0f;
+			for (int a = 0; a < 3; a++)
+			{
+				float center = 0.5f * (node.box.maxPt[a] + node.box.minPt[a]);
+				float half = 0.5f * (node.box.maxPt[a] - node.box.minPt[a]);
+				dist += plane[a] * center;
+				radius += fabsf(plane[a]) * half;
+			}
+
+			if (dist + radius < 0.0f)
+				outside = true;
+			else if (dist - radius < 0.0f)
+				inside = false;
+		}
+
+		if (outside)
+			continue;
+
+		if (inside || !node.left)
+		{
+			// Whole subtree is visible, or a leaf that needs per primitive tests
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				uint32_t prim = _prims[i];
+				if (!inside && !node.left)
+				{
+					const Aabb& box = _boxes[prim];
+					bool primOutside = false;
+					for (int p = 0; p < 6 && !primOutside; p++)
+					{
+						const float* plane = frustum.planes[p];
+						float dist = plane[3];
+						for (int a = 0; a < 3; a++)
+							dist += plane[a] * (plane[a] >= 0.0f ? box.maxPt[a] : box.minPt[a]);
+						primOutside = dist < 0.0f;
+					}
+					if (primOutside)
+						continue;
+				}
+				visible[count++] = prim;
+			}
+			continue;
+		}
+
+		// The median split keeps the depth at about log2(n), far below the stack size
+		stack[top++] = node.right;
+		stack[top++] = node.left;
+	}
+	return count;
+}
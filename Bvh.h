@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+struct Aabb
+{
+	float minPt[3];
+	float maxPt[3];
+};
+
+// World-space box of an object-space box transformed by a matrix in MMatrix layout.
+Aabb TransformAabb(const float minPt[3], const float maxPt[3], const double world[4][4]);
+
+
+// Six planes (a, b, c, d), a point p is inside when a * x + b * y + c * z + d >= 0 for all.
+struct Frustum
+{
+	float planes[6][4];
+
+	// viewProjection uses the row-vector convention, like the view and projection
+	// matrices returned by MDrawContext::getMatrix.
+	static Frustum FromViewProjection(const float viewProjection[4][4]);
+};
+
+
+// Bounding volume hierarchy over a fixed set of primitives identified by their index.
+// Moving primitives only needs Update() + Refit(), adding or removing them a new Build().
+class Bvh
+{
+public:
+	void Build(const Aabb* boxes, size_t count);
+	void Clear();
+
+	// Change the box of one primitive, the tree is fixed up by the next Refit().
+	void Update(uint32_t prim, const Aabb& box);
+	void Refit();
+
+	// Appends the primitives whose box is inside or intersects the frustum.
+	void Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+	// Same into an array of at least PrimCount() elements, returns how many were written
+	size_t Cull(const Frustum& frustum, uint32_t* visible) const;
+
+	inline size_t PrimCount() const { return _primLeaf.size(); }
+	inline size_t NodeCount() const { return _nodes.size(); }
+
+protected:
+	// Nodes are stored in depth-first order so children always follow their parent,
+	// and every node covers the contiguous range [first, first + count) of _prims.
+	struct Node
+	{
+		Aabb box;
+		uint32_t first;
+		uint32_t count;
+		uint32_t left;		// 0 for leaves, the right child is stored at `right`
+		uint32_t right;
+		uint32_t parent;
+	};
+
+	uint32_t BuildNode(uint32_t first, uint32_t count, uint32_t parent, std::vector<float>& centers);
+	void RecomputeNode(uint32_t index);
+
+	std::vector<Node> _nodes;
+	std::vector<uint32_t> _prims;		// primitive indices, ordered by leaf
+	std::vector<uint32_t> _primLeaf;	// leaf node of every primitive
+	std::vector<Aabb> _boxes;			// box of every primitive
+	std::vector<uint8_t> _dirty;		// per node
+	std::vector<uint32_t> _dirtyNodes;
+};
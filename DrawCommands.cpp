@@ -0,0 +1,331 @@
+#include "DrawCommands.h"
+
+#include <cstring>
+
+
+template<class T>
+void CommandBuffer::Push(CommandType type, const T& payload)
+{
+	static_assert(sizeof(T) % 4 == 0, "Command payloads are made of 32-bit fields");
+
+	Header header;
+	header.type = (uint16_t)type;
+	header.size = (uint16_t)sizeof(T);
+
+	size_t at = _bytes.size();
+	_bytes.resize(at + sizeof(Header) + sizeof(T));
+	memcpy(&_bytes[at], &header, sizeof(Header));
+	memcpy(&_bytes[at + sizeof(Header)], &payload, sizeof(T));
+	_count++;
+}
+
+void CommandBuffer::Reset()
+{
+	_bytes.clear();
+	_count = 0;
+}
+
+void CommandBuffer::BindPipeline(ResourceId pipeline)
+{
+	CmdBindPipeline cmd = { pipeline };
+	Push(kCmdBindPipeline, cmd);
+}
+
+void CommandBuffer::BindStates(ResourceId states)
+{
+	CmdBindStates cmd = { states };
+	Push(kCmdBindStates, cmd);
+}
+
+void CommandBuffer::SetVertexBuffer(uint32_t slot, ResourceId buffer, uint32_t stride, uint32_t offset)
+{
+	CmdSetVertexBuffer cmd = { slot, buffer, stride, offset };
+	Push(kCmdSetVertexBuffer, cmd);
+}
+
+void CommandBuffer::SetIndexBuffer(ResourceId buffer, uint32_t offset, uint32_t indexSize)
+{
+	CmdSetIndexBuffer cmd = { buffer, offset, indexSize };
+	Push(kCmdSetIndexBuffer, cmd);
+}
+
+void CommandBuffer::SetConstants(uint32_t slot, uint32_t stages, ResourceId buffer, uint32_t offset, uint32_t size)
+{
+	CmdSetConstants cmd = { slot, stages, buffer, offset, size };
+	Push(kCmdSetConstants, cmd);
+}
+
+void CommandBuffer::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance)
+{
+	CmdDrawIndexedInstanced cmd = { indexCount, instanceCount, startIndex, baseVertex, startInstance };
+	Push(kCmdDrawIndexedInstanced, cmd);
+}
+
+void CommandBuffer::SetTexture(uint32_t slot, uint32_t stages, ResourceId texture)
+{
+	CmdSetTexture cmd = { slot, stages, texture };
+	Push(kCmdSetTexture, cmd);
+}
+
+void CommandBuffer::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+	CmdDraw cmd = { vertexCount, startVertex };
+	Push(kCmdDraw, cmd);
+}
+
+template<class T>
+static bool Decode(const uint8_t* payload, uint16_t size, T& cmd)
+{
+	if (size != sizeof(T))
+		return false;
+	memcpy(&cmd, payload, sizeof(T));
+	return true;
+}
+
+bool ReplayCommands(const CommandBuffer& commands, CommandBackend& backend)
+{
+	const uint8_t* at = commands.Data();
+	const uint8_t* end = at + commands.ByteSize();
+
+	while (at < end)
+	{
+		CommandBuffer::Header header;
+		if ((size_t)(end - at) < sizeof(header))
+			return false;
+		memcpy(&header, at, sizeof(header));
+		at += sizeof(header);
+
+		if ((size_t)(end - at) < header.size)
+			return false;
+		const uint8_t* payload = at;
+		at += header.size;
+
+		switch (header.type)
+		{
+		case kCmdBindPipeline:
+		{
+			CmdBindPipeline cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.BindPipeline(cmd);
+			break;
+		}
+		case kCmdBindStates:
+		{
+			CmdBindStates cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.BindStates(cmd);
+			break;
+		}
+		case kCmdSetVertexBuffer:
+		{
+			CmdSetVertexBuffer cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.SetVertexBuffer(cmd);
+			break;
+		}
+		case kCmdSetIndexBuffer:
+		{
+			CmdSetIndexBuffer cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.SetIndexBuffer(cmd);
+			break;
+		}
+		case kCmdSetConstants:
+		{
+			CmdSetConstants cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.SetConstants(cmd);
+			break;
+		}
+		case kCmdDrawIndexedInstanced:
+		{
+			CmdDrawIndexedInstanced cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.DrawIndexedInstanced(cmd);
+			break;
+		}
+		case kCmdSetTexture:
+		{
+			CmdSetTexture cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.SetTexture(cmd);
+			break;
+		}
+		case kCmdDraw:
+		{
+			CmdDraw cmd;
+			if (!Decode(payload, header.size, cmd))
+				return false;
+			backend.Draw(cmd);
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static void Declare(std::vector<uint8_t>& table, ResourceId id)
+{
+	if (table.size() <= id)
+		table.resize(id + 1, 0);
+	table[id] = 1;
+}
+
+static bool Declared(const std::vector<uint8_t>& table, ResourceId id)
+{
+	return id != 0 && id < table.size() && table[id];
+}
+
+void NullCommandBackend::Reset()
+{
+	_pipeline = 0;
+	_boundStates = 0;
+	for (uint32_t i = 0; i < kMaxVertexSlots; i++)
+		_vertexBuffers[i] = 0;
+	_indexBuffer = 0;
+
+	_commands = 0;
+	_draws = 0;
+	_instances = 0;
+	_indices = 0;
+	_errors = 0;
+	_firstError.clear();
+}
+
+void NullCommandBackend::DeclarePipeline(ResourceId id)
+{
+	Declare(_pipelines, id);
+}
+
+void NullCommandBackend::DeclareStates(ResourceId id)
+{
+	Declare(_states, id);
+}
+
+void NullCommandBackend::DeclareBuffer(ResourceId id, size_t size)
+{
+	if (_bufferSizes.size() <= id)
+		_bufferSizes.resize(id + 1, 0);
+	_bufferSizes[id] = size;
+}
+
+void NullCommandBackend::DeclareTexture(ResourceId id)
+{
+	Declare(_textures, id);
+}
+
+void NullCommandBackend::Error(const char* message)
+{
+	if (_errors == 0)
+		_firstError = message;
+	_errors++;
+}
+
+bool NullCommandBackend::ValidBuffer(ResourceId id, uint64_t end)
+{
+	return id != 0 && id < _bufferSizes.size() && _bufferSizes[id] != 0 && end <= _bufferSizes[id];
+}
+
+void NullCommandBackend::BindPipeline(const CmdBindPipeline& cmd)
+{
+	_commands++;
+	if (!Declared(_pipelines, cmd.pipeline))
+		Error("BindPipeline: unknown pipeline");
+	_pipeline = cmd.pipeline;
+}
+
+void NullCommandBackend::BindStates(const CmdBindStates& cmd)
+{
+	_commands++;
+	if (!Declared(_states, cmd.states))
+		Error("BindStates: unknown states");
+	_boundStates = cmd.states;
+}
+
+void NullCommandBackend::SetVertexBuffer(const CmdSetVertexBuffer& cmd)
+{
+	_commands++;
+	if (cmd.slot >= kMaxVertexSlots)
+	{
+		Error("SetVertexBuffer: slot out of range");
+		return;
+	}
+	if (!ValidBuffer(cmd.buffer, (uint64_t)cmd.offset + cmd.stride))
+		Error("SetVertexBuffer: unknown buffer or offset out of range");
+	_vertexBuffers[cmd.slot] = cmd.buffer;
+}
+
+void NullCommandBackend::SetIndexBuffer(const CmdSetIndexBuffer& cmd)
+{
+	_commands++;
+	if (cmd.indexSize != 2 && cmd.indexSize != 4)
+		Error("SetIndexBuffer: indices are not 16 or 32-bit");
+	if (!ValidBuffer(cmd.buffer, (uint64_t)cmd.offset + cmd.indexSize))
+		Error("SetIndexBuffer: unknown buffer or offset out of range");
+	_indexBuffer = cmd.buffer;
+}
+
+void NullCommandBackend::SetConstants(const CmdSetConstants& cmd)
+{
+	_commands++;
+	if (cmd.offset % 256 != 0)
+		Error("SetConstants: offset is not a multiple of 256 bytes");
+	if ((cmd.stages & (kStageVertex | kStagePixel)) == 0)
+		Error("SetConstants: no shader stage");
+	if (!ValidBuffer(cmd.buffer, (uint64_t)cmd.offset + cmd.size))
+		Error("SetConstants: unknown buffer or range out of bounds");
+}
+
+void NullCommandBackend::DrawIndexedInstanced(const CmdDrawIndexedInstanced& cmd)
+{
+	_commands++;
+	if (!_pipeline)
+		Error("DrawIndexedInstanced: no pipeline bound");
+	if (!_boundStates)
+		Error("DrawIndexedInstanced: no states bound");
+	if (!_vertexBuffers[0])
+		Error("DrawIndexedInstanced: no vertex buffer in slot 0");
+	if (!_indexBuffer)
+		Error("DrawIndexedInstanced: no index buffer");
+	if (cmd.indexCount == 0 || cmd.instanceCount == 0)
+		Error("DrawIndexedInstanced: empty draw");
+
+	_draws++;
+	_instances += cmd.instanceCount;
+	_indices += (uint64_t)cmd.indexCount * cmd.instanceCount;
+}
+
+void NullCommandBackend::SetTexture(const CmdSetTexture& cmd)
+{
+	_commands++;
+	if (cmd.slot >= kMaxTextureSlots)
+		Error("SetTexture: slot out of range");
+	if ((cmd.stages & (kStageVertex | kStagePixel)) == 0)
+		Error("SetTexture: no shader stage");
+	if (cmd.texture != 0 && !Declared(_textures, cmd.texture))
+		Error("SetTexture: unknown texture");
+}
+
+void NullCommandBackend::Draw(const CmdDraw& cmd)
+{
+	_commands++;
+	if (!_pipeline)
+		Error("Draw: no pipeline bound");
+	if (!_boundStates)
+		Error("Draw: no states bound");
+	if (cmd.vertexCount == 0)
+		Error("Draw: empty draw");
+
+	_draws++;
+	_instances++;
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Resources are referenced by small ids, each backend maps them to its own objects.
+// 0 means "none".
+typedef uint32_t ResourceId;
+
+enum CommandType : uint16_t
+{
+	kCmdBindPipeline = 1,
+	kCmdBindStates,
+	kCmdSetVertexBuffer,
+	kCmdSetIndexBuffer,
+	kCmdSetConstants,
+	kCmdDrawIndexedInstanced,
+	kCmdSetTexture,
+	kCmdDraw,
+};
+
+enum ShaderStageBits : uint32_t
+{
+	kStageVertex = 1 << 0,
+	kStagePixel = 1 << 1,
+};
+
+// Command payloads, plain structs of 32-bit fields copied as-is into the stream
+struct CmdBindPipeline
+{
+	ResourceId pipeline;	// shaders, input layout and topology
+};
+
+struct CmdBindStates
+{
+	ResourceId states;		// rasterizer, blend and depth-stencil states
+};
+
+struct CmdSetVertexBuffer
+{
+	uint32_t slot;
+	ResourceId buffer;
+	uint32_t stride;
+	uint32_t offset;
+};
+
+struct CmdSetIndexBuffer
+{
+	ResourceId buffer;
+	uint32_t offset;
+	uint32_t indexSize;		// 2 or 4 bytes
+};
+
+struct CmdSetConstants
+{
+	uint32_t slot;
+	uint32_t stages;		// ShaderStageBits
+	ResourceId buffer;
+	uint32_t offset;		// bytes, multiple of 256 when not 0
+	uint32_t size;
+};
+
+struct CmdDrawIndexedInstanced
+{
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t startIndex;
+	int32_t baseVertex;
+	uint32_t startInstance;
+};
+
+struct CmdSetTexture
+{
+	uint32_t slot;
+	uint32_t stages;		// ShaderStageBits
+	ResourceId texture;		// shader resource view, 0 unbinds the slot
+};
+
+// Vertices generated by the vertex shader, no vertex or index buffer
+struct CmdDraw
+{
+	uint32_t vertexCount;
+	uint32_t startVertex;
+};
+
+
+// A compact stream of draw commands. Recording only appends bytes, so it can be done on
+// any thread; a CommandBackend replays the stream later.
+class CommandBuffer
+{
+public:
+	struct Header
+	{
+		uint16_t type;
+		uint16_t size;		// payload bytes
+	};
+
+	void Reset();
+	void Reserve(size_t bytes) { _bytes.reserve(bytes); }
+
+	void BindPipeline(ResourceId pipeline);
+	void BindStates(ResourceId states);
+	void SetVertexBuffer(uint32_t slot, ResourceId buffer, uint32_t stride, uint32_t offset);
+	void SetIndexBuffer(ResourceId buffer, uint32_t offset, uint32_t indexSize = 2);
+	void SetConstants(uint32_t slot, uint32_t stages, ResourceId buffer, uint32_t offset, uint32_t size);
+	void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex, int32_t baseVertex, uint32_t startInstance);
+	void SetTexture(uint32_t slot, uint32_t stages, ResourceId texture);
+	void Draw(uint32_t vertexCount, uint32_t startVertex);
+
+	inline const uint8_t* Data() const { return _bytes.data(); }
+	inline size_t ByteSize() const { return _bytes.size(); }
+	inline size_t CommandCount() const { return _count; }
+
+protected:
+	template<class T>
+	void Push(CommandType type, const T& payload);
+
+	std::vector<uint8_t> _bytes;
+	size_t _count = 0;
+};
+
+
+// Receives the decoded commands of a CommandBuffer
+class CommandBackend
+{
+public:
+	virtual ~CommandBackend() {}
+
+	virtual void BindPipeline(const CmdBindPipeline& cmd) = 0;
+	virtual void BindStates(const CmdBindStates& cmd) = 0;
+	virtual void SetVertexBuffer(const CmdSetVertexBuffer& cmd) = 0;
+	virtual void SetIndexBuffer(const CmdSetIndexBuffer& cmd) = 0;
+	virtual void SetConstants(const CmdSetConstants& cmd) = 0;
+	virtual void DrawIndexedInstanced(const CmdDrawIndexedInstanced& cmd) = 0;
+	virtual void SetTexture(const CmdSetTexture& cmd) = 0;
+	virtual void Draw(const CmdDraw& cmd) = 0;
+};
+
+// Decodes the stream and calls the backend for each command. Returns false when the
+// stream is malformed, commands before the bad one have been replayed.
+bool ReplayCommands(const CommandBuffer& commands, CommandBackend& backend);
+
+
+// Backend that draws nothing: it checks the stream against the declared resources and
+// counts what would have been submitted. Runs anywhere, used to test and benchmark the
+// recording side without a GPU.
+class NullCommandBackend : public CommandBackend
+{
+public:
+	static const uint32_t kMaxVertexSlots = 16;
+	static const uint32_t kMaxTextureSlots = 16;
+
+	void Reset();
+
+	// Resources the stream may reference
+	void DeclarePipeline(ResourceId id);
+	void DeclareStates(ResourceId id);
+	void DeclareBuffer(ResourceId id, size_t size);
+	void DeclareTexture(ResourceId id);
+
+	void BindPipeline(const CmdBindPipeline& cmd) override;
+	void BindStates(const CmdBindStates& cmd) override;
+	void SetVertexBuffer(const CmdSetVertexBuffer& cmd) override;
+	void SetIndexBuffer(const CmdSetIndexBuffer& cmd) override;
+	void SetConstants(const CmdSetConstants& cmd) override;
+	void DrawIndexedInstanced(const CmdDrawIndexedInstanced& cmd) override;
+	void SetTexture(const CmdSetTexture& cmd) override;
+	void Draw(const CmdDraw& cmd) override;
+
+	inline uint64_t Commands() const { return _commands; }
+	inline uint64_t Draws() const { return _draws; }
+	inline uint64_t Instances() const { return _instances; }
+	inline uint64_t Indices() const { return _indices; }
+	inline uint64_t Errors() const { return _errors; }
+	inline const std::string& FirstError() const { return _firstError; }
+
+protected:
+	void Error(const char* message);
+	bool ValidBuffer(ResourceId id, uint64_t end);
+
+	std::vector<uint8_t> _pipelines;
+	std::vector<uint8_t> _states;
+	std::vector<size_t> _bufferSizes;	// 0 = not declared
+	std::vector<uint8_t> _textures;
+
+	ResourceId _pipeline = 0;
+	ResourceId _boundStates = 0;
+	ResourceId _vertexBuffers[kMaxVertexSlots] = {};
+	ResourceId _indexBuffer = 0;
+
+	uint64_t _commands = 0;
+	uint64_t _draws = 0;
+	uint64_t _instances = 0;
+	uint64_t _indices = 0;
+	uint64_t _errors = 0;
+	std::string _firstError;
+};
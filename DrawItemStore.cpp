@@ -0,0 +1,119 @@
+#include "DrawItemStore.h"
+
+#include <cstring>
+
+
+static const float kPaletteColors[kPaletteCount][3] =
+{
+	{ 1.0f, 1.0f, 1.0f },		// active
+	{ 0.2f, 0.2f, 0.2f },		// templated
+	{ 0.286f, 0.706f, 1.0f },	// mesh
+	{ 0.486f, 0.306f, 1.0f },	// NURBS surface
+	{ 0.886f, 0.206f, 1.0f },	// subdiv
+};
+
+const float* DrawItemStore::PaletteColor(uint8_t palette)
+{
+	return kPaletteColors[palette < kPaletteCount ? palette : (uint8_t)kPaletteActive];
+}
+
+uint8_t DrawItemStore::PaletteOf(uint8_t bits)
+{
+	if (bits & kItemActive)
+		return kPaletteActive;
+	if (bits & kItemTemplated)
+		return kPaletteTemplated;
+
+	switch (bits & kItemTypeMask)
+	{
+	case kShapeMesh:
+		return kPaletteMesh;
+	case kShapeNurbsSurface:
+		return kPaletteNurbsSurface;
+	default:
+		return kPaletteSubdiv;
+	}
+}
+
+void DrawItemStore::Update(uint32_t item, const BoundsEntry& entry)
+{
+	// Keep the active flag, it does not come from the cache
+	uint8_t bits = (uint8_t)(entry.type & kItemTypeMask) | (_bits[item] & kItemActive);
+	if (entry.flags & kBoundsVisible)
+		bits |= kItemVisible;
+	if (entry.flags & kBoundsTemplated)
+		bits |= kItemTemplated;
+	_bits[item] = bits;
+	_palette[item] = PaletteOf(bits);
+
+	for (int a = 0; a < 3; a++)
+	{
+		_minPt[a][item] = entry.minPt[a];
+		_maxPt[a][item] = entry.maxPt[a];
+	}
+	memcpy(_world[item].m, entry.world, sizeof(Matrix));
+}
+
+void DrawItemStore::Rebuild(const BoundsCache& cache)
+{
+	size_t count = 0;
+	cache.ForEach([&](BoundsKey, const BoundsEntry&) { count++; });
+
+	_keys.resize(count);
+	_bits.assign(count, 0);
+	_palette.resize(count);
+	for (int a = 0; a < 3; a++)
+	{
+		_minPt[a].resize(count);
+		_maxPt[a].resize(count);
+	}
+	_world.resize(count);
+	_indexOfKey.clear();
+	_indexOfKey.reserve(count);
+	_activeItems.clear();
+
+	uint32_t item = 0;
+	cache.ForEach([&](BoundsKey key, const BoundsEntry& entry)
+	{
+		_keys[item] = key;
+		_indexOfKey[key] = item;
+		Update(item, entry);
+		item++;
+	});
+}
+
+void DrawItemStore::SetActive(const std::unordered_set<BoundsKey>& active)
+{
+	for (uint32_t item : _activeItems)
+	{
+		_bits[item] &= (uint8_t)~kItemActive;
+		_palette[item] = PaletteOf(_bits[item]);
+	}
+	_activeItems.clear();
+
+	for (BoundsKey key : active)
+	{
+		uint32_t item = IndexOf(key);
+		if (item == kInvalidIndex)
+			continue;
+		_bits[item] |= kItemActive;
+		_palette[item] = kPaletteActive;
+		_activeItems.push_back(item);
+	}
+}
+
+uint32_t DrawItemStore::IndexOf(BoundsKey key) const
+{
+	auto it = _indexOfKey.find(key);
+	return it != _indexOfKey.end() ? it->second : kInvalidIndex;
+}
+
+size_t DrawItemStore::ItemBytes()
+{
+	return sizeof(BoundsKey) + 2 * sizeof(uint8_t) + 6 * sizeof(float) + sizeof(WorldMatrix);
+}
+
+size_t DrawItemStore::ByteSize() const
+{
+	return Size() * ItemBytes();
+}
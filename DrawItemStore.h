@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "BoundsCache.h"
+
+
+// Packed per-item bits: the shape type in the low bits, then the status flags
+enum DrawItemBits : uint8_t
+{
+	kItemTypeMask = 0x3,
+	kItemVisible = 1 << 2,
+	kItemTemplated = 1 << 3,
+	kItemActive = 1 << 4,
+};
+
+// Colors of the overlay's scheme, every item stores the index of its own
+enum DrawItemPalette : uint8_t
+{
+	kPaletteActive,
+	kPaletteTemplated,
+	kPaletteMesh,
+	kPaletteNurbsSurface,
+	kPaletteSubdiv,
+	kPaletteCount
+};
+
+
+// The drawable objects of the scene as structure-of-arrays: the bounds cache is converted
+// once, when it changes, and the per-frame stages (culling, occlusion, classification,
+// transform) stream over these arrays by item index instead of looking up every key.
+// Items are numbered 0..Size()-1 in the order of the last Rebuild(), which is also the
+// primitive numbering of the culling BVH.
+class DrawItemStore
+{
+public:
+	static const uint32_t kInvalidIndex = 0xffffffffu;
+
+	// Maya's MMatrix layout
+	typedef double Matrix[4][4];
+
+	// All the valid entries of the cache. Clears the active flags, SetActive() again after.
+	void Rebuild(const BoundsCache& cache);
+
+	// New data for one item, e.g. of the key at IndexOf()
+	void Update(uint32_t item, const BoundsEntry& entry);
+
+	// The items drawn with the active color, the previous ones are cleared
+	void SetActive(const std::unordered_set<BoundsKey>& active);
+
+	uint32_t IndexOf(BoundsKey key) const;
+
+	inline size_t Size() const { return _keys.size(); }
+	inline BoundsKey Key(uint32_t item) const { return _keys[item]; }
+	inline uint8_t Bits(uint32_t item) const { return _bits[item]; }
+	inline ShapeType Type(uint32_t item) const { return (ShapeType)(_bits[item] & kItemTypeMask); }
+	inline uint8_t Palette(uint32_t item) const { return _palette[item]; }
+	inline const Matrix& World(uint32_t item) const { return _world[item].m; }
+
+	// Meshes drawn as geometry in the mesh modes, hidden and intermediate shapes are not
+	inline bool IsDrawnMesh(uint32_t item) const
+	{
+		return (_bits[item] & (kItemTypeMask | kItemVisible)) == (kShapeMesh | kItemVisible);
+	}
+
+	// Meshes that may hide what is behind them: visible and not templated, templated
+	// objects are see-through wireframes
+	inline bool IsOccluder(uint32_t item) const
+	{
+		return (_bits[item] & (kItemTypeMask | kItemVisible | kItemTemplated)) == (kShapeMesh | kItemVisible);
+	}
+
+	// One lane per axis
+	inline const float* MinPt(int axis) const { return _minPt[axis].data(); }
+	inline const float* MaxPt(int axis) const { return _maxPt[axis].data(); }
+
+	// Gathers the object-space box of one item
+	inline void Bounds(uint32_t item, float minPt[3], float maxPt[3]) const
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			minPt[a] = _minPt[a][item];
+			maxPt[a] = _maxPt[a][item];
+		}
+	}
+
+	static const float* PaletteColor(uint8_t palette);
+
+	// Bytes of the arrays per item, without the key lookup table
+	static size_t ItemBytes();
+	size_t ByteSize() const;
+
+protected:
+	struct WorldMatrix
+	{
+		Matrix m;
+	};
+
+	static uint8_t PaletteOf(uint8_t bits);
+
+	std::vector<BoundsKey> _keys;
+	std::vector<uint8_t> _bits;
+	std::vector<uint8_t> _palette;
+	std::vector<float> _minPt[3];
+	std::vector<float> _maxPt[3];
+	std::vector<WorldMatrix> _world;
+
+	std::unordered_map<BoundsKey, uint32_t> _indexOfKey;
+	std::vector<uint32_t> _activeItems;
+};
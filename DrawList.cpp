@@ -0,0 +1,39 @@
+#include "DrawList.h"
+
+
+void DrawListBuilder::Build(ThreadPool& pool, const DrawItemStore& items, const uint32_t* visible, size_t visibleCount,
+	InstanceBufferBuilder& instances)
+{
+	size_t chunkCount = ThreadPool::ChunkCount(visibleCount, kGrain);
+	_offsets.resize(chunkCount + 1);
+
+	// Count, only the packed bits of the items are read
+	_offsets[0] = 0;
+	pool.ParallelFor(visibleCount, kGrain, [&](size_t chunk, size_t begin, size_t end)
+	{
+		size_t count = 0;
+		for (size_t i = begin; i < end; i++)
+			count += (items.Bits(visible[i]) & kItemVisible) != 0;
+		_offsets[chunk + 1] = count;
+	});
+
+	for (size_t c = 0; c < chunkCount; c++)
+		_offsets[c + 1] += _offsets[c];
+	instances.Resize(_offsets[chunkCount]);
+
+	// Write in chunk order
+	pool.ParallelFor(visibleCount, kGrain, [&](size_t chunk, size_t begin, size_t end)
+	{
+		size_t index = _offsets[chunk];
+		for (size_t i = begin; i < end; i++)
+		{
+			uint32_t item = visible[i];
+			if (!(items.Bits(item) & kItemVisible))
+				continue;
+
+			float minPt[3], maxPt[3];
+			items.Bounds(item, minPt, maxPt);
+			instances.Set(index++, minPt, maxPt, items.World(item), DrawItemStore::PaletteColor(items.Palette(item)));
+		}
+	});
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "DrawItemStore.h"
+#include "FrameArena.h"
+#include "InstanceBuffer.h"
+#include "ThreadPool.h"
+
+
+// Turns the visible items of the frame into bounds instances. The items are split in
+// chunks: a first parallel pass counts the drawn items of each chunk, a second one writes
+// them from the chunk's offset. The result is the same as a serial build whatever the
+// thread count or the stealing.
+class DrawListBuilder
+{
+public:
+	// Chunk size of the classification
+	static const size_t kGrain = 1024;
+
+	// visible holds item indices in draw order. instances must have been started with
+	// Begin(), Finish() it with the same pool to transform the instances in parallel.
+	void Build(ThreadPool& pool, const DrawItemStore& items, const uint32_t* visible, size_t visibleCount,
+		InstanceBufferBuilder& instances);
+
+protected:
+	// Kept from frame to frame so that it does not reallocate
+	std::vector<size_t> _offsets;
+};
+
+// Moves the items drawn as mesh geometry from visible to meshes, both in draw order: the
+// visible meshes cached(item) has a GPU copy of. cached may read and upload the mesh, it
+// is not called for hidden items, which stay in visible for Build() to drop.
+template<class Cached>
+void SplitMeshItems(const DrawItemStore& items, FrameArray<uint32_t>& visible, FrameArray<uint32_t>& meshes, Cached cached)
+{
+	size_t kept = 0;
+	for (uint32_t item : visible)
+	{
+		if (items.IsDrawnMesh(item) && cached(item))
+			meshes.Push(item);
+		else
+			visible[kept++] = item;
+	}
+	visible.Resize(kept);
+}
@@ -0,0 +1,150 @@
+#include "DxCommandBackend.h"
+
+
+template<class T>
+static void Assign(std::vector<T>& table, ResourceId id, const T& value)
+{
+	if (table.size() <= id)
+		table.resize(id + 1);
+	table[id] = value;
+}
+
+template<class T>
+static const T* Lookup(const std::vector<T>& table, ResourceId id)
+{
+	return (id != 0 && id < table.size()) ? &table[id] : nullptr;
+}
+
+DxCommandBackend::DxCommandBackend(ID3D11DeviceContext* context, DxStateCache* states)
+{
+	_context = context;
+	_states = states;
+
+	if (FAILED(_context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&_context1)))
+		_context1 = nullptr;
+}
+
+DxCommandBackend::~DxCommandBackend()
+{
+	if (_context1)
+	{
+		_context1->Release();
+		_context1 = nullptr;
+	}
+	_context = nullptr;
+	_states = nullptr;
+}
+
+void DxCommandBackend::SetPipeline(ResourceId id, const DxPipeline& pipeline)
+{
+	Assign(_pipelines, id, pipeline);
+}
+
+void DxCommandBackend::SetStates(ResourceId id, const DxStateBlock& states)
+{
+	Assign(_stateBlocks, id, states);
+}
+
+void DxCommandBackend::SetBuffer(ResourceId id, ID3D11Buffer* buffer)
+{
+	Assign(_buffers, id, buffer);
+}
+
+void DxCommandBackend::SetTexture(ResourceId id, ID3D11ShaderResourceView* texture)
+{
+	Assign(_textures, id, texture);
+}
+
+ID3D11Buffer* DxCommandBackend::FindBuffer(ResourceId id) const
+{
+	ID3D11Buffer* const* buffer = Lookup(_buffers, id);
+	return buffer ? *buffer : nullptr;
+}
+
+void DxCommandBackend::BindPipeline(const CmdBindPipeline& cmd)
+{
+	const DxPipeline* pipeline = Lookup(_pipelines, cmd.pipeline);
+	if (!pipeline)
+		return;
+
+	_context->IASetPrimitiveTopology(pipeline->topology);
+	_context->IASetInputLayout(pipeline->inputLayout);
+	_context->VSSetShader(pipeline->vertexShader, NULL, 0);
+	_context->PSSetShader(pipeline->pixelShader, NULL, 0);
+}
+
+void DxCommandBackend::BindStates(const CmdBindStates& cmd)
+{
+	const DxStateBlock* block = Lookup(_stateBlocks, cmd.states);
+	if (!block)
+		return;
+
+	if (block->rasterizer)
+		_states->Bind(_context, block->rasterizer);
+	if (block->blend)
+		_states->Bind(_context, block->blend);
+	if (block->depthStencil)
+		_states->Bind(_context, block->depthStencil);
+	if (block->sampler)
+		_states->Bind(_context, 0, block->sampler);
+}
+
+void DxCommandBackend::SetVertexBuffer(const CmdSetVertexBuffer& cmd)
+{
+	ID3D11Buffer* buffer = FindBuffer(cmd.buffer);
+	UINT stride = cmd.stride;
+	UINT offset = cmd.offset;
+	_context->IASetVertexBuffers(cmd.slot, 1, &buffer, &stride, &offset);
+}
+
+void DxCommandBackend::SetIndexBuffer(const CmdSetIndexBuffer& cmd)
+{
+	DXGI_FORMAT format = cmd.indexSize == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+	_context->IASetIndexBuffer(FindBuffer(cmd.buffer), format, cmd.offset);
+}
+
+void DxCommandBackend::SetConstants(const CmdSetConstants& cmd)
+{
+	ID3D11Buffer* buffer = FindBuffer(cmd.buffer);
+
+	// Whole-buffer binding needs no 11.1 context
+	if (cmd.offset == 0 && !_context1)
+	{
+		if (cmd.stages & kStageVertex)
+			_context->VSSetConstantBuffers(cmd.slot, 1, &buffer);
+		if (cmd.stages & kStagePixel)
+			_context->PSSetConstantBuffers(cmd.slot, 1, &buffer);
+		return;
+	}
+	if (!_context1)
+		return;
+
+	// Offsets and sizes are in 16-byte constants and multiples of 16 constants
+	UINT firstConstant = cmd.offset / 16;
+	UINT numConstants = ((cmd.size + 255) / 256) * 16;
+
+	if (cmd.stages & kStageVertex)
+		_context1->VSSetConstantBuffers1(cmd.slot, 1, &buffer, &firstConstant, &numConstants);
+	if (cmd.stages & kStagePixel)
+		_context1->PSSetConstantBuffers1(cmd.slot, 1, &buffer, &firstConstant, &numConstants);
+}
+
+void DxCommandBackend::DrawIndexedInstanced(const CmdDrawIndexedInstanced& cmd)
+{
+	_context->DrawIndexedInstanced(cmd.indexCount, cmd.instanceCount, cmd.startIndex, cmd.baseVertex, cmd.startInstance);
+}
+
+void DxCommandBackend::SetTexture(const CmdSetTexture& cmd)
+{
+	ID3D11ShaderResourceView* const* found = Lookup(_textures, cmd.texture);
+	ID3D11ShaderResourceView* texture = found ? *found : nullptr;
+	if (cmd.stages & kStageVertex)
+		_context->VSSetShaderResources(cmd.slot, 1, &texture);
+	if (cmd.stages & kStagePixel)
+		_context->PSSetShaderResources(cmd.slot, 1, &texture);
+}
+
+void DxCommandBackend::Draw(const CmdDraw& cmd)
+{
+	_context->Draw(cmd.vertexCount, cmd.startVertex);
+}
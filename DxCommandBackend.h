@@ -0,0 +1,67 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11_1.h>
+
+#include <vector>
+
+#include "DrawCommands.h"
+#include "DxStateCache.h"
+
+
+struct DxPipeline
+{
+	ID3D11VertexShader* vertexShader = nullptr;
+	ID3D11PixelShader* pixelShader = nullptr;
+	ID3D11InputLayout* inputLayout = nullptr;
+	D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+};
+
+struct DxStateBlock
+{
+	DxStateCache::RasterizerState rasterizer;
+	DxStateCache::BlendState blend;
+	DxStateCache::DepthStencilState depthStencil;
+	DxStateCache::SamplerState sampler;		// pixel shader slot 0, optional
+};
+
+
+// Replays a CommandBuffer on a D3D11 context. Ids are indices into tables filled with
+// the Set* calls, an entry can be replaced between replays (e.g. a ring buffer that grew).
+// The objects are not owned.
+class DxCommandBackend : public CommandBackend
+{
+public:
+	DxCommandBackend(ID3D11DeviceContext* context, DxStateCache* states);
+	~DxCommandBackend();
+
+	void SetPipeline(ResourceId id, const DxPipeline& pipeline);
+	void SetStates(ResourceId id, const DxStateBlock& states);
+	void SetBuffer(ResourceId id, ID3D11Buffer* buffer);
+	void SetTexture(ResourceId id, ID3D11ShaderResourceView* texture);
+
+	// Constants at an offset of a buffer need D3D 11.1
+	inline bool SupportsConstantOffsets() const { return _context1 != nullptr; }
+
+	void BindPipeline(const CmdBindPipeline& cmd) override;
+	void BindStates(const CmdBindStates& cmd) override;
+	void SetVertexBuffer(const CmdSetVertexBuffer& cmd) override;
+	void SetIndexBuffer(const CmdSetIndexBuffer& cmd) override;
+	void SetConstants(const CmdSetConstants& cmd) override;
+	void DrawIndexedInstanced(const CmdDrawIndexedInstanced& cmd) override;
+	void SetTexture(const CmdSetTexture& cmd) override;
+	void Draw(const CmdDraw& cmd) override;
+
+protected:
+	ID3D11Buffer* FindBuffer(ResourceId id) const;
+
+	ID3D11DeviceContext* _context = nullptr;
+	ID3D11DeviceContext1* _context1 = nullptr;	// null before D3D 11.1, no offset constants
+	DxStateCache* _states = nullptr;
+
+	std::vector<DxPipeline> _pipelines;
+	std::vector<DxStateBlock> _stateBlocks;
+	std::vector<ID3D11Buffer*> _buffers;
+	std::vector<ID3D11ShaderResourceView*> _textures;
+};
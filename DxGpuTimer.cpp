@@ -0,0 +1,122 @@
+#include "DxGpuTimer.h"
+
+
+#define SafeRelease(p) if((p)){(p)->Release(); (p)=NULL;}
+
+
+DxGpuTimer::DxGpuTimer(ID3D11Device* device, FrameStats* stats)
+{
+	_stats = stats;
+
+	D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+
+	_valid = true;
+	for (Frame& frame : _frames)
+	{
+		_valid &= SUCCEEDED(device->CreateQuery(&disjointDesc, &frame.disjoint));
+		for (ID3D11Query*& query : frame.timestamps)
+			_valid &= SUCCEEDED(device->CreateQuery(&timestampDesc, &query));
+	}
+}
+
+DxGpuTimer::~DxGpuTimer()
+{
+	for (Frame& frame : _frames)
+	{
+		SafeRelease(frame.disjoint);
+		for (ID3D11Query*& query : frame.timestamps)
+			SafeRelease(query);
+	}
+	_stats = nullptr;
+}
+
+void DxGpuTimer::BeginFrame(ID3D11DeviceContext* context)
+{
+	if (!_valid || _inFrame)
+		return;
+
+	Collect(context);
+
+	Frame& frame = _frames[_frame % kFrameLatency];
+	if (frame.pending)
+	{
+		// The GPU is more than kFrameLatency frames behind, reuse the queries anyway
+		frame.pending = false;
+		_dropped++;
+	}
+
+	frame.scopeCount = 0;
+	context->Begin(frame.disjoint);
+	_inFrame = true;
+}
+
+void DxGpuTimer::EndFrame(ID3D11DeviceContext* context)
+{
+	if (!_inFrame)
+		return;
+
+	Frame& frame = _frames[_frame % kFrameLatency];
+	context->End(frame.disjoint);
+	frame.pending = true;
+
+	_inFrame = false;
+	_frame++;
+}
+
+int DxGpuTimer::Begin(ID3D11DeviceContext* context, int stage)
+{
+	Frame& frame = _frames[_frame % kFrameLatency];
+	if (!_inFrame || frame.scopeCount == kMaxScopes)
+		return -1;
+
+	int scope = frame.scopeCount++;
+	frame.stages[scope] = stage;
+	frame.ended[scope] = false;
+	context->End(frame.timestamps[scope * 2]);
+	return scope;
+}
+
+void DxGpuTimer::End(ID3D11DeviceContext* context, int scope)
+{
+	Frame& frame = _frames[_frame % kFrameLatency];
+	if (!_inFrame || scope < 0 || scope >= frame.scopeCount)
+		return;
+
+	context->End(frame.timestamps[scope * 2 + 1]);
+	frame.ended[scope] = true;
+}
+
+void DxGpuTimer::Collect(ID3D11DeviceContext* context)
+{
+	for (uint64_t age = kFrameLatency; age > 0; age--)
+	{
+		if (_frame < age)
+			continue;
+
+		Frame& frame = _frames[(_frame - age) % kFrameLatency];
+		if (!frame.pending)
+			continue;
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if (context->GetData(frame.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return;		// the newer frames are not ready either
+		frame.pending = false;
+
+		// The clock changed frequency during the frame, the timestamps are unusable
+		if (disjoint.Disjoint || disjoint.Frequency == 0)
+			continue;
+
+		for (int scope = 0; scope < frame.scopeCount; scope++)
+		{
+			UINT64 begin = 0, end = 0;
+			if (!frame.ended[scope] ||
+				context->GetData(frame.timestamps[scope * 2], &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+				context->GetData(frame.timestamps[scope * 2 + 1], &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				continue;
+
+			if (_stats && end >= begin)
+				_stats->Record(frame.stages[scope], (double)(end - begin) * 1000.0 / (double)disjoint.Frequency);
+		}
+	}
+}
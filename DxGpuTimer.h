@@ -0,0 +1,54 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11.h>
+
+#include <cstdint>
+
+#include "FrameStats.h"
+
+
+// GPU time of frame stages from D3D11 timestamp queries. The results are read back
+// kFrameLatency frames later without flushing or waiting; a frame whose queries are
+// still pending when its slot comes around again is dropped instead of stalling.
+class DxGpuTimer
+{
+public:
+	static const int kFrameLatency = 4;
+	static const int kMaxScopes = 32;
+
+	DxGpuTimer(ID3D11Device* device, FrameStats* stats);
+	~DxGpuTimer();
+
+	void BeginFrame(ID3D11DeviceContext* context);
+	void EndFrame(ID3D11DeviceContext* context);
+
+	// Time the GPU work submitted between Begin() and End() into a stage of the stats.
+	// Returns the scope to pass to End(), -1 when out of scopes or outside of a frame.
+	int Begin(ID3D11DeviceContext* context, int stage);
+	void End(ID3D11DeviceContext* context, int scope);
+
+	inline uint64_t DroppedFrames() const { return _dropped; }
+
+protected:
+	struct Frame
+	{
+		ID3D11Query* disjoint = nullptr;
+		ID3D11Query* timestamps[kMaxScopes * 2] = {};
+		int stages[kMaxScopes] = {};
+		bool ended[kMaxScopes] = {};
+		int scopeCount = 0;
+		bool pending = false;
+	};
+
+	// Read back the finished frames, oldest first
+	void Collect(ID3D11DeviceContext* context);
+
+	FrameStats* _stats = nullptr;
+	Frame _frames[kFrameLatency];
+	bool _valid = false;
+	bool _inFrame = false;
+	uint64_t _frame = 0;
+	uint64_t _dropped = 0;
+};
@@ -3,130 +3,215 @@
 #include "DxManager.h"
 
 #include <DirectXMath.h>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 
 #include <maya/MViewport2Renderer.h>
 #include <maya/MGlobal.h>
 #include <maya/MRenderTargetManager.h>
 #include <maya/MDrawContext.h>
-#include <maya/MDrawTraversal.h>
 #include <maya/M3dView.h>
-#include <maya/MFnDagNode.h>
 
+#include "DxGpuTimer.h"
+#include "DxOverlayLayer.h"
+#include "DxPipelineCache.h"
+#include "DxResources.h"
 #include "GarlandRender.h"
+#include "SceneBounds.h"
 
-// These two files are generated by project "ShaderCompile"
-#include "build/shaders/unlit_vs.h"
-#include "build/shaders/unlit_ps.h"
-
-
-#define SafeRelease(p) if((p)){(p)->Release(); (p)=NULL;}
+// Generated by project "ShaderCompile", every permutation of the overlay shaders
+#include "GarlandShaderTable.h"
 
 
 using vec3 = DirectX::XMFLOAT3;
-using vec4 = DirectX::XMFLOAT4;
-using mat4 = DirectX::XMFLOAT4X4;
 
 struct VSInputData
 {
 	vec3 position;
 };
 
-struct VSConstantBuffer
+// Ids of the resources referenced by the overlay command stream
+enum OverlayResource : ResourceId
 {
-	mat4 WVP;
+	kResCubeVertices = 1,
+	kResCubeIndices,
+	kResInstances,
+	kResBoundsPipeline,
+	kResOverlayStates,
+	kResMeshPipeline,
+	kResObjectConstants,
+	kResCompositePipeline,
+	kResCompositeStates,
+	kResLayerTexture,
+	kResFirstMesh,		// two per mesh drawn in the frame, vertices then indices
 };
 
-struct PSConstantBuffer
-{
-	vec4 diffuseMaterial;
-};
+// The bounds are instanced lines in their status color
+static const uint32_t kBoundsVariant = kVariantInstanced;
 
+// The cube's index buffer holds the lines then the triangles
+static const UINT kCubeLineIndices = 24;
+static const UINT kCubeTriangleIndices = 36;
 
-class MSurfaceDrawTraversal : public MDrawTraversal
-{
-	virtual bool filterNode(const MDagPath& traversalItem)
-	{
-		bool prune = false;
-
-		// Check to only prune shapes, not transforms.
-		if (traversalItem.childCount() == 0)
-		{
-			if (!traversalItem.hasFn(MFn::kMesh) &&
-				!traversalItem.hasFn(MFn::kNurbsSurface) &&
-				!traversalItem.hasFn(MFn::kSubdiv)
-				)
-			{
-				prune = true;
-			}
-		}
-		return prune;
-	}
-};
+// Occluders are the largest meshes covering at least this fraction of the panel height.
+// Bigger meshes are rasterized from their first simplified level.
+static const size_t kMaxOccluders = 8;
+static const double kMinOccluderSize = 0.1;
+static const unsigned int kMaxOccluderTriangles = 20000;
 
 
 DxManager::DxManager(GarlandRenderOverride* gr)
 {
 	_gr = gr;
+	_resources = &_gr->Resources();
+	_sceneBounds = new SceneBounds;
+	_pool = new ThreadPool;
 
 	MHWRender::MRenderer* theRenderer = MHWRender::MRenderer::theRenderer();
 
 	_device = (ID3D11Device*)theRenderer->GPUDeviceHandle();
 	_device->GetImmediateContext(&_deviceContext);
+	_states = new DxStateCache(_device);
+	_backend = new DxCommandBackend(_deviceContext, _states);
+
+	FrameStats& stats = _gr->Stats();
+	_gpuTimer = new DxGpuTimer(_device, &stats);
+	_stageUpdate = stats.Stage("cpu.CustomScene.update");
+	_stageCull = stats.Stage("cpu.CustomScene.cull");
+	_stageClassify = stats.Stage("cpu.CustomScene.classify");
+	_stageTransform = stats.Stage("cpu.CustomScene.transform");
+	_stageSubmit = stats.Stage("cpu.CustomScene.submit");
+	_gpuStageSubmit = stats.Stage("gpu.CustomScene.submit");
+	_stageMeshes = stats.Stage("cpu.CustomScene.meshes");
+	_meshCountCounter = stats.Counter("mesh.count");
+	_meshDrawnCounter = stats.Counter("mesh.drawn");
+	_meshQueuedCounter = stats.Counter("mesh.queued");
+	_meshPendingCounter = stats.Counter("mesh.pendingMB");
+	_meshUploadedCounter = stats.Counter("mesh.uploadedMB");
+	_meshTrianglesCounter = stats.Counter("mesh.triangles");
+	_meshLodPendingCounter = stats.Counter("mesh.lodPending");
+	_stageOcclusion = stats.Stage("cpu.CustomScene.occlusion");
+	_occludersCounter = stats.Counter("occlusion.occluders");
+	_occluderTrianglesCounter = stats.Counter("occlusion.triangles");
+	_occludedCounter = stats.Counter("occlusion.occluded");
+	_occlusionVisibleCounter = stats.Counter("occlusion.visible");
+	_layerHitCounter = stats.Counter("overlay.cacheHit");
+	_layerHitRateCounter = stats.Counter("overlay.hitRate");
+	_layerBytesCounter = stats.Counter("overlay.layerMB");
+	_resolutionScaleCounter = stats.Counter("overlay.resolutionScale");
+	_itemBytesCounter = stats.Counter("scene.itemsMB");
+	_arenaBytesCounter = stats.Counter("frame.arenaKB");
+	_sceneEventsCounter = stats.Counter("scene.events");
+	_sceneDroppedCounter = stats.Counter("scene.eventsDropped");
+	_stateHitsCounter = stats.Counter("states.hits");
+	_stateMissesCounter = stats.Counter("states.misses");
 
 	_mainRenderTargetView = (ID3D11RenderTargetView*)_gr->grColorRT()->resourceHandle();
 	_mainDepthStencilView = (ID3D11DepthStencilView*)_gr->grDepthRT()->resourceHandle();
 
-	size_t vsByteSize = sizeof(unlit_vs) / sizeof(unlit_vs[0]);
-	size_t psByteSize = sizeof(unlit_ps) / sizeof(unlit_ps[0]);
-
-	D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	int numLayoutElements = sizeof layout / sizeof layout[0];
-
-	bool result = InitializeShadersFromByteData(unlit_vs, vsByteSize, unlit_ps, psByteSize, layout, numLayoutElements);
-	if (!result)
+	_pipelines = new DxPipelineCache(_device, garland_shader_table, sizeof(garland_shader_table), _resources);
+	if (!_pipelines->Valid())
 	{
+		MGlobal::displayError("Garland: the shader table is invalid");
 		return;
 	}
 
-	result = CreateBuffers();
+	bool result = CreateBuffers();
 	if (!result)
 	{
 		return;
 	}
+
+	_backend->SetBuffer(kResCubeVertices, _vertexBuffer);
+	_backend->SetBuffer(kResCubeIndices, _indexBuffer);
+
+	// Over a budget the layers go first, a mesh costs a read from Maya and an upload
+	_resources->AddEvictor(kMemoryGpu, this);
+	_resources->AddEvictor(kMemoryGpu, _meshes);
+	_resources->AddEvictor(kMemoryCpu, _meshes);
+
+	// Shader creation is the slow part, keep it off Maya's thread
+	_pipelineThread = std::thread(&DxManager::CreatePipelines, this);
 }
 
 DxManager::~DxManager()
 {
-	if (_dxRasterState)
+	if (_pipelineThread.joinable())
 	{
-		if (!_mRasterState)
-			_dxRasterState->Release();
-		else
-			MHWRender::MStateManager::releaseRasterizerState(_mRasterState);
-		_dxRasterState = nullptr;
-		_mRasterState = nullptr;
+		_pipelineThread.join();
+	}
+
+	_resources->RemoveEvictor(this);
+	_resources->RemoveEvictor(_meshes);
+	_resources->Untrack(_itemsHandle);
+	_resources->Untrack(_arenaHandle);
+
+	if (_gpuTimer)
+	{
+		delete _gpuTimer;
+		_gpuTimer = nullptr;
+	}
+
+	if (_backend)
+	{
+		delete _backend;
+		_backend = nullptr;
+	}
+
+	if (_pipelines)
+	{
+		delete _pipelines;
+		_pipelines = nullptr;
+	}
+
+	if (_meshes)
+	{
+		delete _meshes;
+		_meshes = nullptr;
 	}
-	if (_dxSamplerState)
+
+	// The panels' overlay layers
+	_views.clear();
+	if (_tileTarget)
 	{
-		if (!_mSamplerState)
-			_dxSamplerState->Release();
-		_dxSamplerState = nullptr;
+		delete _tileTarget;
+		_tileTarget = nullptr;
 	}
-	if (_mSamplerState)
+
+	if (_states)
+	{
+		delete _states;
+		_states = nullptr;
+	}
+
+	ReleaseTracked(_resources, _vertexBuffer, _vertexBufferHandle);
+	ReleaseTracked(_resources, _indexBuffer, _indexBufferHandle);
+	if (_instanceRing)
+	{
+		delete _instanceRing;
+		_instanceRing = nullptr;
+	}
+	if (_constantRing)
+	{
+		delete _constantRing;
+		_constantRing = nullptr;
+	}
+
+	if (_sceneBounds)
 	{
-		MHWRender::MStateManager::releaseSamplerState(_mSamplerState);
-		_mSamplerState = nullptr;
+		delete _sceneBounds;
+		_sceneBounds = nullptr;
 	}
 
-	SafeRelease(_vertexBuffer);
-	SafeRelease(_indexBuffer);
-	SafeRelease(_vertexConstantBuffer);
-	SafeRelease(_pixelConstantBuffer);
+	if (_pool)
+	{
+		delete _pool;
+		_pool = nullptr;
+	}
 
 	_gr = nullptr;
+	_resources = nullptr;
 	_device = nullptr;
 	_deviceContext = nullptr;
 	_mainRenderTargetView = nullptr;
@@ -174,20 +259,6 @@ void DxManager::debug(const MHWRender::MDrawContext& drawContext)
 	MMatrix projection =
 		drawContext.getMatrix(MHWRender::MFrameContext::kProjectionMtx);
 
-	mat4 currentViewMatrix = mat4(
-		(float)view.matrix[0][0], (float)view.matrix[0][1], (float)view.matrix[0][2], (float)view.matrix[0][3],
-		(float)view.matrix[1][0], (float)view.matrix[1][1], (float)view.matrix[1][2], (float)view.matrix[1][3],
-		(float)view.matrix[2][0], (float)view.matrix[2][1], (float)view.matrix[2][2], (float)view.matrix[2][3],
-		(float)view.matrix[3][0], (float)view.matrix[3][1], (float)view.matrix[3][2], (float)view.matrix[3][3]
-	);
-
-	mat4 currentProjectionMatrix = mat4(
-		(float)projection.matrix[0][0], (float)projection.matrix[0][1], (float)projection.matrix[0][2], (float)projection.matrix[0][3],
-		(float)projection.matrix[1][0], (float)projection.matrix[1][1], (float)projection.matrix[1][2], (float)projection.matrix[1][3],
-		(float)projection.matrix[2][0], (float)projection.matrix[2][1], (float)projection.matrix[2][2], (float)projection.matrix[2][3],
-		(float)projection.matrix[3][0], (float)projection.matrix[3][1], (float)projection.matrix[3][2], (float)projection.matrix[3][3]
-	);
-
 	// Update state objects
 	UpdateStates(drawContext);
 
@@ -208,217 +279,591 @@ void DxManager::debug(const MHWRender::MDrawContext& drawContext)
 	if (!cameraPath.isValid())
 		return;
 
-	MDrawTraversal* trav = NULL;
-	trav = new MSurfaceDrawTraversal;
+	if (!_vertexBuffer || !_indexBuffer || !_instanceRing)
+		return;
 
-	if (!trav)
+	// Only the plain scene until the pipelines are ready
+	if (!FinishPipelines())
 		return;
 
-	int width, height;
-	drawContext.getRenderTargetSize(width, height);
+	FrameStats* stats = &_gr->Stats();
 
-	trav->enableFiltering(true);
-	trav->setFrustum(cameraPath, width, height);
+	// Camera independent, done by the first panel drawn after a change
+	{
+		ScopedStageTimer timer(stats, _stageUpdate);
+		UpdateScene();
+	}
 
-	if (!trav->frustumValid())
+	PanelView& panel = View(mPanelName);
+	_meshes->SetFrame(_frame);
+	_meshes->SetKeepFrames(_views.size());
+	const OverlaySettings& overlay = _gr->Overlay();
+
+	// A tiled batch frame draws the panel's overlay again for the image, tile by tile
+	RenderTiles(drawContext, panel, view, projection, overlay);
+
+	// The layer covers the viewport, scaled down while the camera moves
+	int viewportX, viewportY, viewportW, viewportH;
+	drawContext.getViewportDimensions(viewportX, viewportY, viewportW, viewportH);
+	double scale = UpdateResolution(panel, view * projection, overlay);
+	int layerW = std::max(1, (int)(viewportW * scale + 0.5));
+	int layerH = std::max(1, (int)(viewportH * scale + 0.5));
+
+	// Nothing the overlay depends on changed since the panel's layer was drawn, for example
+	// a refresh of the HUD or of another panel: only composite the layer
+	OverlaySignature signature = Signature(view, projection, layerW, layerH, overlay);
+	bool layered = PrepareLayer(panel, layerW, layerH);
+	bool cacheHit = layered && panel.layer->Cache().Matches(signature);
+	_layerHits.Add(cacheHit);
+	stats->SetCounter(_layerHitCounter, cacheHit ? 1.0 : 0.0);
+	stats->SetCounter(_layerHitRateCounter, 100.0 * _layerHits.Rate());
+	// A reduced image stays on screen until the next refresh, ask for one so that the full
+	// resolution is drawn once the camera settles
+	if (scale < 1.0 && drawingInteractive)
+		mView.scheduleRefresh();
+
+	if (cacheHit)
 	{
-		delete trav;
-		trav = NULL;
+		CompositeLayer(panel);
 		return;
 	}
-	trav->traverse();
 
-	unsigned int numItems = trav->numberOfItems();
-	for (unsigned int i = 0; i < numItems; i++)
+	if (layered)
+		panel.layer->Begin(_deviceContext);
+
+	size_t readBudget = DrawOverlay(drawContext, panel, view, projection, targetH, overlay);
+
+	const UploadScheduler& uploads = _meshes->Scheduler();
+	if (layered)
 	{
-		MDagPath path;
-		trav->itemPath(i, path);
+		// Kept only when the next frames would draw the same: no mesh data in flight and no
+		// read put off by the budget
+		bool settled = readBudget > 0 && uploads.QueuedCount() == 0 && _meshes->LodPending() == 0;
+		panel.layer->End(_deviceContext);
+		panel.layer->Cache().Update(signature, settled);
+		CompositeLayer(panel);
+	}
+
+	stats->SetCounter(_meshCountCounter, (double)_meshes->MeshCount());
+	stats->SetCounter(_meshDrawnCounter, (double)panel.meshes.Count());
+	stats->SetCounter(_meshQueuedCounter, (double)uploads.QueuedCount());
+	stats->SetCounter(_meshPendingCounter, uploads.PendingBytes() / (1024.0 * 1024.0));
+	stats->SetCounter(_meshUploadedCounter, uploads.UploadedBytes() / (1024.0 * 1024.0));
+	stats->SetCounter(_meshTrianglesCounter, (double)_meshTriangles);
+	stats->SetCounter(_meshLodPendingCounter, (double)_meshes->LodPending());
+	stats->SetCounter(_itemBytesCounter, _items.ByteSize() / (1024.0 * 1024.0));
+	stats->SetCounter(_arenaBytesCounter, _frameArena.Used() / 1024.0);
+}
 
-		if (path.isValid())
+size_t DxManager::DrawOverlay(const MHWRender::MDrawContext& drawContext, PanelView& panel, const MMatrix& view, const MMatrix& projection, int targetHeight, const OverlaySettings& overlay)
+{
+	FrameStats* stats = &_gr->Stats();
+
+	// The arrays of the previous panel are not needed anymore
+	_frameArena.Reset();
+	{
+		ScopedStageTimer timer(stats, _stageCull);
+
+		float viewProjection[4][4];
+		ComputeViewProjection(view.matrix, projection.matrix, viewProjection);
+
+		panel.visible = _frameArena.Array<uint32_t>(_items.Size());
+		_culling.Cull(Frustum::FromViewProjection(viewProjection), panel.visible);
+		panel.meshes = _frameArena.Array<uint32_t>(panel.visible.Count());
+	}
+
+	// The occluders and the drawn meshes share the read budget
+	size_t uploadBudget = (size_t)(overlay.uploadBudgetMB * 1024.0 * 1024.0);
+	size_t readBudget = uploadBudget;
+	if (overlay.occlusion)
+	{
+		ScopedStageTimer timer(stats, _stageOcclusion);
+		CullOccluded(panel, view * projection, projection(1, 1), targetHeight, readBudget);
+	}
+
+	// Meshes with a complete GPU copy are drawn as geometry, the rest as bounds
+	if (overlay.mode != kOverlayBounds && _backend->SupportsConstantOffsets())
+	{
+		ScopedStageTimer timer(stats, _stageMeshes);
+		SelectMeshes(panel, readBudget);
+	}
+
+	// Classify and transform the visible objects in parallel
+	{
+		ScopedStageTimer timer(stats, _stageClassify);
+		panel.instances.Begin(view.matrix, projection.matrix);
+		_drawList.Build(*_pool, _items, panel.visible.Data(), panel.visible.Count(), panel.instances);
+	}
+	{
+		ScopedStageTimer timer(stats, _stageTransform);
+		panel.instances.Finish(BestTransformKernel(), _pool);
+	}
+
+	{
+		ScopedStageTimer timer(stats, _stageSubmit);
+		int gpuScope = _gpuTimer->Begin(_deviceContext, _gpuStageSubmit);
+		_meshes->Upload(_deviceContext, uploadBudget);
+		DrawBoundsInstances(drawContext, panel);
+		DrawMeshes(panel, view * projection, projection(1, 1), targetHeight, overlay.mode);
+		_gpuTimer->End(_deviceContext, gpuScope);
+	}
+
+	_resources->Set(_arenaHandle, kResourceFrameArena, _frameArena.Capacity());
+	return readBudget;
+}
+
+void DxManager::RenderTiles(const MHWRender::MDrawContext& drawContext, PanelView& panel, const MMatrix& view, const MMatrix& projection, const OverlaySettings& overlay)
+{
+	const TileGrid* grid = _gr->BeginBatchTiles();
+	if (!grid)
+		return;
+
+	if (!_tileTarget)
+		_tileTarget = new DxOverlayLayer(_device, _resources);
+	if (!_tileTarget->Resize(grid->TileSize(), grid->TileSize()))
+		return;
+
+	// The panel's camera fitted to the image, with the vertical field of view kept
+	int viewportX, viewportY, viewportW, viewportH;
+	drawContext.getViewportDimensions(viewportX, viewportY, viewportW, viewportH);
+	MMatrix imageProjection = projection;
+	if (viewportW > 0 && viewportH > 0)
+	{
+		double aspect = ((double)viewportW / viewportH) * ((double)grid->Height() / grid->Width());
+		for (int r = 0; r < 4; r++)
+			imageProjection(r, 0) *= aspect;
+	}
+
+	// Each tile is culled and drawn with its own sub-frustum into the same small target,
+	// then copied for the readback before the next one clears it
+	for (size_t i = 0; i < grid->Count(); i++)
+	{
+		Tile tile = grid->At(i);
+		MMatrix tileProjection;
+		grid->Projection(imageProjection.matrix, tile, tileProjection.matrix);
+
+		_tileTarget->Begin(_deviceContext);
+		DrawOverlay(drawContext, panel, view, tileProjection, (int)grid->TileSize(), overlay);
+		_tileTarget->End(_deviceContext);
+		_gr->CaptureBatchTile(tile, _tileTarget->RenderTarget());
+	}
+}
+
+void DxManager::CreatePipelines()
+{
+	FrameStats::Clock::time_point start = FrameStats::Clock::now();
+
+	// Only the device is used here, its creation methods are free threaded
+	_pipelines->Get(kBoundsVariant);
+	_pipelines->Composite();
+
+	_pipelineMs = FrameStats::Milliseconds(start, FrameStats::Clock::now());
+	_pipelinesReady.store(true, std::memory_order_release);
+}
+
+bool DxManager::FinishPipelines()
+{
+	if (!Ready())
+		return false;
+
+	if (_pipelineThread.joinable())
+	{
+		_pipelineThread.join();
+		if (!_pipelines->Get(kBoundsVariant))
 		{
-			bool performBoundsDraw = false;
+			MGlobal::displayError("Garland: failed to create the overlay pipeline");
+			_pipelinesFailed = true;
+		}
+	}
+	return !_pipelinesFailed;
+}
 
-			// Draw surfaces (polys, nurbs, subdivs)
-			bool active = false;
-			bool templated = false;
-			float boundsColor[3] = { 1.0f, 1.0f, 1.0f };
+void DxManager::DrainSceneChanges()
+{
+	size_t events = _sceneBounds->DrainChanges();
+	_gr->Stats().SetCounter(_sceneEventsCounter, (double)events);
+	_gr->Stats().SetCounter(_sceneDroppedCounter, (double)_sceneBounds->DroppedChanges());
+}
 
-			if (path.hasFn(MFn::kMesh) ||
-				path.hasFn(MFn::kNurbsSurface) ||
-				path.hasFn(MFn::kSubdiv))
-			{
-				performBoundsDraw = true;
-				if (trav->itemHasStatus(i, MDrawTraversal::kActiveItem))
-				{
-					active = true;
-				}
-				else if (trav->itemHasStatus(i, MDrawTraversal::kTemplateItem))
-				{
-					boundsColor[0] = 0.2f;
-					boundsColor[1] = 0.2f;
-					boundsColor[2] = 0.2f;
-					templated = true;
-				}
-				else
-				{
-					if (path.hasFn(MFn::kMesh))
-					{
-						boundsColor[0] = 0.286f;
-						boundsColor[1] = 0.706f;
-						boundsColor[2] = 1.0f;
-					}
-					else if (path.hasFn(MFn::kNurbsSurface))
-					{
-						boundsColor[0] = 0.486f;
-						boundsColor[1] = 0.306f;
-						boundsColor[2] = 1.0f;
-					}
-					else
-					{
-						boundsColor[0] = 0.886f;
-						boundsColor[1] = 0.206f;
-						boundsColor[2] = 1.0f;
-					}
-				}
-			}
+size_t DxManager::Evict(ResourceMemory memory, size_t bytes)
+{
+	if (memory != kMemoryGpu)
+		return 0;
 
-			// Draw bounds
-			if (performBoundsDraw)
-			{
-				MFnDagNode dagNode(path);
-				MBoundingBox box = dagNode.boundingBox();
-				
-				if (!_vertexBuffer || !_indexBuffer || !_vertexConstantBuffer || !_pixelConstantBuffer)
-				{
-					return;
-				}
-
-				bool useDrawContextToSetState = true;
-				MStatus status = MStatus::kFailure;
-
-				if (useDrawContextToSetState)
-				{
-					MHWRender::MStateManager* stateManager = drawContext.getStateManager();
-					if (stateManager)
-					{
-						status = stateManager->setRasterizerState(_mRasterState);
-					}
-				}
-				if (status != MStatus::kSuccess)
-				{
-					_deviceContext->RSSetState(_dxRasterState);
-				}
-
-				MMatrix  matrix = path.inclusiveMatrix();
-
-				// Transform from object to world space
-				mat4 mat = mat4
-				(
-					(float)matrix.matrix[0][0], (float)matrix.matrix[0][1], (float)matrix.matrix[0][2], (float)matrix.matrix[0][3],
-					(float)matrix.matrix[1][0], (float)matrix.matrix[1][1], (float)matrix.matrix[1][2], (float)matrix.matrix[1][3],
-					(float)matrix.matrix[2][0], (float)matrix.matrix[2][1], (float)matrix.matrix[2][2], (float)matrix.matrix[2][3],
-					(float)matrix.matrix[3][0], (float)matrix.matrix[3][1], (float)matrix.matrix[3][2], (float)matrix.matrix[3][3]
-				);
-
-				// Adjust the unit cube to the bounds
-				MPoint	minPt = box.min();
-				MPoint	maxPt = box.max();
-
-				float minVal[3] = { (float)minPt.x, (float)minPt.y, (float)minPt.z };
-				float maxVal[3] = { (float)maxPt.x, (float)maxPt.y, (float)maxPt.z };
-
-				mat4 bounds(
-					0.5f * (maxVal[0] - minVal[0]), 0.0f, 0.0f, 0.0f,
-					0.0f, 0.5f * (maxVal[1] - minVal[1]), 0.0f, 0.0f,
-					0.0f, 0.0f, 0.5f * (maxVal[2] - minVal[2]), 0.0f,
-					0.5f * (maxVal[0] + minVal[0]), 0.5f * (maxVal[1] + minVal[1]), 0.5f * (maxVal[2] + minVal[2]), 1.0f
-				);
-
-				// Set vertex buffer
-				UINT stride = sizeof(VSInputData);
-				UINT offset = 0;
-				_deviceContext->IASetVertexBuffers(0, 1, &_vertexBuffer, &stride, &offset);
-
-				// Set index buffer
-				_deviceContext->IASetIndexBuffer(_indexBuffer, DXGI_FORMAT_R16_UINT, 0);
-
-				// Set constant buffer
-				VSConstantBuffer vb;
-				DirectX::XMMATRIX x0 = XMLoadFloat4x4(&bounds);
-				DirectX::XMMATRIX x1 = XMLoadFloat4x4(&mat);
-				DirectX::XMMATRIX x2 = XMLoadFloat4x4(&currentViewMatrix);
-				DirectX::XMMATRIX x3 = XMLoadFloat4x4(&currentProjectionMatrix);
-				
-				DirectX::XMMATRIX result = DirectX::XMMatrixMultiply(DirectX::XMMatrixMultiply(x0, x1), x2);
-				DirectX::XMStoreFloat4x4(&(vb.WVP), XMMatrixTranspose(DirectX::XMMatrixMultiply(result, x3)));
-				_deviceContext->UpdateSubresource(_vertexConstantBuffer, 0, NULL, &vb, 0, 0);
-
-				PSConstantBuffer pb;
-				pb.diffuseMaterial = vec4(boundsColor[0], boundsColor[1], boundsColor[2], 0.f);
-				_deviceContext->UpdateSubresource(_pixelConstantBuffer, 0, NULL, &pb, 0, 0);
-
-				// Set primitive topology
-				_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
-
-				// bind shaders
-				_deviceContext->VSSetShader(unlitShader->vertexShader, NULL, 0);
-				_deviceContext->VSSetConstantBuffers(0, 1, &_vertexConstantBuffer);
-				_deviceContext->IASetInputLayout(unlitShader->inputLayout);
-				_deviceContext->PSSetShader(unlitShader->pixelShader, NULL, 0);
-				_deviceContext->PSSetConstantBuffers(0, 1, &_pixelConstantBuffer);
-
-				// draw
-				_deviceContext->DrawIndexed(24, 0, 0);
+	// Every open panel is drawn once per round of refreshes, least recently drawn first
+	std::vector<PanelView*> idle;
+	for (const auto& it : _views)
+	{
+		PanelView* panel = it.second.get();
+		if (panel->layer && panel->layer->Bytes() && _frame - panel->lastFrame >= _views.size())
+			idle.push_back(panel);
+	}
+	std::sort(idle.begin(), idle.end(), [](const PanelView* a, const PanelView* b) { return a->lastFrame < b->lastFrame; });
+
+	size_t freed = 0;
+	for (PanelView* panel : idle)
+	{
+		if (freed >= bytes)
+			break;
+		freed += panel->layer->Bytes();
+		panel->layer->Release();
+	}
+
+	if (freed < bytes && _tileTarget && !_gr->BatchRunning())
+	{
+		freed += _tileTarget->Bytes();
+		_tileTarget->Release();
+	}
+	return freed;
+}
 
+void DxManager::UpdateScene()
+{
+	// Apply the scene changes reported since the last update and refit the BVH
+	if (!_sceneBounds->HasPendingChanges())
+		return;
+
+	_sceneBounds->Update();
+	_culling.Sync(_sceneBounds->Cache(), _items);
+	_items.SetActive(_sceneBounds->Active());
+	_resources->Set(_itemsHandle, kResourceSceneItems, _items.ByteSize());
+	_sceneVersion++;
+
+	// Edited shapes are read again the next time they are drawn as meshes
+	_sceneBounds->TakeDirtyShapes(_dirtyShapes);
+	for (uint32_t node : _dirtyShapes)
+		_meshes->MarkDirty(node);
+	if (_sceneBounds->TakeLostShapes())
+		_meshes->CheckAll();
+}
+
+void DxManager::CullOccluded(PanelView& panel, const MMatrix& viewProjection, double projectionScaleY, int targetHeight, size_t& readBudget)
+{
+	FrameStats* stats = &_gr->Stats();
+	size_t candidates = panel.visible.Count();
+
+	double vp[4][4];
+	viewProjection.get(vp);
+
+	// The meshes covering the most of the panel
+	_occluders.clear();
+	for (uint32_t item : panel.visible)
+	{
+		if (!_items.IsOccluder(item))
+			continue;
+
+		float minPt[3], maxPt[3];
+		_items.Bounds(item, minPt, maxPt);
+		double size = ProjectedSize(minPt, maxPt, _items.World(item), vp, projectionScaleY, targetHeight);
+		if (size >= kMinOccluderSize * targetHeight)
+			_occluders.push_back(std::make_pair(size, item));
+	}
+	size_t occluderCount = std::min(_occluders.size(), kMaxOccluders);
+	std::partial_sort(_occluders.begin(), _occluders.begin() + occluderCount, _occluders.end(),
+		std::greater<std::pair<double, uint32_t>>());
+	_occluders.resize(occluderCount);
+
+	// Occluders are read like the drawn meshes, the ones not read yet wait for a later frame
+	TransformKernel kernel = BestTransformKernel();
+	_occlusion.Clear();
+	occluderCount = 0;
+	for (const std::pair<double, uint32_t>& occluder : _occluders)
+	{
+		BoundsKey key = _items.Key(occluder.second);
+		_meshes->Find(key, *_sceneBounds, readBudget);
+
+		const float* positions;
+		const uint32_t* triangles;
+		size_t vertexCount, triangleIndexCount;
+		if (!_meshes->Triangles(key, kMaxOccluderTriangles, positions, vertexCount, triangles, triangleIndexCount))
+			continue;
+
+		float objectToClip[4][4];
+		ComputeViewProjection(_items.World(occluder.second), vp, objectToClip);
+		_occlusion.RasterizeMesh(positions, vertexCount, triangles, triangleIndexCount, objectToClip, kernel);
+		occluderCount++;
+	}
+
+	if (occluderCount > 0)
+	{
+		_occlusion.Finish();
+
+		// The buffer and the items are only read by the tests
+		FrameArray<uint32_t>& visible = panel.visible;
+		FrameArray<uint8_t> occluded = _frameArena.Array<uint8_t>(visible.Count());
+		occluded.Resize(visible.Count());
+		_pool->ParallelFor(visible.Count(), 1024, [&](size_t, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				float minPt[3], maxPt[3], objectToClip[4][4];
+				_items.Bounds(visible[i], minPt, maxPt);
+				ComputeViewProjection(_items.World(visible[i]), vp, objectToClip);
+				occluded[i] = _occlusion.IsOccluded(minPt, maxPt, objectToClip);
 			}
+		});
+
+		size_t kept = 0;
+		for (size_t i = 0; i < visible.Count(); i++)
+		{
+			if (!occluded[i])
+				visible[kept++] = visible[i];
 		}
+		visible.Resize(kept);
 	}
 
-	if (trav)
+	stats->SetCounter(_occludersCounter, (double)occluderCount);
+	stats->SetCounter(_occluderTrianglesCounter, (double)_occlusion.TriangleCount());
+	stats->SetCounter(_occludedCounter, (double)(candidates - panel.visible.Count()));
+	stats->SetCounter(_occlusionVisibleCounter, (double)panel.visible.Count());
+}
+
+void DxManager::SelectMeshes(PanelView& panel, size_t& readBudget)
+{
+	SplitMeshItems(_items, panel.visible, panel.meshes, [&](uint32_t item)
 	{
-		delete trav;
-		trav = NULL;
+		return _meshes->Find(_items.Key(item), *_sceneBounds, readBudget) != nullptr;
+	});
+}
+
+DxManager::PanelView::PanelView()
+{
+}
+
+DxManager::PanelView::~PanelView()
+{
+	if (layer)
+	{
+		delete layer;
+		layer = nullptr;
 	}
 }
 
-bool DxManager::InitializeShadersFromByteData(const BYTE* vsByteData, size_t vsByteSize,
-	const BYTE* psByteData, size_t psByteSize, const D3D11_INPUT_ELEMENT_DESC* layout, int numLayoutElements)
+double DxManager::UpdateResolution(PanelView& panel, const MMatrix& viewProjection, const OverlaySettings& overlay)
 {
-	HRESULT hres;
+	// The time since the panel's previous frame, back to back frames while the camera moves
+	FrameStats::Clock::time_point now = FrameStats::Clock::now();
+	double frameMs = FrameStats::Milliseconds(panel.lastDraw, now);
+	bool moving = viewProjection != panel.lastViewProjection;
+	panel.lastDraw = now;
+	panel.lastViewProjection = viewProjection;
+
+	double scale = 1.0;
+	if (overlay.dynamicResolution)
+	{
+		ResolutionController::Settings settings = panel.resolution.GetSettings();
+		settings.budgetMs = overlay.frameBudgetMs;
+		settings.minScale = overlay.minResolutionScale;
+		panel.resolution.SetSettings(settings);
 
-	ID3D11VertexShader* pVertexShader = NULL;
-	hres = _device->CreateVertexShader(vsByteData, vsByteSize, NULL, &pVertexShader);
-	if (FAILED(hres))
+		double seconds = std::chrono::duration<double>(now.time_since_epoch()).count();
+		scale = panel.resolution.Update(frameMs, moving, seconds);
+	}
+	else
 	{
-		MGlobal::displayError("Failed to create vertex shader");
+		panel.resolution.Reset();
+	}
+
+	_gr->Stats().SetCounter(_resolutionScaleCounter, scale);
+	return scale;
+}
+
+OverlaySignature DxManager::Signature(const MMatrix& view, const MMatrix& projection, int width, int height,
+	const OverlaySettings& overlay) const
+{
+	OverlaySignature signature;
+	view.get(signature.view);
+	projection.get(signature.projection);
+	signature.width = (uint32_t)width;
+	signature.height = (uint32_t)height;
+	signature.sceneVersion = _sceneVersion;
+	signature.settings = (uint32_t)overlay.mode | (overlay.occlusion ? 0x100u : 0u);
+	return signature;
+}
+
+bool DxManager::PrepareLayer(PanelView& panel, int width, int height)
+{
+	// Without the composite pass the overlay is drawn straight into Maya's target, at full
+	// resolution
+	if (!_compositeDepthState || !_compositeBlendState || !_pipelines->Composite() || width <= 0 || height <= 0)
 		return false;
+
+	if (!panel.layer)
+		panel.layer = new DxOverlayLayer(_device, _resources);
+	bool ready = panel.layer->Resize((UINT)width, (UINT)height);
+
+	size_t bytes = 0;
+	for (const auto& it : _views)
+		bytes += it.second->layer ? it.second->layer->Bytes() : 0;
+	_gr->Stats().SetCounter(_layerBytesCounter, bytes / (1024.0 * 1024.0));
+	return ready;
+}
+
+void DxManager::CompositeLayer(const PanelView& panel)
+{
+	_backend->SetPipeline(kResCompositePipeline, *_pipelines->Composite());
+	_backend->SetTexture(kResLayerTexture, panel.layer->Texture());
+
+	// A full screen triangle, the layer is unbound after so it can be drawn into again
+	_commands.Reset();
+	_commands.BindStates(kResCompositeStates);
+	_commands.BindPipeline(kResCompositePipeline);
+	_commands.SetTexture(0, kStagePixel, kResLayerTexture);
+	_commands.Draw(3, 0);
+	_commands.SetTexture(0, kStagePixel, 0);
+
+	ReplayCommands(_commands, *_backend);
+}
+
+DxManager::PanelView& DxManager::View(const MString& panelName)
+{
+	_frame++;
+
+	std::unique_ptr<PanelView>& view = _views[panelName.asChar()];
+	if (!view)
+		view.reset(new PanelView);
+	view->lastFrame = _frame;
+
+	// Forget the panels that have not been drawn for a while (closed or torn off)
+	const uint64_t kStaleFrames = 1000;
+	if (_frame % kStaleFrames == 0)
+	{
+		for (auto it = _views.begin(); it != _views.end();)
+		{
+			if (_frame - it->second->lastFrame > kStaleFrames)
+				it = _views.erase(it);
+			else
+				++it;
+		}
+		_meshes->Prune(_frame, kStaleFrames);
 	}
 
-	ID3D11InputLayout* pVertexLayout = NULL;
-	hres = _device->CreateInputLayout(layout, numLayoutElements, vsByteData, vsByteSize, &pVertexLayout);
-	if (FAILED(hres))
+	return *view;
+}
+
+void DxManager::DrawBoundsInstances(const MHWRender::MDrawContext& drawContext, const PanelView& view)
+{
+	UINT numInstances = (UINT)view.instances.Count();
+	if (numInstances == 0 || !_rasterState)
+		return;
+
+	// Created the first time it is drawn
+	const DxPipeline* pipeline = _pipelines->Get(kBoundsVariant);
+	if (!pipeline)
+		return;
+	_backend->SetPipeline(kResBoundsPipeline, *pipeline);
+
+	// Sub-allocate this frame's instances in the ring, the GPU may still be reading
+	// the previous frames from other parts of it
+	size_t instanceOffset = 0;
+	_instanceRing->BeginFrame(_deviceContext);
+	if (!_instanceRing->Upload(_deviceContext, view.instances.Data(), view.instances.ByteSize(), sizeof(float) * 4, instanceOffset))
 	{
-		MGlobal::displayError("Failed to create input layout");
-		return false;
+		_instanceRing->EndFrame(_deviceContext);
+		return;
 	}
 
-	// Set up pixel shader
-	ID3D11PixelShader* pPixelShader = NULL;
-	hres = _device->CreatePixelShader(psByteData, psByteSize, NULL, &pPixelShader);
+	// The ring buffer is replaced when it grows
+	_backend->SetBuffer(kResInstances, _instanceRing->Buffer());
+
+	// Slot 0 is the unit cube, slot 1 the per-instance matrices and colors
+	_commands.Reset();
+	_commands.BindStates(kResOverlayStates);
+	_commands.BindPipeline(kResBoundsPipeline);
+	_commands.SetVertexBuffer(0, kResCubeVertices, sizeof(VSInputData), 0);
+	_commands.SetVertexBuffer(1, kResInstances, sizeof(BoundsInstance), (uint32_t)instanceOffset);
+	_commands.SetIndexBuffer(kResCubeIndices, 0);
+	_commands.DrawIndexedInstanced(kCubeLineIndices, numInstances, 0, 0, 0);
+
+	ReplayCommands(_commands, *_backend);
 
-	if (FAILED(hres))
+	// Fence after the draw that reads this frame's part of the ring
+	_instanceRing->EndFrame(_deviceContext);
+}
+
+void DxManager::DrawMeshes(const PanelView& view, const MMatrix& viewProjection, double projectionScaleY, int targetHeight, OverlayMode mode)
+{
+	_meshTriangles = 0;
+	if (view.meshes.Empty() || !_rasterState)
+		return;
+
+	// Non-instanced, the matrix and color come from ObjectConstants
+	const DxPipeline* pipeline = _pipelines->Get(mode == kOverlayShaded ? kVariantSolid : 0);
+	if (!pipeline)
+		return;
+	_backend->SetPipeline(kResMeshPipeline, *pipeline);
+
+	// All the constants in one upload, the ring may be replaced by a growing upload but
+	// not in the middle of the frame's blocks
+	_meshConstants.resize(view.meshes.Count());
+	for (size_t i = 0; i < view.meshes.Count(); i++)
 	{
-		MGlobal::displayError("Failed to create pixel shader");
-		return false;
+		uint32_t item = view.meshes[i];
+		ObjectConstants& constants = _meshConstants[i];
+
+		MMatrix wvp = MMatrix(_items.World(item)) * viewProjection;
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				constants.wvp[r][c] = (float)wvp(r, c);
+
+		const float* color = DrawItemStore::PaletteColor(_items.Palette(item));
+		constants.color[0] = color[0];
+		constants.color[1] = color[1];
+		constants.color[2] = color[2];
+		constants.color[3] = 0.0f;
+	}
+
+	size_t constantOffset = 0;
+	_constantRing->BeginFrame(_deviceContext);
+	if (!_constantRing->Upload(_deviceContext, _meshConstants.data(), _meshConstants.size() * sizeof(ObjectConstants),
+		DxRingBuffer::kConstantAlignment, constantOffset))
+	{
+		_constantRing->EndFrame(_deviceContext);
+		return;
 	}
+	_backend->SetBuffer(kResObjectConstants, _constantRing->Buffer());
 
-	ShaderAndLayout* sr = new ShaderAndLayout;
-	sr->vertexShader = pVertexShader;
-	sr->pixelShader = pPixelShader;
-	sr->inputLayout = pVertexLayout;
-	unlitShader = sr;
+	_commands.Reset();
+	_commands.BindStates(kResOverlayStates);
+	_commands.BindPipeline(kResMeshPipeline);
 
-	return true;
+	double vp[4][4];
+	viewProjection.get(vp);
+
+	ResourceId id = kResFirstMesh;
+	for (size_t i = 0; i < view.meshes.Count(); i++, id += 2)
+	{
+		// The level whose simplification is not visible at the mesh's size on screen
+		uint32_t item = view.meshes[i];
+		float minPt[3], maxPt[3];
+		_items.Bounds(item, minPt, maxPt);
+		double size = ProjectedSize(minPt, maxPt, _items.World(item), vp, projectionScaleY, targetHeight);
+		BoundsKey key = _items.Key(item);
+		const MeshCache::GpuMesh* mesh = _meshes->Level(key, SelectLod(size));
+
+		// Null when the mesh is not cached anymore, and a buffer is null when its
+		// reallocation failed in Upload(): fall back to level 0, else skip the mesh
+		if (!mesh || !mesh->vertices || !mesh->indices)
+			mesh = _meshes->Level(key, 0);
+		if (!mesh || !mesh->vertices || !mesh->indices)
+			continue;
+		_meshTriangles += mesh->triangleIndices / 3;
+
+		_backend->SetBuffer(id, mesh->vertices);
+		_backend->SetBuffer(id + 1, mesh->indices);
+
+		uint32_t offset = (uint32_t)(constantOffset + i * sizeof(ObjectConstants));
+		_commands.SetConstants(0, kStageVertex, kResObjectConstants, offset, sizeof(ObjectConstants));
+		_commands.SetVertexBuffer(0, id, sizeof(float) * 3, 0);
+		_commands.SetIndexBuffer(id + 1, 0, sizeof(uint32_t));
+		if (mode == kOverlayShaded)
+			_commands.DrawIndexedInstanced(mesh->triangleIndices, 1, 0, 0, 0);
+		else
+			_commands.DrawIndexedInstanced(mesh->edgeIndices, 1, mesh->triangleIndices, 0, 0);
+	}
+
+	ReplayCommands(_commands, *_backend);
+	_constantRing->EndFrame(_deviceContext);
 }
 
 bool DxManager::CreateBuffers()
@@ -448,7 +893,7 @@ bool DxManager::CreateBuffers()
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
 	InitData.pSysMem = vertices;
-	hr = _device->CreateBuffer(&bd, &InitData, &_vertexBuffer);
+	hr = CreateTrackedBuffer(_device, _resources, kResourceBuffers, bd, &InitData, &_vertexBuffer, _vertexBufferHandle);
 
 	if (FAILED(hr))
 	{
@@ -456,6 +901,13 @@ bool DxManager::CreateBuffers()
 		return false;
 	}
 
+	// Per-instance data of the bounds overlay, enough for about 100k objects before growing
+	_instanceRing = new DxRingBuffer(_device, D3D11_BIND_VERTEX_BUFFER, 8 * 1024 * 1024, _resources, kResourceBuffers);
+
+	// Per-mesh constants of the wireframe and shaded modes, 4k meshes before growing
+	_constantRing = new DxRingBuffer(_device, D3D11_BIND_CONSTANT_BUFFER, 1024 * 1024, _resources, kResourceBuffers);
+	_meshes = new MeshCache(_device, _resources);
+
 	// Create index buffer
 	WORD indices[] =
 	{
@@ -471,7 +923,16 @@ bool DxManager::CreateBuffers()
 		1, 5,
 		2, 6,
 		3, 7,
+
+		// Faces, for the solid variants
+		0, 1, 3,  0, 3, 2,
+		4, 6, 7,  4, 7, 5,
+		0, 4, 5,  0, 5, 1,
+		2, 3, 7,  2, 7, 6,
+		0, 2, 6,  0, 6, 4,
+		1, 5, 7,  1, 7, 3,
 	};
+	static_assert(sizeof(indices) / sizeof(indices[0]) == kCubeLineIndices + kCubeTriangleIndices, "cube indices");
 
 	bd.Usage = D3D11_USAGE_DEFAULT;
 	bd.ByteWidth = sizeof(indices);
@@ -479,7 +940,7 @@ bool DxManager::CreateBuffers()
 	bd.CPUAccessFlags = 0;
 	ZeroMemory(&InitData, sizeof(InitData));
 	InitData.pSysMem = indices;
-	hr = _device->CreateBuffer(&bd, &InitData, &_indexBuffer);
+	hr = CreateTrackedBuffer(_device, _resources, kResourceBuffers, bd, &InitData, &_indexBuffer, _indexBufferHandle);
 
 	if (FAILED(hr))
 	{
@@ -487,98 +948,93 @@ bool DxManager::CreateBuffers()
 		return false;
 	}
 
-	// Create vertex constant buffer
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(VSConstantBuffer);
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	bd.CPUAccessFlags = 0;
-	hr = _device->CreateBuffer(&bd, NULL, &_vertexConstantBuffer);
-
-	if (FAILED(hr))
-	{
-		MGlobal::displayError("Failed to create vertex const buffer");
-		return false;
-	}
-
-	// Create pixel constant buffer
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(PSConstantBuffer);
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	bd.CPUAccessFlags = 0;
-	hr = _device->CreateBuffer(&bd, NULL, &_pixelConstantBuffer);
-
-	if (FAILED(hr))
-	{
-		MGlobal::displayError("Failed to create pixel const buffer");
-		return false;
-	}
-
 	return true;
 }
 
 bool DxManager::UpdateStates(const MHWRender::MDrawContext& drawContext)
 {
-	HRESULT hr;
-
-	MHWRender::MStateManager* stateManager = drawContext.getStateManager();
-	bool createStatesViaMayaAPI = (stateManager != NULL);
-
-	if (createStatesViaMayaAPI)
-	{
-		MHWRender::MRasterizerStateDesc rasterizerStateDesc;
-		rasterizerStateDesc.fillMode = MHWRender::MRasterizerState::kFillSolid;
-		rasterizerStateDesc.cullMode = MHWRender::MRasterizerState::kCullNone;
-		rasterizerStateDesc.frontCounterClockwise = true;
-		rasterizerStateDesc.depthBiasIsFloat = true;
-		rasterizerStateDesc.depthBias = 0.0f;
-		rasterizerStateDesc.depthBiasClamp = 0.0f;
-		rasterizerStateDesc.slopeScaledDepthBias = 0.0f;
-		rasterizerStateDesc.depthClipEnable = true;
-		rasterizerStateDesc.scissorEnable = false;
-		rasterizerStateDesc.multiSampleEnable = false;
-		rasterizerStateDesc.antialiasedLineEnable = false;
-
-		_mRasterState = stateManager->acquireRasterizerState(rasterizerStateDesc);
-		if (_mRasterState)
-		{
-			_dxRasterState = (ID3D11RasterizerState*)_mRasterState->resourceHandle();
-		}
-		else
-		{
-			MHWRender::MStateManager::releaseRasterizerState(_mRasterState);
-			_mRasterState = NULL;
-			createStatesViaMayaAPI = false;
-		}
-
-		MHWRender::MSamplerStateDesc sd;
-		_mSamplerState = stateManager->acquireSamplerState(sd);
-		if (_mSamplerState)
-		{
-			_dxSamplerState = (ID3D11SamplerState*)_mSamplerState->resourceHandle();
-		}
-	}
-
-	if (!createStatesViaMayaAPI)
+	// The descriptions are the same every frame, so after the first frame these are
+	// cache hits and nothing is acquired or created
+	_states->SetStateManager(drawContext.getStateManager());
+
+	D3D11_RASTERIZER_DESC rd;
+	ZeroMemory(&rd, sizeof(rd));
+	rd.FillMode = D3D11_FILL_SOLID;
+	rd.CullMode = D3D11_CULL_NONE;
+	rd.FrontCounterClockwise = TRUE;
+	rd.DepthBias = 0;
+	rd.SlopeScaledDepthBias = 0.0f;
+	rd.DepthBiasClamp = 0.0f;
+	rd.DepthClipEnable = TRUE;
+	rd.ScissorEnable = FALSE;
+	rd.MultisampleEnable = FALSE;
+	rd.AntialiasedLineEnable = FALSE;
+	_rasterState = _states->Rasterizer(rd);
+
+	D3D11_SAMPLER_DESC sd;
+	ZeroMemory(&sd, sizeof(sd));
+	sd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sd.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sd.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sd.MaxLOD = D3D11_FLOAT32_MAX;
+	_samplerState = _states->Sampler(sd);
+
+	D3D11_BLEND_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.RenderTarget[0].BlendEnable = FALSE;
+	bd.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].DestBlend = D3D11_BLEND_ZERO;
+	bd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	bd.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+	bd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	bd.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	_blendState = _states->Blend(bd);
+
+	D3D11_DEPTH_STENCIL_DESC dd;
+	ZeroMemory(&dd, sizeof(dd));
+	dd.DepthEnable = TRUE;
+	dd.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	dd.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	dd.StencilEnable = FALSE;
+	_depthStencilState = _states->DepthStencil(dd);
+
+	// The composite blends the layer over whatever is in the target, a layer drawn at a
+	// lower resolution has partly covered pixels after filtering
+	bd.RenderTarget[0].BlendEnable = TRUE;
+	bd.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	bd.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	bd.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	_compositeBlendState = _states->Blend(bd);
+
+	dd.DepthEnable = FALSE;
+	dd.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	_compositeDepthState = _states->DepthStencil(dd);
+
+	// Totals since the device was set up, the misses stop growing after the first frame
+	_gr->Stats().SetCounter(_stateHitsCounter, (double)_states->Hits());
+	_gr->Stats().SetCounter(_stateMissesCounter, (double)_states->Misses());
+
+	if (!_rasterState || !_blendState || !_depthStencilState)
 	{
-		D3D11_RASTERIZER_DESC rd;
-		rd.FillMode = D3D11_FILL_SOLID;
-		rd.CullMode = D3D11_CULL_BACK;
-		rd.FrontCounterClockwise = TRUE;
-		rd.DepthBias = 0;
-		rd.SlopeScaledDepthBias = 0.0f;
-		rd.DepthBiasClamp = 0.0f;
-		rd.DepthClipEnable = TRUE;
-		rd.ScissorEnable = FALSE;
-		rd.MultisampleEnable = FALSE;
-		rd.AntialiasedLineEnable = FALSE;
-
-		hr = _device->CreateRasterizerState(&rd, &_dxRasterState);
-		if (FAILED(hr))
-		{
-			MGlobal::displayError("Failed to create raster state");
-			return false;
-		}
+		MGlobal::displayError("Failed to create overlay states");
+		return false;
 	}
 
+	DxStateBlock overlayStates;
+	overlayStates.rasterizer = _rasterState;
+	overlayStates.blend = _blendState;
+	overlayStates.depthStencil = _depthStencilState;
+	_backend->SetStates(kResOverlayStates, overlayStates);
+
+	DxStateBlock compositeStates = overlayStates;
+	compositeStates.blend = _compositeBlendState;
+	compositeStates.depthStencil = _compositeDepthState;
+	compositeStates.sampler = _samplerState;
+	_backend->SetStates(kResCompositeStates, compositeStates);
+
 	return true;
 }
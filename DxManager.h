@@ -1,38 +1,130 @@
 #pragma once
 #pragma warning(disable: 4005)
 
+#include <maya/MMatrix.h>
 #include <maya/MStateManager.h>
 
 // Includes for DX
 #define WIN32_LEAN_AND_MEAN
 #include <d3d11.h>
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "DrawCommands.h"
+#include "DxCommandBackend.h"
+#include "DxRingBuffer.h"
+#include "DxStateCache.h"
+#include "DrawItemStore.h"
+#include "DrawList.h"
+#include "FrameArena.h"
+#include "FrameStats.h"
+#include "InstanceBuffer.h"
+#include "MeshCache.h"
+#include "OcclusionBuffer.h"
+#include "OverlayCache.h"
+#include "OverlaySettings.h"
+#include "ResolutionController.h"
+#include "ResourceRegistry.h"
+#include "SceneCulling.h"
+#include "ThreadPool.h"
+
+
+class DxGpuTimer;
+class DxOverlayLayer;
+class DxPipelineCache;
 class GarlandRenderOverride;
-struct ShaderAndLayout
+class SceneBounds;
+
+
+// ObjectConstants of shaders/unlit_vs.hlsl, one 256-byte constant block
+struct ObjectConstants
 {
-	ID3D11VertexShader* vertexShader;
-	ID3D11PixelShader* pixelShader;
-	ID3D11InputLayout* inputLayout;
+	float wvp[4][4];	// world * view * projection, row-vector convention
+	float color[4];
+	float padding[44];
 };
 
 
-class DxManager
+class DxManager : public ResourceEvictor
 {
 public:
 	DxManager(GarlandRenderOverride* gr);
 	~DxManager();
 
+	// Over the GPU budget: releases the layers of the panels not drawn in the last round of
+	// refreshes, and the tile target outside of a batch. They are drawn whole when next used.
+	size_t Evict(ResourceMemory memory, size_t bytes) override;
+
 	void Setup();
 	void debug(const MHWRender::MDrawContext& drawContext);
 
+	// Applies the scene changes the callbacks queued since the last frame, on the render
+	// thread before the frame is drawn
+	void DrainSceneChanges();
+
+	inline size_t PanelViewCount() const { return _views.size(); }
+
+	// False until the background thread has created the overlay pipelines, the overlay
+	// is not drawn before
+	inline bool Ready() const { return _pipelinesReady.load(std::memory_order_acquire); }
+	inline double PipelineMilliseconds() const { return Ready() ? _pipelineMs : 0.0; }
+
+	inline DxGpuTimer* GpuTimer() { return _gpuTimer; }
+	inline ID3D11Device* Device() { return _device; }
+	inline ID3D11DeviceContext* Context() { return _deviceContext; }
+
 protected:
-	bool InitializeShadersFromByteData(const BYTE* vsByteData, size_t vsBtyeSize,
-		const BYTE* psByteData, size_t sBtyeSize, const D3D11_INPUT_ELEMENT_DESC* layout, int numLayoutElements);
 	bool CreateBuffers();
+	void CreatePipelines();
+	bool FinishPipelines();
+	// What each model panel sees: its visible items and the instances built from them. In
+	// the mesh modes the meshes drawn as geometry are moved from visible to meshes. Both
+	// are item indices in _frameArena, only valid while the panel is drawn.
+	// The overlay is drawn into the panel's layer, reused while its signature holds.
+	struct PanelView
+	{
+		PanelView();
+		~PanelView();
+
+		FrameArray<uint32_t> visible;
+		FrameArray<uint32_t> meshes;
+		InstanceBufferBuilder instances;
+		DxOverlayLayer* layer = nullptr;
+		uint64_t lastFrame = 0;
+
+		// Camera of the previous frame and when it was drawn, for the dynamic resolution
+		ResolutionController resolution;
+		MMatrix lastViewProjection;
+		FrameStats::Clock::time_point lastDraw;
+	};
+
 	bool UpdateStates(const MHWRender::MDrawContext& drawContext);
+	void UpdateScene();
+	PanelView& View(const MString& panelName);
+	OverlaySignature Signature(const MMatrix& view, const MMatrix& projection, int width, int height, const OverlaySettings& overlay) const;
+	double UpdateResolution(PanelView& panel, const MMatrix& viewProjection, const OverlaySettings& overlay);
+	bool PrepareLayer(PanelView& panel, int width, int height);
+	void CompositeLayer(const PanelView& panel);
+	void CullOccluded(PanelView& panel, const MMatrix& viewProjection, double projectionScaleY, int targetHeight, size_t& readBudget);
+	void SelectMeshes(PanelView& panel, size_t& readBudget);
+	void DrawBoundsInstances(const MHWRender::MDrawContext& drawContext, const PanelView& view);
+	void DrawMeshes(const PanelView& view, const MMatrix& viewProjection, double projectionScaleY, int targetHeight, OverlayMode mode);
+
+	// Culls and draws the overlay of the panel seen through view and projection into the
+	// bound target, targetHeight pixels high. Returns the read budget left.
+	size_t DrawOverlay(const MHWRender::MDrawContext& drawContext, PanelView& panel, const MMatrix& view, const MMatrix& projection, int targetHeight, const OverlaySettings& overlay);
+
+	// Draws the image of a tiled batch frame tile by tile into _tileTarget, each tile read
+	// back by the override
+	void RenderTiles(const MHWRender::MDrawContext& drawContext, PanelView& panel, const MMatrix& view, const MMatrix& projection, const OverlaySettings& overlay);
 
 	GarlandRenderOverride* _gr;
+	ResourceRegistry* _resources = nullptr;
 
 	// DirectX device members
 	ID3D11Device* _device = nullptr;
@@ -40,20 +132,95 @@ protected:
 	ID3D11RenderTargetView* _mainRenderTargetView = nullptr;
 	ID3D11DepthStencilView* _mainDepthStencilView = nullptr;
 
-	// DirectX Rasterizer states.
-	ID3D11RasterizerState* _dxRasterState = nullptr;
-	const MHWRender::MRasterizerState* _mRasterState = nullptr;
-
-	// DirectX Sampler states
-	ID3D11SamplerState* _dxSamplerState = nullptr;
-	const MHWRender::MSamplerState* _mSamplerState = nullptr;
+	// DirectX states, created once by the cache and looked up every frame
+	DxStateCache* _states = nullptr;
+	DxStateCache::RasterizerState _rasterState;
+	DxStateCache::SamplerState _samplerState;
+	DxStateCache::BlendState _blendState;
+	DxStateCache::BlendState _compositeBlendState;
+	DxStateCache::DepthStencilState _depthStencilState;
+	DxStateCache::DepthStencilState _compositeDepthState;
 
 	// DirectX Buffers
 	ID3D11Buffer* _vertexBuffer = nullptr;
 	ID3D11Buffer* _indexBuffer = nullptr;
-	ID3D11Buffer* _vertexConstantBuffer = nullptr;
-	ID3D11Buffer* _pixelConstantBuffer = nullptr;
+	ResourceHandle _vertexBufferHandle = 0;
+	ResourceHandle _indexBufferHandle = 0;
+	DxRingBuffer* _instanceRing = nullptr;
+	DxRingBuffer* _constantRing = nullptr;
+
+	// Cached bounds and world matrices of the scene surfaces, their draw items and the BVH
+	// culling them. Shared by all the panels and brought up to date once per change.
+	SceneBounds* _sceneBounds = nullptr;
+	SceneCulling _culling;
+	DrawItemStore _items;
+	ResourceHandle _itemsHandle = 0;
+	std::vector<uint32_t> _dirtyShapes;
+	uint64_t _sceneVersion = 0;	// one per applied change, part of the layer signatures
+
+	// GPU copies of the meshes for the wireframe and shaded modes, and their per-draw constants
+	MeshCache* _meshes = nullptr;
+	std::vector<ObjectConstants> _meshConstants;
+
+	// Depth of the largest meshes on screen, the visible objects behind it are not drawn
+	OcclusionBuffer _occlusion;
+	std::vector<std::pair<double, uint32_t>> _occluders;
+
+	// The one target of the tiled batch frames, whatever the image size
+	DxOverlayLayer* _tileTarget = nullptr;
+
+	// Per-panel state, the per-instance data is rebuilt every frame on the pool threads.
+	// Only the upload and the draw happen on Maya's render thread.
+	std::unordered_map<std::string, std::unique_ptr<PanelView>> _views;
+	uint64_t _frame = 0;
+	ThreadPool* _pool = nullptr;
+	FrameArena _frameArena;	// the transient arrays of the panel being drawn
+	ResourceHandle _arenaHandle = 0;
+	DrawListBuilder _drawList;
+
+	// The overlay draws are recorded into _commands and replayed by _backend
+	CommandBuffer _commands;
+	DxCommandBackend* _backend = nullptr;
+
+	// Overlay shader permutations. The ones drawn every frame are created on _pipelineThread,
+	// the render thread only uses the cache once _pipelinesReady is set.
+	DxPipelineCache* _pipelines = nullptr;
+	std::thread _pipelineThread;
+	std::atomic<bool> _pipelinesReady{ false };
+	bool _pipelinesFailed = false;
+	double _pipelineMs = 0.0;
 
-	// DirectX Shaders
-	ShaderAndLayout* unlitShader = nullptr;
+	// Timings of the overlay stages, recorded into the override's FrameStats
+	DxGpuTimer* _gpuTimer = nullptr;
+	int _stageUpdate = -1;
+	int _stageCull = -1;
+	int _stageClassify = -1;
+	int _stageTransform = -1;
+	int _stageSubmit = -1;
+	int _gpuStageSubmit = -1;
+	int _stageMeshes = -1;
+	int _meshCountCounter = -1;
+	int _meshDrawnCounter = -1;
+	int _meshQueuedCounter = -1;
+	int _meshPendingCounter = -1;
+	int _meshUploadedCounter = -1;
+	int _meshTrianglesCounter = -1;
+	int _meshLodPendingCounter = -1;
+	int _stageOcclusion = -1;
+	int _occludersCounter = -1;
+	int _occluderTrianglesCounter = -1;
+	int _occludedCounter = -1;
+	int _occlusionVisibleCounter = -1;
+	int _layerHitCounter = -1;
+	int _layerHitRateCounter = -1;
+	int _layerBytesCounter = -1;
+	int _resolutionScaleCounter = -1;
+	int _itemBytesCounter = -1;
+	int _arenaBytesCounter = -1;
+	int _sceneEventsCounter = -1;
+	int _sceneDroppedCounter = -1;
+	int _stateHitsCounter = -1;
+	int _stateMissesCounter = -1;
+	CacheHitRate _layerHits;
+	uint64_t _meshTriangles = 0;
 };
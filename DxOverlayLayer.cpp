@@ -0,0 +1,102 @@
+#include "DxOverlayLayer.h"
+
+#include "DxResources.h"
+
+
+#define SafeRelease(p) if((p)){(p)->Release(); (p)=NULL;}
+
+
+DxOverlayLayer::DxOverlayLayer(ID3D11Device* device, ResourceRegistry* registry)
+{
+	_device = device;
+	_registry = registry;
+}
+
+DxOverlayLayer::~DxOverlayLayer()
+{
+	Release();
+	SafeRelease(_savedColor);
+	SafeRelease(_savedDepth);
+	_device = nullptr;
+}
+
+void DxOverlayLayer::Release()
+{
+	SafeRelease(_colorView);
+	SafeRelease(_colorTarget);
+	ReleaseTracked(_registry, _color, _colorHandle);
+	SafeRelease(_depthTarget);
+	ReleaseTracked(_registry, _depth, _depthHandle);
+	_width = 0;
+	_height = 0;
+	_cache.Invalidate();
+}
+
+bool DxOverlayLayer::Resize(UINT width, UINT height)
+{
+	if (width == _width && height == _height && _colorView)
+		return true;
+
+	Release();
+	if (width == 0 || height == 0)
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(desc));
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	if (FAILED(CreateTrackedTexture2D(_device, _registry, kResourceOverlayLayers, desc, &_color, _colorHandle)) ||
+		FAILED(_device->CreateRenderTargetView(_color, NULL, &_colorTarget)) ||
+		FAILED(_device->CreateShaderResourceView(_color, NULL, &_colorView)))
+	{
+		Release();
+		return false;
+	}
+
+	desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	desc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	if (FAILED(CreateTrackedTexture2D(_device, _registry, kResourceOverlayLayers, desc, &_depth, _depthHandle)) ||
+		FAILED(_device->CreateDepthStencilView(_depth, NULL, &_depthTarget)))
+	{
+		Release();
+		return false;
+	}
+
+	_width = width;
+	_height = height;
+	return true;
+}
+
+void DxOverlayLayer::Begin(ID3D11DeviceContext* context)
+{
+	SafeRelease(_savedColor);
+	SafeRelease(_savedDepth);
+	context->OMGetRenderTargets(1, &_savedColor, &_savedDepth);
+	_savedViewportCount = 1;
+	context->RSGetViewports(&_savedViewportCount, &_savedViewport);
+
+	// Alpha 0 marks the pixels the overlay did not draw
+	float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	context->ClearRenderTargetView(_colorTarget, clearColor);
+	context->ClearDepthStencilView(_depthTarget, D3D11_CLEAR_DEPTH, 1.0f, 0);
+	context->OMSetRenderTargets(1, &_colorTarget, _depthTarget);
+
+	D3D11_VIEWPORT viewport = { 0.0f, 0.0f, (float)_width, (float)_height, 0.0f, 1.0f };
+	context->RSSetViewports(1, &viewport);
+}
+
+void DxOverlayLayer::End(ID3D11DeviceContext* context)
+{
+	context->OMSetRenderTargets(1, &_savedColor, _savedDepth);
+	if (_savedViewportCount)
+		context->RSSetViewports(1, &_savedViewport);
+	SafeRelease(_savedColor);
+	SafeRelease(_savedDepth);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11.h>
+
+#include "OverlayCache.h"
+#include "ResourceRegistry.h"
+
+
+// The overlay of one panel drawn into color and depth targets of its own, then blended over
+// the panel's viewport by the composite pass (shaders/composite_*.hlsl). The layer covers
+// the viewport, smaller than it under dynamic resolution. The image is kept between frames
+// with the signature it was drawn with, a frame that would draw the same image only
+// composites it.
+class DxOverlayLayer
+{
+public:
+	// The targets are tracked as kResourceOverlayLayers when there is a registry
+	DxOverlayLayer(ID3D11Device* device, ResourceRegistry* registry);
+	~DxOverlayLayer();
+
+	// (Re)creates the targets when the size changed, which invalidates the image. False
+	// when they could not be created.
+	bool Resize(UINT width, UINT height);
+
+	// Frees the targets, the next Resize() creates them again
+	void Release();
+
+	// Binds the layer's targets and a viewport covering them and clears them, End()
+	// restores the targets and viewport bound before
+	void Begin(ID3D11DeviceContext* context);
+	void End(ID3D11DeviceContext* context);
+
+	inline ID3D11ShaderResourceView* Texture() const { return _colorView; }
+	inline ID3D11RenderTargetView* RenderTarget() const { return _colorTarget; }
+	inline OverlayCache& Cache() { return _cache; }
+	inline size_t Bytes() const { return (size_t)_width * _height * 8; }
+	inline UINT Width() const { return _width; }
+	inline UINT Height() const { return _height; }
+
+protected:
+	ID3D11Device* _device = nullptr;
+	ResourceRegistry* _registry = nullptr;
+	UINT _width = 0;
+	UINT _height = 0;
+
+	ID3D11Texture2D* _color = nullptr;
+	ResourceHandle _colorHandle = 0;
+	ID3D11RenderTargetView* _colorTarget = nullptr;
+	ID3D11ShaderResourceView* _colorView = nullptr;
+	ID3D11Texture2D* _depth = nullptr;
+	ResourceHandle _depthHandle = 0;
+	ID3D11DepthStencilView* _depthTarget = nullptr;
+
+	// Maya's targets while the layer is bound, referenced by OMGetRenderTargets
+	ID3D11RenderTargetView* _savedColor = nullptr;
+	ID3D11DepthStencilView* _savedDepth = nullptr;
+	D3D11_VIEWPORT _savedViewport;
+	UINT _savedViewportCount = 0;
+
+	OverlayCache _cache;
+};
@@ -0,0 +1,119 @@
+#include "DxPipelineCache.h"
+
+#include "DxResources.h"
+
+
+#define SafeRelease(p) if((p)){(p)->Release(); (p)=NULL;}
+
+
+DxPipelineCache::DxPipelineCache(ID3D11Device* device, const uint8_t* table, size_t tableSize, ResourceRegistry* registry)
+{
+	_device = device;
+	_registry = registry;
+	_table.Parse(table, tableSize);
+}
+
+DxPipelineCache::~DxPipelineCache()
+{
+	for (uint32_t i = 0; i < kVariantCount; i++)
+	{
+		ReleaseTracked(_registry, _vertexShaders[i], _vertexShaderHandles[i]);
+		ReleaseTracked(_registry, _pixelShaders[i], _pixelShaderHandles[i]);
+	}
+	SafeRelease(_layouts[0]);
+	SafeRelease(_layouts[1]);
+	ReleaseTracked(_registry, _composite.vertexShader, _compositeHandles[0]);
+	ReleaseTracked(_registry, _composite.pixelShader, _compositeHandles[1]);
+}
+
+const DxPipeline* DxPipelineCache::Get(uint32_t variant)
+{
+	if (variant >= kVariantCount)
+		return nullptr;
+
+	DxPipeline& pipeline = _pipelines[variant];
+	if (_tried[variant])
+		return pipeline.vertexShader ? &pipeline : nullptr;
+	_tried[variant] = true;
+
+	const uint8_t* vsCode = nullptr;
+	size_t vsSize = 0;
+	ID3D11VertexShader* vertexShader = VertexShader(ShaderKey(kShaderVertex, variant), vsCode, vsSize);
+	ID3D11PixelShader* pixelShader = PixelShader(ShaderKey(kShaderPixel, variant));
+	ID3D11InputLayout* inputLayout = vertexShader ? InputLayout((variant & kVariantInstanced) != 0, vsCode, vsSize) : nullptr;
+
+	if (!vertexShader || !pixelShader || !inputLayout)
+		return nullptr;
+
+	pipeline.vertexShader = vertexShader;
+	pipeline.pixelShader = pixelShader;
+	pipeline.inputLayout = inputLayout;
+	pipeline.topology = (variant & kVariantSolid) ? D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST : D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+	_created++;
+	return &pipeline;
+}
+
+const DxPipeline* DxPipelineCache::Composite()
+{
+	if (_compositeTried)
+		return (_composite.vertexShader && _composite.pixelShader) ? &_composite : nullptr;
+	_compositeTried = true;
+
+	const uint8_t* code = nullptr;
+	size_t size = 0;
+	if (_table.Find(kShaderVertex, kShaderKeyComposite, code, size))
+		CreateTrackedVertexShader(_device, _registry, code, size, &_composite.vertexShader, _compositeHandles[0]);
+	if (_table.Find(kShaderPixel, kShaderKeyComposite, code, size))
+		CreateTrackedPixelShader(_device, _registry, code, size, &_composite.pixelShader, _compositeHandles[1]);
+	if (!_composite.vertexShader || !_composite.pixelShader)
+		return nullptr;
+
+	_composite.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	_created++;
+	return &_composite;
+}
+
+ID3D11VertexShader* DxPipelineCache::VertexShader(uint32_t key, const uint8_t*& code, size_t& size)
+{
+	if (!_table.Find(kShaderVertex, key, code, size))
+		return nullptr;
+
+	if (!_vertexShaders[key])
+		CreateTrackedVertexShader(_device, _registry, code, size, &_vertexShaders[key], _vertexShaderHandles[key]);
+	return _vertexShaders[key];
+}
+
+ID3D11PixelShader* DxPipelineCache::PixelShader(uint32_t key)
+{
+	const uint8_t* code = nullptr;
+	size_t size = 0;
+	if (!_table.Find(kShaderPixel, key, code, size))
+		return nullptr;
+
+	if (!_pixelShaders[key])
+		CreateTrackedPixelShader(_device, _registry, code, size, &_pixelShaders[key], _pixelShaderHandles[key]);
+	return _pixelShaders[key];
+}
+
+ID3D11InputLayout* DxPipelineCache::InputLayout(bool instanced, const uint8_t* vsCode, size_t vsSize)
+{
+	ID3D11InputLayout*& layout = _layouts[instanced ? 1 : 0];
+	if (layout)
+		return layout;
+
+	// Slot 0 is the unit cube, slot 1 the per-instance data (BoundsInstance in InstanceBuffer.h).
+	// The constant color shaders ignore COLOR, unused elements are allowed.
+	D3D11_INPUT_ELEMENT_DESC elements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "INSTANCE_WVP", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE_WVP", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE_WVP", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE_WVP", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+	UINT count = instanced ? (UINT)(sizeof(elements) / sizeof(elements[0])) : 1;
+
+	_device->CreateInputLayout(elements, count, vsCode, vsSize, &layout);
+	return layout;
+}
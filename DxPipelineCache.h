@@ -0,0 +1,57 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11.h>
+
+#include "DxCommandBackend.h"
+#include "ResourceRegistry.h"
+#include "ShaderVariants.h"
+
+
+// Overlay pipelines keyed by ShaderVariantBits. The shaders come from the precompiled
+// table and are only created on the device the first time a variant is asked for, the
+// shaders and input layouts are shared between the variants using them.
+// Nothing is reported to Maya, so a warm-up can run on another thread (device creation
+// methods are free threaded), but one thread at a time.
+class DxPipelineCache
+{
+public:
+	// The table is not copied and must outlive the cache. The shaders are tracked as
+	// kResourceShaders when there is a registry.
+	DxPipelineCache(ID3D11Device* device, const uint8_t* table, size_t tableSize, ResourceRegistry* registry);
+	~DxPipelineCache();
+
+	// Null when the table has no shaders for the variant or they could not be created
+	const DxPipeline* Get(uint32_t variant);
+
+	// The full screen composite of the cached overlay layer, no input layout
+	const DxPipeline* Composite();
+
+	inline bool Valid() const { return _table.Count() != 0; }
+	inline size_t CreatedCount() const { return _created; }
+
+protected:
+	ID3D11VertexShader* VertexShader(uint32_t key, const uint8_t*& code, size_t& size);
+	ID3D11PixelShader* PixelShader(uint32_t key);
+	ID3D11InputLayout* InputLayout(bool instanced, const uint8_t* vsCode, size_t vsSize);
+
+	ID3D11Device* _device = nullptr;
+	ResourceRegistry* _registry = nullptr;
+	ShaderTable _table;
+
+	DxPipeline _pipelines[kVariantCount];
+	bool _tried[kVariantCount] = {};
+	size_t _created = 0;
+
+	// Indexed by ShaderKey()
+	ID3D11VertexShader* _vertexShaders[kVariantCount] = {};
+	ID3D11PixelShader* _pixelShaders[kVariantCount] = {};
+	ResourceHandle _vertexShaderHandles[kVariantCount] = {};
+	ResourceHandle _pixelShaderHandles[kVariantCount] = {};
+	ID3D11InputLayout* _layouts[2] = {};	// [instanced]
+
+	DxPipeline _composite;
+	ResourceHandle _compositeHandles[2] = {};	// vertex, pixel
+	bool _compositeTried = false;
+};
@@ -0,0 +1,127 @@
+#include "DxReadback.h"
+
+#include "DxResources.h"
+
+
+#define SafeRelease(p) if((p)){(p)->Release(); (p)=NULL;}
+
+
+DxReadback::DxReadback(ID3D11Device* device, ID3D11DeviceContext* context, uint32_t slotCount, ResourceRegistry* registry)
+{
+	_device = device;
+	_context = context;
+	_registry = registry;
+	_staging.resize(slotCount, nullptr);
+	_stagingHandles.resize(slotCount, 0);
+	_mapped.resize(slotCount, false);
+}
+
+DxReadback::~DxReadback()
+{
+	Release();
+	SafeRelease(_target);
+	_device = nullptr;
+	_context = nullptr;
+}
+
+void DxReadback::Release()
+{
+	for (size_t i = 0; i < _staging.size(); i++)
+	{
+		if (_mapped[i])
+			_context->Unmap(_staging[i], 0);
+		_mapped[i] = false;
+		ReleaseTracked(_registry, _staging[i], _stagingHandles[i]);
+	}
+	_width = 0;
+	_height = 0;
+	_format = DXGI_FORMAT_UNKNOWN;
+}
+
+bool DxReadback::SetTarget(ID3D11RenderTargetView* target, UINT width, UINT height)
+{
+	SafeRelease(_target);
+	if (!target)
+		return false;
+
+	ID3D11Resource* resource = nullptr;
+	target->GetResource(&resource);
+	HRESULT hr = resource ? resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&_target) : E_FAIL;
+	SafeRelease(resource);
+	if (FAILED(hr))
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc;
+	_target->GetDesc(&desc);
+	if (desc.Format != DXGI_FORMAT_R8G8B8A8_UNORM && desc.Format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+		return false;
+	if (width == 0 || width > desc.Width)
+		width = desc.Width;
+	if (height == 0 || height > desc.Height)
+		height = desc.Height;
+	if (width == _width && height == _height && desc.Format == _format)
+		return true;
+
+	Release();
+	D3D11_TEXTURE2D_DESC staging;
+	ZeroMemory(&staging, sizeof(staging));
+	staging.Width = width;
+	staging.Height = height;
+	staging.MipLevels = 1;
+	staging.ArraySize = 1;
+	staging.Format = desc.Format;
+	staging.SampleDesc.Count = 1;
+	staging.Usage = D3D11_USAGE_STAGING;
+	staging.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	for (size_t i = 0; i < _staging.size(); i++)
+	{
+		if (FAILED(CreateTrackedTexture2D(_device, _registry, kResourceStaging, staging, &_staging[i], _stagingHandles[i])))
+		{
+			Release();
+			return false;
+		}
+	}
+
+	_width = width;
+	_height = height;
+	_format = desc.Format;
+	return true;
+}
+
+bool DxReadback::Copy(uint32_t slot)
+{
+	if (!_target || slot >= _staging.size() || !_staging[slot] || _mapped[slot])
+		return false;
+
+	// Multisampled targets would need a resolve first, Maya's custom targets are not
+	D3D11_BOX box = { 0, 0, 0, _width, _height, 1 };
+	_context->CopySubresourceRegion(_staging[slot], 0, 0, 0, 0, _target, 0, &box);
+	return true;
+}
+
+bool DxReadback::Map(uint32_t slot, bool wait, ReadbackImage& image)
+{
+	if (slot >= _staging.size() || !_staging[slot])
+		return false;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT hr = _context->Map(_staging[slot], 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+	if (FAILED(hr))
+		return false;
+
+	_mapped[slot] = true;
+	image.pixels = (const uint8_t*)mapped.pData;
+	image.width = _width;
+	image.height = _height;
+	image.rowPitch = mapped.RowPitch;
+	return true;
+}
+
+void DxReadback::Unmap(uint32_t slot)
+{
+	if (slot < _staging.size() && _mapped[slot])
+	{
+		_context->Unmap(_staging[slot], 0);
+		_mapped[slot] = false;
+	}
+}
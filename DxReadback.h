@@ -0,0 +1,48 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11.h>
+
+#include <vector>
+
+#include "ReadbackQueue.h"
+#include "ResourceRegistry.h"
+
+
+// The ReadbackSource of D3D11: a ring of staging textures the size of the captured part of
+// a render target. Copy() queues a GPU copy, Map() with DO_NOT_WAIT tells whether the GPU
+// got to it, so the render thread never blocks on a copy it does not need yet.
+// Only the render thread may call it, the immediate context is not thread safe.
+class DxReadback : public ReadbackSource
+{
+public:
+	// The staging textures are tracked as kResourceStaging when there is a registry
+	DxReadback(ID3D11Device* device, ID3D11DeviceContext* context, uint32_t slotCount, ResourceRegistry* registry);
+	~DxReadback();
+
+	// The target copied by the next Copy() calls, its top-left width x height pixels. The
+	// staging textures are recreated when the size or format changes, which must not
+	// happen while slots are mapped. Only RGBA8 targets are supported.
+	bool SetTarget(ID3D11RenderTargetView* target, UINT width, UINT height);
+
+	bool Copy(uint32_t slot) override;
+	bool Map(uint32_t slot, bool wait, ReadbackImage& image) override;
+	void Unmap(uint32_t slot) override;
+
+	inline size_t Bytes() const { return _staging.size() * _width * _height * 4; }
+
+protected:
+	void Release();
+
+	ID3D11Device* _device = nullptr;
+	ID3D11DeviceContext* _context = nullptr;
+	ResourceRegistry* _registry = nullptr;
+	ID3D11Texture2D* _target = nullptr;
+	std::vector<ID3D11Texture2D*> _staging;
+	std::vector<ResourceHandle> _stagingHandles;
+	std::vector<bool> _mapped;
+	UINT _width = 0;
+	UINT _height = 0;
+	DXGI_FORMAT _format = DXGI_FORMAT_UNKNOWN;
+};
@@ -0,0 +1,77 @@
+#include "DxResources.h"
+
+
+static size_t BytesPerPixel(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return 8;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 16;
+	case DXGI_FORMAT_R8_UNORM:
+		return 1;
+	default:
+		// RGBA8, BGRA8, D24S8, D32 and R32
+		return 4;
+	}
+}
+
+size_t TextureBytes(const D3D11_TEXTURE2D_DESC& desc)
+{
+	size_t bytes = 0;
+	UINT width = desc.Width;
+	UINT height = desc.Height;
+	UINT levels = desc.MipLevels ? desc.MipLevels : 32;
+	for (UINT level = 0; level < levels; level++)
+	{
+		bytes += (size_t)width * height;
+		if (width == 1 && height == 1)
+			break;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	UINT samples = desc.SampleDesc.Count ? desc.SampleDesc.Count : 1;
+	return bytes * BytesPerPixel(desc.Format) * desc.ArraySize * samples;
+}
+
+HRESULT CreateTrackedBuffer(ID3D11Device* device, ResourceRegistry* registry, ResourceCategory category,
+	const D3D11_BUFFER_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Buffer** buffer, ResourceHandle& handle)
+{
+	handle = 0;
+	HRESULT hr = device->CreateBuffer(&desc, data, buffer);
+	if (SUCCEEDED(hr) && registry)
+		handle = registry->Track(category, desc.ByteWidth);
+	return hr;
+}
+
+HRESULT CreateTrackedTexture2D(ID3D11Device* device, ResourceRegistry* registry, ResourceCategory category,
+	const D3D11_TEXTURE2D_DESC& desc, ID3D11Texture2D** texture, ResourceHandle& handle)
+{
+	handle = 0;
+	HRESULT hr = device->CreateTexture2D(&desc, NULL, texture);
+	if (SUCCEEDED(hr) && registry)
+		handle = registry->Track(category, TextureBytes(desc));
+	return hr;
+}
+
+HRESULT CreateTrackedVertexShader(ID3D11Device* device, ResourceRegistry* registry,
+	const void* code, size_t size, ID3D11VertexShader** shader, ResourceHandle& handle)
+{
+	handle = 0;
+	HRESULT hr = device->CreateVertexShader(code, size, NULL, shader);
+	if (SUCCEEDED(hr) && registry)
+		handle = registry->Track(kResourceShaders, size);
+	return hr;
+}
+
+HRESULT CreateTrackedPixelShader(ID3D11Device* device, ResourceRegistry* registry,
+	const void* code, size_t size, ID3D11PixelShader** shader, ResourceHandle& handle)
+{
+	handle = 0;
+	HRESULT hr = device->CreatePixelShader(code, size, NULL, shader);
+	if (SUCCEEDED(hr) && registry)
+		handle = registry->Track(kResourceShaders, size);
+	return hr;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11.h>
+
+#include "ResourceRegistry.h"
+
+
+// Creation of the D3D11 resources through the ResourceRegistry: the resource is created,
+// then tracked under `category` with its size. The handle is 0 when creation failed or
+// there is no registry.
+HRESULT CreateTrackedBuffer(ID3D11Device* device, ResourceRegistry* registry, ResourceCategory category,
+	const D3D11_BUFFER_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Buffer** buffer, ResourceHandle& handle);
+HRESULT CreateTrackedTexture2D(ID3D11Device* device, ResourceRegistry* registry, ResourceCategory category,
+	const D3D11_TEXTURE2D_DESC& desc, ID3D11Texture2D** texture, ResourceHandle& handle);
+HRESULT CreateTrackedVertexShader(ID3D11Device* device, ResourceRegistry* registry,
+	const void* code, size_t size, ID3D11VertexShader** shader, ResourceHandle& handle);
+HRESULT CreateTrackedPixelShader(ID3D11Device* device, ResourceRegistry* registry,
+	const void* code, size_t size, ID3D11PixelShader** shader, ResourceHandle& handle);
+
+// All the mip levels and array slices
+size_t TextureBytes(const D3D11_TEXTURE2D_DESC& desc);
+
+// Releases the resource and untracks it, returns the bytes untracked
+template<class T>
+inline size_t ReleaseTracked(ResourceRegistry* registry, T*& resource, ResourceHandle& handle)
+{
+	if (resource)
+	{
+		resource->Release();
+		resource = nullptr;
+	}
+	size_t bytes = registry ? registry->Untrack(handle) : 0;
+	handle = 0;
+	return bytes;
+}
@@ -0,0 +1,152 @@
+#include "DxRingBuffer.h"
+
+#include <cstring>
+
+#include <maya/MGlobal.h>
+
+#include "DxResources.h"
+
+
+#define SafeRelease(p) if((p)){(p)->Release(); (p)=NULL;}
+
+
+DxRingBuffer::DxRingBuffer(ID3D11Device* device, UINT bindFlags, size_t capacity, ResourceRegistry* registry, ResourceCategory category)
+	: _device(device), _bindFlags(bindFlags), _registry(registry), _category(category)
+{
+	CreateBuffer(capacity);
+
+	D3D11_QUERY_DESC qd;
+	qd.Query = D3D11_QUERY_EVENT;
+	qd.MiscFlags = 0;
+	for (int i = 0; i < kMaxFramesInFlight; i++)
+	{
+		if (FAILED(_device->CreateQuery(&qd, &_fences[i])))
+		{
+			MGlobal::displayError("Failed to create ring buffer fence");
+			_fences[i] = nullptr;
+		}
+	}
+}
+
+DxRingBuffer::~DxRingBuffer()
+{
+	ReleaseTracked(_registry, _buffer, _bufferHandle);
+	for (int i = 0; i < kMaxFramesInFlight; i++)
+	{
+		SafeRelease(_fences[i]);
+	}
+	_device = nullptr;
+}
+
+bool DxRingBuffer::CreateBuffer(size_t capacity)
+{
+	ReleaseTracked(_registry, _buffer, _bufferHandle);
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = (UINT)capacity;
+	bd.BindFlags = _bindFlags;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	HRESULT hr = CreateTrackedBuffer(_device, _registry, _category, bd, NULL, &_buffer, _bufferHandle);
+	if (FAILED(hr))
+	{
+		MGlobal::displayError("Failed to create ring buffer");
+		_ring.Reset(0);
+		return false;
+	}
+
+	// A new buffer must be mapped with DISCARD first
+	_ring.Reset(capacity);
+	_discardNext = true;
+	return true;
+}
+
+void DxRingBuffer::BeginFrame(ID3D11DeviceContext* context)
+{
+	for (int i = 0; i < kMaxFramesInFlight; i++)
+	{
+		if (_fencePending[i] && context->GetData(_fences[i], NULL, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+		{
+			_fencePending[i] = false;
+			_ring.Retire(_fenceFrame[i]);
+		}
+	}
+}
+
+void DxRingBuffer::EndFrame(ID3D11DeviceContext* context)
+{
+	_ring.EndFrame(_frame);
+
+	int slot = (int)(_frame % kMaxFramesInFlight);
+	if (_fences[slot])
+	{
+		// All the slots are in flight, the GPU is kMaxFramesInFlight frames behind. Rather
+		// than wait for it, the next upload maps with DISCARD: the driver renames the buffer
+		// and the frames in flight keep the old memory, none of their fences is needed.
+		if (_fencePending[slot])
+		{
+			for (int i = 0; i < kMaxFramesInFlight; i++)
+				_fencePending[i] = false;
+			_discardNext = true;
+		}
+
+		context->End(_fences[slot]);
+		_fenceFrame[slot] = _frame;
+		_fencePending[slot] = true;
+	}
+	else
+	{
+		// No fence, only DISCARD is safe
+		_discardNext = true;
+	}
+
+	_frame++;
+}
+
+bool DxRingBuffer::Upload(ID3D11DeviceContext* context, const void* data, size_t size, size_t alignment, size_t& offset)
+{
+	return Write(context, data, size, size, alignment, offset);
+}
+
+bool DxRingBuffer::Write(ID3D11DeviceContext* context, const void* data, size_t size, size_t allocSize, size_t alignment, size_t& offset)
+{
+	if (!_buffer || allocSize > _ring.Capacity())
+	{
+		size_t capacity = _ring.Capacity() ? _ring.Capacity() : 64 * 1024;
+		while (capacity < allocSize)
+			capacity *= 2;
+		if (!CreateBuffer(capacity))
+			return false;
+	}
+
+	offset = _discardNext ? RingAllocator::kInvalidOffset : _ring.Allocate(allocSize, alignment);
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	if (offset == RingAllocator::kInvalidOffset)
+	{
+		// The GPU may still read the rest of the ring: let the driver rename the buffer
+		// and start again from the beginning, frames in flight keep the old memory.
+		_ring.Reset(_ring.Capacity());
+		for (int i = 0; i < kMaxFramesInFlight; i++)
+			_fencePending[i] = false;
+
+		offset = _ring.Allocate(allocSize, alignment);
+		mapType = D3D11_MAP_WRITE_DISCARD;
+		_discardNext = false;
+		_discards++;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT hr = context->Map(_buffer, 0, mapType, 0, &mapped);
+	if (FAILED(hr))
+	{
+		MGlobal::displayError("Failed to map ring buffer");
+		return false;
+	}
+	memcpy((unsigned char*)mapped.pData + offset, data, size);
+	context->Unmap(_buffer, 0);
+
+	return true;
+}
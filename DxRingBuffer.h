@@ -0,0 +1,62 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11_1.h>
+
+#include "ResourceRegistry.h"
+#include "RingAllocator.h"
+
+
+// A large D3D11_USAGE_DYNAMIC buffer sub-allocated per frame with a RingAllocator.
+// Data is written with MAP_WRITE_NO_OVERWRITE, an event query per frame tells when the
+// GPU is done with a frame's part of the ring. When the ring is full, or the GPU is so far
+// behind that every fence is in flight, the buffer is mapped with MAP_WRITE_DISCARD
+// instead and the ring starts over. The render thread never waits on the GPU.
+class DxRingBuffer
+{
+public:
+	// A "frame" is one BeginFrame/EndFrame pair, the overlay has one per panel drawn, so
+	// this covers a few refreshes of four panels
+	static const int kMaxFramesInFlight = 16;
+
+	// Alignment of constant blocks bound with *SetConstantBuffers1 (16 constants)
+	static const size_t kConstantAlignment = 256;
+
+	// The buffer is tracked under category when there is a registry
+	DxRingBuffer(ID3D11Device* device, UINT bindFlags, size_t capacity, ResourceRegistry* registry, ResourceCategory category);
+	~DxRingBuffer();
+
+	// Retire the frames the GPU has finished, call once before the frame's uploads
+	void BeginFrame(ID3D11DeviceContext* context);
+	void EndFrame(ID3D11DeviceContext* context);
+
+	// Copy `size` bytes into the ring, returns false if the buffer could not be mapped.
+	// The buffer grows when a single upload does not fit.
+	bool Upload(ID3D11DeviceContext* context, const void* data, size_t size, size_t alignment, size_t& offset);
+
+	inline ID3D11Buffer* Buffer() const { return _buffer; }
+	inline const RingAllocator& Allocator() const { return _ring; }
+	inline size_t DiscardCount() const { return _discards; }
+
+protected:
+	bool CreateBuffer(size_t capacity);
+	bool Write(ID3D11DeviceContext* context, const void* data, size_t size, size_t allocSize, size_t alignment, size_t& offset);
+
+	ID3D11Device* _device = nullptr;
+	ID3D11Buffer* _buffer = nullptr;
+	UINT _bindFlags = 0;
+	ResourceRegistry* _registry = nullptr;
+	ResourceCategory _category = kResourceBuffers;
+	ResourceHandle _bufferHandle = 0;
+
+	RingAllocator _ring;
+	bool _discardNext = true;
+	size_t _discards = 0;
+
+	// One event query per frame in flight, _fenceFrame[i] is the frame it was issued for
+	ID3D11Query* _fences[kMaxFramesInFlight] = {};
+	uint64_t _fenceFrame[kMaxFramesInFlight] = {};
+	bool _fencePending[kMaxFramesInFlight] = {};
+	uint64_t _frame = 0;
+};
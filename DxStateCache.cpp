@@ -0,0 +1,264 @@
+#include "DxStateCache.h"
+
+#include <maya/MGlobal.h>
+
+
+static MHWRender::MBlendState::BlendOption ToMayaBlend(D3D11_BLEND blend)
+{
+	switch (blend)
+	{
+	case D3D11_BLEND_ZERO: return MHWRender::MBlendState::kZero;
+	case D3D11_BLEND_SRC_COLOR: return MHWRender::MBlendState::kSourceColor;
+	case D3D11_BLEND_INV_SRC_COLOR: return MHWRender::MBlendState::kInvSourceColor;
+	case D3D11_BLEND_SRC_ALPHA: return MHWRender::MBlendState::kSourceAlpha;
+	case D3D11_BLEND_INV_SRC_ALPHA: return MHWRender::MBlendState::kInvSourceAlpha;
+	case D3D11_BLEND_DEST_ALPHA: return MHWRender::MBlendState::kDestinationAlpha;
+	case D3D11_BLEND_INV_DEST_ALPHA: return MHWRender::MBlendState::kInvDestinationAlpha;
+	case D3D11_BLEND_DEST_COLOR: return MHWRender::MBlendState::kDestinationColor;
+	case D3D11_BLEND_INV_DEST_COLOR: return MHWRender::MBlendState::kInvDestinationColor;
+	default: return MHWRender::MBlendState::kOne;
+	}
+}
+
+static MHWRender::MBlendState::BlendOperation ToMayaBlendOp(D3D11_BLEND_OP op)
+{
+	switch (op)
+	{
+	case D3D11_BLEND_OP_SUBTRACT: return MHWRender::MBlendState::kSubtract;
+	case D3D11_BLEND_OP_REV_SUBTRACT: return MHWRender::MBlendState::kReverseSubtract;
+	case D3D11_BLEND_OP_MIN: return MHWRender::MBlendState::kMin;
+	case D3D11_BLEND_OP_MAX: return MHWRender::MBlendState::kMax;
+	default: return MHWRender::MBlendState::kAdd;
+	}
+}
+
+// D3D11 numbers the functions from 1 (NEVER), Maya from 0 (kCompareNever)
+static MHWRender::MStateManager::CompareMode ToMayaCompare(D3D11_COMPARISON_FUNC func)
+{
+	switch (func)
+	{
+	case D3D11_COMPARISON_NEVER: return MHWRender::MStateManager::kCompareNever;
+	case D3D11_COMPARISON_LESS: return MHWRender::MStateManager::kCompareLess;
+	case D3D11_COMPARISON_EQUAL: return MHWRender::MStateManager::kCompareEqual;
+	case D3D11_COMPARISON_LESS_EQUAL: return MHWRender::MStateManager::kCompareLessEqual;
+	case D3D11_COMPARISON_GREATER: return MHWRender::MStateManager::kCompareGreater;
+	case D3D11_COMPARISON_NOT_EQUAL: return MHWRender::MStateManager::kCompareNotEqual;
+	case D3D11_COMPARISON_GREATER_EQUAL: return MHWRender::MStateManager::kCompareGreaterEqual;
+	case D3D11_COMPARISON_ALWAYS: return MHWRender::MStateManager::kCompareAlways;
+	default: return MHWRender::MStateManager::kCompareAlways;
+	}
+}
+
+
+DxStateCache::DxStateCache(ID3D11Device* device)
+	: _device(device)
+	, _rasterizer([this](const D3D11_RASTERIZER_DESC& d) { return CreateRasterizer(d); },
+		[](RasterizerState s) { if (s.mState) MHWRender::MStateManager::releaseRasterizerState(s.mState); else s.dxState->Release(); })
+	, _sampler([this](const D3D11_SAMPLER_DESC& d) { return CreateSampler(d); },
+		[](SamplerState s) { if (s.mState) MHWRender::MStateManager::releaseSamplerState(s.mState); else s.dxState->Release(); })
+	, _blend([this](const D3D11_BLEND_DESC& d) { return CreateBlend(d); },
+		[](BlendState s) { if (s.mState) MHWRender::MStateManager::releaseBlendState(s.mState); else s.dxState->Release(); })
+	, _depthStencil([this](const D3D11_DEPTH_STENCIL_DESC& d) { return CreateDepthStencil(d); },
+		[](DepthStencilState s) { if (s.mState) MHWRender::MStateManager::releaseDepthStencilState(s.mState); else s.dxState->Release(); })
+{
+}
+
+DxStateCache::~DxStateCache()
+{
+	Clear();
+	_device = nullptr;
+	_stateManager = nullptr;
+}
+
+void DxStateCache::Clear()
+{
+	_rasterizer.Clear();
+	_sampler.Clear();
+	_blend.Clear();
+	_depthStencil.Clear();
+}
+
+uint64_t DxStateCache::Hits() const
+{
+	return _rasterizer.Hits() + _sampler.Hits() + _blend.Hits() + _depthStencil.Hits();
+}
+
+uint64_t DxStateCache::Misses() const
+{
+	return _rasterizer.Misses() + _sampler.Misses() + _blend.Misses() + _depthStencil.Misses();
+}
+
+size_t DxStateCache::Size() const
+{
+	return _rasterizer.Size() + _sampler.Size() + _blend.Size() + _depthStencil.Size();
+}
+
+DxStateCache::RasterizerState DxStateCache::CreateRasterizer(const D3D11_RASTERIZER_DESC& desc)
+{
+	RasterizerState state;
+
+	if (_stateManager)
+	{
+		MHWRender::MRasterizerStateDesc rasterizerStateDesc;
+		rasterizerStateDesc.fillMode = desc.FillMode == D3D11_FILL_WIREFRAME ?
+			MHWRender::MRasterizerState::kFillWireFrame : MHWRender::MRasterizerState::kFillSolid;
+		rasterizerStateDesc.cullMode = desc.CullMode == D3D11_CULL_FRONT ? MHWRender::MRasterizerState::kCullFront :
+			desc.CullMode == D3D11_CULL_BACK ? MHWRender::MRasterizerState::kCullBack : MHWRender::MRasterizerState::kCullNone;
+		rasterizerStateDesc.frontCounterClockwise = desc.FrontCounterClockwise != FALSE;
+		rasterizerStateDesc.depthBiasIsFloat = true;
+		rasterizerStateDesc.depthBias = (float)desc.DepthBias;
+		rasterizerStateDesc.depthBiasClamp = desc.DepthBiasClamp;
+		rasterizerStateDesc.slopeScaledDepthBias = desc.SlopeScaledDepthBias;
+		rasterizerStateDesc.depthClipEnable = desc.DepthClipEnable != FALSE;
+		rasterizerStateDesc.scissorEnable = desc.ScissorEnable != FALSE;
+		rasterizerStateDesc.multiSampleEnable = desc.MultisampleEnable != FALSE;
+		rasterizerStateDesc.antialiasedLineEnable = desc.AntialiasedLineEnable != FALSE;
+
+		state.mState = _stateManager->acquireRasterizerState(rasterizerStateDesc);
+		if (state.mState)
+		{
+			state.dxState = (ID3D11RasterizerState*)state.mState->resourceHandle();
+			return state;
+		}
+	}
+
+	HRESULT hr = _device->CreateRasterizerState(&desc, &state.dxState);
+	if (FAILED(hr))
+	{
+		MGlobal::displayError("Failed to create raster state");
+		state.dxState = nullptr;
+	}
+	return state;
+}
+
+DxStateCache::SamplerState DxStateCache::CreateSampler(const D3D11_SAMPLER_DESC& desc)
+{
+	SamplerState state;
+
+	if (_stateManager)
+	{
+		MHWRender::MSamplerStateDesc sd;
+		sd.filter = desc.Filter == D3D11_FILTER_MIN_MAG_MIP_POINT ?
+			MHWRender::MSamplerState::kMinMagMipPoint : MHWRender::MSamplerState::kMinMagMipLinear;
+		sd.addressU = desc.AddressU == D3D11_TEXTURE_ADDRESS_WRAP ? MHWRender::MSamplerState::kTexWrap : MHWRender::MSamplerState::kTexClamp;
+		sd.addressV = desc.AddressV == D3D11_TEXTURE_ADDRESS_WRAP ? MHWRender::MSamplerState::kTexWrap : MHWRender::MSamplerState::kTexClamp;
+		sd.addressW = desc.AddressW == D3D11_TEXTURE_ADDRESS_WRAP ? MHWRender::MSamplerState::kTexWrap : MHWRender::MSamplerState::kTexClamp;
+		sd.mipLODBias = desc.MipLODBias;
+		sd.maxAnisotropy = desc.MaxAnisotropy;
+		sd.comparisonFn = ToMayaCompare(desc.ComparisonFunc);
+		for (int i = 0; i < 4; i++)
+			sd.borderColor[i] = desc.BorderColor[i];
+		sd.minLOD = desc.MinLOD;
+		sd.maxLOD = desc.MaxLOD;
+
+		state.mState = _stateManager->acquireSamplerState(sd);
+		if (state.mState)
+		{
+			state.dxState = (ID3D11SamplerState*)state.mState->resourceHandle();
+			return state;
+		}
+	}
+
+	HRESULT hr = _device->CreateSamplerState(&desc, &state.dxState);
+	if (FAILED(hr))
+	{
+		MGlobal::displayError("Failed to create sampler state");
+		state.dxState = nullptr;
+	}
+	return state;
+}
+
+DxStateCache::BlendState DxStateCache::CreateBlend(const D3D11_BLEND_DESC& desc)
+{
+	BlendState state;
+
+	if (_stateManager)
+	{
+		MHWRender::MBlendStateDesc bd;
+		bd.alphaToCoverageEnable = desc.AlphaToCoverageEnable != FALSE;
+		bd.independentBlendEnable = desc.IndependentBlendEnable != FALSE;
+		for (int i = 0; i < MHWRender::MBlendState::kMaxTargets && i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+		{
+			const D3D11_RENDER_TARGET_BLEND_DESC& rt = desc.RenderTarget[i];
+			MHWRender::MTargetBlendDesc& target = bd.targetBlends[i];
+			target.blendEnable = rt.BlendEnable != FALSE;
+			target.sourceBlend = ToMayaBlend(rt.SrcBlend);
+			target.destinationBlend = ToMayaBlend(rt.DestBlend);
+			target.blendOperation = ToMayaBlendOp(rt.BlendOp);
+			target.alphaSourceBlend = ToMayaBlend(rt.SrcBlendAlpha);
+			target.alphaDestinationBlend = ToMayaBlend(rt.DestBlendAlpha);
+			target.alphaBlendOperation = ToMayaBlendOp(rt.BlendOpAlpha);
+			target.targetWriteMask = rt.RenderTargetWriteMask;
+		}
+
+		state.mState = _stateManager->acquireBlendState(bd);
+		if (state.mState)
+		{
+			state.dxState = (ID3D11BlendState*)state.mState->resourceHandle();
+			return state;
+		}
+	}
+
+	HRESULT hr = _device->CreateBlendState(&desc, &state.dxState);
+	if (FAILED(hr))
+	{
+		MGlobal::displayError("Failed to create blend state");
+		state.dxState = nullptr;
+	}
+	return state;
+}
+
+DxStateCache::DepthStencilState DxStateCache::CreateDepthStencil(const D3D11_DEPTH_STENCIL_DESC& desc)
+{
+	DepthStencilState state;
+
+	if (_stateManager)
+	{
+		MHWRender::MDepthStencilStateDesc dd;
+		dd.depthEnable = desc.DepthEnable != FALSE;
+		dd.depthWriteEnable = desc.DepthWriteMask == D3D11_DEPTH_WRITE_MASK_ALL;
+		dd.depthFunc = ToMayaCompare(desc.DepthFunc);
+		dd.stencilEnable = desc.StencilEnable != FALSE;
+		dd.stencilReadMask = desc.StencilReadMask;
+		dd.stencilWriteMask = desc.StencilWriteMask;
+
+		state.mState = _stateManager->acquireDepthStencilState(dd);
+		if (state.mState)
+		{
+			state.dxState = (ID3D11DepthStencilState*)state.mState->resourceHandle();
+			return state;
+		}
+	}
+
+	HRESULT hr = _device->CreateDepthStencilState(&desc, &state.dxState);
+	if (FAILED(hr))
+	{
+		MGlobal::displayError("Failed to create depth stencil state");
+		state.dxState = nullptr;
+	}
+	return state;
+}
+
+void DxStateCache::Bind(ID3D11DeviceContext* context, const RasterizerState& state)
+{
+	if (!_stateManager || !state.mState || _stateManager->setRasterizerState(state.mState) != MStatus::kSuccess)
+		context->RSSetState(state.dxState);
+}
+
+void DxStateCache::Bind(ID3D11DeviceContext* context, unsigned int slot, const SamplerState& state)
+{
+	// Samplers are only read by our own pixel shaders, Maya does not need to track them
+	context->PSSetSamplers(slot, 1, &state.dxState);
+}
+
+void DxStateCache::Bind(ID3D11DeviceContext* context, const BlendState& state)
+{
+	if (!_stateManager || !state.mState || _stateManager->setBlendState(state.mState) != MStatus::kSuccess)
+		context->OMSetBlendState(state.dxState, NULL, 0xffffffff);
+}
+
+void DxStateCache::Bind(ID3D11DeviceContext* context, const DepthStencilState& state)
+{
+	if (!_stateManager || !state.mState || _stateManager->setDepthStencilState(state.mState) != MStatus::kSuccess)
+		context->OMSetDepthStencilState(state.dxState, 0);
+}
@@ -0,0 +1,72 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#include <maya/MStateManager.h>
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11.h>
+
+#include "StateCache.h"
+
+
+// A state object acquired through MStateManager, or created directly on the device when
+// the draw context has no state manager (mState is then null).
+template<class MState, class DxState>
+struct CachedState
+{
+	const MState* mState = nullptr;
+	DxState* dxState = nullptr;
+
+	explicit operator bool() const { return dxState != nullptr; }
+};
+
+
+// Rasterizer, sampler, blend and depth-stencil states of the overlay, keyed by their
+// D3D11 description. Each unique description is created once and released in Clear().
+class DxStateCache
+{
+public:
+	using RasterizerState = CachedState<MHWRender::MRasterizerState, ID3D11RasterizerState>;
+	using SamplerState = CachedState<MHWRender::MSamplerState, ID3D11SamplerState>;
+	using BlendState = CachedState<MHWRender::MBlendState, ID3D11BlendState>;
+	using DepthStencilState = CachedState<MHWRender::MDepthStencilState, ID3D11DepthStencilState>;
+
+	DxStateCache(ID3D11Device* device);
+	~DxStateCache();
+
+	// States missing from the cache are acquired from this state manager (may be null)
+	inline void SetStateManager(MHWRender::MStateManager* stateManager) { _stateManager = stateManager; }
+
+	// Descriptions must be zero-initialized before being filled in, see StateCache
+	inline RasterizerState Rasterizer(const D3D11_RASTERIZER_DESC& desc) { return _rasterizer.Acquire(desc); }
+	inline SamplerState Sampler(const D3D11_SAMPLER_DESC& desc) { return _sampler.Acquire(desc); }
+	inline BlendState Blend(const D3D11_BLEND_DESC& desc) { return _blend.Acquire(desc); }
+	inline DepthStencilState DepthStencil(const D3D11_DEPTH_STENCIL_DESC& desc) { return _depthStencil.Acquire(desc); }
+
+	// Bind through the state manager when the state came from it, so Maya's state
+	// shadowing stays correct, otherwise directly on the context
+	void Bind(ID3D11DeviceContext* context, const RasterizerState& state);
+	void Bind(ID3D11DeviceContext* context, unsigned int slot, const SamplerState& state);
+	void Bind(ID3D11DeviceContext* context, const BlendState& state);
+	void Bind(ID3D11DeviceContext* context, const DepthStencilState& state);
+
+	void Clear();
+
+	uint64_t Hits() const;
+	uint64_t Misses() const;
+	size_t Size() const;
+
+protected:
+	RasterizerState CreateRasterizer(const D3D11_RASTERIZER_DESC& desc);
+	SamplerState CreateSampler(const D3D11_SAMPLER_DESC& desc);
+	BlendState CreateBlend(const D3D11_BLEND_DESC& desc);
+	DepthStencilState CreateDepthStencil(const D3D11_DEPTH_STENCIL_DESC& desc);
+
+	ID3D11Device* _device = nullptr;
+	MHWRender::MStateManager* _stateManager = nullptr;
+
+	StateCache<D3D11_RASTERIZER_DESC, RasterizerState> _rasterizer;
+	StateCache<D3D11_SAMPLER_DESC, SamplerState> _sampler;
+	StateCache<D3D11_BLEND_DESC, BlendState> _blend;
+	StateCache<D3D11_DEPTH_STENCIL_DESC, DepthStencilState> _depthStencil;
+};
@@ -0,0 +1,76 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+// std::max takes it by reference
+const size_t FrameArena::kMaxAlignment;
+
+FrameArena::FrameArena(size_t blockSize)
+	: _blockSize(std::max<size_t>(blockSize, kMaxAlignment))
+{
+}
+
+FrameArena::~FrameArena()
+{
+	for (Block& block : _blocks)
+		delete[] block.data;
+}
+
+void FrameArena::AddBlock(size_t minSize)
+{
+	// Room to align the start of the block too
+	Block block;
+	block.size = std::max(_blockSize, minSize + kMaxAlignment);
+	block.data = new char[block.size];
+	_blocks.push_back(block);
+	_capacity += block.size;
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t alignment)
+{
+	if (bytes == 0)
+		bytes = 1;
+
+	while (true)
+	{
+		if (_current < _blocks.size())
+		{
+			Block& block = _blocks[_current];
+			uintptr_t base = (uintptr_t)block.data;
+			uintptr_t start = (base + _offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+			if (start + bytes <= base + block.size)
+			{
+				_used += start + bytes - (base + _offset);
+				_offset = start + bytes - base;
+				_peak = std::max(_peak, _used);
+				return (void*)start;
+			}
+
+			// The end of this block is wasted for this frame
+			_current++;
+			_offset = 0;
+			continue;
+		}
+		AddBlock(bytes);
+	}
+}
+
+void FrameArena::Reset()
+{
+	// Merge the blocks of a frame that overflowed the first one
+	if (_blocks.size() > 1)
+	{
+		size_t total = _capacity;
+		for (Block& block : _blocks)
+			delete[] block.data;
+		_blocks.clear();
+		_capacity = 0;
+		AddBlock(total);
+	}
+
+	_current = 0;
+	_offset = 0;
+	_used = 0;
+}
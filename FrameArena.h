@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+
+// Fixed-capacity array whose storage belongs to a FrameArena, valid until its Reset()
+template<class T>
+class FrameArray
+{
+public:
+	FrameArray() {}
+	FrameArray(T* data, size_t capacity) : _data(data), _capacity(capacity) {}
+
+	inline void Push(const T& value) { _data[_count++] = value; }
+	inline void Clear() { _count = 0; }
+
+	// Shrinks, or grows up to the capacity (the new elements are not initialized)
+	inline void Resize(size_t count) { _count = count < _capacity ? count : _capacity; }
+
+	inline T& operator[](size_t index) { return _data[index]; }
+	inline const T& operator[](size_t index) const { return _data[index]; }
+	inline T* Data() { return _data; }
+	inline const T* Data() const { return _data; }
+	inline size_t Count() const { return _count; }
+	inline size_t Capacity() const { return _capacity; }
+	inline bool Empty() const { return _count == 0; }
+
+	inline T* begin() { return _data; }
+	inline T* end() { return _data + _count; }
+	inline const T* begin() const { return _data; }
+	inline const T* end() const { return _data + _count; }
+
+protected:
+	T* _data = nullptr;
+	size_t _count = 0;
+	size_t _capacity = 0;
+};
+
+
+// Linear allocator for the transient arrays of a frame. Allocations are never freed one
+// by one, Reset() rewinds the arena for the next frame and keeps its memory. When a frame
+// did not fit in one block, the blocks are merged into a single one big enough for it, so
+// after a few frames every frame is served from one block.
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t blockSize = 1 << 20);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// alignment is a power of two, at most kMaxAlignment
+	void* Allocate(size_t bytes, size_t alignment = kMaxAlignment);
+
+	// Room for `capacity` elements, empty. Only for types that need no destructor.
+	template<class T>
+	FrameArray<T> Array(size_t capacity)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "the arena does not run destructors");
+		static_assert(alignof(T) <= kMaxAlignment, "over-aligned type");
+		return FrameArray<T>((T*)Allocate(capacity * sizeof(T), alignof(T)), capacity);
+	}
+
+	void Reset();
+
+	inline size_t Used() const { return _used; }
+	inline size_t Peak() const { return _peak; }
+	inline size_t Capacity() const { return _capacity; }
+	inline size_t BlockCount() const { return _blocks.size(); }
+
+	static const size_t kMaxAlignment = 64;
+
+protected:
+	struct Block
+	{
+		char* data;
+		size_t size;
+	};
+
+	void AddBlock(size_t minSize);
+
+	std::vector<Block> _blocks;
+	size_t _blockSize;
+	size_t _current = 0;	// block allocations come from
+	size_t _offset = 0;		// in the current block
+	size_t _used = 0;
+	size_t _peak = 0;
+	size_t _capacity = 0;
+};
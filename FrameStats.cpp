@@ -0,0 +1,96 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+
+
+int FrameStats::Stage(const std::string& name)
+{
+	for (size_t i = 0; i < _stages.size(); i++)
+	{
+		if (_stages[i].name == name)
+			return (int)i;
+	}
+
+	StageHistory stage;
+	stage.name = name;
+	stage.samples.resize(kHistory);
+	_stages.push_back(stage);
+	return (int)_stages.size() - 1;
+}
+
+int FrameStats::Counter(const std::string& name)
+{
+	for (size_t i = 0; i < _counters.size(); i++)
+	{
+		if (_counters[i].name == name)
+			return (int)i;
+	}
+
+	CounterEntry counter;
+	counter.name = name;
+	_counters.push_back(counter);
+	return (int)_counters.size() - 1;
+}
+
+void FrameStats::SetCounter(int counter, double value)
+{
+	if (counter >= 0 && (size_t)counter < _counters.size())
+		_counters[counter].value = value;
+}
+
+void FrameStats::Record(int stage, double ms)
+{
+	if (stage < 0 || (size_t)stage >= _stages.size())
+		return;
+
+	StageHistory& history = _stages[stage];
+	history.samples[history.next] = ms;
+	history.next = (history.next + 1) % kHistory;
+	history.count = std::min(history.count + 1, kHistory);
+}
+
+StageSummary FrameStats::Summary(int stage, size_t frames) const
+{
+	StageSummary summary;
+	if (stage < 0 || (size_t)stage >= _stages.size())
+		return summary;
+
+	const StageHistory& history = _stages[stage];
+	size_t count = (frames == 0) ? history.count : std::min(frames, history.count);
+	if (count == 0)
+		return summary;
+
+	// The newest `count` samples, walking back from the ring head
+	std::vector<double> samples(count);
+	for (size_t i = 0; i < count; i++)
+		samples[i] = history.samples[(history.next + kHistory - 1 - i) % kHistory];
+
+	double sum = 0.0;
+	summary.minMs = samples[0];
+	summary.maxMs = samples[0];
+	for (double ms : samples)
+	{
+		sum += ms;
+		summary.minMs = std::min(summary.minMs, ms);
+		summary.maxMs = std::max(summary.maxMs, ms);
+	}
+	summary.avgMs = sum / (double)count;
+	summary.samples = count;
+
+	// Nearest-rank percentile
+	size_t rank = (count * 95 + 99) / 100;
+	std::nth_element(samples.begin(), samples.begin() + (rank - 1), samples.end());
+	summary.p95Ms = samples[rank - 1];
+
+	return summary;
+}
+
+void FrameStats::Reset()
+{
+	for (StageHistory& history : _stages)
+	{
+		history.next = 0;
+		history.count = 0;
+	}
+	_frames = 0;
+}
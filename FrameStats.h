@@ -0,0 +1,95 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct StageSummary
+{
+	double minMs = 0.0;
+	double avgMs = 0.0;
+	double p95Ms = 0.0;
+	double maxMs = 0.0;
+	size_t samples = 0;
+};
+
+
+// Rolling timings of named frame stages. Each stage keeps its last kHistory samples in
+// milliseconds; CPU stages get one sample per frame, GPU stages arrive a few frames late.
+class FrameStats
+{
+public:
+	static const size_t kHistory = 1024;
+
+	using Clock = std::chrono::steady_clock;
+
+	// Id of the stage with this name, added on first use
+	int Stage(const std::string& name);
+
+	void Record(int stage, double ms);
+
+	// Over the last `frames` samples of the stage (all of them when 0)
+	StageSummary Summary(int stage, size_t frames = 0) const;
+
+	// Values that are not timings (memory, hit rates, ...), the last one set is reported
+	int Counter(const std::string& name);
+	void SetCounter(int counter, double value);
+
+	inline void EndFrame() { _frames++; }
+	void Reset();
+
+	inline size_t StageCount() const { return _stages.size(); }
+	inline const std::string& StageName(int stage) const { return _stages[stage].name; }
+	inline uint64_t Frames() const { return _frames; }
+
+	inline size_t CounterCount() const { return _counters.size(); }
+	inline const std::string& CounterName(int counter) const { return _counters[counter].name; }
+	inline double CounterValue(int counter) const { return _counters[counter].value; }
+
+	static inline double Milliseconds(Clock::time_point start, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+protected:
+	struct StageHistory
+	{
+		std::string name;
+		std::vector<double> samples;	// ring of kHistory
+		size_t next = 0;
+		size_t count = 0;
+	};
+
+	struct CounterEntry
+	{
+		std::string name;
+		double value = 0.0;
+	};
+
+	std::vector<StageHistory> _stages;
+	std::vector<CounterEntry> _counters;
+	uint64_t _frames = 0;
+};
+
+
+// Records the time spent in its scope into a stage, stats may be null
+class ScopedStageTimer
+{
+public:
+	ScopedStageTimer(FrameStats* stats, int stage) : _stats(stats), _stage(stage), _start(FrameStats::Clock::now()) {}
+	~ScopedStageTimer()
+	{
+		if (_stats)
+			_stats->Record(_stage, FrameStats::Milliseconds(_start, FrameStats::Clock::now()));
+	}
+
+	ScopedStageTimer(const ScopedStageTimer&) = delete;
+	ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+protected:
+	FrameStats* _stats;
+	int _stage;
+	FrameStats::Clock::time_point _start;
+};
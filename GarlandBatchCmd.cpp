@@ -0,0 +1,192 @@
+#include "GarlandBatchCmd.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <maya/M3dView.h>
+#include <maya/MAnimControl.h>
+#include <maya/MArgDatabase.h>
+#include <maya/MComputation.h>
+#include <maya/MGlobal.h>
+#include <maya/MTime.h>
+#include <maya/MViewport2Renderer.h>
+
+#include "GarlandRender.h"
+
+
+const char* GarlandBatchCmd::kName = "garlandBatch";
+
+static const char* kOutputFlag = "-o";
+static const char* kOutputFlagLong = "-output";
+static const char* kStartFlag = "-sf";
+static const char* kStartFlagLong = "-startFrame";
+static const char* kEndFlag = "-ef";
+static const char* kEndFlagLong = "-endFrame";
+static const char* kStepFlag = "-by";
+static const char* kStepFlagLong = "-step";
+static const char* kPanelFlag = "-p";
+static const char* kPanelFlagLong = "-panel";
+static const char* kRingFlag = "-rs";
+static const char* kRingFlagLong = "-ring";
+static const char* kWritersFlag = "-w";
+static const char* kWritersFlagLong = "-writers";
+static const char* kImageWidthFlag = "-iw";
+static const char* kImageWidthFlagLong = "-imageWidth";
+static const char* kImageHeightFlag = "-ih";
+static const char* kImageHeightFlagLong = "-imageHeight";
+static const char* kTileSizeFlag = "-ts";
+static const char* kTileSizeFlagLong = "-tileSize";
+
+MSyntax GarlandBatchCmd::newSyntax()
+{
+	MSyntax syntax;
+	syntax.addFlag(kOutputFlag, kOutputFlagLong, MSyntax::kString);
+	syntax.addFlag(kStartFlag, kStartFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kEndFlag, kEndFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kStepFlag, kStepFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kPanelFlag, kPanelFlagLong, MSyntax::kString);
+	syntax.addFlag(kRingFlag, kRingFlagLong, MSyntax::kUnsigned);
+	syntax.addFlag(kWritersFlag, kWritersFlagLong, MSyntax::kUnsigned);
+	syntax.addFlag(kImageWidthFlag, kImageWidthFlagLong, MSyntax::kUnsigned);
+	syntax.addFlag(kImageHeightFlag, kImageHeightFlagLong, MSyntax::kUnsigned);
+	syntax.addFlag(kTileSizeFlag, kTileSizeFlagLong, MSyntax::kUnsigned);
+	return syntax;
+}
+
+MStatus GarlandBatchCmd::doIt(const MArgList& args)
+{
+	MStatus status;
+	MArgDatabase argData(syntax(), args, &status);
+	if (!status)
+		return status;
+
+	MHWRender::MRenderer* renderer = MHWRender::MRenderer::theRenderer();
+	const MHWRender::MRenderOverride* overridePtr = renderer ? renderer->findRenderOverride("GarlandViewport") : nullptr;
+	if (!overridePtr)
+	{
+		MGlobal::displayError("GarlandViewport is not registered");
+		return MStatus::kFailure;
+	}
+
+	// Registered by this plugin, so it is ours
+	GarlandRenderOverride* gr = const_cast<GarlandRenderOverride*>(static_cast<const GarlandRenderOverride*>(overridePtr));
+
+	MString output;
+	if (!argData.isFlagSet(kOutputFlag) || argData.getFlagArgument(kOutputFlag, 0, output) != MStatus::kSuccess ||
+		output.length() == 0)
+	{
+		MGlobal::displayError("garlandBatch: -output is required");
+		return MStatus::kInvalidParameter;
+	}
+
+	double start = MAnimControl::minTime().as(MTime::uiUnit());
+	double end = MAnimControl::maxTime().as(MTime::uiUnit());
+	double step = 1.0;
+	if (argData.isFlagSet(kStartFlag))
+		argData.getFlagArgument(kStartFlag, 0, start);
+	if (argData.isFlagSet(kEndFlag))
+		argData.getFlagArgument(kEndFlag, 0, end);
+	if (argData.isFlagSet(kStepFlag))
+		argData.getFlagArgument(kStepFlag, 0, step);
+	if (step <= 0.0 || end < start)
+	{
+		MGlobal::displayError("garlandBatch: the step must be positive and the range not empty");
+		return MStatus::kInvalidParameter;
+	}
+
+	unsigned int ring = 3;
+	unsigned int writers = 2;
+	if (argData.isFlagSet(kRingFlag))
+		argData.getFlagArgument(kRingFlag, 0, ring);
+	if (argData.isFlagSet(kWritersFlag))
+		argData.getFlagArgument(kWritersFlag, 0, writers);
+
+	// Both sizes, or none for the viewport's images. The tile is a D3D11 texture.
+	unsigned int imageWidth = 0;
+	unsigned int imageHeight = 0;
+	unsigned int tileSize = 1024;
+	if (argData.isFlagSet(kImageWidthFlag))
+		argData.getFlagArgument(kImageWidthFlag, 0, imageWidth);
+	if (argData.isFlagSet(kImageHeightFlag))
+		argData.getFlagArgument(kImageHeightFlag, 0, imageHeight);
+	if (argData.isFlagSet(kTileSizeFlag))
+		argData.getFlagArgument(kTileSizeFlag, 0, tileSize);
+	if ((imageWidth == 0) != (imageHeight == 0) || imageWidth > 0xffff || imageHeight > 0xffff ||
+		tileSize == 0 || tileSize > 16384)
+	{
+		MGlobal::displayError("garlandBatch: -imageWidth and -imageHeight go together, up to 65535, "
+			"and the tile size up to 16384");
+		return MStatus::kInvalidParameter;
+	}
+
+	M3dView view;
+	if (argData.isFlagSet(kPanelFlag))
+	{
+		MString panel;
+		argData.getFlagArgument(kPanelFlag, 0, panel);
+		status = M3dView::getM3dViewFromModelPanel(panel, view);
+	}
+	else
+	{
+		view = M3dView::active3dView(&status);
+	}
+	if (!status || view.renderOverrideName() != MString("GarlandViewport"))
+	{
+		MGlobal::displayError("garlandBatch: the panel must be a model panel drawn by GarlandViewport");
+		return MStatus::kInvalidParameter;
+	}
+
+	if (!gr->BeginBatch(ring, writers, imageWidth, imageHeight, tileSize))
+	{
+		MGlobal::displayError("garlandBatch: the override has not drawn yet");
+		return MStatus::kFailure;
+	}
+
+	// Whole steps are named after their frame, fractional ones after their index
+	bool wholeFrames = step == std::floor(step) && start == std::floor(start);
+	MTime originalTime = MAnimControl::currentTime();
+	FrameStats::Clock::time_point began = FrameStats::Clock::now();
+	uint64_t frames = 0, missed = 0;
+	bool interrupted = false;
+
+	MComputation computation;
+	computation.beginComputation();
+	for (double t = start; t <= end + 1e-6 * step; t = start + step * (double)frames)
+	{
+		if (computation.isInterruptRequested())
+		{
+			interrupted = true;
+			break;
+		}
+
+		MAnimControl::setCurrentTime(MTime(t, MTime::uiUnit()));
+		long long number = wholeFrames ? (long long)std::llround(t) : (long long)frames;
+		char path[1024];
+		snprintf(path, sizeof(path), "%s.%04lld.tga", output.asChar(), number);
+
+		gr->SetBatchFrame(number, path);
+		view.refresh(false, true, true);
+		if (gr->BatchFramePending())
+			missed++;
+		frames++;
+	}
+	computation.endComputation();
+
+	ReadbackQueue::Stats stats = gr->EndBatch();
+	double seconds = FrameStats::Milliseconds(began, FrameStats::Clock::now()) / 1000.0;
+	MAnimControl::setCurrentTime(originalTime);
+
+	char line[512];
+	snprintf(line, sizeof(line),
+		"frames=%llu captured=%llu written=%llu failed=%llu missed=%llu stalls=%llu stallMs=%.3f MB=%.3f "
+		"maxInFlight=%u seconds=%.3f fps=%.2f%s",
+		(unsigned long long)frames, (unsigned long long)stats.captured, (unsigned long long)stats.written,
+		(unsigned long long)stats.failed, (unsigned long long)missed, (unsigned long long)stats.stalls,
+		stats.stallMs, stats.bytes / (1024.0 * 1024.0), stats.maxInFlight, seconds,
+		seconds > 0.0 ? frames / seconds : 0.0, interrupted ? " interrupted" : "");
+	setResult(MString(line));
+
+	if (stats.failed || missed)
+		MGlobal::displayWarning("garlandBatch: some frames were not written");
+	return MStatus::kSuccess;
+}
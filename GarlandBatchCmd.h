@@ -0,0 +1,26 @@
+#pragma once
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+
+
+// garlandBatch -output prefix [-startFrame F] [-endFrame F] [-step F] [-panel name]
+//              [-ring N] [-writers N] [-imageWidth W -imageHeight H [-tileSize T]]
+// Renders a frame range offscreen through the GarlandViewport override of a model panel
+// (the active one by default) and writes every frame to prefix.####.tga. The frames are
+// read back through a ring of N staging textures (3 by default) mapped a few frames after
+// their copy, and written by a pool of threads (2 by default). Returns one line with the
+// frame, stall and byte counts. Esc interrupts it.
+// With an image size the files hold the overlay alone at W x H, larger than the viewport if
+// need be: it is drawn in T x T tiles (1024 by default), each streamed into the file once
+// read back, so the memory used does not grow with the image. The counts are then tiles.
+class GarlandBatchCmd : public MPxCommand
+{
+public:
+	static const char* kName;
+
+	MStatus doIt(const MArgList& args) override;
+	bool isUndoable() const override { return false; }
+
+	static void* creator() { return new GarlandBatchCmd; }
+	static MSyntax newSyntax();
+};
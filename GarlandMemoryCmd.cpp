@@ -0,0 +1,104 @@
+#include "GarlandMemoryCmd.h"
+
+#include <cstdio>
+
+#include <maya/MArgDatabase.h>
+#include <maya/MGlobal.h>
+#include <maya/MStringArray.h>
+#include <maya/MViewport2Renderer.h>
+
+#include "GarlandRender.h"
+
+
+const char* GarlandMemoryCmd::kName = "garlandMemory";
+
+static const char* kGpuBudgetFlag = "-gb";
+static const char* kGpuBudgetFlagLong = "-gpuBudget";
+static const char* kCpuBudgetFlag = "-cb";
+static const char* kCpuBudgetFlagLong = "-cpuBudget";
+static const char* kHudFlag = "-hud";
+static const char* kHudFlagLong = "-hudLine";
+static const char* kResetPeaksFlag = "-rp";
+static const char* kResetPeaksFlagLong = "-resetPeaks";
+
+MSyntax GarlandMemoryCmd::newSyntax()
+{
+	MSyntax syntax;
+	syntax.addFlag(kGpuBudgetFlag, kGpuBudgetFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kCpuBudgetFlag, kCpuBudgetFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kHudFlag, kHudFlagLong, MSyntax::kBoolean);
+	syntax.addFlag(kResetPeaksFlag, kResetPeaksFlagLong);
+	return syntax;
+}
+
+static bool GetBudget(const MArgDatabase& argData, const char* flag, double& budget)
+{
+	if (!argData.isFlagSet(flag))
+		return true;
+
+	double value = 0.0;
+	argData.getFlagArgument(flag, 0, value);
+	if (value < 0.0)
+	{
+		MGlobal::displayError("garlandMemory: a budget is 0 (none) or positive");
+		return false;
+	}
+	budget = value;
+	return true;
+}
+
+MStatus GarlandMemoryCmd::doIt(const MArgList& args)
+{
+	MStatus status;
+	MArgDatabase argData(syntax(), args, &status);
+	if (!status)
+		return status;
+
+	MHWRender::MRenderer* renderer = MHWRender::MRenderer::theRenderer();
+	const MHWRender::MRenderOverride* overridePtr = renderer ? renderer->findRenderOverride("GarlandViewport") : nullptr;
+	if (!overridePtr)
+	{
+		MGlobal::displayError("GarlandViewport is not registered");
+		return MStatus::kFailure;
+	}
+
+	// Registered by this plugin, so it is ours
+	GarlandRenderOverride* gr = const_cast<GarlandRenderOverride*>(static_cast<const GarlandRenderOverride*>(overridePtr));
+	OverlaySettings& overlay = gr->Overlay();
+	ResourceRegistry& resources = gr->Resources();
+
+	// Applied by the next frame
+	if (!GetBudget(argData, kGpuBudgetFlag, overlay.gpuBudgetMB) || !GetBudget(argData, kCpuBudgetFlag, overlay.cpuBudgetMB))
+		return MStatus::kInvalidParameter;
+
+	if (argData.isFlagSet(kHudFlag))
+		argData.getFlagArgument(kHudFlag, 0, overlay.memoryHud);
+
+	if (argData.isFlagSet(kResetPeaksFlag))
+		resources.ResetPeaks();
+
+	MStringArray lines;
+	char line[256];
+	for (int c = 0; c < kResourceCategoryCount; c++)
+	{
+		ResourceCategory category = (ResourceCategory)c;
+		ResourceUsage usage = resources.Usage(category);
+		snprintf(line, sizeof(line), "%s.%s bytes=%zu peak=%zu count=%zu allocations=%u frees=%u allocated=%zu freed=%zu",
+			ResourceMemoryName(ResourceCategoryMemory(category)), ResourceCategoryName(category),
+			usage.bytes, usage.peakBytes, usage.count, usage.lastFrame.allocations, usage.lastFrame.frees,
+			usage.lastFrame.allocatedBytes, usage.lastFrame.freedBytes);
+		lines.append(line);
+	}
+
+	for (int m = 0; m < kMemoryCount; m++)
+	{
+		ResourceMemory memory = (ResourceMemory)m;
+		snprintf(line, sizeof(line), "%s.total bytes=%zu peak=%zu budget=%zu evicted=%llu",
+			ResourceMemoryName(memory), resources.Bytes(memory), resources.PeakBytes(memory),
+			resources.Budget(memory), (unsigned long long)resources.EvictedBytes(memory));
+		lines.append(line);
+	}
+
+	setResult(lines);
+	return MStatus::kSuccess;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+
+
+// garlandMemory [-gpuBudget MB] [-cpuBudget MB] [-hud on|off] [-resetPeaks]
+// Returns one line per resource category of the GarlandViewport override: its memory,
+// bytes, peak, count and the allocations and frees of the last frame, then one line per
+// memory with its totals, budget and the bytes evicted so far. Over a budget (0 for none)
+// the mesh cache and the layers of idle panels give memory back at the end of each frame.
+// -hud draws the totals in the viewport HUD.
+class GarlandMemoryCmd : public MPxCommand
+{
+public:
+	static const char* kName;
+
+	MStatus doIt(const MArgList& args) override;
+	bool isUndoable() const override { return false; }
+
+	static void* creator() { return new GarlandMemoryCmd; }
+	static MSyntax newSyntax();
+};
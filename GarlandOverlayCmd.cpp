@@ -0,0 +1,95 @@
+#include "GarlandOverlayCmd.h"
+
+#include <maya/MArgDatabase.h>
+#include <maya/MGlobal.h>
+#include <maya/MViewport2Renderer.h>
+
+#include "GarlandRender.h"
+
+
+const char* GarlandOverlayCmd::kName = "garlandOverlay";
+
+static const char* kModeFlag = "-m";
+static const char* kModeFlagLong = "-mode";
+static const char* kBudgetFlag = "-ub";
+static const char* kBudgetFlagLong = "-uploadBudget";
+static const char* kOcclusionFlag = "-oc";
+static const char* kOcclusionFlagLong = "-occlusion";
+static const char* kDynamicFlag = "-dr";
+static const char* kDynamicFlagLong = "-dynamicResolution";
+static const char* kFrameBudgetFlag = "-fb";
+static const char* kFrameBudgetFlagLong = "-frameBudget";
+
+MSyntax GarlandOverlayCmd::newSyntax()
+{
+	MSyntax syntax;
+	syntax.addFlag(kModeFlag, kModeFlagLong, MSyntax::kString);
+	syntax.addFlag(kBudgetFlag, kBudgetFlagLong, MSyntax::kDouble);
+	syntax.addFlag(kOcclusionFlag, kOcclusionFlagLong, MSyntax::kBoolean);
+	syntax.addFlag(kDynamicFlag, kDynamicFlagLong, MSyntax::kBoolean);
+	syntax.addFlag(kFrameBudgetFlag, kFrameBudgetFlagLong, MSyntax::kDouble);
+	return syntax;
+}
+
+MStatus GarlandOverlayCmd::doIt(const MArgList& args)
+{
+	MStatus status;
+	MArgDatabase argData(syntax(), args, &status);
+	if (!status)
+		return status;
+
+	MHWRender::MRenderer* renderer = MHWRender::MRenderer::theRenderer();
+	const MHWRender::MRenderOverride* overridePtr = renderer ? renderer->findRenderOverride("GarlandViewport") : nullptr;
+	if (!overridePtr)
+	{
+		MGlobal::displayError("GarlandViewport is not registered");
+		return MStatus::kFailure;
+	}
+
+	// Registered by this plugin, so it is ours
+	OverlaySettings& overlay = const_cast<GarlandRenderOverride*>(static_cast<const GarlandRenderOverride*>(overridePtr))->Overlay();
+
+	if (argData.isFlagSet(kModeFlag))
+	{
+		MString name;
+		argData.getFlagArgument(kModeFlag, 0, name);
+		if (!ParseOverlayMode(name.asChar(), overlay.mode))
+		{
+			MGlobal::displayError("garlandOverlay: the mode is bounds, wireframe or shaded");
+			return MStatus::kInvalidParameter;
+		}
+	}
+
+	if (argData.isFlagSet(kBudgetFlag))
+	{
+		double budget = 0.0;
+		argData.getFlagArgument(kBudgetFlag, 0, budget);
+		if (budget <= 0.0)
+		{
+			MGlobal::displayError("garlandOverlay: the upload budget must be positive");
+			return MStatus::kInvalidParameter;
+		}
+		overlay.uploadBudgetMB = budget;
+	}
+
+	if (argData.isFlagSet(kOcclusionFlag))
+		argData.getFlagArgument(kOcclusionFlag, 0, overlay.occlusion);
+
+	if (argData.isFlagSet(kDynamicFlag))
+		argData.getFlagArgument(kDynamicFlag, 0, overlay.dynamicResolution);
+
+	if (argData.isFlagSet(kFrameBudgetFlag))
+	{
+		double budget = 0.0;
+		argData.getFlagArgument(kFrameBudgetFlag, 0, budget);
+		if (budget <= 0.0)
+		{
+			MGlobal::displayError("garlandOverlay: the frame budget must be positive");
+			return MStatus::kInvalidParameter;
+		}
+		overlay.frameBudgetMs = budget;
+	}
+
+	setResult(OverlayModeName(overlay.mode));
+	return MStatus::kSuccess;
+}
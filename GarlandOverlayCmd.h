@@ -0,0 +1,21 @@
+#pragma once
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+
+
+// garlandOverlay [-mode bounds|wireframe|shaded] [-uploadBudget MB] [-occlusion on|off]
+//                [-dynamicResolution on|off] [-frameBudget ms]
+// Sets what the GarlandViewport overlay draws for the meshes, how much mesh data it
+// uploads per frame, whether it culls occluded objects and whether it lowers its
+// resolution while the camera moves. Returns the current mode.
+class GarlandOverlayCmd : public MPxCommand
+{
+public:
+	static const char* kName;
+
+	MStatus doIt(const MArgList& args) override;
+	bool isUndoable() const override { return false; }
+
+	static void* creator() { return new GarlandOverlayCmd; }
+	static MSyntax newSyntax();
+};
@@ -3,6 +3,10 @@
 #include <maya/MFnPlugin.h>
 #include <maya/MViewport2Renderer.h>
 #include "GarlandRender.h"
+#include "GarlandBatchCmd.h"
+#include "GarlandMemoryCmd.h"
+#include "GarlandOverlayCmd.h"
+#include "GarlandStatsCmd.h"
 
 
 MStatus initializePlugin(MObject obj)
@@ -20,6 +24,30 @@ MStatus initializePlugin(MObject obj)
 		}
 	}
 
+	status = plugin.registerCommand(GarlandStatsCmd::kName, GarlandStatsCmd::creator, GarlandStatsCmd::newSyntax);
+	if (!status)
+	{
+		status.perror("registerCommand garlandStats");
+	}
+
+	status = plugin.registerCommand(GarlandOverlayCmd::kName, GarlandOverlayCmd::creator, GarlandOverlayCmd::newSyntax);
+	if (!status)
+	{
+		status.perror("registerCommand garlandOverlay");
+	}
+
+	status = plugin.registerCommand(GarlandBatchCmd::kName, GarlandBatchCmd::creator, GarlandBatchCmd::newSyntax);
+	if (!status)
+	{
+		status.perror("registerCommand garlandBatch");
+	}
+
+	status = plugin.registerCommand(GarlandMemoryCmd::kName, GarlandMemoryCmd::creator, GarlandMemoryCmd::newSyntax);
+	if (!status)
+	{
+		status.perror("registerCommand garlandMemory");
+	}
+
 	return status;
 }
 
@@ -28,6 +56,30 @@ MStatus uninitializePlugin(MObject obj)
 	MStatus status;
 	MFnPlugin plugin(obj);
 
+	status = plugin.deregisterCommand(GarlandStatsCmd::kName);
+	if (!status)
+	{
+		status.perror("deregisterCommand garlandStats");
+	}
+
+	status = plugin.deregisterCommand(GarlandOverlayCmd::kName);
+	if (!status)
+	{
+		status.perror("deregisterCommand garlandOverlay");
+	}
+
+	status = plugin.deregisterCommand(GarlandBatchCmd::kName);
+	if (!status)
+	{
+		status.perror("deregisterCommand garlandBatch");
+	}
+
+	status = plugin.deregisterCommand(GarlandMemoryCmd::kName);
+	if (!status)
+	{
+		status.perror("deregisterCommand garlandMemory");
+	}
+
 	MHWRender::MRenderer* renderer = MHWRender::MRenderer::theRenderer();
 	if (renderer)
 	{
@@ -1,19 +1,40 @@
 #include "GarlandRender.h"
+#include <algorithm>
+#include <cmath>
 #include <maya/MRenderTargetManager.h>
 #include <maya/MGlobal.h>
+#include <maya/MUIDrawManager.h>
 #include "DxManager.h"
+#include "DxGpuTimer.h"
+#include "DxReadback.h"
 
 
 GarlandRenderOverride::GarlandRenderOverride(const MString & name)
-	: MRenderOverride(name) , _UIName("GarlandRender")
+	: MRenderOverride(name) , _UIName("GarlandRender"), _targetPool(&_resources)
 {
-	InitRTs();
+	_loadTime = FrameStats::Clock::now();
+	_RTs[0] = nullptr;
+	_RTs[1] = nullptr;
+
+	InitOperations();
 	_PanelName.clear();
-	dx = new DxManager(this);
+
+	_firstSetupCounter = _stats.Counter("startup.firstSetupMs");
+	_initCounter = _stats.Counter("startup.initMs");
+	_pipelineCounter = _stats.Counter("startup.pipelinesMs");
+	_firstFrameCounter = _stats.Counter("startup.firstFrameMs");
+	_firstOverlayCounter = _stats.Counter("startup.firstOverlayMs");
+
+	_gpuBytesCounter = _stats.Counter("memory.gpuMB");
+	_cpuBytesCounter = _stats.Counter("memory.cpuMB");
+	_allocationsCounter = _stats.Counter("memory.allocations");
+	_evictedCounter = _stats.Counter("memory.evictedMB");
 }
 
 GarlandRenderOverride::~GarlandRenderOverride()
 {
+	EndBatch();
+
 	if (dx)
 	{
 		delete dx;
@@ -28,7 +49,23 @@ GarlandRenderOverride::~GarlandRenderOverride()
 MStatus GarlandRenderOverride::setup( const MString & destination )
 {
 	UpdateRTs();
-	dx->Setup();
+
+	if (dx)
+	{
+		dx->Setup();
+	}
+	else
+	{
+		if (!grRTsValid())
+		{
+			MGlobal::displayError("Get RenderTragets Fail !");
+		}
+
+		FrameStats::Clock::time_point start = FrameStats::Clock::now();
+		_stats.SetCounter(_firstSetupCounter, FrameStats::Milliseconds(_loadTime, start));
+		dx = new DxManager(this);
+		_stats.SetCounter(_initCounter, FrameStats::Milliseconds(start, FrameStats::Clock::now()));
+	}
 
 	_PanelName.set(destination.asChar());
 	return MRenderOverride::setup(destination);
@@ -40,17 +77,114 @@ MStatus GarlandRenderOverride::cleanup()
 	return MRenderOverride::cleanup();
 }
 
-void GarlandRenderOverride::InitRTs()
+bool GarlandRenderOverride::startOperationIterator()
 {
-	_RTs[0] = nullptr;
-	_RTs[1] = nullptr;
-	_Desc[0] = nullptr;
-	_Desc[1] = nullptr;
+	bool hasOperation = MRenderOverride::startOperationIterator();
 
-	MHWRender::MRenderer* theRenderer = MHWRender::MRenderer::theRenderer();
-	if (!theRenderer)
+	if (dx && dx->GpuTimer())
+		dx->GpuTimer()->BeginFrame(dx->Context());
+
+	_frameStart = FrameStats::Clock::now();
+	_opIndex = hasOperation ? 0 : -1;
+	BeginOperationTimers();
+	return hasOperation;
+}
+
+bool GarlandRenderOverride::nextRenderOperation()
+{
+	EndOperationTimers();
+
+	bool hasOperation = MRenderOverride::nextRenderOperation();
+	if (hasOperation)
+	{
+		_opIndex++;
+		BeginOperationTimers();
+		return true;
+	}
+
+	// Last operation of the frame
+	_opIndex = -1;
+	if (dx && dx->GpuTimer())
+		dx->GpuTimer()->EndFrame(dx->Context());
+
+	_stats.Record(_cpuFrameStage, FrameStats::Milliseconds(_frameStart, FrameStats::Clock::now()));
+	CaptureBatchFrame();
+	UpdateMemory();
+	RecordStartup();
+	_stats.EndFrame();
+	return false;
+}
+
+void GarlandRenderOverride::UpdateMemory()
+{
+	const double kMB = 1024.0 * 1024.0;
+	_resources.SetBudget(kMemoryGpu, (size_t)(_overlay.gpuBudgetMB * kMB));
+	_resources.SetBudget(kMemoryCpu, (size_t)(_overlay.cpuBudgetMB * kMB));
+	size_t evicted = _resources.EnforceBudget();
+
+	// The churn of this frame, evictions included
+	_resources.EndFrame();
+	ResourceChurn gpu = _resources.LastFrame(kMemoryGpu);
+	ResourceChurn cpu = _resources.LastFrame(kMemoryCpu);
+
+	_stats.SetCounter(_gpuBytesCounter, _resources.Bytes(kMemoryGpu) / kMB);
+	_stats.SetCounter(_cpuBytesCounter, _resources.Bytes(kMemoryCpu) / kMB);
+	_stats.SetCounter(_allocationsCounter, (double)(gpu.allocations + cpu.allocations));
+	_stats.SetCounter(_evictedCounter, evicted / kMB);
+}
+
+void GarlandRenderOverride::RecordStartup()
+{
+	if (_firstOverlayDone)
+		return;
+
+	double sinceLoad = FrameStats::Milliseconds(_loadTime, FrameStats::Clock::now());
+	if (!_firstFrameDone)
+	{
+		_stats.SetCounter(_firstFrameCounter, sinceLoad);
+		_firstFrameDone = true;
+	}
+
+	// The first frame the overlay could draw
+	if (dx && dx->Ready())
+	{
+		_stats.SetCounter(_pipelineCounter, dx->PipelineMilliseconds());
+		_stats.SetCounter(_firstOverlayCounter, sinceLoad);
+		_firstOverlayDone = true;
+
+		MString message = "Garland: overlay ready ";
+		message += sinceLoad;
+		message += " ms after load, pipelines took ";
+		message += dx->PipelineMilliseconds();
+		message += " ms";
+		MGlobal::displayInfo(message);
+	}
+}
+
+void GarlandRenderOverride::BeginOperationTimers()
+{
+	if (_opIndex < 0 || _opIndex >= (int)_cpuOpStages.size())
+		return;
+
+	_opStart = FrameStats::Clock::now();
+	if (dx && dx->GpuTimer())
+		_gpuScope = dx->GpuTimer()->Begin(dx->Context(), _gpuOpStages[_opIndex]);
+}
+
+void GarlandRenderOverride::EndOperationTimers()
+{
+	if (_opIndex < 0 || _opIndex >= (int)_cpuOpStages.size())
 		return;
 
+	_stats.Record(_cpuOpStages[_opIndex], FrameStats::Milliseconds(_opStart, FrameStats::Clock::now()));
+	if (dx && dx->GpuTimer())
+		dx->GpuTimer()->End(dx->Context(), _gpuScope);
+	_gpuScope = -1;
+}
+
+void GarlandRenderOverride::InitOperations()
+{
+	// The targets are acquired by setup(), at the size of the panel being drawn
 	mOperations.clear();
 	//Stanard Operations get from theRender: Background-Scene-HUD-Presesnt
 	//We need to 
@@ -60,151 +194,333 @@ void GarlandRenderOverride::InitRTs()
 	//03.  Render Standard HUD RT
 	//04.  Standard Present
 
-	auto grClear = new SimpleOverrideClass<MHWRender::MClearOperation>("GarlandClear", this);
-	auto grScene = new SimpleOverrideClass<MHWRender::MSceneRender>("GarlandScene", this);
-	CustomSceneRender* customScene = new CustomSceneRender("CustomScene", this);
-	auto grHUD = new SimpleOverrideClass<MHWRender::MHUDRender>(this);
-	auto grPresent = new SimpleOverrideClass<MHWRender::MPresentTarget>("GarlandPresent", this);
+	// Each operation is a pass of the graph, declared in execution order with the targets
+	// it uses. Color and depth only live during the frame, from the clear to the present.
+	_passGraph = PassGraph();
+	PassTargetDesc color;
+	color.name = "__CustomColorTarget__";
+	color.format = MHWRender::kR8G8B8A8_UNORM;
+	color.bytesPerPixel = 4;
+	PassTargetDesc depth;
+	depth.name = "__CustomDepthTarget__";
+	depth.format = MHWRender::kD24S8;
+	depth.bytesPerPixel = 4;
+	_colorTarget = _passGraph.AddTarget(color);
+	_depthTarget = _passGraph.AddTarget(depth);
+
+	// Pass i is operations[i]
+	std::vector<MHWRender::MRenderOperation*> operations;
+	auto declare = [&](auto* op, const char* name, bool sideEffect)
+	{
+		uint32_t pass = _passGraph.AddPass(name, sideEffect);
+		op->SetPass(pass);
+		operations.push_back(op);
+		return pass;
+	};
 
-	mOperations.append(grClear);
-	mOperations.append(grScene);
-	mOperations.append(customScene);
-	mOperations.append(grHUD);
-	mOperations.append(grPresent);
+	uint32_t pass = declare(new SimpleOverrideClass<MHWRender::MClearOperation>("GarlandClear", this), "GarlandClear", false);
+	_passGraph.Overwrite(pass, _colorTarget);
+	_passGraph.Overwrite(pass, _depthTarget);
 
-	const MHWRender::MRenderTargetManager* targetManager = theRenderer ? theRenderer->getRenderTargetManager() : NULL;
-	if (targetManager)
-	{
-		unsigned int targetWidth = 0;
-		unsigned int targetHeight = 0;
+	pass = declare(new ViewportOverrideClass<MHWRender::MSceneRender>("GarlandScene", this), "GarlandScene", false);
+	_passGraph.Write(pass, _colorTarget);
+	_passGraph.Write(pass, _depthTarget);
 
-		if (theRenderer)
-		{
-			theRenderer->outputTargetSize(targetWidth, targetHeight);
-		}
+	pass = declare(new CustomSceneRender("CustomScene", this), "CustomScene", false);
+	_passGraph.Write(pass, _colorTarget);
+	_passGraph.Write(pass, _depthTarget);
 
-		_Desc[0] = new MHWRender::MRenderTargetDescription(
-			MString("__CustomColorTarget__"),
-			targetWidth,
-			targetHeight,
-			1,
-			MHWRender::kR8G8B8A8_UNORM,
-			0,
-			false);
+	pass = declare(new GarlandHUDRender(this), "HUD", false);
+	_passGraph.Write(pass, _colorTarget);
+	_passGraph.Write(pass, _depthTarget);
 
-		_RTs[0] = targetManager->acquireRenderTarget(*_Desc[0]);
+	pass = declare(new SimpleOverrideClass<MHWRender::MPresentTarget>("GarlandPresent", this), "GarlandPresent", true);
+	_passGraph.Read(pass, _colorTarget);
+	_passGraph.Read(pass, _depthTarget);
 
-		_Desc[1] = new MHWRender::MRenderTargetDescription(
-			MString("__CustomDepthTarget__"),
-			targetWidth,
-			targetHeight,
-			1,
-			MHWRender::kD24S8,
-			0,
-			false);
+	if (!_passGraph.Compile())
+		MGlobal::displayError(MString("Garland: ") + _passGraph.Error().c_str());
 
-		_RTs[1] = targetManager->acquireRenderTarget(*_Desc[1]);
+	// Culled passes are not run at all
+	for (uint32_t i = 0; i < (uint32_t)operations.size(); i++)
+	{
+		if (_passGraph.Compiled() && _passGraph.Culled(i))
+			delete operations[i];
+		else
+			mOperations.append(operations[i]);
 	}
 
-	if (!grRTsValid())
+	// The HUD operation has no name of its own
+	_cpuOpStages.clear();
+	_gpuOpStages.clear();
+	for (int i = 0; i < (int)mOperations.length(); i++)
 	{
-		MGlobal::displayError("Get RenderTragets Fail !");
+		MString opName = mOperations[i]->name();
+		std::string stageName = opName.length() ? opName.asChar() : "HUD";
+		_cpuOpStages.push_back(_stats.Stage("cpu." + stageName));
+		_gpuOpStages.push_back(_stats.Stage("gpu." + stageName));
 	}
+	_cpuFrameStage = _stats.Stage("cpu.frame");
+
+	_poolBytesCounter = _stats.Counter("rt.poolBytes");
+	_poolReallocCounter = _stats.Counter("rt.reallocations");
 }
 
 void GarlandRenderOverride::CleanRTs()
+{
+	_targetPool.Clear();
+	_physicalRTs.clear();
+	_passRTs.clear();
+	_RTs[0] = nullptr;
+	_RTs[1] = nullptr;
+}
+
+void GarlandRenderOverride::UpdateRTs()
 {
 	MHWRender::MRenderer* theRenderer = MHWRender::MRenderer::theRenderer();
-	const MHWRender::MRenderTargetManager* targetManager = theRenderer ? theRenderer->getRenderTargetManager() : NULL;
+	if (!theRenderer)
+		return;
+
+	unsigned int targetWidth = 0;
+	unsigned int targetHeight = 0;
+	theRenderer->outputTargetSize(targetWidth, targetHeight);
 
-	if (targetManager)
+	// One pooled target per physical target of the graph, named after its first target
+	double now = std::chrono::duration<double>(FrameStats::Clock::now().time_since_epoch()).count();
+	_physicalRTs.resize(_passGraph.Compiled() ? _passGraph.PhysicalCount() : 0);
+	for (uint32_t p = 0; p < (uint32_t)_physicalRTs.size(); p++)
 	{
-		if (_RTs[0])
-		{
-			targetManager->releaseRenderTarget(_RTs[0]);
-			_RTs[0] = nullptr;
-		}
+		const PassTargetDesc& desc = _passGraph.Target(_passGraph.PhysicalTarget(p));
+		unsigned int width = (unsigned int)std::ceil(targetWidth * (double)desc.scale);
+		unsigned int height = (unsigned int)std::ceil(targetHeight * (double)desc.scale);
+		_physicalRTs[p] = _targetPool.Acquire(desc.name.c_str(), (MHWRender::MRasterFormat)desc.format, width, height, now);
+	}
 
-		if (_RTs[1])
+	_passRTs.resize(_passGraph.PassCount());
+	for (uint32_t pass = 0; pass < (uint32_t)_passRTs.size(); pass++)
+	{
+		std::vector<MHWRender::MRenderTarget*>& list = _passRTs[pass];
+		list.clear();
+		if (_physicalRTs.empty() || _passGraph.Culled(pass))
+			continue;
+		for (const PassGraph::Use& use : _passGraph.Uses(pass))
 		{
-			targetManager->releaseRenderTarget(_RTs[1]);
-			_RTs[1] = nullptr;
+			MHWRender::MRenderTarget* target = _physicalRTs[_passGraph.Physical(use.target)];
+			if (std::find(list.begin(), list.end(), target) == list.end())
+				list.push_back(target);
 		}
 	}
 
-	if (_Desc[0])
+	uint32_t colorPhysical = _physicalRTs.empty() ? PassGraph::kNone : _passGraph.Physical(_colorTarget);
+	uint32_t depthPhysical = _physicalRTs.empty() ? PassGraph::kNone : _passGraph.Physical(_depthTarget);
+	_RTs[0] = colorPhysical != PassGraph::kNone ? _physicalRTs[colorPhysical] : nullptr;
+	_RTs[1] = depthPhysical != PassGraph::kNone ? _physicalRTs[depthPhysical] : nullptr;
+
+	_viewportWidth = targetWidth;
+	_viewportHeight = targetHeight;
+	_targetWidth = targetWidth;
+	_targetHeight = targetHeight;
+	if (_RTs[0])
 	{
-		delete _Desc[0];
-		_Desc[0] = nullptr;
+		MHWRender::MRenderTargetDescription desc;
+		_RTs[0]->targetDescription(desc);
+		_targetWidth = desc.width();
+		_targetHeight = desc.height();
 	}
-	if (_Desc[1])
+
+	if (_targetWidth && _targetHeight)
 	{
-		delete _Desc[1];
-		_Desc[1] = nullptr;
+		_viewportRect.x = 0.0f;
+		_viewportRect.y = 0.0f;
+		_viewportRect.z = (float)_viewportWidth / (float)_targetWidth;
+		_viewportRect.w = (float)_viewportHeight / (float)_targetHeight;
 	}
+
+	_stats.SetCounter(_poolBytesCounter, (double)_targetPool.Bytes());
+	_stats.SetCounter(_poolReallocCounter, (double)_targetPool.Reallocations());
 }
 
-void GarlandRenderOverride::UpdateRTs()
+const MFloatPoint* GarlandRenderOverride::grViewportRect() const
 {
-	MHWRender::MRenderer* theRenderer = MHWRender::MRenderer::theRenderer();
-
-	unsigned int targetWidth = 0;
-	unsigned int targetHeight = 0;
+	if (_targetWidth == 0 || _targetHeight == 0 ||
+		(_viewportWidth == _targetWidth && _viewportHeight == _targetHeight))
+		return nullptr;
+	return &_viewportRect;
+}
 
-	if (theRenderer)
+bool GarlandRenderOverride::BeginBatch(unsigned ringSize, unsigned writerCount, uint32_t imageWidth, uint32_t imageHeight, uint32_t tileSize)
+{
+	EndBatch();
+	if (!dx || !dx->Context())
+		return false;
+
+	// A writer queue as long as the ring never blocks the render thread, the ring does
+	if (ringSize == 0)
+		ringSize = 1;
+	_readback = new DxReadback(dx->Device(), dx->Context(), ringSize, &_resources);
+	if (imageWidth && imageHeight)
+	{
+		_tileGrid = new TileGrid(imageWidth, imageHeight, tileSize);
+		_tileImage = new StreamingImageWriter;
+		_imageSink = new TileImageSink(*_tileImage, *_tileGrid);
+	}
+	else
 	{
-		theRenderer->outputTargetSize(targetWidth, targetHeight);
+		_imageSink = new TgaFileSink;
+	}
+	_imageWriters = new ImageWriterPool(*_imageSink, writerCount, ringSize);
+	_readbackQueue = new ReadbackQueue(*_readback, *_imageWriters, ringSize);
+	_batchPending = false;
+	_batchWidth = 0;
+	_batchHeight = 0;
+	_tileImagesFailed = 0;
+
+	// Every frame at full resolution, the camera may be animated
+	_batchDynamicResolution = _overlay.dynamicResolution;
+	_overlay.dynamicResolution = false;
+	return true;
+}
 
-		if (_Desc[0]->width() != targetWidth || _Desc[1]->height() != targetHeight)
-		{
-			_Desc[0]->setWidth(targetWidth);
-			_Desc[0]->setHeight(targetHeight);
-			_Desc[1]->setWidth(targetWidth);
-			_Desc[1]->setHeight(targetHeight);
-
-			const MHWRender::MRenderTargetManager* targetManager = theRenderer ? theRenderer->getRenderTargetManager() : NULL;
-			if (targetManager)
-			{
-				if (!_RTs[0])
-				{
-					_RTs[0] = targetManager->acquireRenderTarget(*(_Desc[0]));
-				}
-				else
-				{
-					_RTs[0]->updateDescription(*(_Desc[0]));
-				}
-				if (!_RTs[1])
-				{
-					_RTs[1] = targetManager->acquireRenderTarget(*(_Desc[1]));
-				}
-				else
-				{
-					_RTs[1]->updateDescription(*(_Desc[1]));
-				}
-			}
-		}
+void GarlandRenderOverride::SetBatchFrame(int64_t frame, const std::string& path)
+{
+	_batchFrame = frame;
+	_batchPath = path;
+	_batchPending = _readbackQueue != nullptr;
+	_batchTilesDrawn = false;
+}
+
+const TileGrid* GarlandRenderOverride::BeginBatchTiles()
+{
+	if (!_batchPending || !_tileGrid || _batchTilesDrawn)
+		return nullptr;
+	_batchTilesDrawn = true;
+
+	if (!_tileImage->Open(_batchPath, _tileGrid->Width(), _tileGrid->Height()))
+	{
+		MGlobal::displayWarning(MString("Garland: cannot write ") + _batchPath.c_str());
+		return nullptr;
 	}
+	return _tileGrid;
 }
 
-MHWRender::MRenderTarget* const* GarlandRenderOverride::grTargetOverrideList(unsigned int& listSize)
+void GarlandRenderOverride::CaptureBatchTile(const Tile& tile, ID3D11RenderTargetView* target)
 {
-	if (_RTs[0] && _RTs[1])
+	// The tile target keeps its size, the staging textures are only created once
+	if (!_tileImage->IsOpen() || !_readback->SetTarget(target, _tileGrid->TileSize(), _tileGrid->TileSize()))
+		return;
+	_readbackQueue->Capture(tile.index, _batchPath);
+}
+
+void GarlandRenderOverride::CaptureBatchFrame()
+{
+	if (!_batchPending || !_RTs[0])
+		return;
+	_batchPending = false;
+
+	// The tiles of the image were captured while the overlay was drawn, the file is
+	// complete once all of them are written
+	if (_tileGrid)
+	{
+		_readbackQueue->Flush();
+		if (!_tileImage->IsOpen() || !_tileImage->Close())
+			_tileImagesFailed++;
+		return;
+	}
+
+	// The staging textures are only resized once nothing is mapped
+	if (_viewportWidth != _batchWidth || _viewportHeight != _batchHeight)
+	{
+		_readbackQueue->Flush();
+		_batchWidth = _viewportWidth;
+		_batchHeight = _viewportHeight;
+	}
+
+	ID3D11RenderTargetView* colorTarget = (ID3D11RenderTargetView*)_RTs[0]->resourceHandle();
+	if (!_readback->SetTarget(colorTarget, _batchWidth, _batchHeight))
 	{
-		listSize = 2;
-		return _RTs;
+		MGlobal::displayWarning("Garland: the color target cannot be read back");
+		return;
 	}
-	return nullptr;
+	_readbackQueue->Capture(_batchFrame, _batchPath);
+}
+
+ReadbackQueue::Stats GarlandRenderOverride::EndBatch()
+{
+	ReadbackQueue::Stats stats;
+	if (!_readbackQueue)
+		return stats;
+
+	_readbackQueue->Flush();
+	stats = _readbackQueue->GetStats();
+	stats.failed += _tileImagesFailed;
+
+	// The queue unmaps through the readback and waits on the writers
+	delete _readbackQueue;
+	_readbackQueue = nullptr;
+	delete _imageWriters;
+	_imageWriters = nullptr;
+	delete _imageSink;
+	_imageSink = nullptr;
+	delete _readback;
+	_readback = nullptr;
+	delete _tileImage;
+	_tileImage = nullptr;
+	delete _tileGrid;
+	_tileGrid = nullptr;
+
+	_batchPending = false;
+	_overlay.dynamicResolution = _batchDynamicResolution;
+	return stats;
+}
+
+MHWRender::MRenderTarget* const* GarlandRenderOverride::grTargetOverrideList(uint32_t pass, unsigned int& listSize)
+{
+	if (pass >= _passRTs.size() || _passRTs[pass].empty())
+		return nullptr;
+
+	const std::vector<MHWRender::MRenderTarget*>& list = _passRTs[pass];
+	if (std::find(list.begin(), list.end(), nullptr) != list.end())
+		return nullptr;
+	listSize = (unsigned int)list.size();
+	return list.data();
 }
 
 
 CustomSceneRender::CustomSceneRender(const MString& name, GarlandRenderOverride* gr)
-	: SimpleOverrideClass<MHWRender::MUserRenderOperation>(name, gr)
+	: ViewportOverrideClass<MHWRender::MUserRenderOperation>(name, gr)
 {
 
 }
 
 MStatus CustomSceneRender::execute(const MHWRender::MDrawContext& drawContext)
 {	
-	_gr->Dx()->debug(drawContext);
+	if (_gr->Dx())
+	{
+		_gr->Dx()->DrainSceneChanges();
+		_gr->Dx()->debug(drawContext);
+	}
 	return MStatus::kSuccess;
 }
+
+
+bool GarlandHUDRender::hasUIDrawables() const
+{
+	return _gr && _gr->Overlay().memoryHud;
+}
+
+void GarlandHUDRender::addUIDrawables(MHWRender::MUIDrawManager& drawManager, const MHWRender::MFrameContext& frameContext)
+{
+	if (!_gr || !_gr->Overlay().memoryHud)
+		return;
+
+	// Bottom right, clear of the view cube and the axis
+	int x, y, width, height;
+	frameContext.getViewportDimensions(x, y, width, height);
+	MString line = _gr->Resources().Summary().c_str();
+
+	drawManager.beginDrawable();
+	drawManager.setColor(MColor(1.0f, 0.85f, 0.3f));
+	drawManager.setFontSize(MHWRender::MUIDrawManager::kSmallFontSize);
+	drawManager.text2d(MPoint(x + width - 10, y + 10), line, MHWRender::MUIDrawManager::kRight);
+	drawManager.endDrawable();
+}
@@ -1,9 +1,24 @@
 #pragma once
 #include <maya/MString.h>
 #include <maya/MViewport2Renderer.h>
+#include <maya/MFloatPoint.h>
+
+#include <string>
+#include <vector>
+
+#include "FrameStats.h"
+#include "OverlaySettings.h"
+#include "PassGraph.h"
+#include "ReadbackQueue.h"
+#include "RenderTargetPool.h"
+#include "ResourceRegistry.h"
+#include "StreamingImageWriter.h"
+#include "TileGrid.h"
 
 
 class DxManager;
+class DxReadback;
+struct ID3D11RenderTargetView;
 
 
 class GarlandRenderOverride : public MHWRender::MRenderOverride
@@ -16,25 +31,131 @@ public:
 	MStatus setup( const MString & destination ) override;
 	MStatus cleanup() override;
 	MString uiName() const override { return _UIName; }
+
+	// Time each operation, CPU side between two operations and GPU side with timestamps
+	bool startOperationIterator() override;
+	bool nextRenderOperation() override;
+
 	const MString& panelName() const { return _PanelName; }
-	MHWRender::MRenderTarget* const* grTargetOverrideList(unsigned int& listSize);
+
+	// Targets of a pass of the graph, the physical targets of what it uses in the order it
+	// declared them
+	MHWRender::MRenderTarget* const* grTargetOverrideList(uint32_t pass, unsigned int& listSize);
 
 	// Custom Render Func
-	void InitRTs();
+	void InitOperations();
 	void CleanRTs();
 	void UpdateRTs();
 	inline MHWRender::MRenderTarget* grColorRT() { return _RTs[0]; }
 	inline MHWRender::MRenderTarget* grDepthRT() { return _RTs[1]; }
 	inline bool grRTsValid() { return _RTs[0] && _RTs[1]; }
+
+	// Part of the pooled targets covered by the viewport, normalized (x, y, width, height).
+	// Null when the targets have the viewport size.
+	const MFloatPoint* grViewportRect() const;
 	inline DxManager* Dx() { return dx; }
+	inline FrameStats& Stats() { return _stats; }
+	inline OverlaySettings& Overlay() { return _overlay; }
+	inline ResourceRegistry& Resources() { return _resources; }
+
+	// Offscreen batch render, see GarlandBatchCmd. Between BeginBatch() and EndBatch() the
+	// frame drawn after each SetBatchFrame() is read back into a ring of ringSize staging
+	// textures and written to `path` by writerCount threads.
+	// With an image size the frames are instead the overlay alone at that size, drawn tile
+	// by tile and each tile read back and streamed into the file (see BeginBatchTiles).
+	bool BeginBatch(unsigned ringSize, unsigned writerCount, uint32_t imageWidth = 0, uint32_t imageHeight = 0, uint32_t tileSize = 0);
+	void SetBatchFrame(int64_t frame, const std::string& path);
+	inline bool BatchFramePending() const { return _batchPending; }
+	inline bool BatchRunning() const { return _readbackQueue != nullptr; }
+	ReadbackQueue::Stats EndBatch();
+
+	// The grid of the pending frame's image when it is captured tile by tile and no tile was
+	// drawn yet, its file is opened. Null otherwise. Each tile drawn is then passed to
+	// CaptureBatchTile(), the image is complete at the end of the frame.
+	const TileGrid* BeginBatchTiles();
+	void CaptureBatchTile(const Tile& tile, ID3D11RenderTargetView* target);
 
 protected:
 	MString _UIName;
 	MString _PanelName;
-	MHWRender::MRenderTargetDescription* _Desc[2];
 	MHWRender::MRenderTarget* _RTs[2];
 
+	// Every allocation of the plugin, declared before the members that track into it
+	ResourceRegistry _resources;
+
+	// The operations as passes of a graph compiled by InitOperations(): its physical targets
+	// are acquired from the pool and _RTs are the ones of the color and depth targets
+	PassGraph _passGraph;
+	uint32_t _colorTarget = PassGraph::kNone;
+	uint32_t _depthTarget = PassGraph::kNone;
+	std::vector<MHWRender::MRenderTarget*> _physicalRTs;
+	std::vector<std::vector<MHWRender::MRenderTarget*>> _passRTs;
+
+	// Targets are shared by the panels and only reallocated when a size bucket changes
+	RenderTargetPool _targetPool;
+	unsigned int _targetWidth = 0;
+	unsigned int _targetHeight = 0;
+	unsigned int _viewportWidth = 0;
+	unsigned int _viewportHeight = 0;
+	MFloatPoint _viewportRect;
+	int _poolBytesCounter = -1;
+	int _poolReallocCounter = -1;
+
+	// Created by the first setup(), nothing is allocated on the GPU while the plugin loads
 	DxManager* dx = nullptr;
+
+	// Startup timings from the plugin load, recorded once as "startup.*" counters
+	void RecordStartup();
+
+	FrameStats::Clock::time_point _loadTime;
+	int _firstSetupCounter = -1;
+	int _initCounter = -1;
+	int _pipelineCounter = -1;
+	int _firstFrameCounter = -1;
+	int _firstOverlayCounter = -1;
+	bool _firstFrameDone = false;
+	bool _firstOverlayDone = false;
+
+	// Timings of the operations, the overlay adds its own stages
+	void BeginOperationTimers();
+	void EndOperationTimers();
+
+	// Applies the memory budgets at the end of the frame and records the usage
+	void UpdateMemory();
+	int _gpuBytesCounter = -1;
+	int _cpuBytesCounter = -1;
+	int _allocationsCounter = -1;
+	int _evictedCounter = -1;
+
+	FrameStats _stats;
+	OverlaySettings _overlay;
+	std::vector<int> _cpuOpStages;
+	std::vector<int> _gpuOpStages;
+	int _cpuFrameStage = -1;
+	int _opIndex = -1;
+	int _gpuScope = -1;
+	FrameStats::Clock::time_point _frameStart;
+	FrameStats::Clock::time_point _opStart;
+
+	// Batch render, only allocated while one runs
+	void CaptureBatchFrame();
+
+	DxReadback* _readback = nullptr;
+	ImageSink* _imageSink = nullptr;
+	ImageWriterPool* _imageWriters = nullptr;
+	ReadbackQueue* _readbackQueue = nullptr;
+	int64_t _batchFrame = 0;
+	std::string _batchPath;
+	bool _batchPending = false;
+	unsigned int _batchWidth = 0;
+	unsigned int _batchHeight = 0;
+	bool _batchDynamicResolution = false;
+
+	// Tiled batch render: the tiles of one image at a time go through the readback queue
+	TileGrid* _tileGrid = nullptr;
+	StreamingImageWriter* _tileImage = nullptr;
+	bool _batchTilesDrawn = false;
+	uint64_t _tileImagesFailed = 0;
 };
 
 
@@ -44,8 +165,12 @@ public:
 	GarlandUserOperation(GarlandRenderOverride* gr) { _gr = gr; }
 	~GarlandUserOperation() { _gr = nullptr; }
 
+	// The operation's pass in the override's graph
+	inline void SetPass(uint32_t pass) { _pass = pass; }
+
 protected:
 	GarlandRenderOverride* _gr = nullptr;
+	uint32_t _pass = PassGraph::kNone;
 
 };
 
@@ -59,14 +184,39 @@ public:
 
 	MHWRender::MRenderTarget* const* targetOverrideList(unsigned int& listSize) override
 	{
-		return _gr ? _gr->grTargetOverrideList(listSize) : nullptr;
+		return _gr ? _gr->grTargetOverrideList(_pass, listSize) : nullptr;
 	}
 };
 
 
-class CustomSceneRender : public SimpleOverrideClass<MHWRender::MUserRenderOperation>
+// For operations that can render into a sub-rect of the targets
+template<class _Ty>
+class ViewportOverrideClass : public SimpleOverrideClass<_Ty>
+{
+public:
+	ViewportOverrideClass(const MString& name, GarlandRenderOverride* gr) : SimpleOverrideClass<_Ty>(name, gr) {}
+
+	const MFloatPoint* viewportRectangleOverride() override
+	{
+		return this->_gr ? this->_gr->grViewportRect() : nullptr;
+	}
+};
+
+
+class CustomSceneRender : public ViewportOverrideClass<MHWRender::MUserRenderOperation>
 {
 public:
 	CustomSceneRender(const MString& name, GarlandRenderOverride* gr);
 	MStatus execute(const MHWRender::MDrawContext& drawContext) override;
 };
+
+
+// Maya's HUD, with the memory line of the override when OverlaySettings::memoryHud is set
+class GarlandHUDRender : public SimpleOverrideClass<MHWRender::MHUDRender>
+{
+public:
+	GarlandHUDRender(GarlandRenderOverride* gr) : SimpleOverrideClass<MHWRender::MHUDRender>(gr) {}
+
+	bool hasUIDrawables() const override;
+	void addUIDrawables(MHWRender::MUIDrawManager& drawManager, const MHWRender::MFrameContext& frameContext) override;
+};
@@ -0,0 +1,75 @@
+#include "GarlandStatsCmd.h"
+
+#include <cstdio>
+
+#include <maya/MArgDatabase.h>
+#include <maya/MGlobal.h>
+#include <maya/MStringArray.h>
+#include <maya/MViewport2Renderer.h>
+
+#include "GarlandRender.h"
+
+
+const char* GarlandStatsCmd::kName = "garlandStats";
+
+static const char* kFramesFlag = "-f";
+static const char* kFramesFlagLong = "-frames";
+static const char* kResetFlag = "-r";
+static const char* kResetFlagLong = "-reset";
+
+MSyntax GarlandStatsCmd::newSyntax()
+{
+	MSyntax syntax;
+	syntax.addFlag(kFramesFlag, kFramesFlagLong, MSyntax::kUnsigned);
+	syntax.addFlag(kResetFlag, kResetFlagLong);
+	return syntax;
+}
+
+MStatus GarlandStatsCmd::doIt(const MArgList& args)
+{
+	MStatus status;
+	MArgDatabase argData(syntax(), args, &status);
+	if (!status)
+		return status;
+
+	MHWRender::MRenderer* renderer = MHWRender::MRenderer::theRenderer();
+	const MHWRender::MRenderOverride* overridePtr = renderer ? renderer->findRenderOverride("GarlandViewport") : nullptr;
+	if (!overridePtr)
+	{
+		MGlobal::displayError("GarlandViewport is not registered");
+		return MStatus::kFailure;
+	}
+
+	// Registered by this plugin, so it is ours
+	FrameStats& stats = const_cast<GarlandRenderOverride*>(static_cast<const GarlandRenderOverride*>(overridePtr))->Stats();
+
+	if (argData.isFlagSet(kResetFlag))
+	{
+		stats.Reset();
+		return MStatus::kSuccess;
+	}
+
+	unsigned int frames = 120;
+	if (argData.isFlagSet(kFramesFlag))
+		argData.getFlagArgument(kFramesFlag, 0, frames);
+
+	MStringArray lines;
+	char line[256];
+	for (size_t i = 0; i < stats.StageCount(); i++)
+	{
+		StageSummary summary = stats.Summary((int)i, frames);
+		snprintf(line, sizeof(line), "%s samples=%zu min=%.3f avg=%.3f p95=%.3f max=%.3f",
+			stats.StageName((int)i).c_str(), summary.samples,
+			summary.minMs, summary.avgMs, summary.p95Ms, summary.maxMs);
+		lines.append(line);
+	}
+
+	for (size_t i = 0; i < stats.CounterCount(); i++)
+	{
+		snprintf(line, sizeof(line), "%s value=%.6g", stats.CounterName((int)i).c_str(), stats.CounterValue((int)i));
+		lines.append(line);
+	}
+
+	setResult(lines);
+	return MStatus::kSuccess;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <maya/MPxCommand.h>
+#include <maya/MSyntax.h>
+
+
+// garlandStats [-frames N] [-reset]
+// Returns one line per stage of the GarlandViewport override: name, samples and the
+// min/avg/p95/max time in milliseconds over the last N frames (120 by default), then one
+// line per counter with its current value.
+class GarlandStatsCmd : public MPxCommand
+{
+public:
+	static const char* kName;
+
+	MStatus doIt(const MArgList& args) override;
+	bool isUndoable() const override { return false; }
+
+	static void* creator() { return new GarlandStatsCmd; }
+	static MSyntax newSyntax();
+};
@@ -0,0 +1,148 @@
+#include "ImageWriterPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+
+void EncodeTga(const ReadbackImage& image, std::vector<uint8_t>& out)
+{
+	const size_t headerSize = 18;
+	out.resize(headerSize + (size_t)image.width * image.height * 4);
+
+	uint8_t* header = out.data();
+	std::fill(header, header + headerSize, (uint8_t)0);
+	header[2] = 2;							// uncompressed true color
+	header[12] = (uint8_t)(image.width & 0xff);
+	header[13] = (uint8_t)(image.width >> 8);
+	header[14] = (uint8_t)(image.height & 0xff);
+	header[15] = (uint8_t)(image.height >> 8);
+	header[16] = 32;
+	header[17] = 8 | 0x20;					// 8 alpha bits, top-left origin
+
+	uint8_t* dst = out.data() + headerSize;
+	for (uint32_t y = 0; y < image.height; y++)
+	{
+		const uint8_t* src = image.pixels + (size_t)y * image.rowPitch;
+		for (uint32_t x = 0; x < image.width; x++, src += 4, dst += 4)
+		{
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = src[3];
+		}
+	}
+}
+
+bool TgaFileSink::Write(const ImageWriteJob& job, std::vector<uint8_t>& scratch, size_t& bytes)
+{
+	// The format stores 16-bit sizes
+	bytes = 0;
+	if (job.image.width > 0xffff || job.image.height > 0xffff)
+		return false;
+
+	EncodeTga(job.image, scratch);
+
+	FILE* file = fopen(job.path.c_str(), "wb");
+	if (!file)
+		return false;
+	bytes = fwrite(scratch.data(), 1, scratch.size(), file);
+	bool ok = bytes == scratch.size();
+	ok = fclose(file) == 0 && ok;
+	return ok;
+}
+
+
+ImageWriterPool::ImageWriterPool(ImageSink& sink, unsigned threadCount, size_t maxQueued)
+	: _sink(sink), _maxQueued(std::max<size_t>(maxQueued, 1))
+{
+	threadCount = std::max(threadCount, 1u);
+	for (unsigned i = 0; i < threadCount; i++)
+		_threads.emplace_back(&ImageWriterPool::WorkerMain, this);
+}
+
+ImageWriterPool::~ImageWriterPool()
+{
+	// Jobs not started yet point to memory the owner is about to release, drop them
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+		_jobs.clear();
+	}
+	_wake.notify_all();
+
+	for (std::thread& thread : _threads)
+		thread.join();
+}
+
+void ImageWriterPool::Submit(const ImageWriteJob& job)
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_jobs.size() >= _maxQueued)
+		{
+			auto start = std::chrono::steady_clock::now();
+			_room.wait(lock, [this] { return _jobs.size() < _maxQueued; });
+			_blockedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		_jobs.push_back(job);
+	}
+	_wake.notify_one();
+}
+
+size_t ImageWriterPool::Collect(std::vector<ImageWriteResult>& results)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t count = _results.size();
+	results.insert(results.end(), _results.begin(), _results.end());
+	_results.clear();
+	return count;
+}
+
+void ImageWriterPool::WaitAny()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_finished.wait(lock, [this] { return !_results.empty() || (_jobs.empty() && _running == 0); });
+}
+
+void ImageWriterPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_finished.wait(lock, [this] { return _jobs.empty() && _running == 0; });
+}
+
+size_t ImageWriterPool::Pending() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _jobs.size() + _running;
+}
+
+void ImageWriterPool::WorkerMain()
+{
+	std::vector<uint8_t> scratch;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_wake.wait(lock, [this] { return _stop || !_jobs.empty(); });
+		if (_stop)
+			return;
+
+		ImageWriteJob job = std::move(_jobs.front());
+		_jobs.pop_front();
+		_running++;
+		lock.unlock();
+		_room.notify_one();
+
+		ImageWriteResult result;
+		result.slot = job.slot;
+		result.frame = job.frame;
+		result.bytes = 0;
+		result.ok = _sink.Write(job, scratch, result.bytes);
+
+		lock.lock();
+		_results.push_back(result);
+		_running--;
+		_finished.notify_all();
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Pixels read back from the GPU: RGBA8, top row first, rows rowPitch bytes apart. The
+// memory belongs to whoever mapped it, the writers only read it.
+struct ReadbackImage
+{
+	const uint8_t* pixels = nullptr;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t rowPitch = 0;
+};
+
+struct ImageWriteJob
+{
+	uint32_t slot;		// handed back in the result, so the owner can release the pixels
+	int64_t frame;
+	ReadbackImage image;
+	std::string path;
+};
+
+struct ImageWriteResult
+{
+	uint32_t slot;
+	int64_t frame;
+	bool ok;
+	size_t bytes;		// written
+};
+
+
+// Where the writers put the images. Called from the writer threads, one job per call;
+// scratch is the calling thread's own buffer, kept from job to job.
+class ImageSink
+{
+public:
+	virtual ~ImageSink() {}
+
+	virtual bool Write(const ImageWriteJob& job, std::vector<uint8_t>& scratch, size_t& bytes) = 0;
+};
+
+// Uncompressed 32-bit TGA files at job.path
+class TgaFileSink : public ImageSink
+{
+public:
+	bool Write(const ImageWriteJob& job, std::vector<uint8_t>& scratch, size_t& bytes) override;
+};
+
+// The whole TGA file of an image: BGRA, top-left origin
+void EncodeTga(const ReadbackImage& image, std::vector<uint8_t>& out);
+
+
+// Encodes and writes read back images on its own threads, straight from the mapped memory.
+// Jobs are started in submission order; the owner collects the results on its thread and
+// only then releases the pixels. Submit() blocks while maxQueued jobs are waiting, so a
+// producer faster than the disk is held back instead of queueing without bound.
+class ImageWriterPool
+{
+public:
+	// The sink must outlive the pool
+	ImageWriterPool(ImageSink& sink, unsigned threadCount = 2, size_t maxQueued = 8);
+	~ImageWriterPool();
+
+	ImageWriterPool(const ImageWriterPool&) = delete;
+	ImageWriterPool& operator=(const ImageWriterPool&) = delete;
+
+	void Submit(const ImageWriteJob& job);
+
+	// Moves the finished results to `results`, returns how many
+	size_t Collect(std::vector<ImageWriteResult>& results);
+
+	// Blocks until a result can be collected, or nothing is pending
+	void WaitAny();
+
+	// Blocks until every submitted job is finished
+	void Wait();
+
+	size_t Pending() const;
+	inline unsigned ThreadCount() const { return (unsigned)_threads.size(); }
+
+	// Time Submit() spent waiting for room in the queue
+	inline double BlockedMilliseconds() const { return _blockedMs; }
+
+protected:
+	void WorkerMain();
+
+	ImageSink& _sink;
+	size_t _maxQueued;
+	std::vector<std::thread> _threads;
+	mutable std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _finished;
+	std::condition_variable _room;
+	std::deque<ImageWriteJob> _jobs;
+	std::vector<ImageWriteResult> _results;
+	size_t _running = 0;
+	double _blockedMs = 0.0;
+	bool _stop = false;
+};
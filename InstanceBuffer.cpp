@@ -0,0 +1,74 @@
+#include "InstanceBuffer.h"
+
+#include "ThreadPool.h"
+
+
+
+void InstanceBufferBuilder::Begin(const double view[4][4], const double projection[4][4])
+{
+	// View * projection is computed once per frame, the batched transform then only
+	// multiplies each object by it
+	ComputeViewProjection(view, projection, _viewProjection);
+
+	_transforms.Clear();
+	_instances.clear();
+}
+
+void InstanceBufferBuilder::Add(const float minPt[3], const float maxPt[3], const double world[4][4], const float color[3])
+{
+	_transforms.Add(minPt, maxPt, world);
+
+	// The matrix is filled in by Finish()
+	BoundsInstance instance;
+	instance.color[0] = color[0];
+	instance.color[1] = color[1];
+	instance.color[2] = color[2];
+	instance.color[3] = 0.0f;
+
+	_instances.push_back(instance);
+}
+
+void InstanceBufferBuilder::Resize(size_t count)
+{
+	_transforms.Resize(count);
+	_instances.resize(count);
+}
+
+void InstanceBufferBuilder::Set(size_t index, const float minPt[3], const float maxPt[3], const double world[4][4], const float color[3])
+{
+	_transforms.Set(index, minPt, maxPt, world);
+
+	BoundsInstance& instance = _instances[index];
+	instance.color[0] = color[0];
+	instance.color[1] = color[1];
+	instance.color[2] = color[2];
+	instance.color[3] = 0.0f;
+}
+
+void InstanceBufferBuilder::Finish(TransformKernel kernel, ThreadPool* pool)
+{
+	if (_instances.empty())
+		return;
+
+	float* out = &_instances[0].wvp[0][0];
+	const size_t stride = sizeof(BoundsInstance) / sizeof(float);
+
+	if (!pool)
+	{
+		TransformBounds(_transforms, _viewProjection, out, stride, kernel);
+		return;
+	}
+
+	// Multiple of 8 so that only the last range has an AVX2 tail
+	const size_t grain = 4096;
+	pool->ParallelFor(_instances.size(), grain, [&](size_t, size_t begin, size_t end)
+	{
+		TransformBoundsRange(_transforms, begin, end, _viewProjection, out, stride, kernel);
+	});
+}
+
+void InstanceBufferBuilder::Reserve(size_t count)
+{
+	_transforms.Reserve(count);
+	_instances.reserve(count);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "TransformBatch.h"
+
+
+class ThreadPool;
+
+// Per-instance data of the bounds overlay. One entry is streamed per object into
+// vertex buffer slot 1, the layout must match the INSTANCE_WVP/COLOR elements
+// declared in DxPipelineCache.cpp and shaders/unlit_vs.hlsl.
+struct BoundsInstance
+{
+	// bounds * world * view * projection, row-vector convention (not transposed)
+	float wvp[4][4];
+	float color[4];
+};
+
+
+// Builds the per-instance buffer on the CPU. It only depends on the standard library
+// so that it can be tested and benchmarked without Maya or a D3D device.
+class InstanceBufferBuilder
+{
+public:
+	// Start a new frame. view and projection are in Maya's MMatrix layout.
+	void Begin(const double view[4][4], const double projection[4][4]);
+
+	// Append one unit-cube instance scaled to the object-space box [minPt, maxPt].
+	void Add(const float minPt[3], const float maxPt[3], const double world[4][4], const float color[3]);
+
+	// Alternative to Add() for parallel builds: Resize() to the final count, then Set()
+	// every instance, each one from a single thread.
+	void Resize(size_t count);
+	void Set(size_t index, const float minPt[3], const float maxPt[3], const double world[4][4], const float color[3]);
+
+	// Transform all the added instances in one batch, Data() is valid afterwards.
+	// With a pool the batch is split into ranges transformed in parallel.
+	void Finish(TransformKernel kernel = BestTransformKernel(), ThreadPool* pool = nullptr);
+
+	void Reserve(size_t count);
+
+	inline const BoundsInstance* Data() const { return _instances.data(); }
+	inline size_t Count() const { return _instances.size(); }
+	inline size_t ByteSize() const { return _instances.size() * sizeof(BoundsInstance); }
+
+protected:
+	float _viewProjection[4][4];
+	TransformSoA _transforms;
+	std::vector<BoundsInstance> _instances;
+};
@@ -0,0 +1,85 @@
+#include "LodBuilder.h"
+
+#include <algorithm>
+
+
+LodBuilder::LodBuilder(unsigned threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+	for (unsigned i = 0; i < threadCount; i++)
+		_threads.emplace_back(&LodBuilder::WorkerMain, this);
+}
+
+LodBuilder::~LodBuilder()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+		_jobs.clear();
+	}
+	_wake.notify_all();
+
+	for (std::thread& thread : _threads)
+		thread.join();
+}
+
+void LodBuilder::Submit(uint64_t key, uint64_t generation, std::shared_ptr<const LodSource> source)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back({ key, generation, std::move(source) });
+	}
+	_wake.notify_one();
+}
+
+size_t LodBuilder::Collect(std::vector<LodResult>& results)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	size_t count = _results.size();
+	for (LodResult& result : _results)
+		results.push_back(std::move(result));
+	_results.clear();
+	return count;
+}
+
+void LodBuilder::Wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_idle.wait(lock, [this] { return _jobs.empty() && _running == 0; });
+}
+
+size_t LodBuilder::Pending() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _jobs.size() + _running;
+}
+
+void LodBuilder::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_wake.wait(lock, [this] { return _stop || !_jobs.empty(); });
+		if (_stop)
+			return;
+
+		Job job = std::move(_jobs.front());
+		_jobs.pop_front();
+		_running++;
+		lock.unlock();
+
+		LodResult result;
+		result.key = job.key;
+		result.generation = job.generation;
+		const LodSource& source = *job.source;
+		BuildLods(source.positions.data(), source.positions.size() / 3,
+			source.triangles.data(), source.triangles.size(), result.levels);
+		job.source.reset();
+
+		lock.lock();
+		_results.push_back(std::move(result));
+		_running--;
+		if (_jobs.empty() && _running == 0)
+			_idle.notify_all();
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MeshSimplify.h"
+
+
+// Mesh data handed to the LodBuilder, not modified once submitted
+struct LodSource
+{
+	std::vector<float> positions;
+	std::vector<uint32_t> triangles;
+};
+
+struct LodResult
+{
+	uint64_t key;
+	uint64_t generation;
+	std::vector<MeshLod> levels;	// levels 1 to kLodLevelCount - 1
+};
+
+
+// Builds mesh LODs on its own threads. Jobs are taken in submission order; the owner
+// collects the results on its thread and matches them with `generation` to tell the ones
+// built from data that has changed since.
+class LodBuilder
+{
+public:
+	explicit LodBuilder(unsigned threadCount = 1);
+	~LodBuilder();
+
+	LodBuilder(const LodBuilder&) = delete;
+	LodBuilder& operator=(const LodBuilder&) = delete;
+
+	void Submit(uint64_t key, uint64_t generation, std::shared_ptr<const LodSource> source);
+
+	// Moves the finished results to `results`, returns how many
+	size_t Collect(std::vector<LodResult>& results);
+
+	// Blocks until every submitted job is finished
+	void Wait();
+
+	size_t Pending() const;
+	inline unsigned ThreadCount() const { return (unsigned)_threads.size(); }
+
+protected:
+	struct Job
+	{
+		uint64_t key;
+		uint64_t generation;
+		std::shared_ptr<const LodSource> source;
+	};
+
+	void WorkerMain();
+
+	std::vector<std::thread> _threads;
+	mutable std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _idle;
+	std::deque<Job> _jobs;
+	std::vector<LodResult> _results;
+	size_t _running = 0;
+	bool _stop = false;
+};
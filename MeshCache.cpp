@@ -0,0 +1,435 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <maya/MFnMesh.h>
+#include <maya/MIntArray.h>
+
+#include "DxResources.h"
+#include "DxRingBuffer.h"
+#include "SceneBounds.h"
+
+
+static uint64_t HashInts(const MIntArray& values, uint64_t hash)
+{
+	// FNV-1a over the values
+	for (unsigned int i = 0; i < values.length(); i++)
+	{
+		hash ^= (uint32_t)values[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t TopologyHash(const MIntArray& counts, const MIntArray& connects, int numVertices)
+{
+	return HashInts(connects, HashInts(counts, 14695981039346656037ull)) ^ (uint64_t)numVertices;
+}
+
+static uint64_t PointsHash(const float* points, int numVertices)
+{
+	// FNV-1a over the bit patterns
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < 3 * (size_t)numVertices; i++)
+	{
+		uint32_t bits;
+		memcpy(&bits, &points[i], sizeof(bits));
+		hash ^= bits;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+MeshCache::MeshCache(ID3D11Device* device, ResourceRegistry* registry)
+	: _lodBuilder(2)
+{
+	_device = device;
+	_registry = registry;
+
+	// Copy source of the mesh uploads, grows when the budget is larger
+	_staging = new DxRingBuffer(_device, D3D11_BIND_VERTEX_BUFFER, 16 * 1024 * 1024, _registry, kResourceStaging);
+}
+
+MeshCache::~MeshCache()
+{
+	size_t gpuBytes, cpuBytes;
+	for (auto& it : _meshes)
+		Forget(it.first, *it.second, gpuBytes, cpuBytes);
+	_meshes.clear();
+
+	if (_staging)
+	{
+		delete _staging;
+		_staging = nullptr;
+	}
+	_device = nullptr;
+}
+
+void MeshCache::MarkDirty(uint32_t node)
+{
+	auto it = _meshes.find(node);
+	if (it != _meshes.end())
+		it->second->dirty = true;
+}
+
+void MeshCache::CheckAll()
+{
+	for (auto& it : _meshes)
+		it.second->check = true;
+}
+
+const MeshCache::GpuMesh* MeshCache::Find(BoundsKey key, const SceneBounds& scene, size_t& readBudget)
+{
+	uint32_t node = BoundsKeyNode(key);
+	std::unique_ptr<Mesh>& mesh = _meshes[node];
+	if (!mesh)
+		mesh.reset(new Mesh);
+	mesh->lastFrame = _frame;
+
+	// Uploads nothing when the shape is unchanged, a shape that cannot be compared is read
+	if (mesh->check && !mesh->dirty && readBudget > 0)
+	{
+		MDagPath path;
+		size_t checkBytes = 0;
+		if (!scene.PathOf(key, path) || Changed(*mesh, path, checkBytes))
+			mesh->dirty = true;
+		readBudget -= std::min(readBudget, checkBytes);
+		mesh->check = false;
+	}
+
+	// A dirty mesh that does not fit in this frame keeps drawing its previous upload and
+	// stays dirty, so does one that could not be read: both are read again next frame
+	if (mesh->dirty && readBudget > 0)
+	{
+		MDagPath path;
+		MeshChange change;
+		if (scene.PathOf(key, path) && Read(*mesh, path, change))
+		{
+			size_t vertexBytes = mesh->positions.size() * sizeof(float);
+			size_t indexBytes = mesh->indices.size() * sizeof(uint32_t);
+			_scheduler.Request(node, change, vertexBytes, indexBytes);
+
+			size_t readBytes = vertexBytes + (change == kMeshTopologyChanged ? indexBytes : 0);
+			readBudget -= std::min(readBudget, readBytes);
+
+			TrackCpu(*mesh);
+
+			// One build at a time per mesh, the latest read wins
+			mesh->generation++;
+			if (mesh->gpu.triangleIndices / 3 >= kLodMinTriangles)
+			{
+				if (mesh->lodPending)
+					mesh->lodStale = true;
+				else
+					SubmitLods(node, *mesh);
+			}
+			mesh->dirty = false;
+			mesh->check = false;
+		}
+	}
+
+	return _scheduler.Ready(node) ? &mesh->gpu : nullptr;
+}
+
+bool MeshCache::Read(Mesh& mesh, const MDagPath& path, MeshChange& change)
+{
+	MStatus status;
+	MFnMesh fnMesh(path, &status);
+	if (!status)
+		return false;
+
+	int numVertices = fnMesh.numVertices();
+	const float* points = fnMesh.getRawPoints(&status);
+	if (!status || numVertices <= 0 || fnMesh.numPolygons() <= 0)
+		return false;
+
+	// Same face-vertex lists, only the points moved
+	MIntArray counts, connects;
+	fnMesh.getVertices(counts, connects);
+	uint64_t topologyHash = TopologyHash(counts, connects, numVertices);
+
+	mesh.positions.assign(points, points + 3 * (size_t)numVertices);
+	mesh.pointsHash = PointsHash(points, numVertices);
+	if (topologyHash == mesh.topologyHash && !mesh.indices.empty())
+	{
+		change = kMeshPointsChanged;
+		return true;
+	}
+	change = kMeshTopologyChanged;
+	mesh.topologyHash = topologyHash;
+
+	MIntArray triangleCounts, triangleVertices;
+	fnMesh.getTriangles(triangleCounts, triangleVertices);
+
+	mesh.indices.clear();
+	for (unsigned int i = 0; i < triangleVertices.length(); i++)
+		mesh.indices.push_back((uint32_t)triangleVertices[i]);
+
+	// Polygon edges, the ones shared by two faces only once
+	std::vector<uint64_t> edges;
+	edges.reserve(connects.length());
+	unsigned int first = 0;
+	for (unsigned int f = 0; f < counts.length(); f++)
+	{
+		unsigned int count = (unsigned int)counts[f];
+		for (unsigned int v = 0; v < count; v++)
+		{
+			uint32_t a = (uint32_t)connects[first + v];
+			uint32_t b = (uint32_t)connects[first + (v + 1) % count];
+			edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+		}
+		first += count;
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	for (uint64_t edge : edges)
+	{
+		mesh.indices.push_back((uint32_t)(edge >> 32));
+		mesh.indices.push_back((uint32_t)edge);
+	}
+
+	mesh.gpu.triangleIndices = triangleVertices.length();
+	mesh.gpu.edgeIndices = (unsigned int)edges.size() * 2;
+	return true;
+}
+
+bool MeshCache::Changed(const Mesh& mesh, const MDagPath& path, size_t& readBytes)
+{
+	MStatus status;
+	MFnMesh fnMesh(path, &status);
+	if (!status)
+		return true;
+
+	int numVertices = fnMesh.numVertices();
+	const float* points = fnMesh.getRawPoints(&status);
+	if (!status || numVertices <= 0)
+		return true;
+
+	MIntArray counts, connects;
+	fnMesh.getVertices(counts, connects);
+	readBytes = (3 * (size_t)numVertices + counts.length() + connects.length()) * sizeof(uint32_t);
+
+	return TopologyHash(counts, connects, numVertices) != mesh.topologyHash ||
+		PointsHash(points, numVertices) != mesh.pointsHash;
+}
+
+const MeshCache::GpuMesh* MeshCache::Level(BoundsKey key, int level) const
+{
+	uint32_t node = BoundsKeyNode(key);
+	auto it = _meshes.find(node);
+	if (it == _meshes.end())
+		return nullptr;
+
+	const Mesh& mesh = *it->second;
+	for (int l = std::min(level, (int)mesh.lods.size()); l > 0; l--)
+	{
+		if (_scheduler.Ready(LevelKey(node, l)))
+			return &mesh.lodGpu[l - 1];
+	}
+	return &mesh.gpu;
+}
+
+bool MeshCache::Triangles(BoundsKey key, unsigned int maxTriangles, const float*& positions, size_t& vertexCount,
+	const uint32_t*& triangles, size_t& triangleIndexCount) const
+{
+	auto it = _meshes.find(BoundsKeyNode(key));
+	if (it == _meshes.end() || it->second->indices.empty())
+		return false;
+
+	const Mesh& mesh = *it->second;
+	if (mesh.gpu.triangleIndices / 3 <= maxTriangles)
+	{
+		positions = mesh.positions.data();
+		vertexCount = mesh.positions.size() / 3;
+		triangles = mesh.indices.data();
+		triangleIndexCount = mesh.gpu.triangleIndices;
+	}
+	else
+	{
+		// Not while the level is being rebuilt, it may not match the surface anymore
+		if (mesh.lods.empty() || mesh.lodPending)
+			return false;
+
+		const MeshLod& lod = mesh.lods[0];
+		positions = lod.positions.data();
+		vertexCount = lod.positions.size() / 3;
+		triangles = lod.indices.data();
+		triangleIndexCount = lod.triangleIndices;
+	}
+	return true;
+}
+
+void MeshCache::SubmitLods(uint32_t node, Mesh& mesh)
+{
+	std::shared_ptr<LodSource> source = std::make_shared<LodSource>();
+	source->positions = mesh.positions;
+	source->triangles.assign(mesh.indices.begin(), mesh.indices.begin() + mesh.gpu.triangleIndices);
+
+	_lodBuilder.Submit(node, mesh.generation, std::move(source));
+	mesh.lodPending = true;
+	mesh.lodStale = false;
+}
+
+void MeshCache::CollectLods()
+{
+	_lodResults.clear();
+	if (_lodBuilder.Collect(_lodResults) == 0)
+		return;
+
+	for (LodResult& result : _lodResults)
+	{
+		uint32_t node = (uint32_t)result.key;
+		auto it = _meshes.find(node);
+		if (it == _meshes.end() || !it->second->lodPending)
+			continue;
+
+		// Built from an older read it is still close, use it until the next one is done
+		Mesh& mesh = *it->second;
+		mesh.lodPending = false;
+		mesh.lods = std::move(result.levels);
+		for (int level = 1; level <= (int)mesh.lods.size(); level++)
+		{
+			const MeshLod& lod = mesh.lods[level - 1];
+			GpuMesh& gpu = mesh.lodGpu[level - 1];
+			gpu.triangleIndices = lod.triangleIndices;
+			gpu.edgeIndices = lod.edgeIndices;
+			_scheduler.Request(LevelKey(node, level), kMeshTopologyChanged,
+				lod.positions.size() * sizeof(float), lod.indices.size() * sizeof(uint32_t));
+		}
+		TrackCpu(mesh);
+
+		if (mesh.lodStale)
+			SubmitLods(node, mesh);
+	}
+}
+
+bool MeshCache::Allocate(ID3D11Buffer*& buffer, ResourceHandle& handle, UINT bindFlags, size_t size)
+{
+	ReleaseTracked(_registry, buffer, handle);
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = (UINT)size;
+	bd.BindFlags = bindFlags;
+	return SUCCEEDED(CreateTrackedBuffer(_device, _registry, kResourceMeshes, bd, NULL, &buffer, handle));
+}
+
+size_t MeshCache::Release(GpuMesh& gpu)
+{
+	size_t bytes = ReleaseTracked(_registry, gpu.vertices, gpu.vertexHandle);
+	bytes += ReleaseTracked(_registry, gpu.indices, gpu.indexHandle);
+	return bytes;
+}
+
+void MeshCache::TrackCpu(Mesh& mesh)
+{
+	if (!_registry)
+		return;
+
+	size_t bytes = mesh.positions.capacity() * sizeof(float) + mesh.indices.capacity() * sizeof(uint32_t);
+	for (const MeshLod& lod : mesh.lods)
+		bytes += lod.positions.capacity() * sizeof(float) + lod.indices.capacity() * sizeof(uint32_t);
+	_registry->Set(mesh.cpuHandle, kResourceMeshData, bytes);
+}
+
+void MeshCache::Forget(uint32_t node, Mesh& mesh, size_t& gpuBytes, size_t& cpuBytes)
+{
+	gpuBytes = Release(mesh.gpu);
+	_scheduler.Remove(node);
+	for (int level = 1; level < kLodLevelCount; level++)
+	{
+		gpuBytes += Release(mesh.lodGpu[level - 1]);
+		_scheduler.Remove(LevelKey(node, level));
+	}
+	cpuBytes = _registry ? _registry->Untrack(mesh.cpuHandle) : 0;
+}
+
+void MeshCache::Upload(ID3D11DeviceContext* context, size_t budget)
+{
+	CollectLods();
+
+	_uploads.clear();
+	_scheduler.Plan(budget, _uploads);
+	if (_uploads.empty())
+		return;
+
+	_staging->BeginFrame(context);
+	for (const MeshUpload& upload : _uploads)
+	{
+		auto it = _meshes.find((uint32_t)upload.key);
+		int level = (int)(upload.key >> 32);
+		if (it == _meshes.end() || level > (int)it->second->lods.size())
+			continue;
+
+		Mesh& mesh = *it->second;
+		GpuMesh& gpu = level == 0 ? mesh.gpu : mesh.lodGpu[level - 1];
+		const std::vector<float>& positions = level == 0 ? mesh.positions : mesh.lods[level - 1].positions;
+		const std::vector<uint32_t>& indices = level == 0 ? mesh.indices : mesh.lods[level - 1].indices;
+
+		bool vertices = upload.buffer == kMeshVertices;
+		ID3D11Buffer*& target = vertices ? gpu.vertices : gpu.indices;
+		ResourceHandle& handle = vertices ? gpu.vertexHandle : gpu.indexHandle;
+		const uint8_t* source = vertices ? (const uint8_t*)positions.data() : (const uint8_t*)indices.data();
+
+		if (upload.allocate)
+		{
+			size_t size = vertices ? positions.size() * sizeof(float) : indices.size() * sizeof(uint32_t);
+			if (!Allocate(target, handle, vertices ? D3D11_BIND_VERTEX_BUFFER : D3D11_BIND_INDEX_BUFFER, size))
+				continue;
+		}
+
+		size_t stagingOffset = 0;
+		if (!target || !_staging->Upload(context, source + upload.offset, upload.size, sizeof(uint32_t), stagingOffset))
+			continue;
+
+		D3D11_BOX box = { (UINT)stagingOffset, 0, 0, (UINT)(stagingOffset + upload.size), 1, 1 };
+		context->CopySubresourceRegion(target, 0, (UINT)upload.offset, 0, 0, _staging->Buffer(), 0, &box);
+	}
+	_staging->EndFrame(context);
+}
+
+void MeshCache::Prune(uint64_t frame, uint64_t staleFrames)
+{
+	size_t gpuBytes, cpuBytes;
+	for (auto it = _meshes.begin(); it != _meshes.end();)
+	{
+		if (frame - it->second->lastFrame > staleFrames)
+		{
+			Forget(it->first, *it->second, gpuBytes, cpuBytes);
+			it = _meshes.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+size_t MeshCache::Evict(ResourceMemory memory, size_t bytes)
+{
+	// Least recently drawn first, a mesh is read and uploaded again when next drawn
+	_evictOrder.clear();
+	for (const auto& it : _meshes)
+	{
+		if (_frame - it.second->lastFrame >= _keepFrames)
+			_evictOrder.push_back(std::make_pair(it.second->lastFrame, it.first));
+	}
+	std::sort(_evictOrder.begin(), _evictOrder.end());
+
+	size_t freed = 0;
+	for (const std::pair<uint64_t, uint32_t>& entry : _evictOrder)
+	{
+		if (freed >= bytes)
+			break;
+
+		auto it = _meshes.find(entry.second);
+		size_t gpuBytes, cpuBytes;
+		Forget(it->first, *it->second, gpuBytes, cpuBytes);
+		_meshes.erase(it);
+		freed += memory == kMemoryGpu ? gpuBytes : cpuBytes;
+	}
+	return freed;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#pragma warning(disable: 4005)
+
+#define WIN32_LEAN_AND_MEAN
+#include <d3d11.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "BoundsCache.h"
+#include "LodBuilder.h"
+#include "ResourceRegistry.h"
+#include "UploadScheduler.h"
+
+
+class DxRingBuffer;
+class MDagPath;
+class SceneBounds;
+
+
+// GPU copies of the scene meshes for the wireframe and shaded overlay, one per shape
+// node (the DAG instances share it). A mesh is read from Maya when first drawn and when
+// its shape is dirty; a change that keeps the face-vertex lists only rewrites the
+// positions. The copies go through a staging ring and are scheduled by an UploadScheduler,
+// so a big edit is spread over several frames instead of stalling one.
+// Meshes of kLodMinTriangles or more also get simplified levels (MeshSimplify.h), built
+// on the LodBuilder threads after each read and uploaded the same way.
+// The buffers and the CPU copies are tracked in the registry, over a budget the meshes
+// drawn the longest ago are evicted whole, as Prune() does.
+class MeshCache : public ResourceEvictor
+{
+public:
+	struct GpuMesh
+	{
+		ID3D11Buffer* vertices = nullptr;	// float3 positions
+		ID3D11Buffer* indices = nullptr;	// 32-bit, the triangles then the edges
+		unsigned int triangleIndices = 0;
+		unsigned int edgeIndices = 0;
+		ResourceHandle vertexHandle = 0;
+		ResourceHandle indexHandle = 0;
+	};
+
+	static const unsigned int kLodMinTriangles = 5000;
+
+	MeshCache(ID3D11Device* device, ResourceRegistry* registry);
+	~MeshCache();
+
+	// The shape changed, it is read again the next time it is drawn
+	void MarkDirty(uint32_t node);
+
+	// Changes of the shapes were lost: each mesh compares its face-vertex lists and points
+	// with its shape the next time it is drawn, and is only read again if they differ
+	void CheckAll();
+
+	// The GPU mesh of the shape of `key` when it is complete, otherwise null. Reads (or
+	// checks) the shape if it is new or dirty, until `readBudget` bytes have been read this
+	// frame.
+	const GpuMesh* Find(BoundsKey key, const SceneBounds& scene, size_t& readBudget);
+
+	// The uploaded level closest to `level` on the finer side, for a mesh Find() returned
+	const GpuMesh* Level(BoundsKey key, int level) const;
+
+	// CPU triangles of a mesh Find() has read, for the occlusion culling: the mesh itself, or
+	// its first simplified level when it has more than `maxTriangles` triangles. Only the
+	// first level stays close enough to the surface to stand in for it. False when there is
+	// no such level yet.
+	bool Triangles(BoundsKey key, unsigned int maxTriangles, const float*& positions, size_t& vertexCount,
+		const uint32_t*& triangles, size_t& triangleIndexCount) const;
+
+	// Take the finished LODs and copy this frame's share of the pending mesh data, at
+	// most `budget` bytes
+	void Upload(ID3D11DeviceContext* context, size_t budget);
+
+	// Forget the meshes not drawn for `staleFrames` frames
+	void Prune(uint64_t frame, uint64_t staleFrames);
+
+	// Forgets the meshes drawn the longest ago, except the ones drawn in the last
+	// SetKeepFrames() frames, until `bytes` of that memory are freed
+	size_t Evict(ResourceMemory memory, size_t bytes) override;
+
+	inline void SetFrame(uint64_t frame) { _frame = frame; }
+	inline void SetKeepFrames(uint64_t frames) { _keepFrames = frames; }
+	inline size_t MeshCount() const { return _meshes.size(); }
+	inline const UploadScheduler& Scheduler() const { return _scheduler; }
+	inline size_t LodPending() const { return _lodBuilder.Pending(); }
+
+protected:
+	struct Mesh
+	{
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+		uint64_t topologyHash = 0;
+		uint64_t pointsHash = 0;
+		bool dirty = true;
+		bool check = false;		// compare the hashes with the shape, see CheckAll()
+		uint64_t lastFrame = 0;
+		GpuMesh gpu;
+		ResourceHandle cpuHandle = 0;	// positions, indices and the levels
+
+		// Levels 1 and up, from the LodBuilder
+		std::vector<MeshLod> lods;
+		GpuMesh lodGpu[kLodLevelCount - 1];
+		uint64_t generation = 0;	// incremented by each read
+		bool lodPending = false;
+		bool lodStale = false;		// read again while the LODs were being built
+	};
+
+	// Scheduler key of a level, level 0 is the node itself
+	static inline uint64_t LevelKey(uint32_t node, int level) { return ((uint64_t)level << 32) | node; }
+
+	bool Read(Mesh& mesh, const MDagPath& path, MeshChange& change);
+
+	// Whether the shape differs from what was last read, `readBytes` is what comparing it read
+	bool Changed(const Mesh& mesh, const MDagPath& path, size_t& readBytes);
+	void SubmitLods(uint32_t node, Mesh& mesh);
+	void CollectLods();
+	bool Allocate(ID3D11Buffer*& buffer, ResourceHandle& handle, UINT bindFlags, size_t size);
+	size_t Release(GpuMesh& gpu);
+	void TrackCpu(Mesh& mesh);
+
+	// Releases the buffers and untracks the mesh, which is then erased. Returns the GPU
+	// and CPU bytes untracked.
+	void Forget(uint32_t node, Mesh& mesh, size_t& gpuBytes, size_t& cpuBytes);
+
+	ID3D11Device* _device = nullptr;
+	ResourceRegistry* _registry = nullptr;
+	DxRingBuffer* _staging = nullptr;
+	UploadScheduler _scheduler;
+	std::unordered_map<uint32_t, std::unique_ptr<Mesh>> _meshes;
+	std::vector<MeshUpload> _uploads;
+	LodBuilder _lodBuilder;
+	std::vector<LodResult> _lodResults;
+	uint64_t _frame = 0;
+	uint64_t _keepFrames = 1;
+	std::vector<std::pair<uint64_t, uint32_t>> _evictOrder;
+};
@@ -0,0 +1,177 @@
+#include "MeshSimplify.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+
+void SimplifyByClustering(const float* positions, size_t vertexCount,
+	const uint32_t* triangles, size_t triangleIndexCount, int grid, MeshLod& out)
+{
+	out.positions.clear();
+	out.indices.clear();
+	out.triangleIndices = 0;
+	out.edgeIndices = 0;
+	if (vertexCount == 0 || grid <= 0)
+		return;
+
+	float minPt[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maxPt[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			minPt[a] = std::min(minPt[a], positions[v * 3 + a]);
+			maxPt[a] = std::max(maxPt[a], positions[v * 3 + a]);
+		}
+	}
+
+	float extent = std::max(maxPt[0] - minPt[0], std::max(maxPt[1] - minPt[1], maxPt[2] - minPt[2]));
+	float scale = extent > 0.0f ? grid / extent : 0.0f;
+
+	// Sort the vertices by cell, each run of equal cells becomes one cluster
+	std::vector<std::pair<uint64_t, uint32_t>> cells(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		uint64_t cell = 0;
+		for (int a = 0; a < 3; a++)
+		{
+			uint64_t c = (uint64_t)std::min((positions[v * 3 + a] - minPt[a]) * scale, (float)grid);
+			cell = (cell << 21) | c;
+		}
+		cells[v] = { cell, (uint32_t)v };
+	}
+	std::sort(cells.begin(), cells.end());
+
+	std::vector<uint32_t> cluster(vertexCount);
+	for (size_t i = 0; i < vertexCount;)
+	{
+		size_t end = i;
+		double sum[3] = { 0.0, 0.0, 0.0 };
+		for (; end < vertexCount && cells[end].first == cells[i].first; end++)
+		{
+			uint32_t v = cells[end].second;
+			sum[0] += positions[v * 3 + 0];
+			sum[1] += positions[v * 3 + 1];
+			sum[2] += positions[v * 3 + 2];
+			cluster[v] = (uint32_t)(out.positions.size() / 3);
+		}
+
+		double count = (double)(end - i);
+		out.positions.push_back((float)(sum[0] / count));
+		out.positions.push_back((float)(sum[1] / count));
+		out.positions.push_back((float)(sum[2] / count));
+		i = end;
+	}
+
+	// Triangles that keep three clusters, once each. Rotated so the smallest index is
+	// first, which keeps the winding.
+	std::vector<uint32_t> triangleList;
+	triangleList.reserve(triangleIndexCount);
+	{
+		struct Triangle { uint32_t a, b, c; };
+		std::vector<Triangle> remapped;
+		remapped.reserve(triangleIndexCount / 3);
+		for (size_t t = 0; t + 2 < triangleIndexCount; t += 3)
+		{
+			uint32_t a = cluster[triangles[t]], b = cluster[triangles[t + 1]], c = cluster[triangles[t + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			if (b < a && b < c)
+				remapped.push_back({ b, c, a });
+			else if (c < a && c < b)
+				remapped.push_back({ c, a, b });
+			else
+				remapped.push_back({ a, b, c });
+		}
+		std::sort(remapped.begin(), remapped.end(), [](const Triangle& x, const Triangle& y)
+		{
+			return x.a != y.a ? x.a < y.a : (x.b != y.b ? x.b < y.b : x.c < y.c);
+		});
+
+		for (size_t i = 0; i < remapped.size(); i++)
+		{
+			const Triangle& t = remapped[i];
+			if (i > 0 && t.a == remapped[i - 1].a && t.b == remapped[i - 1].b && t.c == remapped[i - 1].c)
+				continue;
+			triangleList.push_back(t.a);
+			triangleList.push_back(t.b);
+			triangleList.push_back(t.c);
+		}
+	}
+
+	std::vector<uint64_t> edges;
+	edges.reserve(triangleList.size());
+	for (size_t t = 0; t < triangleList.size(); t += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			uint32_t a = triangleList[t + e], b = triangleList[t + (e + 1) % 3];
+			edges.push_back(((uint64_t)std::min(a, b) << 32) | std::max(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	out.indices.swap(triangleList);
+	out.triangleIndices = (uint32_t)out.indices.size();
+	for (uint64_t edge : edges)
+	{
+		out.indices.push_back((uint32_t)(edge >> 32));
+		out.indices.push_back((uint32_t)edge);
+	}
+	out.edgeIndices = (uint32_t)edges.size() * 2;
+}
+
+void BuildLods(const float* positions, size_t vertexCount,
+	const uint32_t* triangles, size_t triangleIndexCount, std::vector<MeshLod>& levels)
+{
+	levels.resize(kLodLevelCount - 1);
+	for (int level = 1; level < kLodLevelCount; level++)
+		SimplifyByClustering(positions, vertexCount, triangles, triangleIndexCount, kLodGrids[level], levels[level - 1]);
+}
+
+double ProjectedSize(const float minPt[3], const float maxPt[3], const double world[4][4],
+	const double viewProjection[4][4], double projectionScaleY, double viewportHeight)
+{
+	double center[3], radius = 0.0;
+	for (int a = 0; a < 3; a++)
+	{
+		center[a] = 0.5 * ((double)minPt[a] + maxPt[a]);
+		double half = 0.5 * ((double)maxPt[a] - minPt[a]);
+		radius += half * half;
+	}
+	radius = sqrt(radius);
+
+	// The largest axis scale of the world matrix bounds the world radius
+	double axisScale = 0.0;
+	for (int r = 0; r < 3; r++)
+		axisScale = std::max(axisScale, world[r][0] * world[r][0] + world[r][1] * world[r][1] + world[r][2] * world[r][2]);
+	radius *= sqrt(axisScale);
+
+	double worldCenter[4];
+	for (int c = 0; c < 4; c++)
+		worldCenter[c] = center[0] * world[0][c] + center[1] * world[1][c] + center[2] * world[2][c] + world[3][c];
+
+	// Orthographic when w does not depend on the position
+	bool perspective = viewProjection[0][3] != 0.0 || viewProjection[1][3] != 0.0 || viewProjection[2][3] != 0.0;
+
+	double w = 0.0;
+	for (int r = 0; r < 4; r++)
+		w += worldCenter[r] * viewProjection[r][3];
+
+	// Perspective w is the distance along the view axis, inside the sphere is full size
+	if (perspective && w <= radius)
+		return DBL_MAX;
+	return radius * fabs(projectionScaleY) / w * viewportHeight;
+}
+
+int SelectLod(double projectedSize)
+{
+	for (int level = kLodLevelCount - 1; level > 0; level--)
+	{
+		if (projectedSize <= 2.0 * kLodGrids[level])
+			return level;
+	}
+	return 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Levels of detail of the overlay meshes. Level 0 is the mesh itself, the others are
+// vertex clusterings on a grid of kLodGrids[level] cells along the longest side.
+static const int kLodLevelCount = 4;
+static const int kLodGrids[kLodLevelCount] = { 0, 96, 32, 10 };
+
+// Same layout as the GPU meshes: float3 positions, 32-bit indices of the triangles then
+// of the edges
+struct MeshLod
+{
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	uint32_t triangleIndices = 0;
+	uint32_t edgeIndices = 0;
+};
+
+// Merges the vertices falling in the same grid cell into their average and drops the
+// triangles that collapse. The edges are the unique edges of the remaining triangles.
+void SimplifyByClustering(const float* positions, size_t vertexCount,
+	const uint32_t* triangles, size_t triangleIndexCount, int grid, MeshLod& out);
+
+// Levels 1 to kLodLevelCount - 1 of a mesh
+void BuildLods(const float* positions, size_t vertexCount,
+	const uint32_t* triangles, size_t triangleIndexCount, std::vector<MeshLod>& levels);
+
+// Height in pixels of the bounding sphere of an object box, or a very large value when
+// the camera is inside it. The matrices are row-vector (Maya) with the projection's
+// vertical scale passed separately.
+double ProjectedSize(const float minPt[3], const float maxPt[3], const double world[4][4],
+	const double viewProjection[4][4], double projectionScaleY, double viewportHeight);
+
+// The coarsest level whose grid cells are at most 2 pixels on screen
+int SelectLod(double projectedSize);
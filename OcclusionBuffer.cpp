@@ -0,0 +1,260 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+
+// std::min and std::max take them by reference
+const int OcclusionBuffer::kTileSize;
+const int OcclusionBuffer::kSubpixels;
+const int OcclusionBuffer::kMaxSize;
+
+static inline void TransformPoint(const float p[3], const float m[4][4], float out[4])
+{
+	for (int c = 0; c < 4; c++)
+		out[c] = p[0] * m[0][c] + p[1] * m[1][c] + p[2] * m[2][c] + m[3][c];
+}
+
+static int RoundToTiles(int size)
+{
+	size = std::max(OcclusionBuffer::kTileSize, std::min(OcclusionBuffer::kMaxSize, size));
+	return (size + OcclusionBuffer::kTileSize - 1) / OcclusionBuffer::kTileSize * OcclusionBuffer::kTileSize;
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+{
+	_width = RoundToTiles(width);
+	_height = RoundToTiles(height);
+	_tilesX = _width / kTileSize;
+	_tilesY = _height / kTileSize;
+	_depth.resize((size_t)_width * _height);
+	_tileMax.resize((size_t)_tilesX * _tilesY);
+	Clear();
+}
+
+void OcclusionBuffer::Clear()
+{
+	std::fill(_depth.begin(), _depth.end(), FLT_MAX);
+	std::fill(_tileMax.begin(), _tileMax.end(), FLT_MAX);
+	_triangles = 0;
+}
+
+bool OcclusionBuffer::SetupTriangle(const float v0[4], const float v1[4], const float v2[4], OcclusionTriangle& tri) const
+{
+	const float* v[3] = { v0, v1, v2 };
+	int32_t x[3], y[3];
+	float depth = -FLT_MAX;
+	for (int i = 0; i < 3; i++)
+	{
+		float w = v[i][3];
+		if (!(w > 0.0f))
+			return false;
+
+		// Outside of this guard band the edge functions could overflow. The comparisons
+		// are written so that NaN fails them.
+		float sx = (v[i][0] / w * 0.5f + 0.5f) * _width;
+		float sy = (0.5f - v[i][1] / w * 0.5f) * _height;
+		if (!(sx > -_width && sx < 2.0f * _width && sy > -_height && sy < 2.0f * _height))
+			return false;
+
+		x[i] = (int32_t)std::lround(sx * kSubpixels);
+		y[i] = (int32_t)std::lround(sy * kSubpixels);
+		depth = std::max(depth, v[i][2] / w);
+	}
+
+	// Both facings are occluders, make the winding counter-clockwise
+	int64_t area = (int64_t)(x[1] - x[0]) * (y[2] - y[0]) - (int64_t)(x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0)
+		return false;
+	if (area < 0)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		tri.a[i] = y[i] - y[j];
+		tri.b[i] = x[j] - x[i];
+		tri.c[i] = x[i] * y[j] - x[j] * y[i];
+	}
+
+	// Arithmetic shifts, so negative coordinates round down
+	tri.minX = std::max(0, std::min(x[0], std::min(x[1], x[2])) >> 4);
+	tri.minY = std::max(0, std::min(y[0], std::min(y[1], y[2])) >> 4);
+	tri.maxX = std::min(_width - 1, std::max(x[0], std::max(x[1], x[2])) >> 4);
+	tri.maxY = std::min(_height - 1, std::max(y[0], std::max(y[1], y[2])) >> 4);
+	tri.depth = depth;
+	static_assert(kSubpixels == 16, "the pixel bounds shift by 4");
+
+	return tri.minX <= tri.maxX && tri.minY <= tri.maxY;
+}
+
+void OcclusionBuffer::RasterizeMesh(const float* positions, size_t vertexCount, const uint32_t* triangles,
+	size_t triangleIndexCount, const float objectToClip[4][4], TransformKernel kernel)
+{
+	_clip.resize(vertexCount * 4);
+	for (size_t i = 0; i < vertexCount; i++)
+		TransformPoint(positions + i * 3, objectToClip, _clip.data() + i * 4);
+
+	bool avx2 = kernel == kTransformAVX2 && OcclusionAVX2Compiled();
+	OcclusionTriangle tri;
+	for (size_t t = 0; t + 3 <= triangleIndexCount; t += 3)
+	{
+		uint32_t i0 = triangles[t], i1 = triangles[t + 1], i2 = triangles[t + 2];
+		if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+			continue;
+		if (!SetupTriangle(&_clip[i0 * 4], &_clip[i1 * 4], &_clip[i2 * 4], tri))
+			continue;
+
+		if (!avx2 || !RasterTriangleAVX2(tri, _depth.data(), _width))
+			RasterTriangleScalar(tri, _depth.data(), _width);
+		_triangles++;
+	}
+}
+
+void OcclusionBuffer::Finish()
+{
+	for (int ty = 0; ty < _tilesY; ty++)
+	{
+		for (int tx = 0; tx < _tilesX; tx++)
+		{
+			float farthest = -FLT_MAX;
+			for (int y = ty * kTileSize; y < (ty + 1) * kTileSize; y++)
+			{
+				const float* row = _depth.data() + (size_t)y * _width + tx * kTileSize;
+				for (int x = 0; x < kTileSize; x++)
+					farthest = std::max(farthest, row[x]);
+			}
+			_tileMax[(size_t)ty * _tilesX + tx] = farthest;
+		}
+	}
+}
+
+bool OcclusionBuffer::ScreenRect(const float minPt[3], const float maxPt[3], const float objectToClip[4][4],
+	int& minX, int& minY, int& maxX, int& maxY, float& depth) const
+{
+	// The corners are the clip position of minPt plus any of the three clip-space edges
+	float base[4], edge[3][4];
+	TransformPoint(minPt, objectToClip, base);
+	for (int a = 0; a < 3; a++)
+	{
+		float length = maxPt[a] - minPt[a];
+		for (int c = 0; c < 4; c++)
+			edge[a][c] = objectToClip[a][c] * length;
+	}
+
+	float minNX = FLT_MAX, minNY = FLT_MAX, maxNX = -FLT_MAX, maxNY = -FLT_MAX;
+	depth = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float clip[4];
+		for (int c = 0; c < 4; c++)
+		{
+			clip[c] = base[c];
+			for (int a = 0; a < 3; a++)
+				clip[c] += (corner & (1 << a)) ? edge[a][c] : 0.0f;
+		}
+		if (!(clip[3] > 0.0f))
+			return false;
+
+		float invW = 1.0f / clip[3];
+		minNX = std::min(minNX, clip[0] * invW);
+		maxNX = std::max(maxNX, clip[0] * invW);
+		minNY = std::min(minNY, clip[1] * invW);
+		maxNY = std::max(maxNY, clip[1] * invW);
+		depth = std::min(depth, clip[2] * invW);
+	}
+
+	// Same mapping as the triangles, y points down
+	float minSX = (minNX * 0.5f + 0.5f) * _width;
+	float maxSX = (maxNX * 0.5f + 0.5f) * _width;
+	float minSY = (0.5f - maxNY * 0.5f) * _height;
+	float maxSY = (0.5f - minNY * 0.5f) * _height;
+
+	// Every pixel the box touches, even partly
+	if (!(maxSX >= 0.0f && minSX < (float)_width && maxSY >= 0.0f && minSY < (float)_height))
+		return false;
+	minX = std::max(0, (int)std::floor(minSX));
+	minY = std::max(0, (int)std::floor(minSY));
+	maxX = std::min(_width - 1, (int)std::floor(maxSX));
+	maxY = std::min(_height - 1, (int)std::floor(maxSY));
+	return true;
+}
+
+bool OcclusionBuffer::IsOccluded(const float minPt[3], const float maxPt[3], const float objectToClip[4][4]) const
+{
+	int minX, minY, maxX, maxY;
+	float depth;
+	if (!ScreenRect(minPt, maxPt, objectToClip, minX, minY, maxX, maxY, depth))
+		return false;
+
+	for (int ty = minY / kTileSize; ty <= maxY / kTileSize; ty++)
+	{
+		for (int tx = minX / kTileSize; tx <= maxX / kTileSize; tx++)
+		{
+			// The whole tile is nearer than the box
+			if (_tileMax[(size_t)ty * _tilesX + tx] < depth)
+				continue;
+
+			int y0 = std::max(minY, ty * kTileSize), y1 = std::min(maxY, ty * kTileSize + kTileSize - 1);
+			int x0 = std::max(minX, tx * kTileSize), x1 = std::min(maxX, tx * kTileSize + kTileSize - 1);
+			for (int y = y0; y <= y1; y++)
+			{
+				const float* row = _depth.data() + (size_t)y * _width;
+				for (int x = x0; x <= x1; x++)
+				{
+					if (!(row[x] < depth))
+						return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+bool OcclusionBuffer::IsOccludedReference(const float minPt[3], const float maxPt[3], const float objectToClip[4][4]) const
+{
+	int minX, minY, maxX, maxY;
+	float depth;
+	if (!ScreenRect(minPt, maxPt, objectToClip, minX, minY, maxX, maxY, depth))
+		return false;
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		for (int x = minX; x <= maxX; x++)
+		{
+			if (!(_depth[(size_t)y * _width + x] < depth))
+				return false;
+		}
+	}
+	return true;
+}
+
+void RasterTriangleScalar(const OcclusionTriangle& tri, float* depth, int width)
+{
+	const int32_t step = OcclusionBuffer::kSubpixels;
+	const int32_t half = OcclusionBuffer::kSubpixels / 2;
+	for (int y = tri.minY; y <= tri.maxY; y++)
+	{
+		// Edge functions at the center of the row's first pixel, then one pixel at a time
+		int32_t px = tri.minX * step + half;
+		int32_t py = y * step + half;
+		int32_t e0 = tri.a[0] * px + tri.b[0] * py + tri.c[0];
+		int32_t e1 = tri.a[1] * px + tri.b[1] * py + tri.c[1];
+		int32_t e2 = tri.a[2] * px + tri.b[2] * py + tri.c[2];
+
+		float* row = depth + (size_t)y * width;
+		for (int x = tri.minX; x <= tri.maxX; x++)
+		{
+			// Same select as _mm256_min_ps, for identical results
+			if ((e0 | e1 | e2) >= 0)
+				row[x] = row[x] < tri.depth ? row[x] : tri.depth;
+			e0 += tri.a[0] * step;
+			e1 += tri.a[1] * step;
+			e2 += tri.a[2] * step;
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TransformBatch.h"
+
+
+// One triangle ready to rasterize: edge functions on a fixed-point grid of kSubpixels
+// steps per pixel, a pixel is covered when its center is on the inner side of the three
+// edges (e >= 0). The depth is the farthest of the three vertices, so an occluder is never
+// nearer than the surface it stands for.
+struct OcclusionTriangle
+{
+	int minX = 0, minY = 0, maxX = 0, maxY = 0;	// pixel bounds, inclusive
+	int32_t a[3], b[3], c[3];					// e(px, py) = a * px + b * py + c
+	float depth = 0.0f;
+};
+
+
+// Low resolution CPU depth buffer for occlusion culling. A few large occluder meshes are
+// rasterized, then the boxes of the candidates are tested against it before they reach the
+// draw list. Depth is z / w in clip space, smaller is nearer, cleared to the far end.
+// Every tile of kTileSize x kTileSize pixels also keeps its farthest depth, a box behind
+// the farthest depth of all the tiles it covers is occluded without reading the pixels.
+// The scalar and AVX2 rasterizers give the same buffer bit for bit.
+class OcclusionBuffer
+{
+public:
+	static const int kTileSize = 8;
+	static const int kSubpixels = 16;
+	static const int kMaxSize = 512;	// keeps the edge functions in 32 bits
+
+	// Multiples of kTileSize, at most kMaxSize
+	OcclusionBuffer(int width = 256, int height = 128);
+
+	void Clear();
+
+	// Triangles of float3 positions transformed by objectToClip (row-vector convention).
+	// Triangles crossing the near plane or far outside the screen are skipped.
+	void RasterizeMesh(const float* positions, size_t vertexCount, const uint32_t* triangles, size_t triangleIndexCount,
+		const float objectToClip[4][4], TransformKernel kernel);
+
+	// Builds the tile depths, call after the last occluder and before the tests
+	void Finish();
+
+	// True when the box, transformed by objectToClip, is behind the occluders at every pixel
+	// it covers. Boxes crossing the near plane or off screen are never occluded.
+	bool IsOccluded(const float minPt[3], const float maxPt[3], const float objectToClip[4][4]) const;
+
+	// Same test reading every pixel, without the tiles
+	bool IsOccludedReference(const float minPt[3], const float maxPt[3], const float objectToClip[4][4]) const;
+
+	// Fixed-point setup of a clip-space triangle (x, y, z, w per vertex), false when it is
+	// not rasterized
+	bool SetupTriangle(const float v0[4], const float v1[4], const float v2[4], OcclusionTriangle& tri) const;
+
+	inline int Width() const { return _width; }
+	inline int Height() const { return _height; }
+	inline const float* Depth() const { return _depth.data(); }
+	inline float* Depth() { return _depth.data(); }
+	inline size_t TriangleCount() const { return _triangles; }
+
+protected:
+	// Pixel rectangle and nearest depth of a box, false when it cannot be occluded
+	bool ScreenRect(const float minPt[3], const float maxPt[3], const float objectToClip[4][4],
+		int& minX, int& minY, int& maxX, int& maxY, float& depth) const;
+
+	int _width = 0;
+	int _height = 0;
+	int _tilesX = 0;
+	int _tilesY = 0;
+	std::vector<float> _depth;
+	std::vector<float> _tileMax;
+	std::vector<float> _clip;	// scratch, the transformed vertices of a mesh
+	size_t _triangles = 0;
+};
+
+
+// The rasterizers, one triangle into a depth buffer of `width` pixels per row
+void RasterTriangleScalar(const OcclusionTriangle& tri, float* depth, int width);
+
+// OcclusionBufferAVX2.cpp. Width must be a multiple of 8. Returns false (and does nothing)
+// when the build has no AVX2 kernel.
+bool OcclusionAVX2Compiled();
+bool RasterTriangleAVX2(const OcclusionTriangle& tri, float* depth, int width);
@@ -0,0 +1,65 @@
+// This file is compiled with AVX2/FMA code generation, see garland_enable_avx2() in
+// cmake/GarlandSIMD.cmake. It is only called after BestTransformKernel() checked that
+// the CPU supports it.
+#include "OcclusionBuffer.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+
+bool OcclusionAVX2Compiled()
+{
+	return true;
+}
+
+bool RasterTriangleAVX2(const OcclusionTriangle& tri, float* depth, int width)
+{
+	if (width % 8 != 0)
+		return false;
+
+	const int32_t step = OcclusionBuffer::kSubpixels;
+	const int32_t half = OcclusionBuffer::kSubpixels / 2;
+
+	// Edge function offsets of the 8 pixels of a block from its first pixel
+	const __m256i lanes = _mm256_setr_epi32(0, step, 2 * step, 3 * step, 4 * step, 5 * step, 6 * step, 7 * step);
+	__m256i laneOffset[3];
+	for (int e = 0; e < 3; e++)
+		laneOffset[e] = _mm256_mullo_epi32(_mm256_set1_epi32(tri.a[e]), lanes);
+	const __m256 triDepth = _mm256_set1_ps(tri.depth);
+
+	// Whole blocks of 8, the pixels outside of the triangle's bounds fail the edge tests
+	int startX = tri.minX & ~7;
+	for (int y = tri.minY; y <= tri.maxY; y++)
+	{
+		int32_t py = y * step + half;
+		float* row = depth + (size_t)y * width;
+		for (int x = startX; x <= tri.maxX; x += 8)
+		{
+			int32_t px = x * step + half;
+			__m256i e0 = _mm256_add_epi32(_mm256_set1_epi32(tri.a[0] * px + tri.b[0] * py + tri.c[0]), laneOffset[0]);
+			__m256i e1 = _mm256_add_epi32(_mm256_set1_epi32(tri.a[1] * px + tri.b[1] * py + tri.c[1]), laneOffset[1]);
+			__m256i e2 = _mm256_add_epi32(_mm256_set1_epi32(tri.a[2] * px + tri.b[2] * py + tri.c[2]), laneOffset[2]);
+
+			// The sign bit is set where a pixel is outside of any edge, keep the old depth there
+			__m256 outside = _mm256_castsi256_ps(_mm256_or_si256(_mm256_or_si256(e0, e1), e2));
+			__m256 old = _mm256_loadu_ps(row + x);
+			__m256 nearest = _mm256_min_ps(old, triDepth);
+			_mm256_storeu_ps(row + x, _mm256_blendv_ps(nearest, old, outside));
+		}
+	}
+	return true;
+}
+
+#else
+
+bool OcclusionAVX2Compiled()
+{
+	return false;
+}
+
+bool RasterTriangleAVX2(const OcclusionTriangle& tri, float* depth, int width)
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#include "OverlayCache.h"
+
+#include <cstring>
+
+
+bool OverlaySignature::operator==(const OverlaySignature& other) const
+{
+	return memcmp(view, other.view, sizeof(view)) == 0 &&
+		memcmp(projection, other.projection, sizeof(projection)) == 0 &&
+		width == other.width && height == other.height &&
+		sceneVersion == other.sceneVersion && settings == other.settings;
+}
+
+void OverlayCache::Update(const OverlaySignature& signature, bool cacheable)
+{
+	_signature = signature;
+	_valid = cacheable;
+}
+
+void CacheHitRate::Add(bool hit)
+{
+	// Drop the oldest lookup once the window is full
+	if (_count == kWindow)
+		_windowHits -= _window[_next] ? 1 : 0;
+	else
+		_count++;
+
+	_window[_next] = hit;
+	_windowHits += hit ? 1 : 0;
+	_next = (_next + 1) % kWindow;
+
+	_hits += hit ? 1 : 0;
+	_lookups++;
+}
+
+void CacheHitRate::Reset()
+{
+	*this = CacheHitRate();
+}
+
+double CacheHitRate::Rate() const
+{
+	return _count ? (double)_windowHits / _count : 0.0;
+}
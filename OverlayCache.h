@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+// Everything the overlay image of a panel depends on. Two frames with the same signature
+// draw the same pixels, so the second one can reuse the image of the first.
+struct OverlaySignature
+{
+	double view[4][4] = {};
+	double projection[4][4] = {};
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint64_t sceneVersion = 0;	// bumped by every scene change the overlay applied
+	uint32_t settings = 0;		// the overlay settings that change the image
+
+	// Bitwise on the matrices, a camera that did not move gives the same values
+	bool operator==(const OverlaySignature& other) const;
+	inline bool operator!=(const OverlaySignature& other) const { return !(*this == other); }
+};
+
+
+// Validity of one cached overlay image, independent of where the image is kept
+class OverlayCache
+{
+public:
+	// Whether the cached image was drawn with this signature
+	inline bool Matches(const OverlaySignature& signature) const { return _valid && _signature == signature; }
+
+	// The image was just redrawn. It is only reused when `cacheable`, i.e. nothing that
+	// changes the next frames is still in flight (mesh uploads, deferred reads, ...).
+	void Update(const OverlaySignature& signature, bool cacheable);
+
+	inline void Invalidate() { _valid = false; }
+	inline bool Valid() const { return _valid; }
+
+protected:
+	OverlaySignature _signature;
+	bool _valid = false;
+};
+
+
+// Hits and misses of the last kWindow lookups
+class CacheHitRate
+{
+public:
+	static const size_t kWindow = 256;
+
+	void Add(bool hit);
+	void Reset();
+
+	// Fraction of hits in the window, 0 before the first lookup
+	double Rate() const;
+
+	inline uint64_t Hits() const { return _hits; }
+	inline uint64_t Lookups() const { return _lookups; }
+
+protected:
+	bool _window[kWindow] = {};
+	size_t _next = 0;
+	size_t _count = 0;
+	size_t _windowHits = 0;
+	uint64_t _hits = 0;
+	uint64_t _lookups = 0;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstring>
+
+
+// What the overlay draws for the visible surfaces. Meshes whose buffers are not uploaded
+// yet, and the other surface types, are drawn as bounds in every mode.
+enum OverlayMode
+{
+	kOverlayBounds,
+	kOverlayWireframe,
+	kOverlayShaded,
+	kOverlayModeCount
+};
+
+inline const char* OverlayModeName(OverlayMode mode)
+{
+	switch (mode)
+	{
+	case kOverlayBounds: return "bounds";
+	case kOverlayWireframe: return "wireframe";
+	case kOverlayShaded: return "shaded";
+	default: return "unknown";
+	}
+}
+
+inline bool ParseOverlayMode(const char* name, OverlayMode& mode)
+{
+	for (int m = 0; m < kOverlayModeCount; m++)
+	{
+		if (strcmp(name, OverlayModeName((OverlayMode)m)) == 0)
+		{
+			mode = (OverlayMode)m;
+			return true;
+		}
+	}
+	return false;
+}
+
+struct OverlaySettings
+{
+	OverlayMode mode = kOverlayBounds;
+
+	// Mesh data copied to the GPU per frame at most, the rest waits for the next frames
+	double uploadBudgetMB = 16.0;
+
+	// Skip the objects hidden behind the largest meshes (OcclusionBuffer.h)
+	bool occlusion = true;
+
+	// Draw the overlay at a lower resolution while the camera moves, to keep the frames
+	// under the budget (ResolutionController.h)
+	bool dynamicResolution = false;
+	double frameBudgetMs = 33.3;
+	double minResolutionScale = 0.25;
+
+	// Memory the plugin may hold before the caches that support it evict, none when 0
+	// (ResourceRegistry.h)
+	double gpuBudgetMB = 0.0;
+	double cpuBudgetMB = 0.0;
+
+	// Draw the memory use of the plugin in the HUD
+	bool memoryHud = false;
+};
@@ -0,0 +1,193 @@
+#include "PassGraph.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+uint32_t PassGraph::AddTarget(const PassTargetDesc& desc)
+{
+	TargetSlot target;
+	target.desc = desc;
+	_targets.push_back(target);
+	_compiled = false;
+	return (uint32_t)_targets.size() - 1;
+}
+
+uint32_t PassGraph::AddPass(const std::string& name, bool sideEffect)
+{
+	Pass pass;
+	pass.name = name;
+	pass.sideEffect = sideEffect;
+	_passes.push_back(pass);
+	_compiled = false;
+	return (uint32_t)_passes.size() - 1;
+}
+
+void PassGraph::Access(uint32_t pass, uint32_t target, PassAccess access)
+{
+	Use use;
+	use.target = target;
+	use.access = access;
+	_passes[pass].uses.push_back(use);
+	_compiled = false;
+}
+
+bool PassGraph::Compile()
+{
+	_order.clear();
+	_physical.clear();
+	_error.clear();
+	for (TargetSlot& target : _targets)
+	{
+		target.physical = kNone;
+		target.first = kNone;
+		target.last = kNone;
+	}
+
+	Cull();
+	for (uint32_t p = 0; p < (uint32_t)_passes.size(); p++)
+	{
+		if (!_passes[p].culled)
+			_order.push_back(p);
+	}
+
+	if (!Validate())
+		return false;
+	Alias();
+	_compiled = true;
+	return true;
+}
+
+void PassGraph::Cull()
+{
+	// Backwards from the passes with a visible effect: a pass is needed when it writes an
+	// imported target or a target a later needed pass uses
+	std::vector<bool> needed(_targets.size(), false);
+	for (size_t p = _passes.size(); p-- > 0;)
+	{
+		Pass& pass = _passes[p];
+		bool keep = pass.sideEffect;
+		for (const Use& use : pass.uses)
+		{
+			if (use.access != kAccessRead && (_targets[use.target].desc.imported || needed[use.target]))
+				keep = true;
+		}
+
+		pass.culled = !keep;
+		if (!keep)
+			continue;
+
+		// What the pass overwrites is not needed from earlier passes, unless it reads it too
+		for (const Use& use : pass.uses)
+		{
+			if (use.access == kAccessOverwrite)
+				needed[use.target] = false;
+		}
+		for (const Use& use : pass.uses)
+		{
+			if (use.access != kAccessOverwrite)
+				needed[use.target] = true;
+		}
+	}
+}
+
+bool PassGraph::Validate()
+{
+	std::vector<bool> written(_targets.size(), false);
+	for (uint32_t i = 0; i < (uint32_t)_order.size(); i++)
+	{
+		const Pass& pass = _passes[_order[i]];
+		for (const Use& use : pass.uses)
+		{
+			TargetSlot& target = _targets[use.target];
+			if (use.access != kAccessOverwrite && !target.desc.imported && !written[use.target])
+			{
+				_error = pass.name + " uses " + target.desc.name + " before any pass writes it";
+				return false;
+			}
+		}
+		for (const Use& use : pass.uses)
+		{
+			TargetSlot& target = _targets[use.target];
+			if (use.access != kAccessRead)
+				written[use.target] = true;
+			if (target.first == kNone)
+				target.first = i;
+			target.last = i;
+		}
+	}
+	return true;
+}
+
+void PassGraph::Alias()
+{
+	std::vector<uint32_t> used;
+	for (uint32_t t = 0; t < (uint32_t)_targets.size(); t++)
+	{
+		if (_targets[t].first != kNone)
+			used.push_back(t);
+	}
+	std::stable_sort(used.begin(), used.end(), [this](uint32_t a, uint32_t b)
+	{
+		return _targets[a].first < _targets[b].first;
+	});
+
+	// Greedy interval allocation: a transient target takes the physical target freed the
+	// latest before its first use, with the same format and size
+	std::vector<uint32_t> lastUse;
+	for (uint32_t t : used)
+	{
+		TargetSlot& target = _targets[t];
+		uint32_t best = kNone;
+		if (!target.desc.imported)
+		{
+			for (uint32_t p = 0; p < (uint32_t)_physical.size(); p++)
+			{
+				const PassTargetDesc& desc = _targets[_physical[p]].desc;
+				if (desc.imported || lastUse[p] >= target.first || desc.format != target.desc.format ||
+					desc.scale != target.desc.scale || desc.bytesPerPixel != target.desc.bytesPerPixel)
+					continue;
+				if (best == kNone || lastUse[p] > lastUse[best])
+					best = p;
+			}
+		}
+
+		if (best == kNone)
+		{
+			best = (uint32_t)_physical.size();
+			_physical.push_back(t);
+			lastUse.push_back(target.last);
+		}
+		else
+		{
+			lastUse[best] = target.last;
+		}
+		target.physical = best;
+	}
+}
+
+size_t PassGraph::TargetBytes(const PassTargetDesc& desc, uint32_t width, uint32_t height)
+{
+	size_t w = (size_t)std::ceil(width * (double)desc.scale);
+	size_t h = (size_t)std::ceil(height * (double)desc.scale);
+	return w * h * desc.bytesPerPixel;
+}
+
+size_t PassGraph::Bytes(uint32_t width, uint32_t height) const
+{
+	size_t bytes = 0;
+	for (uint32_t t : _physical)
+		bytes += TargetBytes(_targets[t].desc, width, height);
+	return bytes;
+}
+
+size_t PassGraph::UnaliasedBytes(uint32_t width, uint32_t height) const
+{
+	size_t bytes = 0;
+	for (const TargetSlot& target : _targets)
+	{
+		if (target.first != kNone)
+			bytes += TargetBytes(target.desc, width, height);
+	}
+	return bytes;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// A target of the graph. Transient targets only live during the frame, between the first
+// and the last pass using them, and share memory with other transient targets of the same
+// format and scale whose lifetimes do not overlap. Imported targets live outside the graph
+// (the output, anything kept between frames): they are never aliased and writing them is
+// a side effect that keeps the pass.
+struct PassTargetDesc
+{
+	std::string name;
+	uint32_t format = 0;		// opaque to the graph, only compared
+	uint32_t bytesPerPixel = 4;
+	float scale = 1.0f;			// of the output size
+	bool imported = false;
+};
+
+// How a pass accesses a target
+enum PassAccess : uint8_t
+{
+	kAccessRead,		// sampled or copied from
+	kAccessWrite,		// rendered into, over what earlier passes wrote
+	kAccessOverwrite,	// replaced whole (clear, full screen pass), earlier contents are dead
+};
+
+
+// Declarative render pass graph. Passes are declared in execution order with the targets
+// they access, Compile() then culls the passes whose output nothing uses and maps the
+// transient targets to as few physical targets as their lifetimes allow. The graph is
+// compiled once, when the passes are set up; the physical targets are allocated by the
+// owner, at the output size of each frame.
+class PassGraph
+{
+public:
+	static const uint32_t kNone = 0xffffffffu;
+
+	uint32_t AddTarget(const PassTargetDesc& desc);
+
+	// A pass with a side effect outside its targets (present, readback) is never culled
+	uint32_t AddPass(const std::string& name, bool sideEffect = false);
+	void Access(uint32_t pass, uint32_t target, PassAccess access);
+	inline void Read(uint32_t pass, uint32_t target) { Access(pass, target, kAccessRead); }
+	inline void Write(uint32_t pass, uint32_t target) { Access(pass, target, kAccessWrite); }
+	inline void Overwrite(uint32_t pass, uint32_t target) { Access(pass, target, kAccessOverwrite); }
+
+	// False when a kept pass reads or writes over a transient target no earlier pass
+	// wrote, see Error()
+	bool Compile();
+
+	inline bool Compiled() const { return _compiled; }
+	inline const std::string& Error() const { return _error; }
+
+	// Kept passes in execution order
+	inline const std::vector<uint32_t>& Order() const { return _order; }
+	inline bool Culled(uint32_t pass) const { return _passes[pass].culled; }
+	inline bool SideEffect(uint32_t pass) const { return _passes[pass].sideEffect; }
+
+	// Physical target of a target, kNone when no kept pass uses it
+	inline uint32_t Physical(uint32_t target) const { return _targets[target].physical; }
+	inline size_t PhysicalCount() const { return _physical.size(); }
+	// The first target mapped to the physical target, whose description it has
+	inline uint32_t PhysicalTarget(uint32_t physical) const { return _physical[physical]; }
+
+	// First and last position in Order() of a used target
+	inline uint32_t FirstUse(uint32_t target) const { return _targets[target].first; }
+	inline uint32_t LastUse(uint32_t target) const { return _targets[target].last; }
+
+	// Memory of the used targets at this output size, with and without the aliasing
+	size_t Bytes(uint32_t width, uint32_t height) const;
+	size_t UnaliasedBytes(uint32_t width, uint32_t height) const;
+
+	inline size_t PassCount() const { return _passes.size(); }
+	inline size_t TargetCount() const { return _targets.size(); }
+	inline const std::string& PassName(uint32_t pass) const { return _passes[pass].name; }
+	inline const PassTargetDesc& Target(uint32_t target) const { return _targets[target].desc; }
+
+	struct Use
+	{
+		uint32_t target;
+		PassAccess access;
+	};
+	inline const std::vector<Use>& Uses(uint32_t pass) const { return _passes[pass].uses; }
+
+	static size_t TargetBytes(const PassTargetDesc& desc, uint32_t width, uint32_t height);
+
+protected:
+	struct Pass
+	{
+		std::string name;
+		std::vector<Use> uses;
+		bool sideEffect = false;
+		bool culled = false;
+	};
+
+	struct TargetSlot
+	{
+		PassTargetDesc desc;
+		uint32_t physical = kNone;
+		uint32_t first = kNone;
+		uint32_t last = kNone;
+	};
+
+	void Cull();
+	bool Validate();
+	void Alias();
+
+	std::vector<Pass> _passes;
+	std::vector<TargetSlot> _targets;
+	std::vector<uint32_t> _order;
+	std::vector<uint32_t> _physical;
+	std::string _error;
+	bool _compiled = false;
+};
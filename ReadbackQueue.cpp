@@ -0,0 +1,133 @@
+#include "ReadbackQueue.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+ReadbackQueue::ReadbackQueue(ReadbackSource& source, ImageWriterPool& writers, uint32_t slotCount, uint32_t latency)
+	: _source(source), _writers(writers)
+{
+	// A latency of the whole ring would wait for the GPU on every frame
+	slotCount = std::max(slotCount, 1u);
+	_slots.resize(slotCount);
+	_latency = std::min(latency, slotCount - 1);
+}
+
+ReadbackQueue::~ReadbackQueue()
+{
+	// The writers may still read mapped slots
+	Flush();
+}
+
+uint32_t ReadbackQueue::InFlight() const
+{
+	uint32_t count = 0;
+	for (const Slot& slot : _slots)
+		count += slot.state != kSlotFree;
+	return count;
+}
+
+void ReadbackQueue::Retire()
+{
+	_results.clear();
+	_writers.Collect(_results);
+	for (const ImageWriteResult& result : _results)
+	{
+		_source.Unmap(result.slot);
+		_slots[result.slot].state = kSlotFree;
+		if (result.ok)
+			_stats.written++;
+		else
+			_stats.failed++;
+		_stats.bytes += result.bytes;
+	}
+}
+
+bool ReadbackQueue::MapOldest(bool wait)
+{
+	Slot& slot = _slots[_oldest];
+	if (slot.state != kSlotCopied)
+		return false;
+
+	ReadbackImage image;
+	if (_source.Map(_oldest, wait, image))
+	{
+		ImageWriteJob job;
+		job.slot = _oldest;
+		job.frame = slot.frame;
+		job.image = image;
+		job.path = slot.path;
+		_writers.Submit(job);
+		slot.state = kSlotWriting;
+	}
+	else if (wait)
+	{
+		// Not just late, the frame is lost
+		_stats.failed++;
+		slot.state = kSlotFree;
+	}
+	else
+	{
+		return false;
+	}
+
+	// Copies finish in order, the next one is the oldest now
+	_oldest = (_oldest + 1) % (uint32_t)_slots.size();
+	return true;
+}
+
+bool ReadbackQueue::Capture(int64_t frame, const std::string& path)
+{
+	Retire();
+
+	// The copies old enough that the GPU should be done with them
+	while (_slots[_oldest].state == kSlotCopied && _captures - _slots[_oldest].capture >= _latency && MapOldest(false))
+	{
+	}
+
+	// The ring is full, the slot of this frame is the oldest copy or still being written
+	Slot& slot = _slots[_next];
+	if (slot.state != kSlotFree)
+	{
+		auto start = std::chrono::steady_clock::now();
+		_stats.stalls++;
+		while (slot.state != kSlotFree)
+		{
+			if (slot.state == kSlotCopied)
+			{
+				MapOldest(true);
+			}
+			else
+			{
+				_writers.WaitAny();
+				Retire();
+			}
+		}
+		_stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	if (!_source.Copy(_next))
+	{
+		_stats.failed++;
+		return false;
+	}
+
+	slot.state = kSlotCopied;
+	slot.frame = frame;
+	slot.capture = _captures++;
+	slot.path = path;
+	_next = (_next + 1) % (uint32_t)_slots.size();
+
+	_stats.captured++;
+	_stats.maxInFlight = std::max(_stats.maxInFlight, InFlight());
+	return true;
+}
+
+void ReadbackQueue::Flush()
+{
+	while (MapOldest(true))
+	{
+	}
+	_writers.Wait();
+	Retire();
+}
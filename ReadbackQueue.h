@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ImageWriterPool.h"
+
+
+// GPU side of the readback: a ring of CPU readable copies of the frame. D3D11 implements it
+// with staging textures (DxReadback), a headless test with plain memory.
+class ReadbackSource
+{
+public:
+	virtual ~ReadbackSource() {}
+
+	// Queue a copy of the current frame into the slot
+	virtual bool Copy(uint32_t slot) = 0;
+
+	// Make the slot's pixels readable. Without wait, returns false when the GPU has not
+	// finished the copy yet. The pixels stay valid until Unmap().
+	virtual bool Map(uint32_t slot, bool wait, ReadbackImage& image) = 0;
+	virtual void Unmap(uint32_t slot) = 0;
+};
+
+
+// Pipelined readback of a frame sequence. Every frame is copied into the next slot of a
+// ring; a slot is mapped `latency` captures later or after, once the GPU is done with it, and
+// its pixels are handed as they are to the writer pool. The slot is unmapped and reused
+// when its image is written. All the calls are made from the render thread, the only one
+// talking to the source.
+// When the slot of the next frame is still in use the capture waits for it: first for the
+// GPU copy, then for the writers. This is the backpressure, counted in the stall figures.
+class ReadbackQueue
+{
+public:
+	struct Stats
+	{
+		uint64_t captured = 0;
+		uint64_t written = 0;
+		uint64_t failed = 0;		// copies, maps or writes
+		uint64_t stalls = 0;		// captures that waited for a slot
+		double stallMs = 0.0;
+		uint64_t bytes = 0;
+		uint32_t maxInFlight = 0;	// slots copied, mapped or being written
+	};
+
+	// Captures between a copy and its first map attempt, a map that finds the GPU not done
+	// is tried again on the next capture. At most slotCount - 1.
+	static const uint32_t kDefaultLatency = 2;
+
+	// The writers must not be shared with another queue
+	ReadbackQueue(ReadbackSource& source, ImageWriterPool& writers, uint32_t slotCount, uint32_t latency = kDefaultLatency);
+	~ReadbackQueue();
+
+	ReadbackQueue(const ReadbackQueue&) = delete;
+	ReadbackQueue& operator=(const ReadbackQueue&) = delete;
+
+	// The frame just rendered, written to `path` once read back
+	bool Capture(int64_t frame, const std::string& path);
+
+	// Reads back and writes every captured frame, then returns
+	void Flush();
+
+	inline const Stats& GetStats() const { return _stats; }
+	inline uint32_t SlotCount() const { return (uint32_t)_slots.size(); }
+	inline uint32_t Latency() const { return _latency; }
+
+protected:
+	enum SlotState
+	{
+		kSlotFree,
+		kSlotCopied,	// the GPU copy is queued
+		kSlotWriting,	// mapped, owned by the writers
+	};
+
+	struct Slot
+	{
+		SlotState state = kSlotFree;
+		int64_t frame = 0;
+		uint64_t capture = 0;
+		std::string path;
+	};
+
+	// Unmaps the slots whose image is written
+	void Retire();
+
+	// Maps the oldest copied slot and hands it to the writers. False when there is none,
+	// or without wait when the GPU is not done with it.
+	bool MapOldest(bool wait);
+
+	uint32_t InFlight() const;
+
+	ReadbackSource& _source;
+	ImageWriterPool& _writers;
+	std::vector<Slot> _slots;
+	std::vector<ImageWriteResult> _results;
+	uint32_t _latency;
+	uint32_t _next = 0;			// slot of the next capture
+	uint32_t _oldest = 0;		// oldest slot that may still be copied
+	uint64_t _captures = 0;
+	Stats _stats;
+};
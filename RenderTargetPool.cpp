@@ -0,0 +1,112 @@
+#include "RenderTargetPool.h"
+
+#include <maya/MViewport2Renderer.h>
+
+
+RenderTargetPool::~RenderTargetPool()
+{
+	Clear();
+}
+
+MHWRender::MRenderTarget* RenderTargetPool::Acquire(const MString& name, MHWRender::MRasterFormat format,
+	unsigned int width, unsigned int height, double now)
+{
+	MHWRender::MRenderer* theRenderer = MHWRender::MRenderer::theRenderer();
+	const MHWRender::MRenderTargetManager* targetManager = theRenderer ? theRenderer->getRenderTargetManager() : NULL;
+	if (!targetManager)
+		return nullptr;
+
+	Entry* entry = nullptr;
+	for (Entry& e : _entries)
+	{
+		if (e.name == name && e.format == format)
+		{
+			entry = &e;
+			break;
+		}
+	}
+	if (!entry)
+	{
+		_entries.push_back(Entry());
+		entry = &_entries.back();
+		entry->name = name;
+		entry->format = format;
+		entry->sizing = RenderTargetSizing(_settings);
+	}
+
+	if (!entry->sizing.Request(width, height, now) && entry->target)
+		return entry->target;
+
+	MHWRender::MRenderTargetDescription desc(name, entry->sizing.Width(), entry->sizing.Height(), 1, format, 0, false);
+	if (!entry->target)
+	{
+		entry->target = targetManager->acquireRenderTarget(desc);
+	}
+	else
+	{
+		entry->target->updateDescription(desc);
+	}
+
+	if (_registry && entry->target)
+		_registry->Set(entry->handle, kResourceRenderTargets, EntryBytes(*entry));
+	return entry->target;
+}
+
+void RenderTargetPool::Clear()
+{
+	MHWRender::MRenderer* theRenderer = MHWRender::MRenderer::theRenderer();
+	const MHWRender::MRenderTargetManager* targetManager = theRenderer ? theRenderer->getRenderTargetManager() : NULL;
+
+	for (Entry& e : _entries)
+	{
+		if (targetManager && e.target)
+			targetManager->releaseRenderTarget(e.target);
+		e.target = nullptr;
+		if (_registry)
+			_registry->Untrack(e.handle);
+	}
+	_entries.clear();
+}
+
+unsigned int RenderTargetPool::BytesPerPixel(MHWRender::MRasterFormat format)
+{
+	switch (format)
+	{
+	case MHWRender::kR8G8B8A8_UNORM:
+	case MHWRender::kB8G8R8A8:
+	case MHWRender::kD24S8:
+	case MHWRender::kD32_FLOAT:
+	case MHWRender::kR32_FLOAT:
+		return 4;
+	case MHWRender::kR16G16B16A16_FLOAT:
+		return 8;
+	case MHWRender::kR32G32B32A32_FLOAT:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+size_t RenderTargetPool::EntryBytes(const Entry& entry)
+{
+	return (size_t)entry.sizing.Width() * entry.sizing.Height() * BytesPerPixel(entry.format);
+}
+
+size_t RenderTargetPool::Bytes() const
+{
+	size_t bytes = 0;
+	for (const Entry& e : _entries)
+	{
+		if (e.target)
+			bytes += EntryBytes(e);
+	}
+	return bytes;
+}
+
+uint64_t RenderTargetPool::Reallocations() const
+{
+	uint64_t reallocations = 0;
+	for (const Entry& e : _entries)
+		reallocations += e.sizing.Reallocations();
+	return reallocations;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+
+#include <maya/MString.h>
+#include <maya/MRenderTargetManager.h>
+
+#include "RenderTargetSizing.h"
+#include "ResourceRegistry.h"
+
+
+// Render targets of the override. Each (name, format) is one shared target sized by a
+// RenderTargetSizing: panels render into its top-left viewport-sized sub-rect, so a resize
+// only reallocates when a bucket boundary is crossed, and shrinking waits for the panels
+// to settle. The targets are tracked as kResourceRenderTargets when there is a registry.
+class RenderTargetPool
+{
+public:
+	explicit RenderTargetPool(ResourceRegistry* registry = nullptr) : _registry(registry) {}
+	RenderTargetPool(ResourceRegistry* registry, const RenderTargetSizing::Settings& settings) : _registry(registry), _settings(settings) {}
+	~RenderTargetPool();
+
+	// Target of at least width x height for this frame, null if it could not be acquired.
+	// now is in seconds and drives the shrink delay.
+	MHWRender::MRenderTarget* Acquire(const MString& name, MHWRender::MRasterFormat format,
+		unsigned int width, unsigned int height, double now);
+
+	// Release every target
+	void Clear();
+
+	size_t Bytes() const;
+	uint64_t Reallocations() const;
+	inline size_t TargetCount() const { return _entries.size(); }
+
+protected:
+	struct Entry
+	{
+		MString name;
+		MHWRender::MRasterFormat format;
+		MHWRender::MRenderTarget* target = nullptr;
+		RenderTargetSizing sizing;
+		ResourceHandle handle = 0;
+	};
+
+	static unsigned int BytesPerPixel(MHWRender::MRasterFormat format);
+	static size_t EntryBytes(const Entry& entry);
+
+	ResourceRegistry* _registry = nullptr;
+	RenderTargetSizing::Settings _settings;
+	std::vector<Entry> _entries;
+};
@@ -0,0 +1,67 @@
+#include "RenderTargetSizing.h"
+
+#include <algorithm>
+
+
+unsigned RenderTargetSizing::RoundUp(unsigned size, unsigned bucket)
+{
+	if (bucket <= 1)
+		return std::max(size, 1u);
+	return std::max((size + bucket - 1) / bucket, 1u) * bucket;
+}
+
+bool RenderTargetSizing::Request(unsigned width, unsigned height, double now)
+{
+	unsigned bucketWidth = RoundUp(width, _settings.bucket);
+	unsigned bucketHeight = RoundUp(height, _settings.bucket);
+
+	// Grow right away, keeping the other axis if it is already larger
+	if (bucketWidth > _width || bucketHeight > _height)
+	{
+		_width = std::max(_width, bucketWidth);
+		_height = std::max(_height, bucketHeight);
+		_smallerSince = -1.0;
+		_reallocations++;
+		return true;
+	}
+
+	// Fits exactly, any pending shrink is cancelled
+	if (bucketWidth == _width && bucketHeight == _height)
+	{
+		_smallerSince = -1.0;
+		return false;
+	}
+
+	if (_smallerSince < 0.0)
+	{
+		_smallerSince = now;
+		_peakWidth = bucketWidth;
+		_peakHeight = bucketHeight;
+		return false;
+	}
+
+	_peakWidth = std::max(_peakWidth, bucketWidth);
+	_peakHeight = std::max(_peakHeight, bucketHeight);
+
+	if (now - _smallerSince < _settings.shrinkDelay)
+		return false;
+
+	// Different panels needed each axis at full size
+	_smallerSince = -1.0;
+	if (_peakWidth == _width && _peakHeight == _height)
+		return false;
+
+	_width = _peakWidth;
+	_height = _peakHeight;
+	_reallocations++;
+	return true;
+}
+
+void RenderTargetSizing::Reset()
+{
+	_width = 0;
+	_height = 0;
+	_smallerSince = -1.0;
+	_peakWidth = 0;
+	_peakHeight = 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+
+// Sizing policy of a pooled render target, independent of Maya so it can be exercised
+// offline. Sizes are rounded up to buckets and the target only grows while the viewport
+// changes; it shrinks back once every request of the last shrinkDelay seconds fits in a
+// smaller bucket. Panels of different sizes sharing a target keep it at the largest size.
+class RenderTargetSizing
+{
+public:
+	struct Settings
+	{
+		unsigned bucket = 128;		// pixels
+		double shrinkDelay = 2.0;	// seconds
+	};
+
+	RenderTargetSizing() {}
+	explicit RenderTargetSizing(const Settings& settings) : _settings(settings) {}
+
+	static unsigned RoundUp(unsigned size, unsigned bucket);
+
+	// Viewport size requested this frame at time `now` (seconds, any origin). Returns true
+	// when the target has to be (re)allocated at Width() x Height().
+	bool Request(unsigned width, unsigned height, double now);
+
+	void Reset();
+
+	inline unsigned Width() const { return _width; }
+	inline unsigned Height() const { return _height; }
+	inline const Settings& GetSettings() const { return _settings; }
+	inline uint64_t Reallocations() const { return _reallocations; }
+
+protected:
+	Settings _settings;
+	unsigned _width = 0;
+	unsigned _height = 0;
+
+	// Since when all the requests fit a smaller size, and the largest of them
+	double _smallerSince = -1.0;
+	unsigned _peakWidth = 0;
+	unsigned _peakHeight = 0;
+
+	uint64_t _reallocations = 0;
+};
@@ -0,0 +1,60 @@
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+double ResolutionController::Quantize(double scale) const
+{
+	if (_settings.step <= 0.0)
+		return scale;
+	double steps = std::floor(scale / _settings.step + 0.5);
+	return std::max(_settings.minScale, std::min(1.0, steps * _settings.step));
+}
+
+double ResolutionController::Update(double frameMs, bool moving, double now)
+{
+	double scale = _scale;
+	bool wasIdle = _lastMove < 0.0 || now - _lastMove >= _settings.idleDelay;
+	if (moving)
+		_lastMove = now;
+
+	if (_lastMove < 0.0 || now - _lastMove >= _settings.idleDelay)
+	{
+		// Settled, full resolution
+		_target = 1.0;
+		scale = 1.0;
+	}
+	else if (wasIdle)
+	{
+		// The first frame of a move comes after an idle gap, its time says nothing
+	}
+	else if (frameMs > 0.0 && _settings.budgetMs > 0.0)
+	{
+		double ideal = _target * std::sqrt(_settings.budgetMs / frameMs);
+		if (ideal < _target)
+			_target += _settings.downGain * (ideal - _target);
+		else if (frameMs < _settings.headroom * _settings.budgetMs)
+			_target += _settings.upGain * (ideal - _target);
+		_target = std::max(_settings.minScale, std::min(1.0, _target));
+
+		// Hysteresis: a new step only once the loop is past half of the next one
+		double quantized = Quantize(_target);
+		if (std::fabs(_target - _scale) > 0.75 * _settings.step || quantized == _settings.minScale || quantized == 1.0)
+			scale = quantized;
+	}
+
+	if (scale != _scale)
+	{
+		_scale = scale;
+		_changes++;
+	}
+	return _scale;
+}
+
+void ResolutionController::Reset()
+{
+	_target = 1.0;
+	_scale = 1.0;
+	_lastMove = -1.0;
+}
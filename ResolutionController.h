@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+
+
+// Resolution of the overlay while the camera moves, independent of Maya so it can be
+// exercised offline. A feedback loop on the measured frame time: the overlay cost grows
+// with its pixel count, so the scale moves towards scale * sqrt(budget / frame time).
+// It drops faster than it rises, is quantized to steps so the target is not resized every
+// frame, and snaps back to full resolution once the camera stopped for idleDelay seconds.
+class ResolutionController
+{
+public:
+	struct Settings
+	{
+		double budgetMs = 33.3;		// frame time to stay under while moving
+		double minScale = 0.25;
+		double step = 0.125;		// the scale is a multiple of it (or 1)
+		double downGain = 0.6;		// fraction of the correction applied per frame
+		double upGain = 0.2;
+		double headroom = 0.9;		// only rise while under this fraction of the budget
+		double idleDelay = 0.25;	// seconds
+	};
+
+	ResolutionController() {}
+	explicit ResolutionController(const Settings& settings) : _settings(settings) {}
+
+	// One frame at time `now` (seconds, any origin): the time the last frame took and
+	// whether the camera moved since it. Returns the scale to draw this frame with.
+	double Update(double frameMs, bool moving, double now);
+
+	void Reset();
+
+	inline double Scale() const { return _scale; }
+	inline void SetSettings(const Settings& settings) { _settings = settings; }
+	inline const Settings& GetSettings() const { return _settings; }
+	inline uint64_t Changes() const { return _changes; }
+
+protected:
+	double Quantize(double scale) const;
+
+	Settings _settings;
+	double _target = 1.0;		// unquantized output of the loop
+	double _scale = 1.0;
+	double _lastMove = -1.0;
+	uint64_t _changes = 0;
+};
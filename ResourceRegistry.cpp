@@ -0,0 +1,268 @@
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+const char* ResourceCategoryName(ResourceCategory category)
+{
+	switch (category)
+	{
+	case kResourceRenderTargets: return "renderTargets";
+	case kResourceOverlayLayers: return "overlayLayers";
+	case kResourceMeshes: return "meshes";
+	case kResourceBuffers: return "buffers";
+	case kResourceStaging: return "staging";
+	case kResourceShaders: return "shaders";
+	case kResourceSceneItems: return "sceneItems";
+	case kResourceMeshData: return "meshData";
+	case kResourceFrameArena: return "frameArena";
+	default: return "unknown";
+	}
+}
+
+ResourceMemory ResourceCategoryMemory(ResourceCategory category)
+{
+	switch (category)
+	{
+	case kResourceSceneItems:
+	case kResourceMeshData:
+	case kResourceFrameArena:
+		return kMemoryCpu;
+	default:
+		return kMemoryGpu;
+	}
+}
+
+const char* ResourceMemoryName(ResourceMemory memory)
+{
+	return memory == kMemoryGpu ? "gpu" : "cpu";
+}
+
+
+ResourceRegistry::ResourceRegistry()
+{
+}
+
+void ResourceRegistry::Add(ResourceCategory category, size_t bytes)
+{
+	ResourceUsage& usage = _usage[category];
+	usage.bytes += bytes;
+	usage.peakBytes = std::max(usage.peakBytes, usage.bytes);
+	usage.frame.allocations++;
+	usage.frame.allocatedBytes += bytes;
+
+	ResourceMemory memory = ResourceCategoryMemory(category);
+	_bytes[memory] += bytes;
+	_peak[memory] = std::max(_peak[memory], _bytes[memory]);
+}
+
+void ResourceRegistry::Remove(ResourceCategory category, size_t bytes)
+{
+	ResourceUsage& usage = _usage[category];
+	usage.bytes -= bytes;
+	usage.frame.frees++;
+	usage.frame.freedBytes += bytes;
+	_bytes[ResourceCategoryMemory(category)] -= bytes;
+}
+
+ResourceHandle ResourceRegistry::Track(ResourceCategory category, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	ResourceHandle handle;
+	if (_free.empty())
+	{
+		_entries.push_back(Entry());
+		handle = (ResourceHandle)_entries.size();
+	}
+	else
+	{
+		handle = _free.back();
+		_free.pop_back();
+	}
+
+	Entry& entry = _entries[handle - 1];
+	entry.bytes = bytes;
+	entry.category = category;
+	_usage[category].count++;
+	Add(category, bytes);
+	return handle;
+}
+
+size_t ResourceRegistry::Untrack(ResourceHandle& handle)
+{
+	if (handle == 0)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	Entry& entry = _entries[handle - 1];
+	size_t bytes = entry.bytes;
+	_usage[entry.category].count--;
+	Remove(entry.category, bytes);
+
+	entry.bytes = 0;
+	entry.category = kResourceCategoryCount;
+	_free.push_back(handle);
+	handle = 0;
+	return bytes;
+}
+
+void ResourceRegistry::Set(ResourceHandle& handle, ResourceCategory category, size_t bytes)
+{
+	if (handle == 0)
+	{
+		handle = Track(category, bytes);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	Entry& entry = _entries[handle - 1];
+	if (entry.bytes == bytes && entry.category == category)
+		return;
+
+	// A container that grows copies itself into a new allocation
+	Remove(entry.category, entry.bytes);
+	_usage[entry.category].count--;
+	entry.bytes = bytes;
+	entry.category = category;
+	_usage[category].count++;
+	Add(category, bytes);
+}
+
+ResourceUsage ResourceRegistry::Usage(ResourceCategory category) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _usage[category];
+}
+
+size_t ResourceRegistry::Bytes(ResourceMemory memory) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _bytes[memory];
+}
+
+size_t ResourceRegistry::PeakBytes(ResourceMemory memory) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _peak[memory];
+}
+
+ResourceChurn ResourceRegistry::LastFrame(ResourceMemory memory) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	ResourceChurn churn;
+	for (int c = 0; c < kResourceCategoryCount; c++)
+	{
+		if (ResourceCategoryMemory((ResourceCategory)c) != memory)
+			continue;
+		const ResourceChurn& last = _usage[c].lastFrame;
+		churn.allocations += last.allocations;
+		churn.frees += last.frees;
+		churn.allocatedBytes += last.allocatedBytes;
+		churn.freedBytes += last.freedBytes;
+	}
+	return churn;
+}
+
+void ResourceRegistry::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (ResourceUsage& usage : _usage)
+	{
+		usage.lastFrame = usage.frame;
+		usage.frame = ResourceChurn();
+	}
+}
+
+void ResourceRegistry::ResetPeaks()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (ResourceUsage& usage : _usage)
+		usage.peakBytes = usage.bytes;
+	for (int m = 0; m < kMemoryCount; m++)
+		_peak[m] = _bytes[m];
+}
+
+void ResourceRegistry::SetBudget(ResourceMemory memory, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_budget[memory] = bytes;
+}
+
+size_t ResourceRegistry::Budget(ResourceMemory memory) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _budget[memory];
+}
+
+void ResourceRegistry::AddEvictor(ResourceMemory memory, ResourceEvictor* evictor)
+{
+	_evictors[memory].push_back(evictor);
+}
+
+void ResourceRegistry::RemoveEvictor(ResourceEvictor* evictor)
+{
+	for (std::vector<ResourceEvictor*>& evictors : _evictors)
+		evictors.erase(std::remove(evictors.begin(), evictors.end(), evictor), evictors.end());
+}
+
+size_t ResourceRegistry::EnforceBudget()
+{
+	// The evictors untrack what they release, the lock is only held to read the totals
+	size_t freed = 0;
+	for (int m = 0; m < kMemoryCount; m++)
+	{
+		ResourceMemory memory = (ResourceMemory)m;
+		size_t budget = Budget(memory);
+		if (budget == 0)
+			continue;
+
+		size_t before = Bytes(memory);
+		for (ResourceEvictor* evictor : _evictors[m])
+		{
+			size_t bytes = Bytes(memory);
+			if (bytes <= budget)
+				break;
+			evictor->Evict(memory, bytes - budget);
+		}
+
+		size_t after = Bytes(memory);
+		if (after < before)
+		{
+			_evicted[m] += before - after;
+			freed += before - after;
+		}
+	}
+	return freed;
+}
+
+std::string ResourceRegistry::Summary() const
+{
+	const double kMB = 1024.0 * 1024.0;
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	std::string summary;
+	char part[128];
+	for (int m = 0; m < kMemoryCount; m++)
+	{
+		if (_budget[m])
+			snprintf(part, sizeof(part), "%s%s %.1f/%.0f MB (peak %.1f)", m ? "  " : "", m == kMemoryGpu ? "GPU" : "CPU",
+				_bytes[m] / kMB, _budget[m] / kMB, _peak[m] / kMB);
+		else
+			snprintf(part, sizeof(part), "%s%s %.1f MB (peak %.1f)", m ? "  " : "", m == kMemoryGpu ? "GPU" : "CPU",
+				_bytes[m] / kMB, _peak[m] / kMB);
+		summary += part;
+	}
+
+	uint32_t allocations = 0;
+	uint32_t frees = 0;
+	for (const ResourceUsage& usage : _usage)
+	{
+		allocations += usage.lastFrame.allocations;
+		frees += usage.lastFrame.frees;
+	}
+	snprintf(part, sizeof(part), "  churn +%u/-%u", allocations, frees);
+	summary += part;
+	return summary;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+enum ResourceMemory : uint8_t
+{
+	kMemoryGpu,
+	kMemoryCpu,
+	kMemoryCount
+};
+
+// What a tracked allocation is for, each category is in one memory
+enum ResourceCategory : uint8_t
+{
+	kResourceRenderTargets,		// the pass graph's targets, from the pool
+	kResourceOverlayLayers,		// the panels' layers and the tile target
+	kResourceMeshes,			// MeshCache GPU copies and their levels
+	kResourceBuffers,			// the cube, instance and constant rings
+	kResourceStaging,			// upload ring, readback textures
+	kResourceShaders,			// bytecode size, the driver's copy is about the same
+	kResourceSceneItems,		// DrawItemStore arrays
+	kResourceMeshData,			// MeshCache CPU copies and their levels
+	kResourceFrameArena,
+	kResourceCategoryCount
+};
+
+const char* ResourceCategoryName(ResourceCategory category);
+ResourceMemory ResourceCategoryMemory(ResourceCategory category);
+const char* ResourceMemoryName(ResourceMemory memory);
+
+// 0 is no allocation
+typedef uint32_t ResourceHandle;
+
+// Allocations and frees of one frame
+struct ResourceChurn
+{
+	uint32_t allocations = 0;
+	uint32_t frees = 0;
+	size_t allocatedBytes = 0;
+	size_t freedBytes = 0;
+};
+
+struct ResourceUsage
+{
+	size_t bytes = 0;
+	size_t peakBytes = 0;
+	size_t count = 0;
+	ResourceChurn lastFrame;	// the last frame ended
+	ResourceChurn frame;		// the frame in progress
+};
+
+
+// A cache that can give memory back when its memory is over budget
+class ResourceEvictor
+{
+public:
+	virtual ~ResourceEvictor() {}
+
+	// Free about `bytes` of tracked memory of that kind, least recently used first and
+	// nothing the current frames draw. Returns the bytes untracked.
+	virtual size_t Evict(ResourceMemory memory, size_t bytes) = 0;
+};
+
+
+// Every GPU and CPU allocation the plugin holds, by category: the owners track each
+// resource when they create it and untrack it when they release it (DxResources.h for
+// the D3D objects). The CPU containers that grow and shrink are gauges, set once per
+// frame with Set(). Usage, peaks and the churn of the last frame are reported by
+// garlandMemory and the HUD.
+// Over a budget, EnforceBudget() asks the evictors of that memory in their order.
+// Any thread may track, the shaders are created on the pipeline thread. Evictors are
+// only added, removed and run by the render thread.
+class ResourceRegistry
+{
+public:
+	ResourceRegistry();
+
+	ResourceRegistry(const ResourceRegistry&) = delete;
+	ResourceRegistry& operator=(const ResourceRegistry&) = delete;
+
+	ResourceHandle Track(ResourceCategory category, size_t bytes);
+
+	// Clears the handle, returns its bytes
+	size_t Untrack(ResourceHandle& handle);
+
+	// Tracks the handle at this size, a change of size counts as a free and an allocation
+	void Set(ResourceHandle& handle, ResourceCategory category, size_t bytes);
+
+	ResourceUsage Usage(ResourceCategory category) const;
+	size_t Bytes(ResourceMemory memory) const;
+	size_t PeakBytes(ResourceMemory memory) const;
+	ResourceChurn LastFrame(ResourceMemory memory) const;
+
+	// Starts the churn of the next frame
+	void EndFrame();
+	void ResetPeaks();
+
+	// No budget when 0
+	void SetBudget(ResourceMemory memory, size_t bytes);
+	size_t Budget(ResourceMemory memory) const;
+
+	void AddEvictor(ResourceMemory memory, ResourceEvictor* evictor);
+	void RemoveEvictor(ResourceEvictor* evictor);
+
+	// Evicts until each memory is within its budget or the evictors have nothing left,
+	// returns the bytes freed
+	size_t EnforceBudget();
+	inline uint64_t EvictedBytes(ResourceMemory memory) const { return _evicted[memory]; }
+
+	// GPU and CPU in use, peak and budget in MB, on one line
+	std::string Summary() const;
+
+protected:
+	struct Entry
+	{
+		size_t bytes = 0;
+		ResourceCategory category = kResourceCategoryCount;
+	};
+
+	void Add(ResourceCategory category, size_t bytes);
+	void Remove(ResourceCategory category, size_t bytes);
+
+	mutable std::mutex _mutex;
+	std::vector<Entry> _entries;		// handle - 1
+	std::vector<ResourceHandle> _free;
+	ResourceUsage _usage[kResourceCategoryCount];
+	size_t _bytes[kMemoryCount] = {};
+	size_t _peak[kMemoryCount] = {};
+	size_t _budget[kMemoryCount] = {};
+
+	std::vector<ResourceEvictor*> _evictors[kMemoryCount];
+	uint64_t _evicted[kMemoryCount] = {};
+};
@@ -0,0 +1,96 @@
+#include "RingAllocator.h"
+
+
+static inline size_t AlignUp(size_t value, size_t alignment)
+{
+	return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+}
+
+void RingAllocator::Reset(size_t capacity)
+{
+	_capacity = capacity;
+	_head = 0;
+	_tail = 0;
+	_used = 0;
+	_frameBytes = 0;
+	_frames.clear();
+}
+
+size_t RingAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0 || size > _capacity)
+		return kInvalidOffset;
+
+	size_t offset = kInvalidOffset;
+	size_t bytes = 0;
+	size_t aligned = AlignUp(_head, alignment);
+
+	if (_head == _tail && _used > 0)
+	{
+		// Full
+		return kInvalidOffset;
+	}
+	else if (_head >= _tail)
+	{
+		// Free space is [head, capacity) followed by [0, tail)
+		if (aligned + size <= _capacity)
+		{
+			offset = aligned;
+			bytes = aligned + size - _head;
+		}
+		else if (size <= _tail)
+		{
+			// Wrap, the end of the ring is wasted until this frame retires
+			offset = 0;
+			bytes = (_capacity - _head) + size;
+		}
+	}
+	else
+	{
+		// Free space is [head, tail)
+		if (aligned + size <= _tail)
+		{
+			offset = aligned;
+			bytes = aligned + size - _head;
+		}
+	}
+
+	if (offset == kInvalidOffset)
+		return kInvalidOffset;
+
+	_head = offset + size;
+	_used += bytes;
+	_frameBytes += bytes;
+	return offset;
+}
+
+void RingAllocator::EndFrame(uint64_t frame)
+{
+	FrameRecord record;
+	record.frame = frame;
+	record.head = _head;
+	record.bytes = _frameBytes;
+	_frames.push_back(record);
+
+	_frameBytes = 0;
+}
+
+void RingAllocator::Retire(uint64_t completedFrame)
+{
+	while (!_frames.empty() && _frames.front().frame <= completedFrame)
+	{
+		_tail = _frames.front().head;
+		_used -= _frames.front().bytes;
+		_frames.pop_front();
+	}
+
+	if (_used == 0)
+	{
+		// Nothing is in use, start again at the beginning of the ring. Frames still in
+		// the queue did not allocate anything, move them along.
+		_head = 0;
+		_tail = 0;
+		for (FrameRecord& record : _frames)
+			record.head = 0;
+	}
+}
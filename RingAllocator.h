@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+
+// Bookkeeping of a per-frame linear allocator over a ring of `capacity` bytes. It only
+// hands out offsets, the memory itself is e.g. a dynamic D3D buffer (see DxRingBuffer).
+// Allocations made before EndFrame(frame) stay in use until Retire() is told that the
+// GPU finished that frame, so they can be written with MAP_WRITE_NO_OVERWRITE.
+class RingAllocator
+{
+public:
+	static const size_t kInvalidOffset = (size_t)-1;
+
+	RingAllocator(size_t capacity = 0) { Reset(capacity); }
+
+	// Forget every allocation, e.g. after the buffer was discarded or recreated
+	void Reset(size_t capacity);
+
+	// Returns the offset of `size` bytes aligned to `alignment` (a power of two), or
+	// kInvalidOffset when the free part of the ring is too small.
+	size_t Allocate(size_t size, size_t alignment);
+
+	// Everything allocated since the previous EndFrame() belongs to `frame`
+	void EndFrame(uint64_t frame);
+
+	// The GPU is done with every frame up to and including `completedFrame`
+	void Retire(uint64_t completedFrame);
+
+	inline size_t Capacity() const { return _capacity; }
+	inline size_t Used() const { return _used; }
+	inline size_t FramesInFlight() const { return _frames.size(); }
+
+protected:
+	struct FrameRecord
+	{
+		uint64_t frame;
+		size_t head;	// end of the frame's last allocation
+		size_t bytes;	// bytes used by the frame, including padding and the wasted end of the ring
+	};
+
+	size_t _capacity = 0;
+	size_t _head = 0;	// next free byte
+	size_t _tail = 0;	// first byte still in use
+	size_t _used = 0;
+	size_t _frameBytes = 0;
+	std::deque<FrameRecord> _frames;
+};
@@ -0,0 +1,442 @@
+#include "SceneBounds.h"
+
+#include <maya/MBoundingBox.h>
+#include <maya/MDGMessage.h>
+#include <maya/MFnDagNode.h>
+#include <maya/MGlobal.h>
+#include <maya/MItDag.h>
+#include <maya/MMatrix.h>
+#include <maya/MMessage.h>
+#include <maya/MModelMessage.h>
+#include <maya/MNodeMessage.h>
+#include <maya/MObjectHandle.h>
+#include <maya/MSelectionList.h>
+
+
+// One tracked DAG instance, it is also the client data of its callbacks
+struct SceneBounds::Tracked
+{
+	SceneBounds* owner;
+	BoundsKey key;
+	MDagPath path;
+	MObjectHandle node;		// the shape, the key only has its hash
+	MCallbackIdArray callbacks;
+	std::vector<uint64_t> ancestors;
+};
+
+// A transform above tracked instances. Its single dirty callback stands for all of them,
+// the render thread fans the record out when draining.
+struct SceneBounds::Ancestor
+{
+	SceneBounds* owner;
+	uint64_t id;			// ids are not reused, a record of a released ancestor is ignored
+	uint32_t hash;
+	MObjectHandle node;
+	MCallbackId callback = 0;
+	std::unordered_set<BoundsKey> instances;
+};
+
+
+SceneBounds::SceneBounds()
+{
+	MStatus status;
+	MCallbackId id = MDGMessage::addNodeAddedCallback(NodeAddedCB, "dagNode", this, &status);
+	if (status == MStatus::kSuccess)
+		_globalCallbacks.append(id);
+
+	id = MDGMessage::addNodeRemovedCallback(NodeRemovedCB, "dagNode", this, &status);
+	if (status == MStatus::kSuccess)
+		_globalCallbacks.append(id);
+
+	// Reparenting and instancing changes the paths, simply rescan the DAG
+	id = MDagMessage::addAllDagChangesCallback(DagChangedCB, this, &status);
+	if (status == MStatus::kSuccess)
+		_globalCallbacks.append(id);
+
+	id = MModelMessage::addCallback(MModelMessage::kActiveListModified, ActiveListModifiedCB, this, &status);
+	if (status == MStatus::kSuccess)
+		_globalCallbacks.append(id);
+}
+
+SceneBounds::~SceneBounds()
+{
+	for (auto& it : _tracked)
+	{
+		MMessage::removeCallbacks(it.second->callbacks);
+	}
+	_tracked.clear();
+
+	for (auto& it : _ancestors)
+	{
+		MMessage::removeCallback(it.second->callback);
+	}
+	_ancestors.clear();
+	_ancestorIds.clear();
+
+	MMessage::removeCallbacks(_globalCallbacks);
+	_globalCallbacks.clear();
+}
+
+BoundsKey SceneBounds::KeyFromPath(const MDagPath& path)
+{
+	MObjectHandle handle(path.node());
+	return MakeBoundsKey(handle.hashCode(), path.instanceNumber());
+}
+
+bool SceneBounds::IsSurface(const MDagPath& path)
+{
+	return path.hasFn(MFn::kMesh) ||
+		path.hasFn(MFn::kNurbsSurface) ||
+		path.hasFn(MFn::kSubdiv);
+}
+
+size_t SceneBounds::DrainChanges()
+{
+	size_t events = _changes.Drain(_batch);
+
+	// Records were lost, anything may have changed. The bounds are all fetched again, the
+	// per-shape caches are told through TakeLostShapes() and check what they hold.
+	if (_batch.overflowed)
+	{
+		_rescan = true;
+		_activeDirty = true;
+		_shapesLost = true;
+		_cache.InvalidateAll();
+	}
+
+	for (uint32_t node : _batch.removedNodes)
+		UntrackNode(node);
+	for (BoundsKey key : _batch.dirty)
+		_cache.OnChanged(key);
+	for (uint64_t id : _batch.dirtyAncestors)
+	{
+		auto it = _ancestors.find(id);
+		if (it == _ancestors.end())
+			continue;
+		for (BoundsKey key : it->second->instances)
+			_cache.OnChanged(key);
+	}
+	_dirtyShapes.insert(_batch.dirtyShapes.begin(), _batch.dirtyShapes.end());
+
+	// New nodes are usually not parented yet, the rescan finds them once they are
+	if (_batch.nodesAdded || _batch.dagChanged)
+		_rescan = true;
+	if (_batch.activeChanged)
+		_activeDirty = true;
+	return events;
+}
+
+size_t SceneBounds::Update()
+{
+	if (_rescan)
+	{
+		Rescan();
+		_rescan = false;
+	}
+
+	if (_activeDirty)
+	{
+		UpdateActive();
+		_activeDirty = false;
+	}
+
+	return _cache.Update(*this);
+}
+
+void SceneBounds::Rescan()
+{
+	std::unordered_set<BoundsKey> seen;
+
+	MItDag it(MItDag::kDepthFirst, MFn::kShape);
+	for (; !it.isDone(); it.next())
+	{
+		MDagPath path;
+		if (it.getPath(path) != MStatus::kSuccess || !IsSurface(path))
+			continue;
+
+		BoundsKey key = KeyFromPath(path);
+		seen.insert(key);
+
+		// Reparenting keeps the key but changes the path, track again and refetch
+		auto tracked = _tracked.find(key);
+		if (tracked == _tracked.end() || !(tracked->second->path == path))
+		{
+			Track(key, path);
+			_cache.OnAdded(key);
+		}
+	}
+
+	std::vector<BoundsKey> removed;
+	for (auto& tracked : _tracked)
+	{
+		if (!seen.count(tracked.first))
+			removed.push_back(tracked.first);
+	}
+	for (BoundsKey key : removed)
+	{
+		Release(*_tracked[key]);
+		_tracked.erase(key);
+		_cache.OnRemoved(key);
+	}
+}
+
+void SceneBounds::UpdateActive()
+{
+	_active.clear();
+
+	MSelectionList list;
+	MGlobal::getActiveSelectionList(list);
+
+	for (unsigned int i = 0; i < list.length(); i++)
+	{
+		MDagPath path;
+		if (list.getDagPath(i, path) != MStatus::kSuccess)
+			continue;
+
+		// Selecting a transform makes all the surfaces below it active
+		MItDag it(MItDag::kDepthFirst, MFn::kShape);
+		it.reset(path, MItDag::kDepthFirst, MFn::kShape);
+		for (; !it.isDone(); it.next())
+		{
+			MDagPath shapePath;
+			if (it.getPath(shapePath) == MStatus::kSuccess)
+				_active.insert(KeyFromPath(shapePath));
+		}
+	}
+}
+
+bool SceneBounds::FetchBounds(BoundsKey key, BoundsEntry& entry)
+{
+	auto it = _tracked.find(key);
+	if (it == _tracked.end())
+		return false;
+
+	const MDagPath& path = it->second->path;
+
+	bool valid = path.isValid();
+	if (valid)
+	{
+		if (path.hasFn(MFn::kMesh))
+			entry.type = kShapeMesh;
+		else if (path.hasFn(MFn::kNurbsSurface))
+			entry.type = kShapeNurbsSurface;
+		else if (path.hasFn(MFn::kSubdiv))
+			entry.type = kShapeSubdiv;
+		else
+			valid = false;
+	}
+
+	if (!valid)
+	{
+		// The cache drops the entry itself when the fetch fails
+		Release(*it->second);
+		_tracked.erase(it);
+		return false;
+	}
+
+	MFnDagNode dagNode(path);
+	MBoundingBox box = dagNode.boundingBox();
+	MPoint minPt = box.min();
+	MPoint maxPt = box.max();
+
+	entry.minPt[0] = (float)minPt.x;
+	entry.minPt[1] = (float)minPt.y;
+	entry.minPt[2] = (float)minPt.z;
+	entry.maxPt[0] = (float)maxPt.x;
+	entry.maxPt[1] = (float)maxPt.y;
+	entry.maxPt[2] = (float)maxPt.z;
+
+	MMatrix matrix = path.inclusiveMatrix();
+	matrix.get(entry.world);
+
+	entry.flags = 0;
+	if (path.isVisible() && !dagNode.isIntermediateObject())
+		entry.flags |= kBoundsVisible;
+	if (path.isTemplated())
+		entry.flags |= kBoundsTemplated;
+
+	return true;
+}
+
+bool SceneBounds::PathOf(BoundsKey key, MDagPath& path) const
+{
+	auto it = _tracked.find(key);
+	if (it == _tracked.end())
+		return false;
+	path = it->second->path;
+	return true;
+}
+
+void SceneBounds::TakeDirtyShapes(std::vector<uint32_t>& nodes)
+{
+	nodes.assign(_dirtyShapes.begin(), _dirtyShapes.end());
+	_dirtyShapes.clear();
+}
+
+void SceneBounds::Track(BoundsKey key, const MDagPath& path)
+{
+	// Taken off its old ancestors first, the new path may share some of them
+	auto it = _tracked.find(key);
+	if (it != _tracked.end())
+		Release(*it->second);
+
+	std::unique_ptr<Tracked> tracked(new Tracked);
+	tracked->owner = this;
+	tracked->key = key;
+	tracked->path = path;
+	tracked->node = MObjectHandle(path.node());
+
+	MStatus status;
+	MDagPath target = path;
+	MCallbackId id = MDagMessage::addWorldMatrixModifiedCallback(target, WorldMatrixModifiedCB, tracked.get(), &status);
+	if (status == MStatus::kSuccess)
+		tracked->callbacks.append(id);
+
+	// Any dirty plug on the shape may change its bounds
+	MObject node = path.node();
+	id = MNodeMessage::addNodeDirtyCallback(node, NodeDirtyCB, tracked.get(), &status);
+	if (status == MStatus::kSuccess)
+		tracked->callbacks.append(id);
+
+	// Visibility and template state are inherited: hiding or templating any ancestor, or
+	// a display layer's drawOverride connected to one, dirties that ancestor
+	MDagPath ancestorPath = path;
+	while (ancestorPath.pop() == MStatus::kSuccess && ancestorPath.length() > 0)
+		Attach(*tracked, ancestorPath.node());
+
+	_tracked[key] = std::move(tracked);
+}
+
+void SceneBounds::Attach(Tracked& tracked, const MObject& node)
+{
+	MObjectHandle handle(node);
+	uint32_t hash = handle.hashCode();
+
+	Ancestor* ancestor = nullptr;
+	auto range = _ancestorIds.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		Ancestor* candidate = _ancestors[it->second].get();
+		if (candidate->node.isValid() && candidate->node == handle)
+		{
+			ancestor = candidate;
+			break;
+		}
+	}
+
+	if (!ancestor)
+	{
+		std::unique_ptr<Ancestor> created(new Ancestor);
+		created->owner = this;
+		created->id = _nextAncestorId++;
+		created->hash = hash;
+		created->node = handle;
+
+		MStatus status;
+		MObject target = node;
+		created->callback = MNodeMessage::addNodeDirtyCallback(target, AncestorDirtyCB, created.get(), &status);
+		if (status != MStatus::kSuccess)
+			return;
+
+		ancestor = created.get();
+		_ancestorIds.emplace(hash, ancestor->id);
+		_ancestors[ancestor->id] = std::move(created);
+	}
+
+	ancestor->instances.insert(tracked.key);
+	tracked.ancestors.push_back(ancestor->id);
+}
+
+void SceneBounds::Release(Tracked& tracked)
+{
+	MMessage::removeCallbacks(tracked.callbacks);
+	tracked.callbacks.clear();
+
+	for (uint64_t id : tracked.ancestors)
+	{
+		auto it = _ancestors.find(id);
+		if (it == _ancestors.end())
+			continue;
+
+		Ancestor& ancestor = *it->second;
+		ancestor.instances.erase(tracked.key);
+		if (!ancestor.instances.empty())
+			continue;
+
+		MMessage::removeCallback(ancestor.callback);
+		auto range = _ancestorIds.equal_range(ancestor.hash);
+		for (auto entry = range.first; entry != range.second; ++entry)
+		{
+			if (entry->second == id)
+			{
+				_ancestorIds.erase(entry);
+				break;
+			}
+		}
+		_ancestors.erase(it);
+	}
+	tracked.ancestors.clear();
+}
+
+void SceneBounds::UntrackNode(uint32_t nodeHash)
+{
+	// Hash codes are not unique: a node still in the graph only shares the hash of the
+	// removed one and stays tracked
+	for (auto it = _tracked.begin(); it != _tracked.end();)
+	{
+		if (BoundsKeyNode(it->first) == nodeHash && !it->second->node.isValid())
+		{
+			Release(*it->second);
+			_cache.OnRemoved(it->first);
+			it = _tracked.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void SceneBounds::WorldMatrixModifiedCB(MObject& transformNode, MDagMessage::MatrixModifiedFlags& modified, void* clientData)
+{
+	Tracked* tracked = (Tracked*)clientData;
+	tracked->owner->_changes.Push(kChangeDirty, tracked->key);
+}
+
+void SceneBounds::NodeDirtyCB(MObject& node, void* clientData)
+{
+	Tracked* tracked = (Tracked*)clientData;
+	tracked->owner->_changes.Push(kChangeShapeDirty, tracked->key);
+}
+
+void SceneBounds::AncestorDirtyCB(MObject& node, void* clientData)
+{
+	// One record for the whole subtree, moving a group does not fill the queue
+	Ancestor* ancestor = (Ancestor*)clientData;
+	ancestor->owner->_changes.Push(kChangeAncestorDirty, ancestor->id);
+}
+
+void SceneBounds::NodeAddedCB(MObject& node, void* clientData)
+{
+	SceneBounds* self = (SceneBounds*)clientData;
+	self->_changes.Push(kChangeNodeAdded);
+}
+
+void SceneBounds::NodeRemovedCB(MObject& node, void* clientData)
+{
+	SceneBounds* self = (SceneBounds*)clientData;
+	MObjectHandle handle(node);
+	self->_changes.Push(kChangeNodeRemoved, MakeBoundsKey(handle.hashCode(), 0));
+}
+
+void SceneBounds::DagChangedCB(MDagMessage::DagMessage msgType, MDagPath& child, MDagPath& parent, void* clientData)
+{
+	SceneBounds* self = (SceneBounds*)clientData;
+	self->_changes.Push(kChangeDagChanged);
+}
+
+void SceneBounds::ActiveListModifiedCB(void* clientData)
+{
+	SceneBounds* self = (SceneBounds*)clientData;
+	self->_changes.Push(kChangeActiveList);
+}
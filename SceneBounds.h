@@ -0,0 +1,108 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <maya/MDagPath.h>
+#include <maya/MDagMessage.h>
+#include <maya/MCallbackIdArray.h>
+
+#include "BoundsCache.h"
+#include "SceneChangeQueue.h"
+
+
+// Maya side of the BoundsCache: finds the surfaces of the scene, reads their bounds and
+// matrices from the DAG and registers DG/DAG message callbacks which report the changes.
+// Nothing is queried from the DG for objects that did not change.
+// The callbacks may run on evaluation threads, they only push records to a lock-free queue
+// that the render thread drains before drawing (DrainChanges).
+class SceneBounds : public BoundsSource
+{
+public:
+	SceneBounds();
+	~SceneBounds();
+
+	static BoundsKey KeyFromPath(const MDagPath& path);
+
+	// Moves the changes queued by the callbacks to the cache and the pending flags, once
+	// per frame before Update(). Returns the number of records drained.
+	size_t DrainChanges();
+
+	// Records dropped because the queue was full, each drop costs a full refresh
+	inline uint64_t DroppedChanges() const { return _changes.Dropped(); }
+
+	// Apply the scene changes reported by the callbacks since the last call: track new
+	// surfaces, drop deleted ones and refetch dirty entries. Returns how many were fetched.
+	size_t Update();
+
+	// Whether Update() has anything to do. The overlay draws several panels per refresh,
+	// only the first one after a change pays for it.
+	inline bool HasPendingChanges() const
+	{
+		return _rescan || _activeDirty || _cache.DirtyCount() != 0;
+	}
+
+	bool FetchBounds(BoundsKey key, BoundsEntry& entry) override;
+
+	// Whether the object is part of the active selection (directly or through a parent)
+	inline bool IsActive(BoundsKey key) const { return _active.count(key) != 0; }
+	inline const std::unordered_set<BoundsKey>& Active() const { return _active; }
+
+	inline BoundsCache& Cache() { return _cache; }
+
+	bool PathOf(BoundsKey key, MDagPath& path) const;
+
+	// Shape nodes that had a dirty plug since the last call (not their transforms), for
+	// the caches of per-shape data
+	void TakeDirtyShapes(std::vector<uint32_t>& nodes);
+
+	// Whether shape changes were lost since the last call because the queue overflowed,
+	// any shape may then have changed without being in TakeDirtyShapes()
+	inline bool TakeLostShapes()
+	{
+		bool lost = _shapesLost;
+		_shapesLost = false;
+		return lost;
+	}
+
+protected:
+	struct Tracked;
+	struct Ancestor;
+
+	void Rescan();
+	void UpdateActive();
+	void Track(BoundsKey key, const MDagPath& path);
+	void UntrackNode(uint32_t nodeHash);
+
+	// Adds the instance to the ancestor node, registering its callback if it is new
+	void Attach(Tracked& tracked, const MObject& node);
+
+	// Removes the callbacks of the instance and takes it off its ancestors, the last
+	// instance below an ancestor removes the ancestor's callback
+	void Release(Tracked& tracked);
+
+	static bool IsSurface(const MDagPath& path);
+
+	static void WorldMatrixModifiedCB(MObject& transformNode, MDagMessage::MatrixModifiedFlags& modified, void* clientData);
+	static void NodeDirtyCB(MObject& node, void* clientData);
+	static void AncestorDirtyCB(MObject& node, void* clientData);
+	static void NodeAddedCB(MObject& node, void* clientData);
+	static void NodeRemovedCB(MObject& node, void* clientData);
+	static void DagChangedCB(MDagMessage::DagMessage msgType, MDagPath& child, MDagPath& parent, void* clientData);
+	static void ActiveListModifiedCB(void* clientData);
+
+	BoundsCache _cache;
+	std::unordered_map<BoundsKey, std::unique_ptr<Tracked>> _tracked;
+	std::unordered_map<uint64_t, std::unique_ptr<Ancestor>> _ancestors;
+	std::unordered_multimap<uint32_t, uint64_t> _ancestorIds;	// by node hash
+	uint64_t _nextAncestorId = 1;
+	std::unordered_set<BoundsKey> _active;
+	std::unordered_set<uint32_t> _dirtyShapes;
+	SceneChangeQueue _changes;
+	SceneChangeBatch _batch;
+	bool _rescan = true;
+	bool _activeDirty = true;
+	bool _shapesLost = false;
+	MCallbackIdArray _globalCallbacks;
+};
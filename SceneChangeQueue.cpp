@@ -0,0 +1,130 @@
+#include "SceneChangeQueue.h"
+
+
+void SceneChangeBatch::Clear()
+{
+	dirty.clear();
+	dirtyShapes.clear();
+	removedNodes.clear();
+	dirtyAncestors.clear();
+	nodesAdded = false;
+	dagChanged = false;
+	activeChanged = false;
+	overflowed = false;
+	events = 0;
+}
+
+
+SceneChangeQueue::SceneChangeQueue(size_t capacity)
+{
+	size_t size = 2;
+	while (size < capacity)
+		size <<= 1;
+	_mask = size - 1;
+
+	// A cell is free for the push at position p when its sequence is p
+	_cells = new Cell[size];
+	for (size_t i = 0; i < size; i++)
+		_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+SceneChangeQueue::~SceneChangeQueue()
+{
+	delete[] _cells;
+	_cells = nullptr;
+}
+
+bool SceneChangeQueue::Push(const SceneChange& change)
+{
+	uint64_t pos = _tail.load(std::memory_order_relaxed);
+	Cell* cell;
+	for (;;)
+	{
+		cell = &_cells[pos & _mask];
+		uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+		int64_t diff = (int64_t)(sequence - pos);
+		if (diff == 0)
+		{
+			if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			// The consumer has not read this cell since the last lap
+			_overflow.store(true, std::memory_order_release);
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+		{
+			// Another producer took the cell
+			pos = _tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->change = change;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool SceneChangeQueue::Pop(SceneChange& change)
+{
+	Cell& cell = _cells[_head & _mask];
+	if (cell.sequence.load(std::memory_order_acquire) != _head + 1)
+		return false;
+
+	change = cell.change;
+
+	// Free for the push one lap later
+	cell.sequence.store(_head + _mask + 1, std::memory_order_release);
+	_head++;
+	return true;
+}
+
+size_t SceneChangeQueue::Drain(SceneChangeBatch& batch)
+{
+	batch.Clear();
+	_seenKeys.clear();
+	_seenShapes.clear();
+	_seenRemoved.clear();
+	_seenAncestors.clear();
+
+	// Dropped records are only known through the flag, taken before the records so that a
+	// drop is never missed
+	batch.overflowed = _overflow.exchange(false, std::memory_order_acquire);
+
+	SceneChange change;
+	while (Pop(change))
+	{
+		batch.events++;
+		switch (change.type)
+		{
+		case kChangeShapeDirty:
+			if (_seenShapes.insert(BoundsKeyNode(change.key)).second)
+				batch.dirtyShapes.push_back(BoundsKeyNode(change.key));
+			// fall through
+		case kChangeDirty:
+			if (_seenKeys.insert(change.key).second)
+				batch.dirty.push_back(change.key);
+			break;
+		case kChangeNodeAdded:
+			batch.nodesAdded = true;
+			break;
+		case kChangeNodeRemoved:
+			if (_seenRemoved.insert(BoundsKeyNode(change.key)).second)
+				batch.removedNodes.push_back(BoundsKeyNode(change.key));
+			break;
+		case kChangeDagChanged:
+			batch.dagChanged = true;
+			break;
+		case kChangeActiveList:
+			batch.activeChanged = true;
+			break;
+		case kChangeAncestorDirty:
+			if (_seenAncestors.insert(change.key).second)
+				batch.dirtyAncestors.push_back(change.key);
+			break;
+		}
+	}
+	return batch.events;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "BoundsCache.h"
+
+
+enum SceneChangeType : uint8_t
+{
+	kChangeDirty,			// bounds or matrix of key
+	kChangeShapeDirty,		// same, and the shape's own data (mesh) may have changed
+	kChangeNodeAdded,
+	kChangeNodeRemoved,		// node hash in the upper half of key
+	kChangeDagChanged,		// parenting or instancing
+	kChangeActiveList,
+	kChangeAncestorDirty,	// every instance below an ancestor, the ancestor's id in key
+};
+
+// One scene change reported by a DG/DAG callback, 16 bytes
+struct SceneChange
+{
+	BoundsKey key;
+	SceneChangeType type;
+};
+
+// The changes of one Drain(), each key and node once
+struct SceneChangeBatch
+{
+	std::vector<BoundsKey> dirty;
+	std::vector<uint32_t> dirtyShapes;
+	std::vector<uint32_t> removedNodes;
+	std::vector<uint64_t> dirtyAncestors;
+	bool nodesAdded = false;
+	bool dagChanged = false;
+	bool activeChanged = false;
+	bool overflowed = false;	// records were dropped, everything must be treated as changed
+	size_t events = 0;			// records drained, before coalescing
+
+	void Clear();
+};
+
+
+// Bounded multi-producer / single-consumer queue between the Maya callbacks and the render
+// thread. The callbacks may run on evaluation threads in parallel evaluation, Push() never
+// locks nor allocates: it claims a cell of the ring with a compare-and-swap on the tail and
+// publishes it with the cell's sequence number. A full ring drops the record and raises
+// the overflow flag, the consumer then has to assume that anything may have changed.
+// Only one thread may call Pop() and Drain().
+class SceneChangeQueue
+{
+public:
+	static const size_t kDefaultCapacity = 1 << 16;
+
+	// Rounded up to a power of two
+	SceneChangeQueue(size_t capacity = kDefaultCapacity);
+	~SceneChangeQueue();
+
+	SceneChangeQueue(const SceneChangeQueue&) = delete;
+	SceneChangeQueue& operator=(const SceneChangeQueue&) = delete;
+
+	// False when the ring is full, the record is dropped
+	bool Push(const SceneChange& change);
+	inline bool Push(SceneChangeType type, BoundsKey key = 0) { return Push(SceneChange{ key, type }); }
+
+	// The oldest published record. A record being written stops the consumer there, it is
+	// read by the next call.
+	bool Pop(SceneChange& change);
+
+	// Pops everything published and coalesces it into batch (cleared first), returns the
+	// number of records
+	size_t Drain(SceneChangeBatch& batch);
+
+	inline size_t Capacity() const { return _mask + 1; }
+	inline uint64_t Dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+protected:
+	struct Cell
+	{
+		std::atomic<uint64_t> sequence;
+		SceneChange change;
+	};
+
+	Cell* _cells = nullptr;
+	size_t _mask = 0;
+
+	// Producers and the consumer on their own cache lines. Padded rather than aligned, C++14
+	// new does not align past 16 bytes.
+	uint8_t _padding0[64];
+	std::atomic<uint64_t> _tail{ 0 };
+	uint8_t _padding1[64];
+	uint64_t _head = 0;
+	uint8_t _padding2[64];
+	std::atomic<bool> _overflow{ false };
+	std::atomic<uint64_t> _dropped{ 0 };
+
+	// Consumer side, for the coalescing
+	std::unordered_set<BoundsKey> _seenKeys;
+	std::unordered_set<uint32_t> _seenShapes;
+	std::unordered_set<uint32_t> _seenRemoved;
+	std::unordered_set<uint64_t> _seenAncestors;
+};
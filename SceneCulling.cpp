@@ -0,0 +1,53 @@
+#include "SceneCulling.h"
+
+
+Aabb SceneCulling::WorldBox(const DrawItemStore& items, uint32_t item)
+{
+	float minPt[3], maxPt[3];
+	items.Bounds(item, minPt, maxPt);
+	return TransformAabb(minPt, maxPt, items.World(item));
+}
+
+void SceneCulling::Rebuild(const BoundsCache& cache, DrawItemStore& items)
+{
+	items.Rebuild(cache);
+
+	std::vector<Aabb> boxes(items.Size());
+	for (uint32_t item = 0; item < (uint32_t)items.Size(); item++)
+		boxes[item] = WorldBox(items, item);
+
+	_bvh.Build(boxes.data(), boxes.size());
+	_rebuilds++;
+}
+
+void SceneCulling::Sync(BoundsCache& cache, DrawItemStore& items)
+{
+	if (cache.StructureCounter() != _structureCounter)
+	{
+		_structureCounter = cache.StructureCounter();
+		Rebuild(cache, items);
+	}
+	else
+	{
+		for (BoundsKey key : cache.Updated())
+		{
+			uint32_t item = items.IndexOf(key);
+			const BoundsEntry* entry = cache.Find(key);
+			if (item != DrawItemStore::kInvalidIndex && entry)
+			{
+				items.Update(item, *entry);
+				_bvh.Update(item, WorldBox(items, item));
+			}
+		}
+		_bvh.Refit();
+	}
+
+	cache.ClearUpdated();
+}
+
+void SceneCulling::Cull(const Frustum& frustum, FrameArray<uint32_t>& visible)
+{
+	size_t count = visible.Count();
+	visible.Resize(count + _bvh.PrimCount());
+	visible.Resize(count + _bvh.Cull(frustum, visible.Data() + count));
+}
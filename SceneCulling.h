@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+#include "BoundsCache.h"
+#include "Bvh.h"
+#include "DrawItemStore.h"
+#include "FrameArena.h"
+
+
+// Keeps the draw items and a BVH over their world-space boxes in sync with a BoundsCache,
+// and culls it against the camera. The BVH primitives are the item indices. Objects that
+// moved only refit the tree, added or removed objects rebuild the items and the tree.
+class SceneCulling
+{
+public:
+	// Bring the items and the BVH up to date with the entries updated in the cache, and
+	// clear them. After a rebuild the item indices change and the active flags are cleared.
+	void Sync(BoundsCache& cache, DrawItemStore& items);
+
+	// Appends the indices of the items intersecting the frustum. visible must have room
+	// for Count() more items.
+	void Cull(const Frustum& frustum, FrameArray<uint32_t>& visible);
+
+	inline size_t Count() const { return _bvh.PrimCount(); }
+	inline size_t RebuildCount() const { return _rebuilds; }
+
+protected:
+	void Rebuild(const BoundsCache& cache, DrawItemStore& items);
+
+	static Aabb WorldBox(const DrawItemStore& items, uint32_t item);
+
+	Bvh _bvh;
+	uint64_t _structureCounter = ~0ull;
+	size_t _rebuilds = 0;
+};
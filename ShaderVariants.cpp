@@ -0,0 +1,155 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+const char* ShaderStageName(ShaderStage stage)
+{
+	switch (stage)
+	{
+	case kShaderVertex: return "vs";
+	case kShaderPixel: return "ps";
+	default: return "unknown";
+	}
+}
+
+std::string VariantName(uint32_t variant)
+{
+	std::string name = (variant & kVariantInstanced) ? "instanced" : "single";
+	name += (variant & kVariantSolid) ? "|solid" : "|line";
+	name += (variant & kVariantConstantColor) ? "|constant" : "|status";
+	return name;
+}
+
+uint32_t ShaderKey(ShaderStage stage, uint32_t variant)
+{
+	if (stage == kShaderVertex)
+	{
+		uint32_t key = variant & kVariantInstanced;
+		if (key)
+			key |= variant & kVariantConstantColor;
+		return key;
+	}
+	return variant & kVariantSolid;
+}
+
+std::vector<std::string> ShaderDefines(ShaderStage, uint32_t key)
+{
+	std::vector<std::string> defines;
+	if (key & kVariantInstanced)
+		defines.push_back("INSTANCED=1");
+	if (key & kVariantSolid)
+		defines.push_back("SOLID=1");
+	if (key & kVariantConstantColor)
+		defines.push_back("CONSTANT_COLOR=1");
+	return defines;
+}
+
+std::vector<ShaderTableKey> EnumerateShaders()
+{
+	std::vector<ShaderTableKey> shaders;
+	for (uint32_t stage = 0; stage < kShaderStageCount; stage++)
+	{
+		std::vector<uint32_t> keys;
+		for (uint32_t variant = 0; variant < kVariantCount; variant++)
+			keys.push_back(ShaderKey((ShaderStage)stage, variant));
+		keys.push_back(kShaderKeyComposite);
+
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+		for (uint32_t key : keys)
+			shaders.push_back({ (ShaderStage)stage, key });
+	}
+	return shaders;
+}
+
+static void Append32(std::vector<uint8_t>& out, uint32_t value)
+{
+	uint8_t bytes[4];
+	memcpy(bytes, &value, 4);
+	out.insert(out.end(), bytes, bytes + 4);
+}
+
+std::vector<uint8_t> PackShaderTable(const std::vector<ShaderBlob>& blobs)
+{
+	std::vector<const ShaderBlob*> sorted;
+	for (const ShaderBlob& blob : blobs)
+		sorted.push_back(&blob);
+	std::sort(sorted.begin(), sorted.end(), [](const ShaderBlob* a, const ShaderBlob* b)
+	{
+		return a->stage != b->stage ? a->stage < b->stage : a->key < b->key;
+	});
+
+	uint32_t count = (uint32_t)sorted.size();
+	uint32_t offset = 12 + 16 * count;
+
+	std::vector<uint8_t> table;
+	Append32(table, ShaderTable::kMagic);
+	Append32(table, ShaderTable::kVersion);
+	Append32(table, count);
+
+	for (const ShaderBlob* blob : sorted)
+	{
+		Append32(table, blob->stage);
+		Append32(table, blob->key);
+		Append32(table, offset);
+		Append32(table, (uint32_t)blob->code.size());
+		offset += ((uint32_t)blob->code.size() + 3) & ~3u;
+	}
+
+	for (const ShaderBlob* blob : sorted)
+	{
+		table.insert(table.end(), blob->code.begin(), blob->code.end());
+		table.resize((table.size() + 3) & ~(size_t)3, 0);
+	}
+	return table;
+}
+
+bool ShaderTable::Parse(const uint8_t* data, size_t size)
+{
+	_data = nullptr;
+	_entries.clear();
+
+	uint32_t header[3];
+	if (!data || size < sizeof(header))
+		return false;
+	memcpy(header, data, sizeof(header));
+	if (header[0] != kMagic || header[1] != kVersion)
+		return false;
+
+	uint32_t count = header[2];
+	if ((size - sizeof(header)) / sizeof(Entry) < count)
+		return false;
+
+	_entries.resize(count);
+	if (count)
+		memcpy(_entries.data(), data + sizeof(header), count * sizeof(Entry));
+
+	for (const Entry& entry : _entries)
+	{
+		if (entry.offset > size || entry.size > size - entry.offset)
+		{
+			_entries.clear();
+			return false;
+		}
+	}
+
+	_data = data;
+	return true;
+}
+
+bool ShaderTable::Find(ShaderStage stage, uint32_t key, const uint8_t*& code, size_t& size) const
+{
+	for (const Entry& entry : _entries)
+	{
+		if (entry.stage == stage && entry.key == key)
+		{
+			code = _data + entry.offset;
+			size = entry.size;
+			return true;
+		}
+	}
+	return false;
+}
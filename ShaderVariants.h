@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Permutations of the overlay pipeline. Every combination of bits is a variant; a shader
+// stage only depends on some of the bits (ShaderKey), the rest only changes pipeline state.
+enum ShaderVariantBits : uint32_t
+{
+	kVariantInstanced = 1 << 0,			// per-instance matrix and color in slot 1, else ObjectConstants
+	kVariantSolid = 1 << 1,				// shaded triangles instead of lines
+	kVariantConstantColor = 1 << 2,		// color from ObjectConstants instead of the status color
+
+	kVariantCount = 1 << 3,
+};
+
+enum ShaderStage : uint32_t
+{
+	kShaderVertex,
+	kShaderPixel,
+	kShaderStageCount
+};
+
+// Key of the shaders compositing a cached overlay layer over the target, not a variant:
+// a full screen triangle and a texture read, without defines
+static const uint32_t kShaderKeyComposite = 1 << 8;
+
+const char* ShaderStageName(ShaderStage stage);
+
+// e.g. "instanced|line|status"
+std::string VariantName(uint32_t variant);
+
+// The bits of a variant that select the shader of a stage. Without kVariantInstanced the
+// color always comes from the constants, so kVariantConstantColor is dropped.
+uint32_t ShaderKey(ShaderStage stage, uint32_t variant);
+
+// Preprocessor defines of a shader, NAME=1 for every bit set in its key
+std::vector<std::string> ShaderDefines(ShaderStage stage, uint32_t key);
+
+struct ShaderTableKey
+{
+	ShaderStage stage;
+	uint32_t key;
+};
+
+// The distinct shaders needed by all the variants and the composite, ordered by stage then key
+std::vector<ShaderTableKey> EnumerateShaders();
+
+
+struct ShaderBlob
+{
+	ShaderStage stage;
+	uint32_t key;
+	std::vector<uint8_t> code;
+};
+
+// Packs compiled shaders into one table:
+//   header  { magic 'GSHT', version, count }
+//   entries { stage, key, offset, size } x count, ordered like EnumerateShaders()
+//   code, each blob 4-byte aligned, offsets from the start of the table
+std::vector<uint8_t> PackShaderTable(const std::vector<ShaderBlob>& blobs);
+
+// Read-only view of a packed table, the data is not copied
+class ShaderTable
+{
+public:
+	static const uint32_t kMagic = 0x54485347;	// "GSHT"
+	static const uint32_t kVersion = 1;
+
+	// Returns false when the data is not a valid table
+	bool Parse(const uint8_t* data, size_t size);
+
+	bool Find(ShaderStage stage, uint32_t key, const uint8_t*& code, size_t& size) const;
+
+	inline size_t Count() const { return _entries.size(); }
+
+protected:
+	struct Entry
+	{
+		uint32_t stage;
+		uint32_t key;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	const uint8_t* _data = nullptr;
+	std::vector<Entry> _entries;
+};
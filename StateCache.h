@@ -0,0 +1,102 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+
+
+// Creates every unique state object once and hands out the cached one afterwards.
+// Desc must be a plain struct that is fully zero-initialized before it is filled in,
+// since it is hashed and compared byte-wise (padding included). State is a cheap handle
+// (usually a pointer) owned by the cache until Clear().
+template<class Desc, class State>
+class StateCache
+{
+	static_assert(std::is_trivially_copyable<Desc>::value, "StateCache descriptions must be plain structs");
+
+public:
+	using CreateFunc = std::function<State(const Desc&)>;
+	using ReleaseFunc = std::function<void(State)>;
+
+	StateCache(CreateFunc create, ReleaseFunc release) : _create(create), _release(release) {}
+	~StateCache() { Clear(); }
+
+	StateCache(const StateCache&) = delete;
+	StateCache& operator=(const StateCache&) = delete;
+
+	// Returns the state of the description, created on first use. A failed creation
+	// returns State() and is retried on the next call.
+	State Acquire(const Desc& desc)
+	{
+		Key key;
+		memcpy(&key.desc, &desc, sizeof(Desc));
+		key.hash = Hash(desc);
+
+		auto it = _states.find(key);
+		if (it != _states.end())
+		{
+			_hits++;
+			return it->second;
+		}
+
+		_misses++;
+		State state = _create(desc);
+		if (state)
+		{
+			_states.emplace(key, state);
+		}
+		return state;
+	}
+
+	// Release every state, the next Acquire() creates them again
+	void Clear()
+	{
+		for (auto& it : _states)
+		{
+			_release(it.second);
+		}
+		_states.clear();
+	}
+
+	inline size_t Size() const { return _states.size(); }
+	inline uint64_t Hits() const { return _hits; }
+	inline uint64_t Misses() const { return _misses; }
+
+	// FNV-1a over the bytes of the description
+	static size_t Hash(const Desc& desc)
+	{
+		const unsigned char* bytes = (const unsigned char*)&desc;
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(Desc); i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return (size_t)hash;
+	}
+
+protected:
+	struct Key
+	{
+		Desc desc;
+		size_t hash;
+
+		bool operator==(const Key& other) const
+		{
+			return hash == other.hash && memcmp(&desc, &other.desc, sizeof(Desc)) == 0;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const { return key.hash; }
+	};
+
+	CreateFunc _create;
+	ReleaseFunc _release;
+	std::unordered_map<Key, State, KeyHash> _states;
+	uint64_t _hits = 0;
+	uint64_t _misses = 0;
+};
@@ -0,0 +1,114 @@
+#include "StreamingImageWriter.h"
+
+#include <algorithm>
+
+
+static const size_t kTgaHeaderSize = 18;
+
+// Files past 2GB, 16-bit sizes allow 16GB
+static bool SeekTo(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+
+StreamingImageWriter::~StreamingImageWriter()
+{
+	Close();
+}
+
+bool StreamingImageWriter::Open(const std::string& path, uint32_t width, uint32_t height)
+{
+	Close();
+	if (width == 0 || height == 0 || width > 0xffff || height > 0xffff)
+		return false;
+
+	_file = fopen(path.c_str(), "wb");
+	if (!_file)
+		return false;
+	_width = width;
+	_height = height;
+	_pixels = 0;
+	_failed = false;
+
+	// The header of EncodeTga() for an empty image of this size
+	std::vector<uint8_t> header;
+	ReadbackImage empty;
+	EncodeTga(empty, header);
+	header[12] = (uint8_t)(width & 0xff);
+	header[13] = (uint8_t)(width >> 8);
+	header[14] = (uint8_t)(height & 0xff);
+	header[15] = (uint8_t)(height >> 8);
+	_failed = fwrite(header.data(), 1, kTgaHeaderSize, _file) != kTgaHeaderSize;
+	return !_failed;
+}
+
+bool StreamingImageWriter::WriteTile(uint32_t x, uint32_t y, const ReadbackImage& tile, std::vector<uint8_t>& scratch, size_t& bytes)
+{
+	bytes = 0;
+	if (!_file || x >= _width || y >= _height)
+		return false;
+
+	uint32_t width = std::min(tile.width, _width - x);
+	uint32_t height = std::min(tile.height, _height - y);
+	size_t rowBytes = (size_t)width * 4;
+
+	// Converted outside of the lock, the other writers only wait for the disk
+	scratch.resize(rowBytes * height);
+	uint8_t* dst = scratch.data();
+	for (uint32_t row = 0; row < height; row++)
+	{
+		const uint8_t* src = tile.pixels + (size_t)row * tile.rowPitch;
+		for (uint32_t i = 0; i < width; i++, src += 4, dst += 4)
+		{
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = src[3];
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	bool ok = true;
+	for (uint32_t row = 0; row < height && ok; row++)
+	{
+		uint64_t offset = kTgaHeaderSize + ((uint64_t)(y + row) * _width + x) * 4;
+		ok = SeekTo(_file, offset) && fwrite(scratch.data() + row * rowBytes, 1, rowBytes, _file) == rowBytes;
+		bytes += ok ? rowBytes : 0;
+	}
+	if (ok)
+		_pixels += (uint64_t)width * height;
+	else
+		_failed = true;
+	return ok;
+}
+
+bool StreamingImageWriter::Close()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_file)
+		return false;
+
+	bool ok = !_failed && _pixels == (uint64_t)_width * _height;
+	ok = fclose(_file) == 0 && ok;
+	_file = nullptr;
+	return ok;
+}
+
+
+bool TileImageSink::Write(const ImageWriteJob& job, std::vector<uint8_t>& scratch, size_t& bytes)
+{
+	bytes = 0;
+	if (job.frame < 0 || (size_t)job.frame >= _grid.Count())
+		return false;
+
+	Tile tile = _grid.At((size_t)job.frame);
+	ReadbackImage image = job.image;
+	image.width = std::min(image.width, tile.width);
+	image.height = std::min(image.height, tile.height);
+	return _image.WriteTile(tile.x, tile.y, image, scratch, bytes);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ImageWriterPool.h"
+#include "TileGrid.h"
+
+
+// Writes a TGA file of any size a tile at a time: the header when opened, then every row
+// of a tile straight to its place in the file. Only the tile being converted is ever in
+// memory, the file is the same as EncodeTga() of the whole image.
+// WriteTile() may be called from several threads, for tiles that do not overlap.
+class StreamingImageWriter
+{
+public:
+	StreamingImageWriter() {}
+	~StreamingImageWriter();
+
+	StreamingImageWriter(const StreamingImageWriter&) = delete;
+	StreamingImageWriter& operator=(const StreamingImageWriter&) = delete;
+
+	bool Open(const std::string& path, uint32_t width, uint32_t height);
+
+	// The tile's top-left pixel goes to (x, y), whatever falls outside the image is dropped.
+	// scratch is the calling thread's own buffer.
+	bool WriteTile(uint32_t x, uint32_t y, const ReadbackImage& tile, std::vector<uint8_t>& scratch, size_t& bytes);
+
+	// False when a write failed or some pixels were never written
+	bool Close();
+
+	inline bool IsOpen() const { return _file != nullptr; }
+	inline uint32_t Width() const { return _width; }
+	inline uint32_t Height() const { return _height; }
+	inline uint64_t PixelsWritten() const { return _pixels; }
+
+protected:
+	std::mutex _mutex;
+	FILE* _file = nullptr;
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	uint64_t _pixels = 0;
+	bool _failed = false;
+};
+
+
+// Writer pool sink for a tiled capture: the job's frame is the tile index in the grid and
+// its image the tile target, cropped to the tile
+class TileImageSink : public ImageSink
+{
+public:
+	// Both must outlive the sink
+	TileImageSink(StreamingImageWriter& image, const TileGrid& grid) : _image(image), _grid(grid) {}
+
+	bool Write(const ImageWriteJob& job, std::vector<uint8_t>& scratch, size_t& bytes) override;
+
+protected:
+	StreamingImageWriter& _image;
+	const TileGrid& _grid;
+};
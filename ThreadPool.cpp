@@ -0,0 +1,145 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(unsigned threadCount)
+	: _remaining(0), _steals(0)
+{
+	_threadCount = std::max(threadCount, 1u);
+	_queues.reset(new Queue[_threadCount]);
+
+	// Queue 0 belongs to the thread calling ParallelFor()
+	for (unsigned i = 1; i < _threadCount; i++)
+		_threads.emplace_back(&ThreadPool::WorkerMain, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wake.notify_all();
+
+	for (std::thread& thread : _threads)
+		thread.join();
+}
+
+unsigned ThreadPool::DefaultThreadCount()
+{
+	unsigned count = std::thread::hardware_concurrency();
+	return std::min(std::max(count, 1u), 16u);
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, const ChunkFunc& func)
+{
+	grain = std::max(grain, (size_t)1);
+	size_t chunkCount = ChunkCount(count, grain);
+	if (chunkCount == 0)
+		return;
+
+	// Not worth waking anybody up
+	if (chunkCount == 1 || _threadCount == 1)
+	{
+		for (size_t c = 0; c < chunkCount; c++)
+			func(c, c * grain, std::min(count, (c + 1) * grain));
+		return;
+	}
+
+	_func = &func;
+	_count = count;
+	_grain = grain;
+	_remaining.store(chunkCount);
+
+	// Contiguous runs of chunks per thread, the owner takes them from the front and
+	// thieves from the back
+	for (unsigned q = 0; q < _threadCount; q++)
+	{
+		size_t first = chunkCount * q / _threadCount;
+		size_t last = chunkCount * (q + 1) / _threadCount;
+
+		std::lock_guard<std::mutex> lock(_queues[q].mutex);
+		for (size_t c = first; c < last; c++)
+			_queues[q].chunks.push_back(c);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_generation++;
+	}
+	_wake.notify_all();
+
+	while (RunChunk(0))
+	{
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this] { return _remaining.load() == 0; });
+	_func = nullptr;
+}
+
+void ThreadPool::WorkerMain(unsigned index)
+{
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	for (;;)
+	{
+		_wake.wait(lock, [&] { return _quit || _generation != seen; });
+		if (_quit)
+			return;
+		seen = _generation;
+
+		lock.unlock();
+		while (RunChunk(index))
+		{
+		}
+		lock.lock();
+	}
+}
+
+bool ThreadPool::Pop(unsigned index, size_t& chunk)
+{
+	{
+		Queue& own = _queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.chunks.empty())
+		{
+			chunk = own.chunks.front();
+			own.chunks.pop_front();
+			return true;
+		}
+	}
+
+	for (unsigned i = 1; i < _threadCount; i++)
+	{
+		Queue& victim = _queues[(index + i) % _threadCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.chunks.empty())
+		{
+			chunk = victim.chunks.back();
+			victim.chunks.pop_back();
+			_steals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::RunChunk(unsigned index)
+{
+	size_t chunk;
+	if (!Pop(index, chunk))
+		return false;
+
+	// The loop cannot finish while one of its chunks is held, so _func is still valid
+	size_t begin = chunk * _grain;
+	(*_func)(chunk, begin, std::min(_count, begin + _grain));
+
+	if (_remaining.fetch_sub(1) == 1)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_done.notify_all();
+	}
+	return true;
+}
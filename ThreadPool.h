@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Fork-join pool for data-parallel loops. Each thread has its own queue of chunks and
+// steals from the others when it runs dry; the thread calling ParallelFor() works too.
+class ThreadPool
+{
+public:
+	// Called once per chunk with the chunk index and its range of items
+	using ChunkFunc = std::function<void(size_t chunk, size_t begin, size_t end)>;
+
+	// threadCount includes the calling thread, 1 runs everything inline
+	explicit ThreadPool(unsigned threadCount = DefaultThreadCount());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Hardware threads, at least 1 and at most 16
+	static unsigned DefaultThreadCount();
+
+	// Number of chunks ParallelFor() splits count items into
+	static inline size_t ChunkCount(size_t count, size_t grain) { return (count + grain - 1) / grain; }
+
+	// Split [0, count) into chunks of `grain` items and run func on all of them, returns
+	// when they are done. Must not be called from inside func.
+	void ParallelFor(size_t count, size_t grain, const ChunkFunc& func);
+
+	inline unsigned ThreadCount() const { return _threadCount; }
+	inline uint64_t Steals() const { return _steals.load(std::memory_order_relaxed); }
+
+protected:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<size_t> chunks;
+	};
+
+	void WorkerMain(unsigned index);
+	bool RunChunk(unsigned index);
+	bool Pop(unsigned index, size_t& chunk);
+
+	unsigned _threadCount = 1;
+	std::vector<std::thread> _threads;
+	std::unique_ptr<Queue[]> _queues;
+
+	// The current loop, written before its chunks are queued
+	const ChunkFunc* _func = nullptr;
+	size_t _count = 0;
+	size_t _grain = 1;
+	std::atomic<size_t> _remaining;
+
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	uint64_t _generation = 0;
+	bool _quit = false;
+
+	std::atomic<uint64_t> _steals;
+};
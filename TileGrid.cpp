@@ -0,0 +1,48 @@
+#include "TileGrid.h"
+
+#include <algorithm>
+
+
+TileGrid::TileGrid(uint32_t width, uint32_t height, uint32_t tileSize)
+{
+	_width = std::max(width, 1u);
+	_height = std::max(height, 1u);
+	_tileSize = std::max(tileSize, 1u);
+	_columns = (_width + _tileSize - 1) / _tileSize;
+	_rows = (_height + _tileSize - 1) / _tileSize;
+}
+
+Tile TileGrid::At(size_t index) const
+{
+	Tile tile;
+	tile.index = (uint32_t)index;
+	tile.x = (uint32_t)(index % _columns) * _tileSize;
+	tile.y = (uint32_t)(index / _columns) * _tileSize;
+	tile.width = std::min(_tileSize, _width - tile.x);
+	tile.height = std::min(_tileSize, _height - tile.y);
+	return tile;
+}
+
+void TileGrid::Projection(const double projection[4][4], const Tile& tile, double out[4][4]) const
+{
+	// The tile's square in NDC, y points up. Edge tiles reach past the image.
+	double x0 = 2.0 * tile.x / _width - 1.0;
+	double x1 = 2.0 * (tile.x + _tileSize) / _width - 1.0;
+	double y1 = 1.0 - 2.0 * tile.y / _height;
+	double y0 = 1.0 - 2.0 * (tile.y + _tileSize) / _height;
+
+	// Scale and offset clip x and y so that the square covers [-1, 1]: x' = sx * x + tx * w
+	double sx = 2.0 / (x1 - x0);
+	double sy = 2.0 / (y1 - y0);
+	double tx = -(x1 + x0) / (x1 - x0);
+	double ty = -(y1 + y0) / (y1 - y0);
+
+	for (int r = 0; r < 4; r++)
+	{
+		const double* row = projection[r];
+		out[r][0] = row[0] * sx + row[3] * tx;
+		out[r][1] = row[1] * sy + row[3] * ty;
+		out[r][2] = row[2];
+		out[r][3] = row[3];
+	}
+}
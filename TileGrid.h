@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+
+// One tile of an image, clipped to it. The tile is drawn into a tileSize x tileSize target
+// and only its top-left width x height pixels are kept.
+struct Tile
+{
+	uint32_t index;
+	uint32_t x, y;				// top-left pixel in the image
+	uint32_t width, height;
+};
+
+
+// Splits an image of any size into square tiles, numbered in scanline order (left to right,
+// then top to bottom). Each tile is drawn with a sub-frustum of the image's projection that
+// maps its tileSize x tileSize square of pixels to the whole clip space, so a tile target
+// shows exactly those pixels of the full image.
+class TileGrid
+{
+public:
+	TileGrid(uint32_t width, uint32_t height, uint32_t tileSize);
+
+	inline uint32_t Width() const { return _width; }
+	inline uint32_t Height() const { return _height; }
+	inline uint32_t TileSize() const { return _tileSize; }
+	inline uint32_t Columns() const { return _columns; }
+	inline uint32_t Rows() const { return _rows; }
+	inline size_t Count() const { return (size_t)_columns * _rows; }
+
+	Tile At(size_t index) const;
+
+	// projection * (the tile's crop), both in Maya's MMatrix layout (row-vector convention).
+	// The vertical scale grows by height / tileSize, so a size on screen computed from the
+	// tile projection and tileSize is the one of the full image.
+	void Projection(const double projection[4][4], const Tile& tile, double out[4][4]) const;
+
+protected:
+	uint32_t _width;
+	uint32_t _height;
+	uint32_t _tileSize;
+	uint32_t _columns;
+	uint32_t _rows;
+};
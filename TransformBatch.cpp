@@ -0,0 +1,173 @@
+#include "TransformBatch.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+void TransformSoA::Reserve(size_t count)
+{
+	if (count <= _capacity)
+		return;
+
+	std::vector<float> lanes(count * kLaneCount);
+	for (int l = 0; l < kLaneCount; l++)
+	{
+		std::copy(Lane(l), Lane(l) + _count, lanes.data() + l * count);
+	}
+	_lanes.swap(lanes);
+	_capacity = count;
+}
+
+void TransformSoA::Add(const float minVal[3], const float maxVal[3], const double matrix[4][4])
+{
+	if (_count == _capacity)
+		Reserve(_capacity ? _capacity * 2 : 256);
+
+	Set(_count, minVal, maxVal, matrix);
+	_count++;
+}
+
+void TransformSoA::Resize(size_t count)
+{
+	Reserve(count);
+	_count = count;
+}
+
+void TransformSoA::Set(size_t index, const float minVal[3], const float maxVal[3], const double matrix[4][4])
+{
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			Lane(r * 4 + c)[index] = (float)matrix[r][c];
+
+	for (int a = 0; a < 3; a++)
+	{
+		Lane(kMinLane + a)[index] = minVal[a];
+		Lane(kMaxLane + a)[index] = maxVal[a];
+	}
+}
+
+void ComputeViewProjection(const double view[4][4], const double projection[4][4], float viewProjection[4][4])
+{
+	for (int r = 0; r < 4; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			double sum = view[r][0] * projection[0][c] + view[r][1] * projection[1][c] +
+				view[r][2] * projection[2][c] + view[r][3] * projection[3][c];
+			viewProjection[r][c] = (float)sum;
+		}
+	}
+}
+
+static bool CpuSupportsAVX2()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	if (!osxsave || !fma)
+		return false;
+
+	// The OS must save the YMM registers
+	if ((_xgetbv(0) & 0x6) != 0x6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+	return false;
+#endif
+}
+
+TransformKernel BestTransformKernel()
+{
+	static const TransformKernel best =
+		(TransformAVX2Compiled() && CpuSupportsAVX2()) ? kTransformAVX2 : kTransformScalar;
+	return best;
+}
+
+const char* TransformKernelName(TransformKernel kernel)
+{
+	switch (kernel)
+	{
+	case kTransformAVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+void TransformBounds(const TransformSoA& input, const float viewProjection[4][4],
+	float* out, size_t outStride, TransformKernel kernel)
+{
+	TransformBoundsRange(input, 0, input.Count(), viewProjection, out, outStride, kernel);
+}
+
+void TransformBoundsRange(const TransformSoA& input, size_t begin, size_t end, const float viewProjection[4][4],
+	float* out, size_t outStride, TransformKernel kernel)
+{
+	TransformLanes lanes;
+	for (int e = 0; e < 16; e++)
+		lanes.world[e] = input.World(e);
+	for (int a = 0; a < 3; a++)
+	{
+		lanes.minPt[a] = input.MinPt(a);
+		lanes.maxPt[a] = input.MaxPt(a);
+	}
+
+	if (kernel == kTransformAVX2 && TransformBoundsAVX2(lanes, begin, end, viewProjection, out, outStride))
+		return;
+
+	TransformBoundsScalar(lanes, begin, end, viewProjection, out, outStride);
+}
+
+void TransformBoundsScalar(const TransformLanes& input, size_t begin, size_t end,
+	const float viewProjection[4][4], float* out, size_t outStride)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		// The unit cube spans [-1, 1], so scaling by the half extents and translating to the
+		// center is the same as multiplying by the bounds matrix: only the first three rows of
+		// the world matrix are scaled and the center is folded into the translation row.
+		float half[3], center[3];
+		for (int a = 0; a < 3; a++)
+		{
+			half[a] = 0.5f * (input.maxPt[a][i] - input.minPt[a][i]);
+			center[a] = 0.5f * (input.maxPt[a][i] + input.minPt[a][i]);
+		}
+
+		float boundsWorld[4][4];
+		for (int c = 0; c < 4; c++)
+		{
+			float w0 = input.world[0 + c][i];
+			float w1 = input.world[4 + c][i];
+			float w2 = input.world[8 + c][i];
+			float w3 = input.world[12 + c][i];
+
+			boundsWorld[0][c] = half[0] * w0;
+			boundsWorld[1][c] = half[1] * w1;
+			boundsWorld[2][c] = half[2] * w2;
+			boundsWorld[3][c] = center[0] * w0 + center[1] * w1 + center[2] * w2 + w3;
+		}
+
+		float* o = out + i * outStride;
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				o[r * 4 + c] =
+					boundsWorld[r][0] * viewProjection[0][c] +
+					boundsWorld[r][1] * viewProjection[1][c] +
+					boundsWorld[r][2] * viewProjection[2][c] +
+					boundsWorld[r][3] * viewProjection[3][c];
+			}
+		}
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+
+// Structure-of-arrays storage of the inputs of the batched bounds transform:
+// element (r, c) of the world matrix of object i is World(r * 4 + c)[i], and the
+// object-space box of object i is [MinPt(axis)[i], MaxPt(axis)[i]].
+class TransformSoA
+{
+public:
+	void Clear() { _count = 0; }
+	void Reserve(size_t count);
+
+	// world is in Maya's MMatrix layout, it is converted to float here
+	void Add(const float minPt[3], const float maxPt[3], const double world[4][4]);
+
+	// Resize then Set() each object, different objects can be set from different threads
+	void Resize(size_t count);
+	void Set(size_t index, const float minPt[3], const float maxPt[3], const double world[4][4]);
+
+	inline size_t Count() const { return _count; }
+
+	inline const float* World(int element) const { return _lanes.data() + element * _capacity; }
+	inline const float* MinPt(int axis) const { return _lanes.data() + (kMinLane + axis) * _capacity; }
+	inline const float* MaxPt(int axis) const { return _lanes.data() + (kMaxLane + axis) * _capacity; }
+
+protected:
+	// All the lanes live in one allocation, lane l starts at l * _capacity
+	enum
+	{
+		kMinLane = 16,
+		kMaxLane = 19,
+		kLaneCount = 22,
+	};
+
+	inline float* Lane(int lane) { return _lanes.data() + lane * _capacity; }
+
+	std::vector<float> _lanes;
+	size_t _capacity = 0;
+	size_t _count = 0;
+};
+
+
+// view * projection in double precision, converted to float. Both are in MMatrix layout.
+void ComputeViewProjection(const double view[4][4], const double projection[4][4], float viewProjection[4][4]);
+
+
+enum TransformKernel
+{
+	kTransformScalar,
+	kTransformAVX2,
+};
+
+// Fastest kernel supported by the CPU we are running on and by the build.
+TransformKernel BestTransformKernel();
+const char* TransformKernelName(TransformKernel kernel);
+
+// Computes bounds * world * viewProjection for every object of the batch, the unit cube
+// spanning [-1, 1] is scaled to each box. Matrices use the row-vector convention.
+// Object i is written to out + i * outStride (in floats) as 16 row-major floats, so the
+// result can go straight into an interleaved vertex buffer.
+void TransformBounds(const TransformSoA& input, const float viewProjection[4][4],
+	float* out, size_t outStride, TransformKernel kernel = BestTransformKernel());
+
+// Same for the objects [begin, end) only, object i is still written to out + i * outStride
+void TransformBoundsRange(const TransformSoA& input, size_t begin, size_t end, const float viewProjection[4][4],
+	float* out, size_t outStride, TransformKernel kernel = BestTransformKernel());
+
+// Plain pointers to the lanes of a TransformSoA, this is what the kernels work on.
+// TransformBatchAVX2.cpp is built with AVX2/FMA code generation enabled, so it must not
+// call inline functions shared with the rest of the plugin (the linker could pick its copy).
+struct TransformLanes
+{
+	const float* world[16];
+	const float* minPt[3];
+	const float* maxPt[3];
+};
+
+void TransformBoundsScalar(const TransformLanes& input, size_t begin, size_t end,
+	const float viewProjection[4][4], float* out, size_t outStride);
+bool TransformBoundsAVX2(const TransformLanes& input, size_t begin, size_t end,
+	const float viewProjection[4][4], float* out, size_t outStride);
+bool TransformAVX2Compiled();
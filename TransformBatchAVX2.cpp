@@ -0,0 +1,95 @@
+// This file is compiled with AVX2/FMA code generation, see garland_enable_avx2() in
+// cmake/GarlandSIMD.cmake. It is only called after BestTransformKernel() checked that
+// the CPU supports it.
+#include "TransformBatch.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+
+bool TransformAVX2Compiled()
+{
+	return true;
+}
+
+bool TransformBoundsAVX2(const TransformLanes& input, size_t begin, size_t end,
+	const float viewProjection[4][4], float* out, size_t outStride)
+{
+	// View * projection is the same for every object, broadcast it once
+	__m256 vp[4][4];
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			vp[r][c] = _mm256_set1_ps(viewProjection[r][c]);
+
+	const __m256 halfScale = _mm256_set1_ps(0.5f);
+	alignas(32) float result[16][8];
+
+	size_t i = begin;
+	for (; i + 8 <= end; i += 8)
+	{
+		__m256 half[3], center[3];
+		for (int a = 0; a < 3; a++)
+		{
+			__m256 lo = _mm256_loadu_ps(input.minPt[a] + i);
+			__m256 hi = _mm256_loadu_ps(input.maxPt[a] + i);
+			half[a] = _mm256_mul_ps(halfScale, _mm256_sub_ps(hi, lo));
+			center[a] = _mm256_mul_ps(halfScale, _mm256_add_ps(hi, lo));
+		}
+
+		// bounds * world, see TransformBoundsScalar
+		__m256 bw[4][4];
+		for (int c = 0; c < 4; c++)
+		{
+			__m256 w0 = _mm256_loadu_ps(input.world[0 + c] + i);
+			__m256 w1 = _mm256_loadu_ps(input.world[4 + c] + i);
+			__m256 w2 = _mm256_loadu_ps(input.world[8 + c] + i);
+			__m256 w3 = _mm256_loadu_ps(input.world[12 + c] + i);
+
+			bw[0][c] = _mm256_mul_ps(half[0], w0);
+			bw[1][c] = _mm256_mul_ps(half[1], w1);
+			bw[2][c] = _mm256_mul_ps(half[2], w2);
+			bw[3][c] = _mm256_fmadd_ps(center[0], w0, _mm256_fmadd_ps(center[1], w1, _mm256_fmadd_ps(center[2], w2, w3)));
+		}
+
+		// (bounds * world) * (view * projection)
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				__m256 sum = _mm256_mul_ps(bw[r][0], vp[0][c]);
+				sum = _mm256_fmadd_ps(bw[r][1], vp[1][c], sum);
+				sum = _mm256_fmadd_ps(bw[r][2], vp[2][c], sum);
+				sum = _mm256_fmadd_ps(bw[r][3], vp[3][c], sum);
+				_mm256_store_ps(result[r * 4 + c], sum);
+			}
+		}
+
+		// Back to one matrix per object
+		for (int j = 0; j < 8; j++)
+		{
+			float* o = out + (i + j) * outStride;
+			for (int e = 0; e < 16; e++)
+				o[e] = result[e][j];
+		}
+	}
+
+	if (i < end)
+		TransformBoundsScalar(input, i, end, viewProjection, out, outStride);
+
+	return true;
+}
+
+#else
+
+bool TransformAVX2Compiled()
+{
+	return false;
+}
+
+bool TransformBoundsAVX2(const TransformLanes& input, size_t begin, size_t end,
+	const float viewProjection[4][4], float* out, size_t outStride)
+{
+	return false;
+}
+
+#endif
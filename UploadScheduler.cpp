@@ -0,0 +1,143 @@
+#include "UploadScheduler.h"
+
+#include <algorithm>
+
+
+size_t UploadScheduler::Remaining(const Mesh& mesh)
+{
+	return (mesh.vertexBytes - mesh.vertexDone) + (mesh.indexBytes - mesh.indexDone);
+}
+
+void UploadScheduler::Enqueue(uint64_t key, Mesh& mesh)
+{
+	if (mesh.queued)
+		return;
+	mesh.queued = true;
+	_queuedCount++;
+	_queue.push_back(key);
+}
+
+void UploadScheduler::Request(uint64_t key, MeshChange change, size_t vertexBytes, size_t indexBytes)
+{
+	Mesh& mesh = _meshes[key];
+	_pendingBytes -= Remaining(mesh);
+
+	if (change == kMeshPointsChanged && mesh.vertexBytes == vertexBytes && mesh.indexBytes == indexBytes &&
+		(mesh.ready || mesh.queued))
+	{
+		// Copies not started yet read the new positions anyway
+		if (mesh.vertexDone == mesh.vertexBytes)
+			mesh.vertexDone = 0;
+		else if (mesh.vertexDone != 0)
+			mesh.resweep = true;
+	}
+	else
+	{
+		mesh.vertexBytes = vertexBytes;
+		mesh.indexBytes = indexBytes;
+		mesh.vertexDone = 0;
+		mesh.indexDone = 0;
+		mesh.allocateVertices = true;
+		mesh.allocateIndices = true;
+		mesh.resweep = false;
+		mesh.ready = false;
+	}
+
+	_pendingBytes += Remaining(mesh);
+	Enqueue(key, mesh);
+}
+
+void UploadScheduler::Remove(uint64_t key)
+{
+	auto it = _meshes.find(key);
+	if (it == _meshes.end())
+		return;
+
+	if (it->second.queued)
+	{
+		_queuedCount--;
+		_pendingBytes -= Remaining(it->second);
+	}
+	_meshes.erase(it);
+}
+
+void UploadScheduler::Clear()
+{
+	_meshes.clear();
+	_queue.clear();
+	_queuedCount = 0;
+	_pendingBytes = 0;
+}
+
+void UploadScheduler::Plan(size_t budget, std::vector<MeshUpload>& uploads)
+{
+	size_t left = budget;
+
+	while (!_queue.empty())
+	{
+		uint64_t key = _queue.front();
+		auto it = _meshes.find(key);
+		if (it == _meshes.end() || !it->second.queued)
+		{
+			_queue.pop_front();
+			continue;
+		}
+
+		// Indices first, they are not touched again by points changes
+		Mesh& mesh = it->second;
+		for (MeshBufferKind buffer : { kMeshIndices, kMeshVertices })
+		{
+			size_t total = buffer == kMeshIndices ? mesh.indexBytes : mesh.vertexBytes;
+			size_t& done = buffer == kMeshIndices ? mesh.indexDone : mesh.vertexDone;
+			bool& allocate = buffer == kMeshIndices ? mesh.allocateIndices : mesh.allocateVertices;
+
+			if (done == total)
+				continue;
+
+			// Keep the pieces 4-byte aligned unless it is the end of the buffer
+			size_t size = std::min(total - done, left);
+			if (size < total - done)
+				size &= ~(size_t)3;
+			if (size == 0)
+				break;
+
+			MeshUpload upload;
+			upload.key = key;
+			upload.buffer = buffer;
+			upload.allocate = allocate;
+			upload.offset = done;
+			upload.size = size;
+			uploads.push_back(upload);
+
+			allocate = false;
+			done += size;
+			left -= size;
+			_pendingBytes -= size;
+			_uploadedBytes += size;
+		}
+
+		if (Remaining(mesh) != 0)
+			return;
+
+		mesh.ready = true;
+		_queue.pop_front();
+
+		if (mesh.resweep)
+		{
+			mesh.resweep = false;
+			mesh.vertexDone = 0;
+			_pendingBytes += mesh.vertexBytes;
+			_queue.push_back(key);
+			continue;
+		}
+
+		mesh.queued = false;
+		_queuedCount--;
+	}
+}
+
+bool UploadScheduler::Ready(uint64_t key) const
+{
+	auto it = _meshes.find(key);
+	return it != _meshes.end() && it->second.ready;
+}
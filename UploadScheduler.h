@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+
+enum MeshBufferKind : uint8_t
+{
+	kMeshVertices,
+	kMeshIndices,
+};
+
+enum MeshChange : uint8_t
+{
+	kMeshTopologyChanged,	// new vertex and index buffers, not drawable until uploaded
+	kMeshPointsChanged,		// positions rewritten in place, stays drawable
+};
+
+// One copy of a frame: `size` bytes at `offset` of a mesh buffer
+struct MeshUpload
+{
+	uint64_t key;
+	MeshBufferKind buffer;
+	bool allocate;		// (re)create the buffer with its full size before the copy
+	size_t offset;
+	size_t size;
+};
+
+
+// Decides which mesh data is copied to the GPU each frame without going over a byte
+// budget. Meshes are uploaded in request order, a mesh larger than the budget is split
+// over several frames. A mesh deformed while its positions are being copied finishes
+// the pass and goes to the back of the queue for another one, so a mesh deformed every
+// frame does not hold up the others. Only bytes are tracked here, the caller owns the
+// data and the buffers, so this runs without a GPU.
+class UploadScheduler
+{
+public:
+	// A mesh was seen for the first time or changed. A points change of a mesh whose
+	// vertex size changed is a topology change.
+	void Request(uint64_t key, MeshChange change, size_t vertexBytes, size_t indexBytes);
+	void Remove(uint64_t key);
+	void Clear();
+
+	// Appends this frame's copies to `uploads`, at most `budget` bytes in total
+	void Plan(size_t budget, std::vector<MeshUpload>& uploads);
+
+	// Whether the GPU buffers hold a complete upload of the mesh's current topology
+	bool Ready(uint64_t key) const;
+
+	inline size_t MeshCount() const { return _meshes.size(); }
+	inline size_t QueuedCount() const { return _queuedCount; }
+	inline size_t PendingBytes() const { return _pendingBytes; }
+	inline uint64_t UploadedBytes() const { return _uploadedBytes; }
+
+protected:
+	struct Mesh
+	{
+		size_t vertexBytes = 0;
+		size_t indexBytes = 0;
+		size_t vertexDone = 0;		// bytes of the pending upload already copied
+		size_t indexDone = 0;
+		bool allocateVertices = false;
+		bool allocateIndices = false;
+		bool resweep = false;		// positions changed behind the copy, copy them again
+		bool ready = false;
+		bool queued = false;
+	};
+
+	static size_t Remaining(const Mesh& mesh);
+	void Enqueue(uint64_t key, Mesh& mesh);
+
+	std::unordered_map<uint64_t, Mesh> _meshes;
+	std::deque<uint64_t> _queue;	// may hold removed or duplicate keys, skipped by Plan()
+	size_t _queuedCount = 0;
+	size_t _pendingBytes = 0;
+	uint64_t _uploadedBytes = 0;
+};
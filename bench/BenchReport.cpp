@@ -0,0 +1,77 @@
+#include "BenchReport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+ReportFormat BenchReport::_format = kReportText;
+
+BenchReport::BenchReport(const char* bench)
+	: _bench(bench)
+{
+}
+
+BenchReport& BenchReport::Text(const char* key, const char* value)
+{
+	_fields.push_back({ key, value, true });
+	return *this;
+}
+
+BenchReport& BenchReport::Count(const char* key, uint64_t value)
+{
+	_fields.push_back({ key, std::to_string((unsigned long long)value), false });
+	return *this;
+}
+
+BenchReport& BenchReport::Value(const char* key, double value)
+{
+	// JSON has no inf or nan
+	char text[64];
+	if (std::isfinite(value))
+		snprintf(text, sizeof(text), "%.6g", value);
+	else
+		snprintf(text, sizeof(text), "null");
+
+	_fields.push_back({ key, text, false });
+	return *this;
+}
+
+void BenchReport::Print() const
+{
+	if (_format == kReportJson)
+	{
+		printf("{\"bench\":\"%s\"", _bench.c_str());
+		for (const Field& field : _fields)
+		{
+			if (field.quoted)
+				printf(",\"%s\":\"%s\"", field.key.c_str(), field.value.c_str());
+			else
+				printf(",\"%s\":%s", field.key.c_str(), field.value.c_str());
+		}
+		printf("}\n");
+	}
+	else
+	{
+		printf("%s", _bench.c_str());
+		for (const Field& field : _fields)
+			printf(" %s=%s", field.key.c_str(), field.value.c_str());
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+double BenchSamples::Min() const
+{
+	return _ms.empty() ? 0.0 : *std::min_element(_ms.begin(), _ms.end());
+}
+
+double BenchSamples::Median() const
+{
+	if (_ms.empty())
+		return 0.0;
+
+	std::vector<double> sorted = _ms;
+	std::sort(sorted.begin(), sorted.end());
+	return sorted[sorted.size() / 2];
+}
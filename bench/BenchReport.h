@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+enum ReportFormat
+{
+	kReportText,	// bench key=value ...
+	kReportJson,	// one JSON object per line
+};
+
+// One result line. Fields are printed in the order they are added, so the output of two
+// runs can be diffed line by line.
+class BenchReport
+{
+public:
+	static void SetFormat(ReportFormat format) { _format = format; }
+
+	explicit BenchReport(const char* bench);
+
+	BenchReport& Text(const char* key, const char* value);
+	BenchReport& Count(const char* key, uint64_t value);
+	BenchReport& Value(const char* key, double value);
+
+	void Print() const;
+
+protected:
+	struct Field
+	{
+		std::string key;
+		std::string value;
+		bool quoted;
+	};
+
+	static ReportFormat _format;
+
+	std::string _bench;
+	std::vector<Field> _fields;
+};
+
+
+// Timings of the iterations of a benchmark, reported as the best one which is the least
+// sensitive to the noise of the machine
+class BenchSamples
+{
+public:
+	inline void Add(double ms) { _ms.push_back(ms); }
+
+	double Min() const;
+	double Median() const;
+
+protected:
+	std::vector<double> _ms;
+};
@@ -0,0 +1,1954 @@
+// Benchmarks of the Maya independent parts of the overlay pipeline over generated scenes.
+//
+//   GarlandBench [--iterations N] [--max-objects N] [--scene grid|clustered|hierarchy]
+//                [--filter name] [--json]
+//
+// Every result is one line, "bench key=value ..." or a JSON object with --json. Times are
+// in milliseconds, *_ms is the best of the iterations and *_median_ms the median.
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "BenchReport.h"
+#include "BoundsCache.h"
+#include "Bvh.h"
+#include "DrawCommands.h"
+#include "DrawItemStore.h"
+#include "DrawList.h"
+#include "FrameArena.h"
+#include "ImageWriterPool.h"
+#include "InstanceBuffer.h"
+#include "LodBuilder.h"
+#include "MeshSimplify.h"
+#include "OcclusionBuffer.h"
+#include "OverlayCache.h"
+#include "PassGraph.h"
+#include "PerfCounter.h"
+#include "ReadbackQueue.h"
+#include "RenderTargetSizing.h"
+#include "ResolutionController.h"
+#include "ResourceRegistry.h"
+#include "RingAllocator.h"
+#include "SceneChangeQueue.h"
+#include "SceneCulling.h"
+#include "ShaderVariants.h"
+#include "StreamingImageWriter.h"
+#include "SyntheticScene.h"
+#include "ThreadPool.h"
+#include "TileGrid.h"
+#include "TransformBatch.h"
+#include "UploadScheduler.h"
+
+
+using BenchClock = std::chrono::steady_clock;
+
+static double ElapsedMs(BenchClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+struct BenchScene
+{
+	SceneKind kind;
+	std::vector<SyntheticObject> objects;
+
+	inline const char* Name() const { return SceneKindName(kind); }
+	inline size_t Count() const { return objects.size(); }
+};
+
+// Camera at z = 300 looking down -z, the wide one sees the whole scene
+static const double kView[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, -300, 1 } };
+static const double kWideProjection[4][4] = { { 1.5, 0, 0, 0 }, { 0, 2.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+static const double kNarrowProjection[4][4] = { { 12.0, 0, 0, 0 }, { 0, 12.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+
+static Frustum MakeFrustum(const double projection[4][4])
+{
+	float viewProjection[4][4];
+	ComputeViewProjection(kView, projection, viewProjection);
+	return Frustum::FromViewProjection(viewProjection);
+}
+
+// Object i of the scene is the cache entry with key i
+static void FillCache(const std::vector<SyntheticObject>& objects, BoundsSource& source, BoundsCache& cache)
+{
+	for (size_t i = 0; i < objects.size(); i++)
+		cache.OnAdded(i);
+	cache.Update(source);
+}
+
+static void BenchInstanceBuffer(const BenchScene& scene, int iterations)
+{
+	InstanceBufferBuilder builder;
+	builder.Reserve(scene.Count());
+
+	BenchSamples samples;
+	for (int it = 0; it < iterations; it++)
+	{
+		auto start = BenchClock::now();
+
+		builder.Begin(kView, kWideProjection);
+		for (const SyntheticObject& o : scene.objects)
+		{
+			builder.Add(o.minPt, o.maxPt, o.world, o.color);
+		}
+		builder.Finish();
+
+		samples.Add(ElapsedMs(start));
+	}
+
+	BenchReport("instance_buffer")
+		.Text("scene", scene.Name())
+		.Count("objects", scene.Count())
+		.Count("bytes", builder.ByteSize())
+		.Value("pack_ms", samples.Min())
+		.Value("pack_median_ms", samples.Median())
+		.Value("objects_per_ms", scene.Count() / samples.Min())
+		.Print();
+}
+
+// Runs the batched transform with every kernel available
+static void BenchTransformBatch(const BenchScene& scene, int iterations)
+{
+	size_t count = scene.Count();
+
+	TransformSoA soa;
+	soa.Reserve(count);
+	for (const SyntheticObject& o : scene.objects)
+		soa.Add(o.minPt, o.maxPt, o.world);
+
+	float viewProjection[4][4];
+	ComputeViewProjection(kView, kWideProjection, viewProjection);
+
+	TransformKernel kernels[] = { kTransformScalar, kTransformAVX2 };
+	for (TransformKernel kernel : kernels)
+	{
+		if (kernel == kTransformAVX2 && BestTransformKernel() != kTransformAVX2)
+			continue;
+
+		std::vector<float> out(count * 16);
+		BenchSamples samples;
+		for (int it = 0; it < iterations; it++)
+		{
+			auto start = BenchClock::now();
+			TransformBounds(soa, viewProjection, out.data(), 16, kernel);
+			samples.Add(ElapsedMs(start));
+		}
+
+		BenchReport("transform_batch")
+			.Text("scene", scene.Name())
+			.Text("kernel", TransformKernelName(kernel))
+			.Count("objects", count)
+			.Value("transform_ms", samples.Min())
+			.Value("transform_median_ms", samples.Median())
+			.Value("objects_per_ms", count / samples.Min())
+			.Print();
+	}
+}
+
+// Build, refit one percent of the boxes and cull
+static void BenchBvh(const BenchScene& scene, int iterations)
+{
+	size_t count = scene.Count();
+	std::vector<Aabb> boxes(count);
+	for (size_t i = 0; i < count; i++)
+		boxes[i] = TransformAabb(scene.objects[i].minPt, scene.objects[i].maxPt, scene.objects[i].world);
+
+	Frustum frustum = MakeFrustum(kNarrowProjection);
+
+	Bvh bvh;
+	BenchSamples build, refit, cull;
+	std::vector<uint32_t> visible;
+	size_t moved = count / 100 + 1;
+
+	for (int it = 0; it < iterations; it++)
+	{
+		auto start = BenchClock::now();
+		bvh.Build(boxes.data(), boxes.size());
+		build.Add(ElapsedMs(start));
+
+		start = BenchClock::now();
+		for (size_t i = 0; i < moved; i++)
+		{
+			uint32_t prim = (uint32_t)((i * 7919 + it) % count);
+			Aabb box = boxes[prim];
+			box.minPt[0] += 1.0f;
+			box.maxPt[0] += 1.0f;
+			boxes[prim] = box;
+			bvh.Update(prim, box);
+		}
+		bvh.Refit();
+		refit.Add(ElapsedMs(start));
+
+		start = BenchClock::now();
+		visible.clear();
+		bvh.Cull(frustum, visible);
+		cull.Add(ElapsedMs(start));
+	}
+
+	BenchReport("bvh")
+		.Text("scene", scene.Name())
+		.Count("objects", count)
+		.Count("nodes", bvh.NodeCount())
+		.Value("build_ms", build.Min())
+		.Value("refit_ms", refit.Min())
+		.Count("refit_objects", moved)
+		.Value("cull_ms", cull.Min())
+		.Value("cull_median_ms", cull.Median())
+		.Count("visible", visible.size())
+		.Print();
+}
+
+// What the overlay does with the scene changes of a frame: one percent of the objects
+// are dirty, the cache refetches them, the BVH is refitted from the updated list and culled
+static void BenchSceneUpdate(const BenchScene& scene, int iterations)
+{
+	size_t count = scene.Count();
+	SyntheticBoundsSource source(scene.objects);
+	BoundsCache cache;
+	FillCache(scene.objects, source, cache);
+
+	SceneCulling culling;
+	DrawItemStore items;
+	culling.Sync(cache, items);
+
+	Frustum frustum = MakeFrustum(kNarrowProjection);
+	FrameArena arena;
+	FrameArray<uint32_t> visible;
+	size_t dirty = count / 100 + 1;
+	BenchSamples update, sync, cull;
+
+	for (int it = 0; it < iterations; it++)
+	{
+		for (size_t i = 0; i < dirty; i++)
+			cache.OnChanged((i * 7919 + it) % count);
+
+		auto start = BenchClock::now();
+		cache.Update(source);
+		update.Add(ElapsedMs(start));
+
+		start = BenchClock::now();
+		culling.Sync(cache, items);
+		sync.Add(ElapsedMs(start));
+
+		start = BenchClock::now();
+		arena.Reset();
+		visible = arena.Array<uint32_t>(items.Size());
+		culling.Cull(frustum, visible);
+		cull.Add(ElapsedMs(start));
+	}
+
+	BenchReport("scene_update")
+		.Text("scene", scene.Name())
+		.Count("objects", count)
+		.Count("dirty_per_frame", dirty)
+		.Value("cache_update_ms", update.Min())
+		.Value("bvh_sync_ms", sync.Min())
+		.Value("cull_ms", cull.Min())
+		.Value("total_median_ms", update.Median() + sync.Median() + cull.Median())
+		.Count("visible", visible.Count())
+		.Count("rebuilds", culling.RebuildCount())
+		.Print();
+}
+
+// Classifies and packs all the objects with 1 to 16 threads. The speedup is relative to
+// the single thread build.
+static void BenchDrawList(const BenchScene& scene, int iterations)
+{
+	size_t count = scene.Count();
+	SyntheticBoundsSource source(scene.objects);
+	BoundsCache cache;
+	FillCache(scene.objects, source, cache);
+
+	DrawItemStore items;
+	items.Rebuild(cache);
+	std::vector<uint32_t> visible(count);
+	std::unordered_set<BoundsKey> active;
+	for (size_t i = 0; i < count; i++)
+	{
+		visible[i] = (uint32_t)i;
+		if (i % 50 == 0)
+			active.insert(i);
+	}
+	items.SetActive(active);
+
+	double serialMs = 0.0;
+
+	for (unsigned threads : { 1u, 2u, 4u, 8u, 16u })
+	{
+		ThreadPool pool(threads);
+		DrawListBuilder drawList;
+		InstanceBufferBuilder instances;
+
+		BenchSamples samples;
+		for (int it = 0; it < iterations; it++)
+		{
+			auto start = BenchClock::now();
+			instances.Begin(kView, kWideProjection);
+			drawList.Build(pool, items, visible.data(), visible.size(), instances);
+			instances.Finish(BestTransformKernel(), &pool);
+			samples.Add(ElapsedMs(start));
+		}
+
+		if (threads == 1)
+			serialMs = samples.Min();
+
+		BenchReport("draw_list")
+			.Text("scene", scene.Name())
+			.Count("objects", count)
+			.Count("instances", instances.Count())
+			.Count("threads", threads)
+			.Value("build_ms", samples.Min())
+			.Value("build_median_ms", samples.Median())
+			.Value("speedup", serialMs / samples.Min())
+			.Count("steals", pool.Steals())
+			.Print();
+	}
+}
+
+// The draw list of the previous overlay: every visible key looked up in the cache and in
+// the active set, the color chosen by branches
+static void BuildKeyedDrawList(const BoundsCache& cache, const std::vector<BoundsKey>& visible,
+	const std::unordered_set<BoundsKey>& active, InstanceBufferBuilder& instances)
+{
+	for (BoundsKey key : visible)
+	{
+		const BoundsEntry* entry = cache.Find(key);
+		if (!entry || !(entry->flags & kBoundsVisible))
+			continue;
+
+		float color[3] = { 1.0f, 1.0f, 1.0f };
+		if (active.count(key) == 0)
+		{
+			if (entry->flags & kBoundsTemplated)
+				color[0] = color[1] = color[2] = 0.2f;
+			else if (entry->type == kShapeMesh)
+				memcpy(color, DrawItemStore::PaletteColor(kPaletteMesh), sizeof(color));
+			else if (entry->type == kShapeNurbsSurface)
+				memcpy(color, DrawItemStore::PaletteColor(kPaletteNurbsSurface), sizeof(color));
+			else
+				memcpy(color, DrawItemStore::PaletteColor(kPaletteSubdiv), sizeof(color));
+		}
+		instances.Add(entry->minPt, entry->maxPt, entry->world, color);
+	}
+}
+
+// Culls and packs a frame on one thread, from the keyed cache and from the draw items.
+// Cache misses are counted when the kernel allows it.
+static void BenchDrawItems(const BenchScene& scene, int iterations)
+{
+	size_t count = scene.Count();
+	SyntheticBoundsSource source(scene.objects);
+	BoundsCache cache;
+	FillCache(scene.objects, source, cache);
+
+	SceneCulling culling;
+	DrawItemStore items;
+	culling.Sync(cache, items);
+
+	std::unordered_set<BoundsKey> active;
+	for (size_t i = 0; i < count; i += 50)
+		active.insert(i);
+	items.SetActive(active);
+
+	// Same draw order for both, the one of the BVH
+	FrameArena arena;
+	Frustum frustum = MakeFrustum(kWideProjection);
+	FrameArray<uint32_t> visibleItems = arena.Array<uint32_t>(items.Size());
+	culling.Cull(frustum, visibleItems);
+	std::vector<BoundsKey> visibleKeys;
+	for (uint32_t item : visibleItems)
+		visibleKeys.push_back(items.Key(item));
+
+	ThreadPool pool(1);
+	DrawListBuilder drawList;
+	InstanceBufferBuilder keyed, packed;
+	CacheMissCounter misses;
+	BenchSamples keyedSamples, packedSamples;
+	uint64_t keyedMisses = 0, packedMisses = 0;
+
+	for (int it = 0; it < iterations; it++)
+	{
+		misses.Start();
+		auto start = BenchClock::now();
+		keyed.Begin(kView, kWideProjection);
+		BuildKeyedDrawList(cache, visibleKeys, active, keyed);
+		keyedSamples.Add(ElapsedMs(start));
+		keyedMisses += misses.Stop();
+
+		misses.Start();
+		start = BenchClock::now();
+		packed.Begin(kView, kWideProjection);
+		drawList.Build(pool, items, visibleItems.Data(), visibleItems.Count(), packed);
+		packedSamples.Add(ElapsedMs(start));
+		packedMisses += misses.Stop();
+	}
+
+	// A node of the cache's hash map holds the key, the slot and a link, plus a bucket
+	size_t keyedBytes = sizeof(BoundsKey) + sizeof(BoundsEntry) + 2 * sizeof(bool) + 2 * sizeof(void*);
+	double perItem = (double)iterations * std::max<size_t>(visibleItems.Count(), 1);
+
+	BenchReport("draw_items")
+		.Text("scene", scene.Name())
+		.Count("objects", count)
+		.Count("instances", packed.Count())
+		.Count("keyed_bytes_per_item", keyedBytes)
+		.Count("soa_bytes_per_item", DrawItemStore::ItemBytes())
+		.Value("keyed_ms", keyedSamples.Min())
+		.Value("soa_ms", packedSamples.Min())
+		.Value("speedup", keyedSamples.Min() / packedSamples.Min())
+		.Value("keyed_misses_per_item", misses.Available() ? keyedMisses / perItem : -1.0)
+		.Value("soa_misses_per_item", misses.Available() ? packedMisses / perItem : -1.0)
+		.Print();
+}
+
+// Allocates the transient arrays of a few frames, the first one overflows the arena's
+// block. From the second frame on everything comes from one merged block.
+static void BenchFrameArena(int iterations)
+{
+	FrameArena arena(64 * 1024);
+	size_t blocksAfterFirst = 0;
+	BenchSamples samples;
+	for (int it = 0; it < iterations; it++)
+	{
+		auto start = BenchClock::now();
+		arena.Reset();
+		for (size_t n = 1000; n <= 64000; n *= 2)
+		{
+			FrameArray<uint32_t> visible = arena.Array<uint32_t>(n);
+			for (size_t i = 0; i < n; i++)
+				visible.Push((uint32_t)i);
+			FrameArray<uint8_t> flags = arena.Array<uint8_t>(n);
+			flags.Resize(n);
+			memset(flags.Data(), 0, n);
+		}
+		samples.Add(ElapsedMs(start));
+		if (it == 0)
+			blocksAfterFirst = arena.BlockCount();
+	}
+	arena.Reset();
+
+	BenchReport("frame_arena")
+		.Count("frames", iterations)
+		.Count("used_kb", arena.Peak() / 1024)
+		.Count("capacity_kb", arena.Capacity() / 1024)
+		.Count("first_frame_blocks", blocksAfterFirst)
+		.Count("blocks", arena.BlockCount())
+		.Value("frame_ms", samples.Min())
+		.Print();
+}
+
+// Records one draw per object the way an overlay with several pipelines and per-draw
+// constants would, then replays the stream on the null backend
+static void BenchDrawCommands(size_t draws, int iterations)
+{
+	const ResourceId kVertices = 1, kIndices = 2, kInstances = 3, kConstants = 4;
+	const uint32_t pipelineCount = 4;
+	const size_t instanceBytes = 80 * draws;
+	const size_t constantBytes = 256 * draws;
+
+	NullCommandBackend backend;
+	backend.DeclareBuffer(kVertices, 8 * 12);
+	backend.DeclareBuffer(kIndices, 24 * 2);
+	backend.DeclareBuffer(kInstances, instanceBytes);
+	backend.DeclareBuffer(kConstants, constantBytes);
+	backend.DeclareStates(1);
+	for (ResourceId p = 1; p <= pipelineCount; p++)
+		backend.DeclarePipeline(p);
+
+	CommandBuffer commands;
+	BenchSamples record, replay;
+
+	for (int it = 0; it < iterations; it++)
+	{
+		auto start = BenchClock::now();
+		commands.Reset();
+		commands.BindStates(1);
+		commands.SetVertexBuffer(0, kVertices, 12, 0);
+		commands.SetIndexBuffer(kIndices, 0);
+		for (size_t i = 0; i < draws; i++)
+		{
+			if (i % 64 == 0)
+				commands.BindPipeline(1 + (uint32_t)(i / 64) % pipelineCount);
+			commands.SetConstants(0, kStageVertex | kStagePixel, kConstants, (uint32_t)(i * 256), 64);
+			commands.SetVertexBuffer(1, kInstances, 80, (uint32_t)(i * 80));
+			commands.DrawIndexedInstanced(24, 1, 0, 0, 0);
+		}
+		record.Add(ElapsedMs(start));
+
+		start = BenchClock::now();
+		backend.Reset();
+		ReplayCommands(commands, backend);
+		replay.Add(ElapsedMs(start));
+	}
+
+	double commandCount = (double)commands.CommandCount();
+	BenchReport("draw_commands")
+		.Count("draws", draws)
+		.Count("commands", commands.CommandCount())
+		.Value("bytes_per_command", commands.ByteSize() / commandCount)
+		.Value("record_ms", record.Min())
+		.Value("replay_ms", replay.Min())
+		.Value("record_mcmd_per_s", commandCount / (record.Min() * 1000.0))
+		.Value("replay_mcmd_per_s", commandCount / (replay.Min() * 1000.0))
+		.Print();
+}
+
+// Packs fake shaders for every permutation and times the packing and the lookups of
+// every variant
+static void BenchShaderTable(int lookups)
+{
+	std::vector<ShaderTableKey> shaders = EnumerateShaders();
+
+	std::mt19937 random(7);
+	std::vector<ShaderBlob> blobs;
+	for (const ShaderTableKey& shader : shaders)
+	{
+		ShaderBlob blob;
+		blob.stage = shader.stage;
+		blob.key = shader.key;
+		blob.code.resize(500 + random() % 4000);
+		for (uint8_t& byte : blob.code)
+			byte = (uint8_t)random();
+		blobs.push_back(std::move(blob));
+	}
+
+	auto start = BenchClock::now();
+	std::vector<uint8_t> packed = PackShaderTable(blobs);
+	double packMs = ElapsedMs(start);
+
+	ShaderTable table;
+	table.Parse(packed.data(), packed.size());
+
+	start = BenchClock::now();
+	size_t found = 0;
+	for (int i = 0; i < lookups; i++)
+	{
+		const uint8_t* code = nullptr;
+		size_t size = 0;
+		uint32_t variant = (uint32_t)i % kVariantCount;
+		found += table.Find(kShaderVertex, ShaderKey(kShaderVertex, variant), code, size);
+		found += table.Find(kShaderPixel, ShaderKey(kShaderPixel, variant), code, size);
+	}
+	double lookupMs = ElapsedMs(start);
+
+	BenchReport("shader_table")
+		.Count("variants", kVariantCount)
+		.Count("shaders", shaders.size())
+		.Count("bytes", packed.size())
+		.Value("pack_ms", packMs)
+		.Value("lookup_ns", lookupMs * 1e6 / (2.0 * lookups))
+		.Count("found", found)
+		.Print();
+}
+
+// Edits meshes for a few seconds while uploading them under a per-frame budget into
+// simulated GPU buffers: a few meshes deformed every frame, random deformations and
+// topology changes. Then lets the queue drain, and reports how long the meshes took to
+// be ready and the cost of planning a frame.
+static void BenchUploadScheduler(size_t meshCount, size_t budget)
+{
+	struct SimMesh
+	{
+		std::vector<uint8_t> vertices, indices;
+		std::vector<uint8_t> gpuVertices, gpuIndices;
+		int requestedFrame = -1;
+	};
+
+	std::mt19937 random(11);
+	auto fill = [&](std::vector<uint8_t>& data, size_t size)
+	{
+		// A new pattern per call is enough to tell the versions apart
+		uint32_t seed = random();
+		data.resize(size);
+		for (size_t i = 0; i < size; i++)
+			data[i] = (uint8_t)(seed + i * 31 + (i >> 8));
+	};
+	auto resize = [&](SimMesh& mesh)
+	{
+		// 100 to 100k vertices, about two triangles per vertex
+		size_t vertices = 100 + random() % 100000;
+		fill(mesh.vertices, vertices * 12);
+		fill(mesh.indices, vertices * 6 * 4);
+	};
+
+	std::vector<SimMesh> meshes(meshCount);
+	UploadScheduler scheduler;
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		resize(meshes[i]);
+		meshes[i].requestedFrame = 0;
+		scheduler.Request(i, kMeshTopologyChanged, meshes[i].vertices.size(), meshes[i].indices.size());
+	}
+
+	const int editFrames = 300;
+	const size_t deformedEveryFrame = 3;
+	std::vector<MeshUpload> uploads;
+	BenchSamples planMs;
+	size_t maxFrameBytes = 0;
+	double latencySum = 0.0;
+	size_t latencyCount = 0;
+	int frame = 0;
+
+	for (; frame < editFrames || scheduler.QueuedCount() != 0; frame++)
+	{
+		if (frame < editFrames)
+		{
+			for (size_t i = 0; i < deformedEveryFrame; i++)
+			{
+				fill(meshes[i].vertices, meshes[i].vertices.size());
+				scheduler.Request(i, kMeshPointsChanged, meshes[i].vertices.size(), meshes[i].indices.size());
+			}
+
+			size_t edited = random() % meshCount;
+			SimMesh& mesh = meshes[edited];
+			if (random() % 10 == 0)
+			{
+				resize(mesh);
+				mesh.requestedFrame = frame;
+				scheduler.Request(edited, kMeshTopologyChanged, mesh.vertices.size(), mesh.indices.size());
+			}
+			else
+			{
+				fill(mesh.vertices, mesh.vertices.size());
+				scheduler.Request(edited, kMeshPointsChanged, mesh.vertices.size(), mesh.indices.size());
+			}
+		}
+
+		uploads.clear();
+		auto start = BenchClock::now();
+		scheduler.Plan(budget, uploads);
+		planMs.Add(ElapsedMs(start));
+
+		size_t frameBytes = 0;
+		for (const MeshUpload& upload : uploads)
+		{
+			SimMesh& mesh = meshes[upload.key];
+			const std::vector<uint8_t>& source = upload.buffer == kMeshVertices ? mesh.vertices : mesh.indices;
+			std::vector<uint8_t>& target = upload.buffer == kMeshVertices ? mesh.gpuVertices : mesh.gpuIndices;
+			if (upload.allocate)
+				target.assign(source.size(), 0xcd);
+			memcpy(target.data() + upload.offset, source.data() + upload.offset, upload.size);
+			frameBytes += upload.size;
+		}
+		maxFrameBytes = std::max(maxFrameBytes, frameBytes);
+
+		for (size_t i = 0; i < meshCount; i++)
+		{
+			if (meshes[i].requestedFrame >= 0 && scheduler.Ready(i))
+			{
+				latencySum += frame - meshes[i].requestedFrame;
+				latencyCount++;
+				meshes[i].requestedFrame = -1;
+			}
+		}
+	}
+
+	BenchReport("upload_scheduler")
+		.Count("meshes", meshCount)
+		.Value("budget_mb", budget / (1024.0 * 1024.0))
+		.Count("frames", frame)
+		.Value("uploaded_mb", scheduler.UploadedBytes() / (1024.0 * 1024.0))
+		.Value("max_frame_mb", maxFrameBytes / (1024.0 * 1024.0))
+		.Value("ready_latency_frames", latencyCount ? latencySum / latencyCount : 0.0)
+		.Value("plan_median_ms", planMs.Median())
+		.Print();
+}
+
+// Vertex clustering of one mesh per level, then whole LOD chains built by the LodBuilder
+// on 1 to 4 threads
+static void BenchMeshSimplify(size_t triangles, int iterations)
+{
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	MakeSphere(triangles, positions, indices);
+	size_t vertexCount = positions.size() / 3;
+	size_t inputTriangles = indices.size() / 3;
+
+	for (int level = 1; level < kLodLevelCount; level++)
+	{
+		MeshLod lod;
+		BenchSamples samples;
+		for (int it = 0; it < iterations; it++)
+		{
+			auto start = BenchClock::now();
+			SimplifyByClustering(positions.data(), vertexCount, indices.data(), indices.size(), kLodGrids[level], lod);
+			samples.Add(ElapsedMs(start));
+		}
+
+		BenchReport("mesh_simplify")
+			.Count("triangles", inputTriangles)
+			.Count("level", level)
+			.Count("grid", kLodGrids[level])
+			.Count("lod_triangles", lod.triangleIndices / 3)
+			.Count("lod_vertices", lod.positions.size() / 3)
+			.Value("ms", samples.Min())
+			.Value("mtris_per_s", inputTriangles / (samples.Min() * 1000.0))
+			.Print();
+	}
+
+	std::shared_ptr<LodSource> source = std::make_shared<LodSource>();
+	source->positions = positions;
+	source->triangles = indices;
+	const int meshes = 8;
+
+	for (unsigned threads : { 1u, 2u, 4u })
+	{
+		LodBuilder builder(threads);
+		auto start = BenchClock::now();
+		for (int m = 0; m < meshes; m++)
+			builder.Submit(m, 1, source);
+		builder.Wait();
+		double ms = ElapsedMs(start);
+
+		BenchReport("lod_builder")
+			.Count("triangles", inputTriangles)
+			.Count("meshes", meshes)
+			.Count("threads", threads)
+			.Value("ms", ms)
+			.Value("mtris_per_s", meshes * inputTriangles / (ms * 1000.0))
+			.Print();
+	}
+}
+
+// Walls and a dense sphere in front of random boxes, the occluders rasterized with each
+// kernel then the boxes tested against them
+static void BenchOcclusion(size_t boxCount, int iterations)
+{
+	float viewProjection[4][4];
+	ComputeViewProjection(kView, kWideProjection, viewProjection);
+
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	MakeSphere(20000, positions, indices);
+	for (size_t i = 0; i < positions.size(); i += 3)
+	{
+		positions[i] = positions[i] * 3.0f + 60.0f;
+		positions[i + 1] = positions[i + 1] * 3.0f - 40.0f;
+		positions[i + 2] = positions[i + 2] * 3.0f + 40.0f;
+	}
+
+	const int walls = 32;
+	for (int w = 0; w < walls; w++)
+	{
+		float cx = w == 0 ? 0.0f : unit(rng) * 200.0f - 100.0f;
+		float cy = w == 0 ? 0.0f : unit(rng) * 200.0f - 100.0f;
+		float z = w == 0 ? 100.0f : unit(rng) * 100.0f;
+		float hx = 10.0f + unit(rng) * 30.0f, hy = 10.0f + unit(rng) * 30.0f;
+		uint32_t base = (uint32_t)(positions.size() / 3);
+		positions.insert(positions.end(), { cx - hx, cy - hy, z, cx + hx, cy - hy, z, cx + hx, cy + hy, z, cx - hx, cy + hy, z });
+		indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+	}
+	size_t vertexCount = positions.size() / 3;
+
+	std::vector<float> boxes(boxCount * 6);
+	for (size_t b = 0; b < boxCount; b++)
+	{
+		float size = 1.0f + unit(rng) * 4.0f;
+		float* box = &boxes[b * 6];
+		box[0] = unit(rng) * 200.0f - 100.0f;
+		box[1] = unit(rng) * 200.0f - 100.0f;
+		box[2] = unit(rng) * 200.0f - 200.0f;
+		for (int a = 0; a < 3; a++)
+			box[3 + a] = box[a] + size;
+	}
+
+	TransformKernel kernels[] = { kTransformScalar, kTransformAVX2 };
+	for (TransformKernel kernel : kernels)
+	{
+		if (kernel == kTransformAVX2 && (BestTransformKernel() != kTransformAVX2 || !OcclusionAVX2Compiled()))
+			continue;
+
+		OcclusionBuffer buffer;
+		BenchSamples rasterSamples;
+		for (int it = 0; it < iterations; it++)
+		{
+			auto start = BenchClock::now();
+			buffer.Clear();
+			buffer.RasterizeMesh(positions.data(), vertexCount, indices.data(), indices.size(), viewProjection, kernel);
+			buffer.Finish();
+			rasterSamples.Add(ElapsedMs(start));
+		}
+
+		size_t pixels = (size_t)buffer.Width() * buffer.Height();
+		size_t covered = 0;
+		for (size_t p = 0; p < pixels; p++)
+			covered += buffer.Depth()[p] < FLT_MAX;
+
+		size_t occluded = 0;
+		BenchSamples testSamples;
+		for (int it = 0; it < iterations; it++)
+		{
+			auto start = BenchClock::now();
+			occluded = 0;
+			for (size_t b = 0; b < boxCount; b++)
+				occluded += buffer.IsOccluded(&boxes[b * 6], &boxes[b * 6 + 3], viewProjection);
+			testSamples.Add(ElapsedMs(start));
+		}
+
+		BenchReport("occlusion")
+			.Text("kernel", TransformKernelName(kernel))
+			.Count("width", buffer.Width())
+			.Count("height", buffer.Height())
+			.Count("triangles", buffer.TriangleCount())
+			.Count("covered_pixels", covered)
+			.Value("raster_ms", rasterSamples.Min())
+			.Value("mtris_per_s", buffer.TriangleCount() / (rasterSamples.Min() * 1000.0))
+			.Count("boxes", boxCount)
+			.Count("occluded", occluded)
+			.Value("test_ms", testSamples.Min())
+			.Value("boxes_per_ms", boxCount / testSamples.Min())
+			.Print();
+	}
+}
+
+// Four panels refreshed together over a few interaction patterns. Panel 0 is the one the
+// user works in; a panel redraws its layer when its signature changed or the layer was not
+// settled (mesh uploads in flight). Reports the hit rate and the cost of a lookup.
+static void BenchOverlayCache(const char* pattern, int frames)
+{
+	const int panels = 4;
+	OverlayCache caches[panels];
+	CacheHitRate hitRate;
+
+	uint64_t sceneVersion = 0;
+	size_t redraws = 0;
+	double matchMs = 0.0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		bool orbit = strcmp(pattern, "orbit") == 0;
+		bool edit = strcmp(pattern, "edit") == 0 && frame % 10 == 0;
+		bool uploading = strcmp(pattern, "uploads") == 0 && frame < frames / 4;
+		if (edit)
+			sceneVersion++;
+
+		for (int p = 0; p < panels; p++)
+		{
+			OverlaySignature signature;
+			for (int i = 0; i < 4; i++)
+				signature.view[i][i] = signature.projection[i][i] = 1.0;
+			signature.view[3][0] = p;
+			signature.view[3][2] = -300.0 + ((orbit && p == 0) ? frame * 0.1 : 0.0);
+			signature.width = 1280;
+			signature.height = 720;
+			signature.sceneVersion = sceneVersion;
+
+			auto start = BenchClock::now();
+			bool hit = caches[p].Matches(signature);
+			matchMs += ElapsedMs(start);
+
+			hitRate.Add(hit);
+			if (hit)
+				continue;
+
+			redraws++;
+			caches[p].Update(signature, !uploading);
+		}
+	}
+
+	BenchReport("overlay_cache")
+		.Text("pattern", pattern)
+		.Count("panels", panels)
+		.Count("frames", frames)
+		.Count("redraws", redraws)
+		.Value("hit_rate", (double)hitRate.Hits() / hitRate.Lookups())
+		.Value("window_hit_rate", hitRate.Rate())
+		.Value("match_ns", matchMs * 1e6 / hitRate.Lookups())
+		.Print();
+}
+
+// A camera tumble of 4 seconds then 1 second idle. The frame time is a fixed part plus an
+// overlay part proportional to its pixel count, with 5% noise. Reports where the scale
+// settles, the frame time there and how long it takes to get back to full resolution.
+static void BenchResolutionController(const char* name, double fixedMs, double overlayMs, double budgetMs)
+{
+	ResolutionController::Settings settings;
+	settings.budgetMs = budgetMs;
+	ResolutionController controller(settings);
+
+	std::mt19937 rng(19);
+	std::uniform_real_distribution<double> noise(0.95, 1.05);
+
+	const double moveSeconds = 4.0, idleSeconds = 1.0;
+	double now = 0.0, frameMs = 0.0;
+	double settledScale = 0.0, settledMs = 0.0;
+	size_t settledFrames = 0, overBudget = 0, frames = 0;
+	double fullResAfter = -1.0;
+	while (now < moveSeconds + idleSeconds)
+	{
+		bool moving = now < moveSeconds;
+		double scale = controller.Update(frameMs, moving, now);
+
+		// Idle refreshes are cheap, the layer is reused
+		frameMs = moving ? (fixedMs + overlayMs * scale * scale) * noise(rng) : 16.0;
+		if (moving && now >= moveSeconds - 1.0)
+		{
+			settledScale += scale;
+			settledMs += frameMs;
+			settledFrames++;
+			overBudget += frameMs > budgetMs;
+		}
+		if (!moving && scale == 1.0 && fullResAfter < 0.0)
+			fullResAfter = now - moveSeconds;
+
+		now += frameMs / 1000.0;
+		frames++;
+	}
+
+	BenchReport("resolution_controller")
+		.Text("load", name)
+		.Value("budget_ms", budgetMs)
+		.Value("full_res_ms", fixedMs + overlayMs)
+		.Count("frames", frames)
+		.Value("settled_scale", settledScale / settledFrames)
+		.Value("settled_ms", settledMs / settledFrames)
+		.Value("over_budget", (double)overBudget / settledFrames)
+		.Count("scale_changes", controller.Changes())
+		.Value("full_res_after_s", fullResAfter)
+		.Value("final_scale", controller.Scale())
+		.Print();
+}
+
+// Stand-in for the staging textures: Copy() draws the frame into the slot's memory with
+// the capture number in the first pixel, and the GPU gets to a copy `gpuLatency` captures
+// later. Mapping a copy the GPU has not reached waits for the frames left.
+class FakeReadbackSource : public ReadbackSource
+{
+public:
+	FakeReadbackSource(uint32_t slotCount, uint32_t width, uint32_t height, uint32_t gpuLatency, double frameMs)
+		: _width(width), _height(height), _gpuLatency(gpuLatency), _frameMs(frameMs)
+	{
+		_slots.resize(slotCount);
+		for (Slot& slot : _slots)
+			slot.pixels.resize((size_t)width * height * 4);
+	}
+
+	bool Copy(uint32_t slot) override
+	{
+		Slot& s = _slots[slot];
+		if (s.mapped)
+			return false;
+
+		uint32_t frame = (uint32_t)_copies;
+		uint8_t* row = s.pixels.data();
+		for (uint32_t y = 0; y < _height; y++, row += _width * 4)
+			memset(row, (int)((frame + y) & 0xff), (size_t)_width * 4);
+		memcpy(s.pixels.data(), &frame, sizeof(frame));
+		s.readyAt = _copies + _gpuLatency;
+		_copies++;
+		return true;
+	}
+
+	bool Map(uint32_t slot, bool wait, ReadbackImage& image) override
+	{
+		Slot& s = _slots[slot];
+		if (_copies < s.readyAt)
+		{
+			if (!wait)
+				return false;
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(_frameMs * (s.readyAt - _copies)));
+			_gpuWaits++;
+		}
+		s.mapped = true;
+		image.pixels = s.pixels.data();
+		image.width = _width;
+		image.height = _height;
+		image.rowPitch = _width * 4;
+		return true;
+	}
+
+	void Unmap(uint32_t slot) override
+	{
+		_slots[slot].mapped = false;
+	}
+
+	inline uint64_t GpuWaits() const { return _gpuWaits; }
+
+protected:
+	struct Slot
+	{
+		std::vector<uint8_t> pixels;
+		uint64_t readyAt = 0;
+		bool mapped = false;
+	};
+
+	std::vector<Slot> _slots;
+	uint32_t _width, _height, _gpuLatency;
+	double _frameMs;
+	uint64_t _copies = 0;
+	uint64_t _gpuWaits = 0;
+};
+
+// Encodes like the file sink without the file, writeMs stands for the disk
+class SlowImageSink : public ImageSink
+{
+public:
+	explicit SlowImageSink(double writeMs) : _writeMs(writeMs) {}
+
+	bool Write(const ImageWriteJob& job, std::vector<uint8_t>& scratch, size_t& bytes) override
+	{
+		EncodeTga(job.image, scratch);
+		if (_writeMs > 0.0)
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(_writeMs));
+		bytes = scratch.size();
+		return true;
+	}
+
+protected:
+	double _writeMs;
+};
+
+// A frame range rendered at frameMs per frame with the GPU two frames behind, read back
+// through a ring of slots and written by the pool. A ring of one maps every copy right
+// after it, the render thread then waits for the GPU and for the writers on every frame.
+static void BenchReadback(uint32_t ring, unsigned writers, size_t frames, double frameMs, double writeMs)
+{
+	const uint32_t width = 1280, height = 720, gpuLatency = 2;
+	FakeReadbackSource source(ring, width, height, gpuLatency, frameMs);
+	SlowImageSink sink(writeMs);
+	double totalMs = 0.0;
+	ReadbackQueue::Stats stats;
+	{
+		ImageWriterPool pool(sink, writers, ring);
+		ReadbackQueue queue(source, pool, ring);
+
+		auto start = BenchClock::now();
+		for (size_t f = 0; f < frames; f++)
+		{
+			// The CPU side of the frame
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(frameMs));
+			queue.Capture((int64_t)f, std::string());
+		}
+		queue.Flush();
+		totalMs = ElapsedMs(start);
+		stats = queue.GetStats();
+	}
+
+	BenchReport("readback")
+		.Count("ring", ring)
+		.Count("writers", writers)
+		.Count("frames", frames)
+		.Value("frame_ms", frameMs)
+		.Value("write_ms", writeMs)
+		.Value("fps", frames * 1000.0 / totalMs)
+		.Value("ideal_fps", 1000.0 / frameMs)
+		.Count("stalls", stats.stalls)
+		.Value("stall_ms", stats.stallMs)
+		.Count("gpu_waits", source.GpuWaits())
+		.Count("max_in_flight", stats.maxInFlight)
+		.Count("written", stats.written)
+		.Print();
+}
+
+// The pixel (x, y) of the bench image, RGBA: a hash of the position over a gradient
+static void ImagePixel(uint32_t x, uint32_t y, uint8_t* rgba)
+{
+	uint32_t h = x * 0x9e3779b1u ^ y * 0x85ebca77u;
+	h ^= h >> 15;
+	rgba[0] = (uint8_t)(x ^ (h & 0x0f));
+	rgba[1] = (uint8_t)(y ^ (h >> 8 & 0x0f));
+	rgba[2] = (uint8_t)(h >> 16);
+	rgba[3] = (uint8_t)(h >> 24 | 1);
+}
+
+// Stand-in for the tile target and its staging textures: Draw() fills the target with the
+// tile's part of the image, whatever is past the image's edge with garbage, and Copy()
+// copies the target into the slot. Rows are padded like mapped textures.
+class FakeTileSource : public ReadbackSource
+{
+public:
+	FakeTileSource(uint32_t slotCount, const TileGrid& grid)
+		: _grid(grid), _pitch(grid.TileSize() * 4 + 64)
+	{
+		_target.resize((size_t)_pitch * grid.TileSize());
+		_slots.resize(slotCount);
+		for (std::vector<uint8_t>& slot : _slots)
+			slot.resize(_target.size());
+	}
+
+	void Draw(const Tile& tile)
+	{
+		uint32_t size = _grid.TileSize();
+		for (uint32_t y = 0; y < size; y++)
+		{
+			uint8_t* row = _target.data() + (size_t)y * _pitch;
+			for (uint32_t x = 0; x < size; x++, row += 4)
+			{
+				if (x < tile.width && y < tile.height)
+					ImagePixel(tile.x + x, tile.y + y, row);
+				else
+					memset(row, 0xcd, 4);
+			}
+		}
+	}
+
+	bool Copy(uint32_t slot) override
+	{
+		memcpy(_slots[slot].data(), _target.data(), _target.size());
+		return true;
+	}
+
+	bool Map(uint32_t slot, bool, ReadbackImage& image) override
+	{
+		image.pixels = _slots[slot].data();
+		image.width = _grid.TileSize();
+		image.height = _grid.TileSize();
+		image.rowPitch = _pitch;
+		return true;
+	}
+
+	void Unmap(uint32_t) override {}
+
+	inline size_t Bytes() const { return _target.size() * (_slots.size() + 1); }
+
+protected:
+	const TileGrid& _grid;
+	uint32_t _pitch;
+	std::vector<uint8_t> _target;
+	std::vector<std::vector<uint8_t>> _slots;
+};
+
+// An image of width x height drawn tile by tile and streamed to a file through the readback
+// queue, against encoding the untiled image in memory
+static void BenchTiledImage(uint32_t width, uint32_t height, uint32_t tileSize, uint32_t ring, unsigned writers)
+{
+	TileGrid grid(width, height, tileSize);
+	const char* tmp = getenv("TMPDIR");
+	char path[512];
+	snprintf(path, sizeof(path), "%s/garland_tiled_%ux%u_%u.tga", tmp ? tmp : "/tmp", width, height, tileSize);
+
+	StreamingImageWriter image;
+	TileImageSink sink(image, grid);
+	FakeTileSource source(ring, grid);
+	double tiledMs = 0.0;
+	ReadbackQueue::Stats stats;
+	{
+		ImageWriterPool pool(sink, writers, ring);
+		ReadbackQueue queue(source, pool, ring);
+
+		auto start = BenchClock::now();
+		if (image.Open(path, width, height))
+		{
+			for (size_t i = 0; i < grid.Count(); i++)
+			{
+				Tile tile = grid.At(i);
+				source.Draw(tile);
+				queue.Capture(tile.index, path);
+			}
+			queue.Flush();
+			image.Close();
+		}
+		tiledMs = ElapsedMs(start);
+		stats = queue.GetStats();
+	}
+
+	// The untiled reference, the whole image in memory
+	auto start = BenchClock::now();
+	std::vector<uint8_t> pixels((size_t)width * height * 4);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+			ImagePixel(x, y, pixels.data() + ((size_t)y * width + x) * 4);
+	}
+	ReadbackImage full;
+	full.pixels = pixels.data();
+	full.width = width;
+	full.height = height;
+	full.rowPitch = width * 4;
+	std::vector<uint8_t> reference;
+	EncodeTga(full, reference);
+	double untiledMs = ElapsedMs(start);
+	remove(path);
+
+	BenchReport("tiled_image")
+		.Count("width", width)
+		.Count("height", height)
+		.Count("tile", tileSize)
+		.Count("tiles", grid.Count())
+		.Count("ring", ring)
+		.Count("writers", writers)
+		.Value("tiled_ms", tiledMs)
+		.Value("untiled_encode_ms", untiledMs)
+		.Value("tiled_memory_mb", source.Bytes() / (1024.0 * 1024.0))
+		.Value("untiled_memory_mb", (pixels.size() + reference.size()) / (1024.0 * 1024.0))
+		.Count("stalls", stats.stalls)
+		.Print();
+}
+
+// Producers push their own numbered records into a small ring, retrying while it is full,
+// and the consumer pops them one by one. The ring wraps thousands of times under contention.
+static void BenchChangeQueueStress(unsigned producers, size_t capacity, size_t eventsPerProducer)
+{
+	SceneChangeQueue queue(capacity);
+	size_t received = 0;
+	std::atomic<uint64_t> retries{ 0 };
+
+	auto start = BenchClock::now();
+	std::vector<std::thread> threads;
+	for (unsigned p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&, p]
+		{
+			uint64_t full = 0;
+			for (size_t i = 0; i < eventsPerProducer; i++)
+			{
+				SceneChange change = { MakeBoundsKey(p, (uint32_t)i), (SceneChangeType)(i % 2) };
+				while (!queue.Push(change))
+				{
+					full++;
+					std::this_thread::yield();
+				}
+			}
+			retries += full;
+		});
+	}
+
+	size_t total = (size_t)producers * eventsPerProducer;
+	SceneChange change;
+	while (received < total)
+	{
+		if (queue.Pop(change))
+			received++;
+		else
+			std::this_thread::yield();
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	double ms = ElapsedMs(start);
+
+	BenchReport("change_queue_stress")
+		.Count("producers", producers)
+		.Count("capacity", queue.Capacity())
+		.Count("events", total)
+		.Count("full_retries", retries.load())
+		.Value("ms", ms)
+		.Print();
+}
+
+// Producers report dirty objects as fast as they can, a few thousand objects each touched
+// many times, while the consumer drains and coalesces like the render thread does. A push
+// into a full ring is retried, full_pushes counts them.
+static void BenchChangeQueueThroughput(unsigned producers, size_t totalEvents, uint32_t objectCount)
+{
+	SceneChangeQueue queue;
+	size_t eventsPerProducer = totalEvents / producers;
+	std::atomic<unsigned> running{ producers };
+
+	auto start = BenchClock::now();
+	std::vector<std::thread> threads;
+	for (unsigned p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&, p]
+		{
+			for (size_t i = 0; i < eventsPerProducer; i++)
+			{
+				uint32_t h = (uint32_t)(i * producers + p) * 0x9e3779b1u;
+				uint32_t object = (h ^ h >> 16) % objectCount;
+				while (!queue.Push(kChangeDirty, MakeBoundsKey(object, 0)))
+					std::this_thread::yield();
+			}
+			running--;
+		});
+	}
+
+	SceneChangeBatch batch;
+	size_t drained = 0, drains = 0, coalesced = 0;
+	for (;;)
+	{
+		bool done = running.load() == 0;
+		if (queue.Drain(batch) > 0)
+		{
+			drained += batch.events;
+			coalesced += batch.dirty.size();
+			drains++;
+		}
+		else if (done)
+		{
+			break;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	double ms = ElapsedMs(start);
+	for (std::thread& thread : threads)
+		thread.join();
+
+	BenchReport("change_queue")
+		.Count("producers", producers)
+		.Count("events", drained)
+		.Count("objects", objectCount)
+		.Value("ms", ms)
+		.Value("events_per_s", drained * 1000.0 / ms)
+		.Count("drains", drains)
+		.Count("coalesced", coalesced)
+		.Count("full_pushes", queue.Dropped())
+		.Print();
+}
+
+static uint32_t AddBenchTarget(PassGraph& graph, const char* name, uint32_t format, float scale, bool imported = false)
+{
+	PassTargetDesc desc;
+	desc.name = name;
+	desc.format = format;
+	desc.bytesPerPixel = format == 2 ? 8 : 4;
+	desc.scale = scale;
+	desc.imported = imported;
+	return graph.AddTarget(desc);
+}
+
+// A pass graph of passCount passes over targetCount targets in three formats and two
+// sizes: each pass reads up to three targets written before and writes one or two
+static void RandomPassGraph(std::mt19937& rng, size_t passCount, size_t targetCount, PassGraph& graph)
+{
+	std::vector<bool> written(targetCount, false);
+	std::vector<uint32_t> writtenList;
+	for (size_t t = 0; t < targetCount; t++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "t%zu", t);
+		AddBenchTarget(graph, name, (uint32_t)(rng() % 3), rng() % 2 ? 1.0f : 0.5f, t < 2);
+	}
+
+	for (size_t p = 0; p < passCount; p++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "p%zu", p);
+		uint32_t pass = graph.AddPass(name, p + 1 == passCount);
+
+		size_t reads = writtenList.empty() ? 0 : rng() % 4;
+		for (size_t r = 0; r < reads; r++)
+			graph.Read(pass, writtenList[rng() % writtenList.size()]);
+
+		size_t writes = 1 + rng() % 2;
+		uint32_t first = PassGraph::kNone;
+		for (size_t w = 0; w < writes; w++)
+		{
+			uint32_t t = (uint32_t)(rng() % targetCount);
+			if (t == first)
+				continue;
+			first = t;
+			graph.Access(pass, t, written[t] && rng() % 2 ? kAccessWrite : kAccessOverwrite);
+			if (!written[t])
+				writtenList.push_back(t);
+			written[t] = true;
+		}
+	}
+}
+
+static void ReportPassGraph(const char* name, const PassGraph& graph, double compileMs)
+{
+	size_t culled = graph.PassCount() - graph.Order().size();
+	size_t used = 0;
+	for (uint32_t t = 0; t < graph.TargetCount(); t++)
+		used += graph.Physical(t) != PassGraph::kNone;
+
+	BenchReport("pass_graph")
+		.Text("graph", name)
+		.Count("passes", graph.PassCount())
+		.Count("culled", culled)
+		.Count("targets", used)
+		.Count("physical", graph.PhysicalCount())
+		.Value("mb_1080p", graph.Bytes(1920, 1080) / (1024.0 * 1024.0))
+		.Value("unaliased_mb_1080p", graph.UnaliasedBytes(1920, 1080) / (1024.0 * 1024.0))
+		.Value("compile_ms", compileMs)
+		.Print();
+}
+
+// The viewport's graph as GarlandRenderOverride declares it, the same with effect passes
+// and a debug view nothing presents, then random graphs
+static void BenchPassGraph(int iterations)
+{
+	const uint32_t kRgba8 = 0, kDepth = 1, kR8 = 3;
+	{
+		PassGraph graph;
+		uint32_t color = AddBenchTarget(graph, "color", kRgba8, 1.0f);
+		uint32_t depth = AddBenchTarget(graph, "depth", kDepth, 1.0f);
+		uint32_t pass = graph.AddPass("Clear");
+		graph.Overwrite(pass, color);
+		graph.Overwrite(pass, depth);
+		for (const char* name : { "Scene", "CustomScene", "HUD" })
+		{
+			pass = graph.AddPass(name);
+			graph.Write(pass, color);
+			graph.Write(pass, depth);
+		}
+		pass = graph.AddPass("Present", true);
+		graph.Read(pass, color);
+		graph.Read(pass, depth);
+
+		auto start = BenchClock::now();
+		graph.Compile();
+		ReportPassGraph("viewport", graph, ElapsedMs(start));
+	}
+
+	{
+		PassGraph graph;
+		uint32_t color = AddBenchTarget(graph, "color", kRgba8, 1.0f);
+		uint32_t depth = AddBenchTarget(graph, "depth", kDepth, 1.0f);
+		uint32_t normals = AddBenchTarget(graph, "normals", kRgba8, 1.0f);
+		uint32_t ao = AddBenchTarget(graph, "ao", kR8, 0.5f);
+		uint32_t aoBlur = AddBenchTarget(graph, "aoBlur", kR8, 0.5f);
+		uint32_t aoUp = AddBenchTarget(graph, "aoUp", kR8, 1.0f);
+		uint32_t outline = AddBenchTarget(graph, "outline", kRgba8, 1.0f);
+		uint32_t debug = AddBenchTarget(graph, "debug", kRgba8, 1.0f);
+		uint32_t output = AddBenchTarget(graph, "output", kRgba8, 1.0f);
+
+		uint32_t pass = graph.AddPass("Clear");
+		graph.Overwrite(pass, color);
+		graph.Overwrite(pass, depth);
+		pass = graph.AddPass("Scene");
+		graph.Write(pass, color);
+		graph.Write(pass, depth);
+		pass = graph.AddPass("Normals");
+		graph.Read(pass, depth);
+		graph.Overwrite(pass, normals);
+		pass = graph.AddPass("SSAO");
+		graph.Read(pass, depth);
+		graph.Read(pass, normals);
+		graph.Overwrite(pass, ao);
+		pass = graph.AddPass("SSAOBlurX");
+		graph.Read(pass, ao);
+		graph.Overwrite(pass, aoBlur);
+		pass = graph.AddPass("SSAOBlurY");
+		graph.Read(pass, aoBlur);
+		graph.Overwrite(pass, ao);
+		pass = graph.AddPass("SSAOUpsample");
+		graph.Read(pass, ao);
+		graph.Read(pass, depth);
+		graph.Overwrite(pass, aoUp);
+		pass = graph.AddPass("DebugNormals");
+		graph.Read(pass, normals);
+		graph.Overwrite(pass, debug);
+		pass = graph.AddPass("Outline");
+		graph.Read(pass, depth);
+		graph.Overwrite(pass, outline);
+		pass = graph.AddPass("Composite");
+		graph.Read(pass, color);
+		graph.Read(pass, aoUp);
+		graph.Read(pass, outline);
+		graph.Overwrite(pass, output);
+		pass = graph.AddPass("HUD");
+		graph.Write(pass, output);
+		pass = graph.AddPass("Present", true);
+		graph.Read(pass, output);
+
+		auto start = BenchClock::now();
+		graph.Compile();
+		ReportPassGraph("effects", graph, ElapsedMs(start));
+	}
+
+	std::mt19937 rng(11);
+	for (size_t passCount : { 50, 1000 })
+	{
+		size_t physical = 0, used = 0;
+		double bytes = 0.0, unaliased = 0.0, bestMs = DBL_MAX;
+		int graphs = std::max(iterations, 1) * 20;
+		for (int i = 0; i < graphs; i++)
+		{
+			PassGraph graph;
+			RandomPassGraph(rng, passCount, passCount / 2, graph);
+			auto start = BenchClock::now();
+			graph.Compile();
+			bestMs = std::min(bestMs, ElapsedMs(start));
+			physical += graph.PhysicalCount();
+			for (uint32_t t = 0; t < graph.TargetCount(); t++)
+				used += graph.Physical(t) != PassGraph::kNone;
+			bytes += graph.Bytes(1920, 1080);
+			unaliased += graph.UnaliasedBytes(1920, 1080);
+		}
+
+		BenchReport("pass_graph")
+			.Text("graph", "random")
+			.Count("passes", passCount)
+			.Count("graphs", graphs)
+			.Value("targets_avg", (double)used / graphs)
+			.Value("physical_avg", (double)physical / graphs)
+			.Value("memory_ratio", unaliased > 0.0 ? bytes / unaliased : 1.0)
+			.Value("compile_ms", bestMs)
+			.Print();
+	}
+}
+
+// A cache of GPU buffers with CPU copies, tracked like MeshCache and evicted least recently
+// drawn first, except what the last keepFrames frames drew
+class BenchMeshCache : public ResourceEvictor
+{
+public:
+	BenchMeshCache(ResourceRegistry& registry, size_t objectCount, uint64_t keepFrames)
+		: _registry(registry), _entries(objectCount), _keepFrames(keepFrames) {}
+
+	~BenchMeshCache()
+	{
+		for (Entry& entry : _entries)
+		{
+			_registry.Untrack(entry.gpu);
+			_registry.Untrack(entry.cpu);
+		}
+	}
+
+	// True when the object was cached
+	bool Draw(uint32_t object, size_t bytes)
+	{
+		Entry& entry = _entries[object];
+		entry.lastFrame = _frame;
+		if (entry.gpu)
+			return true;
+		entry.gpu = _registry.Track(kResourceMeshes, bytes);
+		entry.cpu = _registry.Track(kResourceMeshData, bytes / 2);
+		entry.gpuBytes = bytes;
+		entry.cpuBytes = bytes / 2;
+		return false;
+	}
+
+	size_t Evict(ResourceMemory memory, size_t bytes) override
+	{
+		_order.clear();
+		for (uint32_t i = 0; i < (uint32_t)_entries.size(); i++)
+		{
+			if (_entries[i].gpu && _frame - _entries[i].lastFrame >= _keepFrames)
+				_order.push_back(std::make_pair(_entries[i].lastFrame, i));
+		}
+		std::sort(_order.begin(), _order.end());
+
+		size_t freed = 0;
+		for (const std::pair<uint64_t, uint32_t>& candidate : _order)
+		{
+			if (freed >= bytes)
+				break;
+			Entry& entry = _entries[candidate.second];
+			size_t gpuBytes = _registry.Untrack(entry.gpu);
+			size_t cpuBytes = _registry.Untrack(entry.cpu);
+			entry.gpuBytes = 0;
+			entry.cpuBytes = 0;
+			freed += memory == kMemoryGpu ? gpuBytes : cpuBytes;
+		}
+		return freed;
+	}
+
+	inline void SetFrame(uint64_t frame) { _frame = frame; }
+
+protected:
+	struct Entry
+	{
+		ResourceHandle gpu = 0;
+		ResourceHandle cpu = 0;
+		size_t gpuBytes = 0;
+		size_t cpuBytes = 0;
+		uint64_t lastFrame = 0;
+	};
+
+	ResourceRegistry& _registry;
+	std::vector<Entry> _entries;
+	uint64_t _keepFrames;
+	uint64_t _frame = 1;
+	std::vector<std::pair<uint64_t, uint32_t>> _order;
+};
+
+// Frames drawing a skewed working set out of objectCount meshes, the camera moving over
+// the scene, with a GPU budget of budgetMB and a fixed part (targets, rings) tracked
+// beside the cache
+static void BenchResourceRegistry(size_t objectCount, size_t drawsPerFrame, double budgetMB, int frames)
+{
+	const double kMB = 1024.0 * 1024.0;
+	ResourceRegistry registry;
+	ResourceHandle targets = registry.Track(kResourceRenderTargets, 64 * 1024 * 1024);
+	ResourceHandle rings = registry.Track(kResourceBuffers, 9 * 1024 * 1024);
+	ResourceHandle arena = 0;
+
+	size_t hits = 0, draws = 0, overBudget = 0;
+	uint64_t allocations = 0, frees = 0;
+	double ms = 0.0;
+	{
+		BenchMeshCache cache(registry, objectCount, 1);
+		registry.AddEvictor(kMemoryGpu, &cache);
+		registry.SetBudget(kMemoryGpu, (size_t)(budgetMB * kMB));
+
+		std::mt19937 rng(7);
+		auto start = BenchClock::now();
+		for (int frame = 1; frame <= frames; frame++)
+		{
+			cache.SetFrame((uint64_t)frame);
+
+			// Most draws near the camera position, which walks through the scene
+			size_t center = (size_t)frame * objectCount / (size_t)(frames / 4 + 1);
+			std::normal_distribution<double> spread(0.0, objectCount / 40.0);
+			for (size_t d = 0; d < drawsPerFrame; d++)
+			{
+				size_t object = (size_t)(center + (int64_t)spread(rng) + objectCount * 4) % objectCount;
+				size_t bytes = 64 * 1024 + (object * 2654435761u) % (1024 * 1024);
+				hits += cache.Draw((uint32_t)object, bytes);
+				draws++;
+			}
+			registry.Set(arena, kResourceFrameArena, (size_t)(drawsPerFrame * 8 * (1.0 + (frame % 7) / 7.0)));
+
+			registry.EnforceBudget();
+			registry.EndFrame();
+
+			overBudget += registry.Bytes(kMemoryGpu) > registry.Budget(kMemoryGpu);
+
+			ResourceChurn churn = registry.LastFrame(kMemoryGpu);
+			allocations += churn.allocations;
+			frees += churn.frees;
+		}
+		ms = ElapsedMs(start);
+		registry.RemoveEvictor(&cache);
+	}
+
+	registry.Untrack(targets);
+	registry.Untrack(rings);
+	registry.Untrack(arena);
+
+	BenchReport("resource_registry")
+		.Count("objects", objectCount)
+		.Count("draws_per_frame", drawsPerFrame)
+		.Value("budget_mb", budgetMB)
+		.Count("frames", frames)
+		.Value("hit_rate", draws ? (double)hits / draws : 0.0)
+		.Value("peak_gpu_mb", registry.PeakBytes(kMemoryGpu) / kMB)
+		.Value("evicted_mb", registry.EvictedBytes(kMemoryGpu) / kMB)
+		.Value("allocations_per_frame", (double)allocations / frames)
+		.Value("frees_per_frame", (double)frees / frames)
+		.Count("over_budget_frames", overBudget)
+		.Value("frame_us", ms * 1000.0 / frames)
+		.Print();
+}
+
+// Track and Untrack from several threads at once, as the pipeline thread does while the
+// render thread draws. Every thread keeps a window of live handles.
+static void BenchResourceRegistryThreads(unsigned threadCount, size_t operationsPerThread)
+{
+	ResourceRegistry registry;
+
+	auto start = BenchClock::now();
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&, t]
+		{
+			const size_t kWindow = 64;
+			ResourceHandle live[kWindow] = {};
+			ResourceCategory category = (ResourceCategory)(t % kResourceCategoryCount);
+			for (size_t i = 0; i < operationsPerThread; i++)
+			{
+				size_t slot = i % kWindow;
+				registry.Untrack(live[slot]);
+				live[slot] = registry.Track(category, 256 + (i * 40503u) % 65536);
+			}
+			for (size_t slot = 0; slot < kWindow; slot++)
+				registry.Untrack(live[slot]);
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	double ms = ElapsedMs(start);
+
+	size_t operations = 2 * operationsPerThread * threadCount;
+
+	BenchReport("resource_registry_threads")
+		.Count("threads", threadCount)
+		.Count("operations", operations)
+		.Value("ms", ms)
+		.Value("ns_per_op", ms * 1e6 / operations)
+		.Print();
+}
+
+// Simulates a GPU running `latency` frames behind the CPU and reports how often the ring
+// had to be discarded
+static void BenchRingAllocator(size_t allocationsPerFrame, int frames)
+{
+	const size_t capacity = 1024 * 1024;
+	const uint64_t latency = 3;
+
+	RingAllocator ring(capacity);
+	std::mt19937 rng(42);
+	size_t failures = 0, allocations = 0;
+
+	auto start = BenchClock::now();
+	for (uint64_t frame = 0; frame < (uint64_t)frames; frame++)
+	{
+		if (frame >= latency)
+			ring.Retire(frame - latency);
+
+		for (size_t i = 0; i < allocationsPerFrame; i++)
+		{
+			size_t size = 16 + rng() % 512;
+			size_t offset = ring.Allocate(size, 256);
+			if (offset == RingAllocator::kInvalidOffset)
+			{
+				// What DxRingBuffer does: discard the buffer and start over
+				failures++;
+				ring.Reset(capacity);
+				ring.Allocate(size, 256);
+			}
+			allocations++;
+		}
+		ring.EndFrame(frame);
+	}
+
+	BenchReport("ring_allocator")
+		.Count("allocations", allocations)
+		.Count("frames", frames)
+		.Value("total_ms", ElapsedMs(start))
+		.Count("discards", failures)
+		.Print();
+}
+
+// Replays panel resizes at 60 Hz: a drag of the panel edge, two panels of different sizes
+// drawn alternately, then the panel left alone. Counts the reallocations a target sized to
+// the viewport would do against the pooled sizing.
+static void BenchTargetSizing(const char* pattern, unsigned bucket, double shrinkDelay)
+{
+	RenderTargetSizing::Settings settings;
+	settings.bucket = bucket;
+	settings.shrinkDelay = shrinkDelay;
+	RenderTargetSizing sizing(settings);
+
+	const double frameTime = 1.0 / 60.0;
+	const int frames = 600;
+	bool drag = strcmp(pattern, "drag") == 0;
+
+	uint64_t exactReallocations = 0;
+	unsigned lastWidth = 0, lastHeight = 0;
+	double pooledArea = 0.0, viewportArea = 0.0;
+
+	for (int f = 0; f < frames; f++)
+	{
+		unsigned width, height;
+		if (drag)
+		{
+			// 3 seconds of dragging back and forth between 800 and 1600 pixels, then still
+			double t = std::min(f * frameTime, 3.0);
+			width = (unsigned)(1200.0 + 400.0 * sin(t * 4.0));
+			height = (unsigned)(900.0 - 100.0 * sin(t * 3.0));
+		}
+		else
+		{
+			// Two panels drawn every frame, the second one closed after 4 seconds
+			bool second = (f % 2 == 1) && f * frameTime < 4.0;
+			width = second ? 640 : 1920;
+			height = second ? 480 : 1080;
+		}
+
+		if (width != lastWidth || height != lastHeight)
+			exactReallocations++;
+		lastWidth = width;
+		lastHeight = height;
+
+		sizing.Request(width, height, f * frameTime);
+
+		pooledArea += (double)sizing.Width() * sizing.Height();
+		viewportArea += (double)width * height;
+	}
+
+	BenchReport("rt_sizing")
+		.Text("pattern", pattern)
+		.Count("bucket", bucket)
+		.Value("shrink_delay_s", shrinkDelay)
+		.Count("frames", frames)
+		.Count("exact_reallocations", exactReallocations)
+		.Count("pooled_reallocations", sizing.Reallocations())
+		.Value("memory_overhead", pooledArea / viewportArea)
+		.Count("final_width", sizing.Width())
+		.Count("final_height", sizing.Height())
+		.Print();
+}
+
+
+struct BenchOptions
+{
+	int iterations = 5;
+	size_t maxObjects = 1000000;
+	int scene = -1;				// all of them
+	std::string filter;			// benches whose name contains it
+};
+
+static bool Selected(const BenchOptions& options, const char* bench)
+{
+	return options.filter.empty() || strstr(bench, options.filter.c_str()) != nullptr;
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--json")
+			BenchReport::SetFormat(kReportJson);
+		else if (arg == "--iterations" && hasValue)
+			options.iterations = std::max(atoi(argv[++i]), 1);
+		else if (arg == "--max-objects" && hasValue)
+			options.maxObjects = (size_t)strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--filter" && hasValue)
+			options.filter = argv[++i];
+		else if (arg == "--scene" && hasValue)
+		{
+			std::string name = argv[++i];
+			options.scene = -2;
+			for (int s = 0; s < kSceneKindCount; s++)
+			{
+				if (name == SceneKindName((SceneKind)s))
+					options.scene = s;
+			}
+			if (options.scene == -2)
+				return false;
+		}
+		else if (arg[0] != '-')
+			options.iterations = std::max(atoi(arg.c_str()), 1);	// old form: GarlandBench N
+		else
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		fprintf(stderr, "usage: GarlandBench [--iterations N] [--max-objects N] [--scene grid|clustered|hierarchy] [--filter name] [--json]\n");
+		return 1;
+	}
+
+	for (size_t count : { 1000, 10000, 100000, 1000000 })
+	{
+		if (count > options.maxObjects)
+			break;
+
+		for (int s = 0; s < kSceneKindCount; s++)
+		{
+			if (options.scene >= 0 && options.scene != s)
+				continue;
+
+			BenchScene scene;
+			scene.kind = (SceneKind)s;
+			scene.objects = GenerateScene(scene.kind, count);
+
+			if (Selected(options, "scene_update"))
+				BenchSceneUpdate(scene, options.iterations);
+			if (Selected(options, "bvh"))
+				BenchBvh(scene, options.iterations);
+			if (Selected(options, "draw_list"))
+				BenchDrawList(scene, options.iterations);
+			if (Selected(options, "draw_items"))
+				BenchDrawItems(scene, options.iterations);
+			if (Selected(options, "transform_batch"))
+				BenchTransformBatch(scene, options.iterations);
+			if (Selected(options, "instance_buffer"))
+				BenchInstanceBuffer(scene, options.iterations);
+		}
+
+		if (Selected(options, "draw_commands"))
+			BenchDrawCommands(count, options.iterations);
+	}
+
+	if (Selected(options, "frame_arena"))
+		BenchFrameArena(options.iterations);
+
+	if (Selected(options, "rt_sizing"))
+	{
+		for (const char* pattern : { "drag", "two_panels" })
+		{
+			BenchTargetSizing(pattern, 64, 1.0);
+			BenchTargetSizing(pattern, 128, 2.0);
+			BenchTargetSizing(pattern, 256, 2.0);
+		}
+	}
+
+	if (Selected(options, "shader_table"))
+		BenchShaderTable(1000000);
+
+	if (Selected(options, "mesh_simplify") || Selected(options, "lod_builder"))
+	{
+		for (size_t triangles : { 20000, 200000, 1000000 })
+		{
+			if (triangles <= options.maxObjects)
+				BenchMeshSimplify(triangles, options.iterations);
+		}
+	}
+
+	if (Selected(options, "occlusion"))
+		BenchOcclusion(std::min<size_t>(options.maxObjects, 100000), options.iterations);
+
+	if (Selected(options, "overlay_cache"))
+	{
+		for (const char* pattern : { "idle", "orbit", "edit", "uploads" })
+			BenchOverlayCache(pattern, 1000);
+	}
+
+	if (Selected(options, "resolution_controller"))
+	{
+		BenchResolutionController("light", 8.0, 10.0, 33.3);
+		BenchResolutionController("heavy", 10.0, 90.0, 33.3);
+		BenchResolutionController("too_heavy", 40.0, 60.0, 33.3);
+	}
+
+	if (Selected(options, "readback"))
+	{
+		// Writing takes three frames: one writer cannot keep up whatever the ring
+		for (uint32_t ring : { 1u, 3u, 6u })
+		{
+			for (unsigned writers : { 1u, 2u, 4u })
+				BenchReadback(ring, writers, 120, 4.0, 12.0);
+		}
+	}
+
+	if (Selected(options, "tiled_image"))
+	{
+		// Edge tiles cut by the image, then 8K and 16K wide images
+		BenchTiledImage(1000, 700, 256, 3, 2);
+		BenchTiledImage(8192, 4608, 1024, 3, 2);
+		BenchTiledImage(16384, 9216, 2048, 3, 4);
+	}
+
+	if (Selected(options, "change_queue"))
+	{
+		for (unsigned producers : { 2u, 8u, 16u })
+			BenchChangeQueueStress(producers, 1024, 200000);
+		for (unsigned producers : { 1u, 2u, 4u, 8u, 16u })
+			BenchChangeQueueThroughput(producers, 4000000, 5000);
+	}
+
+	if (Selected(options, "pass_graph"))
+		BenchPassGraph(options.iterations);
+
+	if (Selected(options, "resource_registry"))
+	{
+		// The working set fits, then needs about twice the budget, then the budget is tiny
+		BenchResourceRegistry(5000, 200, 512.0, 2000);
+		BenchResourceRegistry(5000, 400, 256.0, 2000);
+		BenchResourceRegistry(5000, 400, 64.0, 2000);
+		for (unsigned threads : { 1u, 2u, 4u })
+			BenchResourceRegistryThreads(threads, 500000);
+	}
+
+	if (Selected(options, "upload_scheduler"))
+	{
+		BenchUploadScheduler(100, 4 * 1024 * 1024);
+		BenchUploadScheduler(100, 16 * 1024 * 1024);
+	}
+
+	if (Selected(options, "ring_allocator"))
+	{
+		BenchRingAllocator(256, 2000);
+		BenchRingAllocator(2048, 2000);
+	}
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include "PerfCounter.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+CacheMissCounter::CacheMissCounter()
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+	if (_fd >= 0)
+		close(_fd);
+}
+
+void CacheMissCounter::Start()
+{
+	if (_fd < 0)
+		return;
+	ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+uint64_t CacheMissCounter::Stop()
+{
+	if (_fd < 0)
+		return 0;
+	ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+	uint64_t misses = 0;
+	if (read(_fd, &misses, sizeof(misses)) != (ssize_t)sizeof(misses))
+		return 0;
+	return misses;
+}
+
+#else
+
+CacheMissCounter::CacheMissCounter()
+{
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+}
+
+void CacheMissCounter::Start()
+{
+}
+
+uint64_t CacheMissCounter::Stop()
+{
+	return 0;
+}
+
+#endif
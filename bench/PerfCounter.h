@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+
+
+// Hardware cache misses of the calling thread, from perf_event_open on Linux. Elsewhere, or
+// when the kernel does not allow it (perf_event_paranoid, containers), Available() is false.
+class CacheMissCounter
+{
+public:
+	CacheMissCounter();
+	~CacheMissCounter();
+
+	CacheMissCounter(const CacheMissCounter&) = delete;
+	CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+	inline bool Available() const { return _fd >= 0; }
+
+	void Start();
+
+	// Misses since Start(), 0 when not available
+	uint64_t Stop();
+
+protected:
+	int _fd = -1;
+};
@@ -0,0 +1,218 @@
+#include "SyntheticScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+
+static const double kTwoPi = 6.283185307179586;
+
+static void SetIdentity(double m[4][4])
+{
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			m[r][c] = (r == c) ? 1.0 : 0.0;
+}
+
+// Rotation around Y followed by a translation, row-vector convention
+static void SetRotateYTranslate(double m[4][4], double angle, double x, double y, double z)
+{
+	double cs = cos(angle), sn = sin(angle);
+	SetIdentity(m);
+	m[0][0] = cs;
+	m[0][2] = -sn;
+	m[2][0] = sn;
+	m[2][2] = cs;
+	m[3][0] = x;
+	m[3][1] = y;
+	m[3][2] = z;
+}
+
+static void Multiply(const double a[4][4], const double b[4][4], double out[4][4])
+{
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			out[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
+}
+
+// Asymmetric box around the origin, so that the bounds matrix has a translation
+static void RandomBox(std::mt19937& rng, float minExtent, float maxExtent, SyntheticObject& o)
+{
+	std::uniform_real_distribution<float> ext(minExtent, maxExtent);
+	for (int i = 0; i < 3; i++)
+	{
+		float e = ext(rng);
+		float offset = 0.25f * ext(rng);
+		o.minPt[i] = offset - e;
+		o.maxPt[i] = offset + e;
+		o.color[i] = 1.0f;
+	}
+}
+
+static void GenerateGrid(std::vector<SyntheticObject>& objects)
+{
+	size_t side = 1;
+	while (side * side * side < objects.size())
+		side++;
+	double spacing = 200.0 / (double)side;
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		SyntheticObject& o = objects[i];
+		for (int a = 0; a < 3; a++)
+		{
+			o.minPt[a] = -0.5f;
+			o.maxPt[a] = 0.5f;
+			o.color[a] = 1.0f;
+		}
+
+		size_t x = i % side, y = (i / side) % side, z = i / (side * side);
+		SetIdentity(o.world);
+		o.world[3][0] = -100.0 + spacing * (x + 0.5);
+		o.world[3][1] = -100.0 + spacing * (y + 0.5);
+		o.world[3][2] = -100.0 + spacing * (z + 0.5);
+	}
+}
+
+static void GenerateClustered(std::vector<SyntheticObject>& objects, std::mt19937& rng)
+{
+	const int clusterCount = 32;
+	std::uniform_real_distribution<double> center(-90.0, 90.0);
+	std::normal_distribution<double> spread(0.0, 4.0);
+	std::uniform_real_distribution<double> angle(0.0, kTwoPi);
+
+	double centers[clusterCount][3];
+	for (int c = 0; c < clusterCount; c++)
+		for (int a = 0; a < 3; a++)
+			centers[c][a] = center(rng);
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		SyntheticObject& o = objects[i];
+		RandomBox(rng, 0.1f, 2.0f, o);
+
+		const double* c = centers[i % clusterCount];
+		SetRotateYTranslate(o.world, angle(rng), c[0] + spread(rng), c[1] + spread(rng), c[2] + spread(rng));
+	}
+}
+
+static void GenerateHierarchy(std::vector<SyntheticObject>& objects, std::mt19937& rng)
+{
+	const size_t depth = 24;
+	std::uniform_real_distribution<double> position(-90.0, 90.0);
+	std::uniform_real_distribution<double> angle(0.0, kTwoPi);
+
+	// Each child is offset along X, turned a little and scaled down from its parent
+	double local[4][4] = {};
+	SetRotateYTranslate(local, 0.25, 1.5, 0.5, 0.0);
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 3; c++)
+			local[r][c] *= 0.97;
+
+	double parent[4][4] = {};
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		SyntheticObject& o = objects[i];
+		RandomBox(rng, 0.3f, 1.5f, o);
+
+		if (i % depth == 0)
+		{
+			SetRotateYTranslate(o.world, angle(rng), position(rng), position(rng), position(rng));
+		}
+		else
+		{
+			Multiply(local, parent, o.world);
+		}
+
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				parent[r][c] = o.world[r][c];
+	}
+}
+
+const char* SceneKindName(SceneKind kind)
+{
+	switch (kind)
+	{
+	case kSceneGrid: return "grid";
+	case kSceneClustered: return "clustered";
+	case kSceneHierarchy: return "hierarchy";
+	default: return "unknown";
+	}
+}
+
+std::vector<SyntheticObject> GenerateScene(SceneKind kind, size_t count, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<SyntheticObject> objects(count);
+
+	switch (kind)
+	{
+	case kSceneGrid:
+		GenerateGrid(objects);
+		break;
+	case kSceneClustered:
+		GenerateClustered(objects, rng);
+		break;
+	case kSceneHierarchy:
+		GenerateHierarchy(objects, rng);
+		break;
+	default:
+		break;
+	}
+	return objects;
+}
+
+bool SyntheticBoundsSource::FetchBounds(BoundsKey key, BoundsEntry& entry)
+{
+	if (key >= _objects.size())
+		return false;
+
+	const SyntheticObject& o = _objects[(size_t)key];
+	for (int i = 0; i < 3; i++)
+	{
+		entry.minPt[i] = o.minPt[i];
+		entry.maxPt[i] = o.maxPt[i];
+	}
+	for (int r = 0; r < 4; r++)
+		for (int c = 0; c < 4; c++)
+			entry.world[r][c] = o.world[r][c];
+
+	size_t index = (size_t)key;
+	entry.type = (ShapeType)(index % kShapeTypeCount);
+	entry.flags = (index % 17 == 0) ? 0 : kBoundsVisible;
+	if (index % 11 == 0)
+		entry.flags |= kBoundsTemplated;
+	return true;
+}
+
+void MakeSphere(size_t triangles, std::vector<float>& positions, std::vector<uint32_t>& indices)
+{
+	uint32_t rings = (uint32_t)std::max(4.0, sqrt(triangles / 4.0));
+	uint32_t segments = 2 * rings;
+
+	positions.clear();
+	indices.clear();
+	for (uint32_t r = 0; r <= rings; r++)
+	{
+		double theta = 0.5 * kTwoPi * r / rings;
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			double phi = kTwoPi * s / segments;
+			double radius = 10.0 + 0.3 * sin(theta * 12.0) * cos(phi * 9.0);
+			positions.push_back((float)(radius * sin(theta) * cos(phi)));
+			positions.push_back((float)(radius * cos(theta)));
+			positions.push_back((float)(radius * sin(theta) * sin(phi)));
+		}
+	}
+
+	for (uint32_t r = 0; r < rings; r++)
+	{
+		for (uint32_t s = 0; s < segments; s++)
+		{
+			uint32_t a = r * segments + s, b = r * segments + (s + 1) % segments;
+			uint32_t c = a + segments, d = b + segments;
+			indices.insert(indices.end(), { a, c, b, b, c, d });
+		}
+	}
+}
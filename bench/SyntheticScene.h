@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "BoundsCache.h"
+
+
+struct SyntheticObject
+{
+	float minPt[3];
+	float maxPt[3];
+	double world[4][4];
+	float color[3];
+};
+
+enum SceneKind
+{
+	kSceneGrid,			// unit boxes on a regular grid, no rotation
+	kSceneClustered,	// rotated boxes packed in a few dense clusters
+	kSceneHierarchy,	// chains of nested transforms, world = local * parent
+	kSceneKindCount
+};
+
+const char* SceneKindName(SceneKind kind);
+
+// Objects spread over about [-100, 100]^3. The same kind, count and seed always give the
+// same scene, so results can be compared from one commit to the next.
+std::vector<SyntheticObject> GenerateScene(SceneKind kind, size_t count, unsigned int seed = 1234);
+
+// Bumpy UV sphere of about `triangles` triangles, radius 10, as float3 positions and
+// triangle indices
+void MakeSphere(size_t triangles, std::vector<float>& positions, std::vector<uint32_t>& indices);
+
+
+// Feeds a BoundsCache from synthetic objects, the key is the object index. A few objects
+// are hidden or templated and all the surface types are used, so that the draw list has
+// something to classify.
+class SyntheticBoundsSource : public BoundsSource
+{
+public:
+	SyntheticBoundsSource(const std::vector<SyntheticObject>& objects) : _objects(objects) {}
+
+	bool FetchBounds(BoundsKey key, BoundsEntry& entry) override;
+
+protected:
+	const std::vector<SyntheticObject>& _objects;
+};
@@ -0,0 +1,64 @@
+# The parts of the overlay pipeline that do not depend on Maya or DirectX, shared by
+# GarlandBench and GarlandTests. GARLAND_ROOT is the repository root.
+set(GARLAND_CORE_SOURCE_FILES
+   ${GARLAND_ROOT}/DrawItemStore.h
+   ${GARLAND_ROOT}/DrawItemStore.cpp
+   ${GARLAND_ROOT}/DrawList.h
+   ${GARLAND_ROOT}/DrawList.cpp
+   ${GARLAND_ROOT}/ImageWriterPool.h
+   ${GARLAND_ROOT}/ImageWriterPool.cpp
+   ${GARLAND_ROOT}/InstanceBuffer.h
+   ${GARLAND_ROOT}/InstanceBuffer.cpp
+   ${GARLAND_ROOT}/FrameArena.h
+   ${GARLAND_ROOT}/FrameArena.cpp
+   ${GARLAND_ROOT}/LodBuilder.h
+   ${GARLAND_ROOT}/LodBuilder.cpp
+   ${GARLAND_ROOT}/MeshSimplify.h
+   ${GARLAND_ROOT}/MeshSimplify.cpp
+   ${GARLAND_ROOT}/OcclusionBuffer.h
+   ${GARLAND_ROOT}/OcclusionBuffer.cpp
+   ${GARLAND_ROOT}/OcclusionBufferAVX2.cpp
+   ${GARLAND_ROOT}/OverlayCache.h
+   ${GARLAND_ROOT}/OverlayCache.cpp
+   ${GARLAND_ROOT}/PassGraph.h
+   ${GARLAND_ROOT}/PassGraph.cpp
+   ${GARLAND_ROOT}/ReadbackQueue.h
+   ${GARLAND_ROOT}/ReadbackQueue.cpp
+   ${GARLAND_ROOT}/RenderTargetSizing.h
+   ${GARLAND_ROOT}/RenderTargetSizing.cpp
+   ${GARLAND_ROOT}/ResolutionController.h
+   ${GARLAND_ROOT}/ResolutionController.cpp
+   ${GARLAND_ROOT}/ResourceRegistry.h
+   ${GARLAND_ROOT}/ResourceRegistry.cpp
+   ${GARLAND_ROOT}/RingAllocator.h
+   ${GARLAND_ROOT}/RingAllocator.cpp
+   ${GARLAND_ROOT}/DrawCommands.h
+   ${GARLAND_ROOT}/DrawCommands.cpp
+   ${GARLAND_ROOT}/BoundsCache.h
+   ${GARLAND_ROOT}/BoundsCache.cpp
+   ${GARLAND_ROOT}/Bvh.h
+   ${GARLAND_ROOT}/Bvh.cpp
+   ${GARLAND_ROOT}/SceneChangeQueue.h
+   ${GARLAND_ROOT}/SceneChangeQueue.cpp
+   ${GARLAND_ROOT}/SceneCulling.h
+   ${GARLAND_ROOT}/SceneCulling.cpp
+   ${GARLAND_ROOT}/ShaderVariants.h
+   ${GARLAND_ROOT}/ShaderVariants.cpp
+   ${GARLAND_ROOT}/StreamingImageWriter.h
+   ${GARLAND_ROOT}/StreamingImageWriter.cpp
+   ${GARLAND_ROOT}/TransformBatch.h
+   ${GARLAND_ROOT}/TransformBatch.cpp
+   ${GARLAND_ROOT}/TransformBatchAVX2.cpp
+   ${GARLAND_ROOT}/ThreadPool.h
+   ${GARLAND_ROOT}/ThreadPool.cpp
+   ${GARLAND_ROOT}/TileGrid.h
+   ${GARLAND_ROOT}/TileGrid.cpp
+   ${GARLAND_ROOT}/UploadScheduler.h
+   ${GARLAND_ROOT}/UploadScheduler.cpp
+)
+
+# Source properties are per directory, each target's CMakeLists.txt calls this
+include(${GARLAND_ROOT}/cmake/GarlandSIMD.cmake)
+macro(garland_core_enable_avx2)
+	garland_enable_avx2(${GARLAND_ROOT}/TransformBatchAVX2.cpp ${GARLAND_ROOT}/OcclusionBufferAVX2.cpp)
+endmacro()
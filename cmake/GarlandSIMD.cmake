@@ -0,0 +1,11 @@
+# Enables AVX2/FMA code generation for the given source files only. The rest of the
+# code stays baseline x64, the AVX2 kernels are picked at runtime after a CPU check.
+function(garland_enable_avx2)
+	foreach(src ${ARGN})
+		if(MSVC)
+			set_property(SOURCE ${src} APPEND PROPERTY COMPILE_OPTIONS /arch:AVX2)
+		elseif(CMAKE_SYSTEM_PROCESSOR MATCHES "x86_64|AMD64|amd64|i.86")
+			set_property(SOURCE ${src} APPEND PROPERTY COMPILE_OPTIONS -mavx2 -mfma)
+		endif()
+	endforeach()
+endfunction()
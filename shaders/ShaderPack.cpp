@@ -0,0 +1,73 @@
+// Packs the compiled overlay shaders into GarlandShaderTable.h, one byte array holding
+// every permutation, see ShaderVariants.h for the table layout.
+//
+//   ShaderPack <directory of the .cso files> <output header>
+//
+// The shaders are expected as <stage>_<key>.cso, e.g. vs_5.cso. Fails when one of the
+// shaders enumerated by ShaderVariants is missing, so CMakeLists.txt and the C++ side
+// cannot silently disagree on the permutations.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ShaderVariants.h"
+
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>& data)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	data.clear();
+	uint8_t buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		data.insert(data.end(), buffer, buffer + read);
+	fclose(file);
+	return !data.empty();
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: ShaderPack <shader directory> <output header>\n");
+		return 1;
+	}
+
+	std::vector<ShaderBlob> blobs;
+	for (const ShaderTableKey& shader : EnumerateShaders())
+	{
+		std::string path = std::string(argv[1]) + "/" + ShaderStageName(shader.stage) + "_" + std::to_string(shader.key) + ".cso";
+
+		ShaderBlob blob;
+		blob.stage = shader.stage;
+		blob.key = shader.key;
+		if (!ReadFile(path, blob.code))
+		{
+			fprintf(stderr, "ShaderPack: missing %s\n", path.c_str());
+			return 1;
+		}
+		blobs.push_back(std::move(blob));
+	}
+
+	std::vector<uint8_t> table = PackShaderTable(blobs);
+
+	FILE* out = fopen(argv[2], "w");
+	if (!out)
+	{
+		fprintf(stderr, "ShaderPack: cannot write %s\n", argv[2]);
+		return 1;
+	}
+
+	fprintf(out, "// Generated by ShaderPack, %zu shaders\n#pragma once\n\n", blobs.size());
+	fprintf(out, "alignas(4) static const unsigned char garland_shader_table[%zu] =\n{", table.size());
+	for (size_t i = 0; i < table.size(); i++)
+		fprintf(out, "%s0x%02x,", (i % 16) ? " " : "\n\t", table[i]);
+	fprintf(out, "\n};\n");
+	fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,16 @@
+// Blends the overlay layer over the target where the overlay drew something. The layer
+// covers the viewport, at full or reduced resolution (dynamic resolution), and is filtered
+// when it is smaller.
+
+Texture2D<float4> overlayLayer : register(t0);
+SamplerState layerSampler : register(s0);
+
+float4 main(float4 position : SV_POSITION, float2 uv : TEXCOORD0) : SV_Target
+{
+	float4 color = overlayLayer.Sample(layerSampler, uv);
+
+	// Cleared to 0, every overlay shader writes an alpha of 1
+	if (color.a == 0.0)
+		discard;
+	return color;
+}
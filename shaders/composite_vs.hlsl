@@ -0,0 +1,16 @@
+// Full screen triangle, the composite of a cached overlay layer (see DxOverlayLayer.h).
+// Drawn with Draw(3, 0) and no vertex buffer.
+
+struct VSOutput
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;		// 0 to 1 across the viewport, top left first
+};
+
+VSOutput main(uint vertexId : SV_VertexID)
+{
+	VSOutput output;
+	output.uv = float2((vertexId << 1) & 2, vertexId & 2);
+	output.position = float4(output.uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);
+	return output;
+}
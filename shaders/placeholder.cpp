@@ -1,3 +0,0 @@
-// I put an empty cpp file here since I don't know how to get CMake works with a HLSL only project
-// This project(ShaderCompile) will be compiled first before Garland, the shader will be compiled
-// as a header which contains compiled binary so there is no need for compiling or loading .cso file runtime!
@@ -1,10 +1,24 @@
-cbuffer ConstantBuffer : register( b0 )
+// Permutations, see ShaderVariants.h
+//   SOLID  faces shaded by their orientation, otherwise the flat color of the lines
+
+struct PSInput
 {
-	float4 diffuseMaterial = float4(0.8f, 0.2f, 0.0f, 0.0f);
-}
+	float4 position : SV_POSITION;
+	float4 color : COLOR;
+	float3 local : TEXCOORD0;
+};
 
-float4 main() : SV_Target
+float4 main(PSInput input) : SV_Target
 {
-	float4 color = diffuseMaterial;
-	return color;
+#if SOLID
+	// The cube has no normals, the face normal comes from the position derivatives
+	float3 normal = normalize(cross(ddx(input.local), ddy(input.local)));
+	float shade = 0.6 + 0.4 * abs(dot(normal, float3(0.27, 0.88, 0.39)));
+	float3 color = input.color.rgb * shade;
+#else
+	float3 color = input.color.rgb;
+#endif
+
+	// Opaque, the cached overlay layer is composited where alpha is set
+	return float4(color, 1.0);
 }
@@ -1,9 +1,51 @@
-cbuffer ConstantBuffer : register( b0 )
+// Permutations, see ShaderVariants.h
+//   INSTANCED       matrix and color per instance in slot 1, otherwise from ObjectConstants
+//   CONSTANT_COLOR  color from ObjectConstants instead of the per-instance status color
+
+cbuffer ObjectConstants : register(b0)
 {
-	matrix wvp : WorldViewProjection;
-}
+	row_major float4x4 objectWvp;	// same layout as the instance rows
+	float4 objectColor;
+};
+
+struct VSInput
+{
+	float3 vertex : POSITION;
+
+#if INSTANCED
+	// Per-instance data, see BoundsInstance in InstanceBuffer.h
+	float4 wvp0 : INSTANCE_WVP0;
+	float4 wvp1 : INSTANCE_WVP1;
+	float4 wvp2 : INSTANCE_WVP2;
+	float4 wvp3 : INSTANCE_WVP3;
+	float4 color : COLOR;
+#endif
+};
+
+struct VSOutput
+{
+	float4 position : SV_POSITION;
+	float4 color : COLOR;
+	float3 local : TEXCOORD0;	// unit cube position, the solid variant shades from it
+};
+
+VSOutput main(VSInput input)
+{
+	VSOutput output;
 
-void main(float3 vertex : POSITION, out float4 position: SV_POSITION)
-{ 
-	position = mul(float4(vertex, 1.0), wvp);
-}
\ No newline at end of file
+#if INSTANCED
+	float4x4 wvp = float4x4(input.wvp0, input.wvp1, input.wvp2, input.wvp3);
+#else
+	float4x4 wvp = objectWvp;
+#endif
+	output.position = mul(float4(input.vertex, 1.0), wvp);
+
+#if INSTANCED && !CONSTANT_COLOR
+	output.color = input.color;
+#else
+	output.color = objectColor;
+#endif
+	output.local = input.vertex;
+
+	return output;
+}
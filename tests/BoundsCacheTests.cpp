@@ -0,0 +1,183 @@
+#include <set>
+
+#include "BoundsCache.h"
+#include "GarlandTests.h"
+
+
+// Object k is a unit box moved to x = k + version, the objects in `gone` no longer exist
+class CountingSource : public BoundsSource
+{
+public:
+	bool FetchBounds(BoundsKey key, BoundsEntry& entry) override
+	{
+		fetches++;
+		if (gone.count(key))
+			return false;
+
+		for (int i = 0; i < 3; i++)
+		{
+			entry.minPt[i] = 0.0f;
+			entry.maxPt[i] = 1.0f;
+		}
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				entry.world[r][c] = r == c ? 1.0 : 0.0;
+		entry.world[3][0] = (double)(key + version);
+		entry.type = kShapeMesh;
+		entry.flags = kBoundsVisible;
+		return true;
+	}
+
+	size_t fetches = 0;
+	uint64_t version = 0;
+	std::set<BoundsKey> gone;
+};
+
+TEST(BoundsCache, AddedEntriesAreValidOnceFetched)
+{
+	BoundsCache cache;
+	CountingSource source;
+	cache.OnAdded(MakeBoundsKey(1, 0));
+	cache.OnAdded(MakeBoundsKey(2, 0));
+
+	CHECK(cache.Contains(MakeBoundsKey(1, 0)));
+	CHECK(cache.Find(MakeBoundsKey(1, 0)) == nullptr);
+	CHECK_EQUAL(2u, cache.DirtyCount());
+	uint64_t structure = cache.StructureCounter();
+
+	CHECK_EQUAL(2u, cache.Update(source));
+	CHECK_EQUAL(2u, source.fetches);
+	CHECK_EQUAL(0u, cache.DirtyCount());
+	CHECK_EQUAL(structure + 2, cache.StructureCounter());
+	CHECK_EQUAL(2u, cache.Updated().size());
+
+	const BoundsEntry* entry = cache.Find(MakeBoundsKey(2, 0));
+	CHECK(entry != nullptr);
+	CHECK(entry && entry->world[3][0] == (double)MakeBoundsKey(2, 0));
+}
+
+TEST(BoundsCache, UpdateOnlyFetchesChangedEntries)
+{
+	BoundsCache cache;
+	CountingSource source;
+	for (BoundsKey key = 0; key < 1000; key++)
+		cache.OnAdded(key);
+	cache.Update(source);
+	cache.ClearUpdated();
+
+	// Changed twice is fetched once, unknown keys are ignored
+	source.fetches = 0;
+	source.version = 100;
+	uint64_t changes = cache.ChangeCounter();
+	uint64_t structure = cache.StructureCounter();
+	cache.OnChanged(5);
+	cache.OnChanged(7);
+	cache.OnChanged(5);
+	cache.OnChanged(5000);
+	CHECK_EQUAL(2u, cache.DirtyCount());
+	CHECK(cache.ChangeCounter() > changes);
+
+	CHECK_EQUAL(2u, cache.Update(source));
+	CHECK_EQUAL(2u, source.fetches);
+	CHECK_EQUAL(structure, cache.StructureCounter());
+	CHECK_EQUAL(2u, cache.Updated().size());
+	CHECK(cache.Find(5)->world[3][0] == 105.0);
+	CHECK(cache.Find(6)->world[3][0] == 6.0);
+
+	// Nothing changed, nothing fetched
+	source.fetches = 0;
+	CHECK_EQUAL(0u, cache.Update(source));
+	CHECK_EQUAL(0u, source.fetches);
+}
+
+TEST(BoundsCache, DirtyEntriesKeepTheirLastData)
+{
+	BoundsCache cache;
+	CountingSource source;
+	cache.OnAdded(3);
+	cache.Update(source);
+
+	source.version = 10;
+	cache.OnChanged(3);
+	CHECK(cache.Find(3) != nullptr);
+	CHECK(cache.Find(3)->world[3][0] == 3.0);
+
+	cache.Update(source);
+	CHECK(cache.Find(3)->world[3][0] == 13.0);
+}
+
+TEST(BoundsCache, RemovedEntriesAreDropped)
+{
+	BoundsCache cache;
+	CountingSource source;
+	for (uint32_t instance = 0; instance < 3; instance++)
+	{
+		cache.OnAdded(MakeBoundsKey(1, instance));
+		cache.OnAdded(MakeBoundsKey(2, instance));
+	}
+	cache.Update(source);
+
+	uint64_t structure = cache.StructureCounter();
+	cache.OnRemoved(MakeBoundsKey(1, 1));
+	CHECK_EQUAL(5u, cache.Size());
+	CHECK(cache.Find(MakeBoundsKey(1, 1)) == nullptr);
+	CHECK_EQUAL(structure + 1, cache.StructureCounter());
+
+	for (uint32_t instance = 0; instance < 3; instance++)
+		cache.OnRemoved(MakeBoundsKey(2, instance));
+	CHECK_EQUAL(2u, cache.Size());
+	CHECK(!cache.Contains(MakeBoundsKey(2, 0)));
+	CHECK(cache.Contains(MakeBoundsKey(1, 2)));
+
+	// Removed while dirty: the next update skips it
+	source.fetches = 0;
+	cache.OnChanged(MakeBoundsKey(1, 0));
+	cache.OnRemoved(MakeBoundsKey(1, 0));
+	CHECK_EQUAL(0u, cache.Update(source));
+	CHECK_EQUAL(0u, source.fetches);
+	CHECK_EQUAL(1u, cache.Size());
+}
+
+TEST(BoundsCache, EntriesTheSourceLostAreDropped)
+{
+	BoundsCache cache;
+	CountingSource source;
+	cache.OnAdded(1);
+	cache.OnAdded(2);
+	cache.Update(source);
+
+	uint64_t structure = cache.StructureCounter();
+	source.gone.insert(2);
+	cache.OnChanged(2);
+	CHECK_EQUAL(0u, cache.Update(source));
+	CHECK(!cache.Contains(2));
+	CHECK(cache.Contains(1));
+	CHECK_EQUAL(structure + 1, cache.StructureCounter());
+
+	// Never fetched, so never counted as added
+	structure = cache.StructureCounter();
+	source.gone.insert(3);
+	cache.OnAdded(3);
+	cache.Update(source);
+	CHECK(!cache.Contains(3));
+	CHECK_EQUAL(structure, cache.StructureCounter());
+}
+
+TEST(BoundsCache, InvalidateAllRefetchesEverything)
+{
+	BoundsCache cache;
+	CountingSource source;
+	for (BoundsKey key = 0; key < 50; key++)
+		cache.OnAdded(key);
+	cache.Update(source);
+
+	source.fetches = 0;
+	cache.InvalidateAll();
+	CHECK_EQUAL(50u, cache.DirtyCount());
+	CHECK_EQUAL(50u, cache.Update(source));
+	CHECK_EQUAL(50u, source.fetches);
+
+	cache.Clear();
+	CHECK_EQUAL(0u, cache.Size());
+	CHECK(cache.Updated().empty());
+}
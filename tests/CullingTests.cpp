@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <vector>
+
+#include "BoundsCache.h"
+#include "Bvh.h"
+#include "GarlandTests.h"
+#include "SceneCulling.h"
+#include "SyntheticScene.h"
+#include "TransformBatch.h"
+
+
+// Camera at z = 300 looking down -z, the wide one sees the whole scene
+static const double kView[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, -300, 1 } };
+static const double kWideProjection[4][4] = { { 1.5, 0, 0, 0 }, { 0, 2.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+static const double kNarrowProjection[4][4] = { { 12.0, 0, 0, 0 }, { 0, 12.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+
+static Frustum MakeFrustum(const double projection[4][4])
+{
+	float viewProjection[4][4];
+	ComputeViewProjection(kView, projection, viewProjection);
+	return Frustum::FromViewProjection(viewProjection);
+}
+
+static bool BruteForceVisible(const Frustum& frustum, const Aabb& box)
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const float* plane = frustum.planes[p];
+		float dist = plane[3];
+		for (int a = 0; a < 3; a++)
+			dist += plane[a] * (plane[a] >= 0.0f ? box.maxPt[a] : box.minPt[a]);
+		if (dist < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+static std::vector<uint32_t> BruteForceCull(const Frustum& frustum, const std::vector<Aabb>& boxes)
+{
+	std::vector<uint32_t> visible;
+	for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+	{
+		if (BruteForceVisible(frustum, boxes[i]))
+			visible.push_back(i);
+	}
+	return visible;
+}
+
+static std::vector<uint32_t> Sorted(std::vector<uint32_t> values)
+{
+	std::sort(values.begin(), values.end());
+	return values;
+}
+
+static std::vector<Aabb> WorldBoxes(const std::vector<SyntheticObject>& objects)
+{
+	std::vector<Aabb> boxes(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+		boxes[i] = TransformAabb(objects[i].minPt, objects[i].maxPt, objects[i].world);
+	return boxes;
+}
+
+TEST(Culling, TransformedBoxContainsTheCorners)
+{
+	std::vector<SyntheticObject> objects = GenerateScene(kSceneHierarchy, 200);
+	size_t outside = 0;
+	for (const SyntheticObject& o : objects)
+	{
+		Aabb box = TransformAabb(o.minPt, o.maxPt, o.world);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			double p[3];
+			for (int a = 0; a < 3; a++)
+				p[a] = (corner >> a & 1) ? o.maxPt[a] : o.minPt[a];
+			for (int c = 0; c < 3; c++)
+			{
+				double w = p[0] * o.world[0][c] + p[1] * o.world[1][c] + p[2] * o.world[2][c] + o.world[3][c];
+				outside += w < box.minPt[c] - 1e-3 || w > box.maxPt[c] + 1e-3;
+			}
+		}
+	}
+	CHECK_EQUAL(0u, outside);
+}
+
+TEST(Culling, BvhMatchesBruteForce)
+{
+	for (int kind = 0; kind < kSceneKindCount; kind++)
+	{
+		std::vector<Aabb> boxes = WorldBoxes(GenerateScene((SceneKind)kind, 5000));
+		Bvh bvh;
+		bvh.Build(boxes.data(), boxes.size());
+		CHECK_EQUAL(boxes.size(), bvh.PrimCount());
+
+		for (const double (*projection)[4] : { kWideProjection, kNarrowProjection })
+		{
+			Frustum frustum = MakeFrustum(projection);
+			std::vector<uint32_t> visible;
+			bvh.Cull(frustum, visible);
+			CHECK(Sorted(visible) == BruteForceCull(frustum, boxes));
+
+			// The array form gives the same primitives
+			std::vector<uint32_t> array(bvh.PrimCount());
+			array.resize(bvh.Cull(frustum, array.data()));
+			CHECK(Sorted(array) == Sorted(visible));
+		}
+	}
+}
+
+// Boxes moved in and out of the narrow frustum, the tree is only refitted
+TEST(Culling, RefittedBvhMatchesBruteForce)
+{
+	std::vector<Aabb> boxes = WorldBoxes(GenerateScene(kSceneClustered, 5000));
+	Bvh bvh;
+	bvh.Build(boxes.data(), boxes.size());
+	Frustum frustum = MakeFrustum(kNarrowProjection);
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		for (uint32_t i = 0; i < 60; i++)
+		{
+			uint32_t prim = (i * 7919 + frame * 31) % (uint32_t)boxes.size();
+			Aabb& box = boxes[prim];
+			float offset[3] = { 0.0f, 0.0f, 0.0f };
+			if (i % 3 == 0)
+			{
+				// Into the middle of the view
+				for (int a = 0; a < 3; a++)
+					offset[a] = -0.5f * (box.minPt[a] + box.maxPt[a]);
+			}
+			else
+			{
+				offset[i % 3] = i % 2 ? 150.0f : -35.0f;
+			}
+			for (int a = 0; a < 3; a++)
+			{
+				box.minPt[a] += offset[a];
+				box.maxPt[a] += offset[a];
+			}
+			bvh.Update(prim, box);
+		}
+		bvh.Refit();
+
+		std::vector<uint32_t> visible;
+		bvh.Cull(frustum, visible);
+		CHECK(Sorted(visible) == BruteForceCull(frustum, boxes));
+	}
+}
+
+TEST(Culling, EmptyAndSingleBoxBvh)
+{
+	Frustum frustum = MakeFrustum(kWideProjection);
+	Bvh bvh;
+	bvh.Build(nullptr, 0);
+	std::vector<uint32_t> visible;
+	bvh.Cull(frustum, visible);
+	CHECK(visible.empty());
+
+	Aabb box = { { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f } };
+	bvh.Build(&box, 1);
+	bvh.Cull(frustum, visible);
+	CHECK_EQUAL(1u, visible.size());
+
+	// Behind the camera
+	box.minPt[2] = 400.0f;
+	box.maxPt[2] = 410.0f;
+	bvh.Update(0, box);
+	bvh.Refit();
+	visible.clear();
+	bvh.Cull(frustum, visible);
+	CHECK(visible.empty());
+}
+
+// The items culled are the ones whose world box is in the frustum, after moves (refit)
+// and removals (rebuild)
+TEST(Culling, SceneCullingFollowsTheCache)
+{
+	std::vector<SyntheticObject> objects = GenerateScene(kSceneGrid, 2000);
+	SyntheticBoundsSource source(objects);
+	BoundsCache cache;
+	for (size_t i = 0; i < objects.size(); i++)
+		cache.OnAdded(i);
+	cache.Update(source);
+
+	SceneCulling culling;
+	DrawItemStore items;
+	Frustum frustum = MakeFrustum(kNarrowProjection);
+	auto check = [&]()
+	{
+		std::vector<Aabb> boxes(items.Size());
+		for (uint32_t item = 0; item < (uint32_t)items.Size(); item++)
+		{
+			const SyntheticObject& o = objects[(size_t)items.Key(item)];
+			boxes[item] = TransformAabb(o.minPt, o.maxPt, o.world);
+		}
+
+		FrameArena arena;
+		FrameArray<uint32_t> visible = arena.Array<uint32_t>(culling.Count());
+		culling.Cull(frustum, visible);
+		CHECK(Sorted(std::vector<uint32_t>(visible.begin(), visible.end())) == BruteForceCull(frustum, boxes));
+	};
+
+	culling.Sync(cache, items);
+	CHECK_EQUAL(objects.size(), culling.Count());
+	CHECK_EQUAL(1u, culling.RebuildCount());
+	CHECK(cache.Updated().empty());
+	check();
+
+	// Moved objects only refit
+	for (size_t i = 0; i < objects.size(); i += 37)
+	{
+		objects[i].world[3][0] = 0.0;
+		objects[i].world[3][1] = 0.0;
+		cache.OnChanged(i);
+	}
+	cache.Update(source);
+	culling.Sync(cache, items);
+	CHECK_EQUAL(1u, culling.RebuildCount());
+	check();
+
+	// Removed objects rebuild
+	for (size_t i = 0; i < objects.size(); i += 5)
+		cache.OnRemoved(i);
+	cache.Update(source);
+	culling.Sync(cache, items);
+	CHECK_EQUAL(2u, culling.RebuildCount());
+	CHECK_EQUAL(objects.size() - objects.size() / 5, culling.Count());
+	CHECK(items.IndexOf(5) == DrawItemStore::kInvalidIndex);
+	check();
+}
@@ -0,0 +1,173 @@
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "DrawCommands.h"
+#include "GarlandTests.h"
+
+
+// Writes every decoded command as one line, to compare a replay with what was recorded
+class PrintingBackend : public CommandBackend
+{
+public:
+	void BindPipeline(const CmdBindPipeline& cmd) override { Add("pipeline", { cmd.pipeline }); }
+	void BindStates(const CmdBindStates& cmd) override { Add("states", { cmd.states }); }
+	void SetVertexBuffer(const CmdSetVertexBuffer& cmd) override { Add("vb", { cmd.slot, cmd.buffer, cmd.stride, cmd.offset }); }
+	void SetIndexBuffer(const CmdSetIndexBuffer& cmd) override { Add("ib", { cmd.buffer, cmd.offset, cmd.indexSize }); }
+	void SetConstants(const CmdSetConstants& cmd) override { Add("cb", { cmd.slot, cmd.stages, cmd.buffer, cmd.offset, cmd.size }); }
+	void DrawIndexedInstanced(const CmdDrawIndexedInstanced& cmd) override
+	{
+		Add("drawIndexed", { cmd.indexCount, cmd.instanceCount, cmd.startIndex, (int64_t)cmd.baseVertex, cmd.startInstance });
+	}
+	void SetTexture(const CmdSetTexture& cmd) override { Add("texture", { cmd.slot, cmd.stages, cmd.texture }); }
+	void Draw(const CmdDraw& cmd) override { Add("draw", { cmd.vertexCount, cmd.startVertex }); }
+
+	std::vector<std::string> lines;
+
+protected:
+	void Add(const char* name, std::initializer_list<int64_t> fields)
+	{
+		std::string line = name;
+		for (int64_t field : fields)
+			line += " " + std::to_string(field);
+		lines.push_back(line);
+	}
+};
+
+// Gives the tests access to the bytes of the stream
+class CorruptibleBuffer : public CommandBuffer
+{
+public:
+	inline void Truncate(size_t bytes) { _bytes.resize(bytes); }
+	inline void Poke(size_t at, uint8_t value) { _bytes[at] = value; }
+};
+
+static void RecordFrame(CommandBuffer& commands)
+{
+	commands.BindStates(1);
+	commands.BindPipeline(2);
+	commands.SetVertexBuffer(0, 10, 12, 0);
+	commands.SetIndexBuffer(11, 0, 4);
+	commands.SetConstants(0, kStageVertex | kStagePixel, 12, 256, 64);
+	commands.SetTexture(3, kStagePixel, 20);
+	commands.DrawIndexedInstanced(36, 5, 6, -2, 7);
+	commands.SetTexture(3, kStagePixel, 0);
+	commands.Draw(3, 0);
+}
+
+static void DeclareFrame(NullCommandBackend& backend)
+{
+	backend.DeclareStates(1);
+	backend.DeclarePipeline(2);
+	backend.DeclareBuffer(10, 8 * 12);
+	backend.DeclareBuffer(11, 36 * 4);
+	backend.DeclareBuffer(12, 1024);
+	backend.DeclareTexture(20);
+}
+
+TEST(DrawCommands, ReplayGivesBackWhatWasRecorded)
+{
+	CommandBuffer commands;
+	RecordFrame(commands);
+	CHECK_EQUAL(9u, commands.CommandCount());
+
+	PrintingBackend backend;
+	CHECK(ReplayCommands(commands, backend));
+	std::vector<std::string> expected = {
+		"states 1",
+		"pipeline 2",
+		"vb 0 10 12 0",
+		"ib 11 0 4",
+		"cb 0 3 12 256 64",
+		"texture 3 2 20",
+		"drawIndexed 36 5 6 -2 7",
+		"texture 3 2 0",
+		"draw 3 0",
+	};
+	CHECK(backend.lines == expected);
+
+	commands.Reset();
+	CHECK_EQUAL(0u, commands.CommandCount());
+	CHECK_EQUAL(0u, commands.ByteSize());
+}
+
+TEST(DrawCommands, MalformedStreamsAreRejected)
+{
+	CorruptibleBuffer commands;
+	RecordFrame(commands);
+	size_t size = commands.ByteSize();
+
+	// Cut in a payload: the commands before it are replayed
+	commands.Truncate(size - 2);
+	PrintingBackend truncated;
+	CHECK(!ReplayCommands(commands, truncated));
+	CHECK_EQUAL(8u, truncated.lines.size());
+
+	// Unknown type in the first header
+	commands.Reset();
+	RecordFrame(commands);
+	commands.Poke(0, 0xee);
+	PrintingBackend unknown;
+	CHECK(!ReplayCommands(commands, unknown));
+	CHECK(unknown.lines.empty());
+
+	// Payload size that does not match the type
+	commands.Reset();
+	RecordFrame(commands);
+	commands.Poke(2, 8);
+	PrintingBackend resized;
+	CHECK(!ReplayCommands(commands, resized));
+}
+
+TEST(DrawCommands, NullBackendCountsAWellFormedStream)
+{
+	NullCommandBackend backend;
+	DeclareFrame(backend);
+
+	CommandBuffer commands;
+	RecordFrame(commands);
+	CHECK(ReplayCommands(commands, backend));
+	CHECK_EQUAL(0u, backend.Errors());
+	CHECK(backend.FirstError().empty());
+	CHECK_EQUAL(9u, backend.Commands());
+	CHECK_EQUAL(2u, backend.Draws());
+	CHECK_EQUAL(6u, backend.Instances());
+	CHECK_EQUAL(36u * 5, backend.Indices());
+
+	backend.Reset();
+	CHECK_EQUAL(0u, backend.Commands());
+}
+
+TEST(DrawCommands, NullBackendReportsInvalidCommands)
+{
+	struct Case
+	{
+		void (*record)(CommandBuffer&);
+		const char* error;
+	};
+	Case cases[] = {
+		{ [](CommandBuffer& c) { c.BindPipeline(9); }, "BindPipeline: unknown pipeline" },
+		{ [](CommandBuffer& c) { c.BindStates(0); }, "BindStates: unknown states" },
+		{ [](CommandBuffer& c) { c.SetVertexBuffer(16, 10, 12, 0); }, "SetVertexBuffer: slot out of range" },
+		{ [](CommandBuffer& c) { c.SetVertexBuffer(0, 10, 12, 96); }, "SetVertexBuffer: unknown buffer or offset out of range" },
+		{ [](CommandBuffer& c) { c.SetIndexBuffer(11, 0, 1); }, "SetIndexBuffer: indices are not 16 or 32-bit" },
+		{ [](CommandBuffer& c) { c.SetConstants(0, kStageVertex, 12, 128, 64); }, "SetConstants: offset is not a multiple of 256 bytes" },
+		{ [](CommandBuffer& c) { c.SetConstants(0, 0, 12, 0, 64); }, "SetConstants: no shader stage" },
+		{ [](CommandBuffer& c) { c.SetConstants(0, kStagePixel, 12, 1024, 64); }, "SetConstants: unknown buffer or range out of bounds" },
+		{ [](CommandBuffer& c) { c.SetTexture(0, kStagePixel, 21); }, "SetTexture: unknown texture" },
+		{ [](CommandBuffer& c) { c.DrawIndexedInstanced(36, 1, 0, 0, 0); }, "DrawIndexedInstanced: no pipeline bound" },
+		{ [](CommandBuffer& c) { c.BindPipeline(2); c.BindStates(1); c.Draw(0, 0); }, "Draw: empty draw" },
+	};
+
+	for (const Case& test : cases)
+	{
+		NullCommandBackend backend;
+		DeclareFrame(backend);
+		CommandBuffer commands;
+		test.record(commands);
+		CHECK(ReplayCommands(commands, backend));
+		CHECK(backend.Errors() > 0);
+		if (backend.FirstError() != test.error)
+			TestFailed(__FILE__, __LINE__, "first error is \"" + backend.FirstError() + "\", expected \"" + test.error + "\"");
+	}
+}
@@ -0,0 +1,176 @@
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+#include "BoundsCache.h"
+#include "DrawItemStore.h"
+#include "DrawList.h"
+#include "GarlandTests.h"
+#include "SceneCulling.h"
+#include "SyntheticScene.h"
+#include "ThreadPool.h"
+
+
+static const double kView[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, -300, 1 } };
+static const double kProjection[4][4] = { { 1.5, 0, 0, 0 }, { 0, 2.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+
+static void FillCache(const std::vector<SyntheticObject>& objects, SyntheticBoundsSource& source, BoundsCache& cache)
+{
+	for (size_t i = 0; i < objects.size(); i++)
+		cache.OnAdded(i);
+	cache.Update(source);
+}
+
+// The overlay's color rules, applied to a cache entry
+static DrawItemPalette ExpectedPalette(const BoundsEntry& entry, bool active)
+{
+	if (active)
+		return kPaletteActive;
+	if (entry.flags & kBoundsTemplated)
+		return kPaletteTemplated;
+	if (entry.type == kShapeMesh)
+		return kPaletteMesh;
+	if (entry.type == kShapeNurbsSurface)
+		return kPaletteNurbsSurface;
+	return kPaletteSubdiv;
+}
+
+// The draw list built by looking up every visible key in the cache, as before the items
+static void BuildKeyedDrawList(const BoundsCache& cache, const std::vector<BoundsKey>& visible,
+	const std::unordered_set<BoundsKey>& active, InstanceBufferBuilder& instances)
+{
+	for (BoundsKey key : visible)
+	{
+		const BoundsEntry* entry = cache.Find(key);
+		if (!entry || !(entry->flags & kBoundsVisible))
+			continue;
+		const float* color = DrawItemStore::PaletteColor(ExpectedPalette(*entry, active.count(key) != 0));
+		instances.Add(entry->minPt, entry->maxPt, entry->world, color);
+	}
+}
+
+TEST(DrawItems, MirrorTheCache)
+{
+	std::vector<SyntheticObject> objects = GenerateScene(kSceneHierarchy, 3000);
+	SyntheticBoundsSource source(objects);
+	BoundsCache cache;
+	FillCache(objects, source, cache);
+
+	DrawItemStore items;
+	items.Rebuild(cache);
+	CHECK_EQUAL(objects.size(), items.Size());
+	CHECK_EQUAL(items.Size() * DrawItemStore::ItemBytes(), items.ByteSize());
+
+	size_t wrong = 0;
+	for (uint32_t item = 0; item < (uint32_t)items.Size(); item++)
+	{
+		BoundsKey key = items.Key(item);
+		const BoundsEntry* entry = cache.Find(key);
+		if (!entry || items.IndexOf(key) != item)
+		{
+			wrong++;
+			continue;
+		}
+
+		float minPt[3], maxPt[3];
+		items.Bounds(item, minPt, maxPt);
+		wrong += memcmp(minPt, entry->minPt, sizeof(minPt)) != 0 || memcmp(maxPt, entry->maxPt, sizeof(maxPt)) != 0;
+		wrong += memcmp(items.World(item), entry->world, sizeof(DrawItemStore::Matrix)) != 0;
+		wrong += items.Type(item) != entry->type;
+		wrong += ((items.Bits(item) & kItemVisible) != 0) != ((entry->flags & kBoundsVisible) != 0);
+		wrong += ((items.Bits(item) & kItemTemplated) != 0) != ((entry->flags & kBoundsTemplated) != 0);
+		wrong += items.MinPt(1)[item] != entry->minPt[1] || items.MaxPt(2)[item] != entry->maxPt[2];
+	}
+	CHECK_EQUAL(0u, wrong);
+	CHECK(items.IndexOf(objects.size()) == DrawItemStore::kInvalidIndex);
+}
+
+// Active over templated over the shape type, the previous active items go back to theirs
+TEST(DrawItems, PaletteFollowsTheColorRules)
+{
+	std::vector<SyntheticObject> objects = GenerateScene(kSceneGrid, 1000);
+	SyntheticBoundsSource source(objects);
+	BoundsCache cache;
+	FillCache(objects, source, cache);
+
+	DrawItemStore items;
+	items.Rebuild(cache);
+	auto check = [&](const std::unordered_set<BoundsKey>& active)
+	{
+		size_t wrong = 0;
+		for (uint32_t item = 0; item < (uint32_t)items.Size(); item++)
+		{
+			bool isActive = active.count(items.Key(item)) != 0;
+			wrong += items.Palette(item) != ExpectedPalette(*cache.Find(items.Key(item)), isActive);
+			wrong += ((items.Bits(item) & kItemActive) != 0) != isActive;
+		}
+		CHECK_EQUAL(0u, wrong);
+	};
+	check({});
+
+	std::unordered_set<BoundsKey> first = { 0, 11, 12, 13, 500 };
+	items.SetActive(first);
+	check(first);
+
+	// Unknown keys are ignored
+	std::unordered_set<BoundsKey> second = { 12, 22, 999, 5000 };
+	items.SetActive(second);
+	second.erase(5000);
+	check(second);
+
+	// An update keeps the active flag
+	uint32_t item = items.IndexOf(22);
+	items.Update(item, *cache.Find(22));
+	check(second);
+
+	items.Rebuild(cache);
+	check({});
+
+	CHECK(memcmp(DrawItemStore::PaletteColor(kPaletteCount), DrawItemStore::PaletteColor(kPaletteActive), 3 * sizeof(float)) == 0);
+}
+
+// The draw list streamed from the items gives the instances of the keyed lookups, in the
+// same order
+TEST(DrawItems, SameInstancesAsTheKeyedCache)
+{
+	for (int kind = 0; kind < kSceneKindCount; kind++)
+	{
+		std::vector<SyntheticObject> objects = GenerateScene((SceneKind)kind, 5000);
+		SyntheticBoundsSource source(objects);
+		BoundsCache cache;
+		FillCache(objects, source, cache);
+
+		SceneCulling culling;
+		DrawItemStore items;
+		culling.Sync(cache, items);
+		std::unordered_set<BoundsKey> active;
+		for (BoundsKey key = 0; key < objects.size(); key += 50)
+			active.insert(key);
+		items.SetActive(active);
+
+		float viewProjection[4][4];
+		ComputeViewProjection(kView, kProjection, viewProjection);
+		Frustum frustum = Frustum::FromViewProjection(viewProjection);
+		FrameArena arena;
+		FrameArray<uint32_t> visibleItems = arena.Array<uint32_t>(items.Size());
+		culling.Cull(frustum, visibleItems);
+		std::vector<BoundsKey> visibleKeys;
+		for (uint32_t item : visibleItems)
+			visibleKeys.push_back(items.Key(item));
+		CHECK(!visibleKeys.empty());
+
+		InstanceBufferBuilder keyed, packed;
+		keyed.Begin(kView, kProjection);
+		BuildKeyedDrawList(cache, visibleKeys, active, keyed);
+		keyed.Finish();
+
+		ThreadPool pool(1);
+		DrawListBuilder drawList;
+		packed.Begin(kView, kProjection);
+		drawList.Build(pool, items, visibleItems.Data(), visibleItems.Count(), packed);
+		packed.Finish();
+
+		CHECK(keyed.Count() > 0);
+		CHECK(keyed.Count() == packed.Count() && memcmp(keyed.Data(), packed.Data(), keyed.ByteSize()) == 0);
+	}
+}
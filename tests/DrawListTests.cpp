@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "BoundsCache.h"
+#include "DrawList.h"
+#include "GarlandTests.h"
+#include "SyntheticScene.h"
+#include "ThreadPool.h"
+
+
+static const double kView[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, -300, 1 } };
+static const double kProjection[4][4] = { { 1.5, 0, 0, 0 }, { 0, 2.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+
+TEST(DrawList, PoolRunsEveryChunkOnce)
+{
+	for (unsigned threads : { 1u, 3u, 8u })
+	{
+		ThreadPool pool(threads);
+		CHECK_EQUAL(threads, pool.ThreadCount());
+
+		for (size_t count : { 0, 1, 64, 10007 })
+		{
+			const size_t grain = 64;
+			std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[count + 1]);
+			for (size_t i = 0; i < count; i++)
+				runs[i] = 0;
+			std::atomic<size_t> badRanges{ 0 };
+
+			pool.ParallelFor(count, grain, [&](size_t chunk, size_t begin, size_t end)
+			{
+				if (begin != chunk * grain || end != std::min(begin + grain, count))
+					badRanges++;
+				for (size_t i = begin; i < end; i++)
+					runs[i]++;
+			});
+
+			size_t wrong = 0;
+			for (size_t i = 0; i < count; i++)
+				wrong += runs[i] != 1;
+			CHECK_EQUAL(0u, wrong);
+			CHECK_EQUAL(0u, badRanges.load());
+		}
+	}
+}
+
+// Every visible item once, in the order of `visible`, whatever the thread count
+TEST(DrawList, SameInstancesWithAnyThreadCount)
+{
+	std::vector<SyntheticObject> objects = GenerateScene(kSceneClustered, 20000);
+	SyntheticBoundsSource source(objects);
+	BoundsCache cache;
+	for (size_t i = 0; i < objects.size(); i++)
+		cache.OnAdded(i);
+	cache.Update(source);
+
+	DrawItemStore items;
+	items.Rebuild(cache);
+	std::unordered_set<BoundsKey> active;
+	for (BoundsKey key = 0; key < objects.size(); key += 50)
+		active.insert(key);
+	items.SetActive(active);
+
+	// Reversed, so that the draw order is not the item order
+	std::vector<uint32_t> visible;
+	size_t drawn = 0;
+	for (uint32_t item = (uint32_t)items.Size(); item-- > 0;)
+	{
+		visible.push_back(item);
+		drawn += (items.Bits(item) & kItemVisible) != 0;
+	}
+	CHECK(drawn < visible.size());
+
+	std::vector<BoundsInstance> reference;
+	for (unsigned threads : { 1u, 2u, 4u, 8u })
+	{
+		ThreadPool pool(threads);
+		DrawListBuilder drawList;
+		InstanceBufferBuilder instances;
+		instances.Begin(kView, kProjection);
+		drawList.Build(pool, items, visible.data(), visible.size(), instances);
+		instances.Finish(BestTransformKernel(), &pool);
+		CHECK_EQUAL(drawn, instances.Count());
+
+		if (threads == 1)
+		{
+			reference.assign(instances.Data(), instances.Data() + instances.Count());
+
+			// The first drawn item of the list, with its palette color
+			size_t first = 0;
+			while (!(items.Bits(visible[first]) & kItemVisible))
+				first++;
+			const float* color = DrawItemStore::PaletteColor(items.Palette(visible[first]));
+			CHECK(memcmp(reference[0].color, color, 3 * sizeof(float)) == 0);
+			continue;
+		}
+		CHECK(instances.Count() == reference.size() &&
+			memcmp(instances.Data(), reference.data(), instances.ByteSize()) == 0);
+	}
+}
+
+// One item per kind of shape the mesh modes meet
+class MixedShapesSource : public BoundsSource
+{
+public:
+	bool FetchBounds(BoundsKey key, BoundsEntry& entry) override
+	{
+		static const struct
+		{
+			ShapeType type;
+			unsigned char flags;
+		} kShapes[] = {
+			{ kShapeMesh, kBoundsVisible },
+			{ kShapeMesh, 0 },		// hidden, or a deformer's intermediate shape
+			{ kShapeNurbsSurface, kBoundsVisible },
+			{ kShapeMesh, kBoundsVisible | kBoundsTemplated },
+			{ kShapeMesh, 0 },
+			{ kShapeSubdiv, 0 },
+		};
+		if (key >= sizeof(kShapes) / sizeof(kShapes[0]))
+			return false;
+
+		entry = BoundsEntry();
+		for (int a = 0; a < 3; a++)
+		{
+			entry.minPt[a] = -1.0f;
+			entry.maxPt[a] = 1.0f;
+			entry.world[a][a] = 1.0;
+		}
+		entry.world[3][3] = 1.0;
+		entry.type = kShapes[key].type;
+		entry.flags = kShapes[key].flags;
+		return true;
+	}
+};
+
+static void BuildMixedShapes(DrawItemStore& items)
+{
+	BoundsCache cache;
+	MixedShapesSource source;
+	for (BoundsKey key = 0; key < 6; key++)
+		cache.OnAdded(key);
+	cache.Update(source);
+	items.Rebuild(cache);
+}
+
+// Hidden meshes are never read or uploaded, they stay in visible and the draw list drops
+// them with the other hidden items
+TEST(DrawList, HiddenMeshesAreNotDrawnAsMeshes)
+{
+	DrawItemStore items;
+	BuildMixedShapes(items);
+	uint32_t visibleMesh = items.IndexOf(0), hiddenMesh = items.IndexOf(1), templatedMesh = items.IndexOf(3);
+	CHECK(items.IsDrawnMesh(visibleMesh));
+	CHECK(!items.IsDrawnMesh(hiddenMesh));
+	CHECK(!items.IsDrawnMesh(items.IndexOf(2)));
+
+	FrameArena arena;
+	FrameArray<uint32_t> visible = arena.Array<uint32_t>(items.Size());
+	FrameArray<uint32_t> meshes = arena.Array<uint32_t>(items.Size());
+	for (uint32_t item = 0; item < (uint32_t)items.Size(); item++)
+		visible.Push(item);
+
+	std::vector<uint32_t> looked;
+	SplitMeshItems(items, visible, meshes, [&](uint32_t item)
+	{
+		looked.push_back(item);
+		return item != templatedMesh;
+	});
+
+	// The templated mesh is visible but has no GPU copy yet, it is drawn as bounds
+	std::vector<uint32_t> expectedLooked, expectedMeshes, expectedRest;
+	for (uint32_t item = 0; item < (uint32_t)items.Size(); item++)
+	{
+		if (item == visibleMesh || item == templatedMesh)
+			expectedLooked.push_back(item);
+		if (item == visibleMesh)
+			expectedMeshes.push_back(item);
+		else
+			expectedRest.push_back(item);
+	}
+	CHECK(looked == expectedLooked);
+	CHECK(std::vector<uint32_t>(meshes.begin(), meshes.end()) == expectedMeshes);
+	CHECK(std::vector<uint32_t>(visible.begin(), visible.end()) == expectedRest);
+
+	// The rest draws only its visible bounds
+	ThreadPool pool(2);
+	DrawListBuilder drawList;
+	InstanceBufferBuilder instances;
+	instances.Begin(kView, kProjection);
+	drawList.Build(pool, items, visible.Data(), visible.Count(), instances);
+	CHECK_EQUAL(2u, instances.Count());
+}
+
+// A hidden mesh, like the intermediate shape right under a deformed one, or a templated
+// one would hide objects the user sees
+TEST(DrawList, OnlyVisibleSolidMeshesOcclude)
+{
+	DrawItemStore items;
+	BuildMixedShapes(items);
+	std::vector<BoundsKey> occluders;
+	for (uint32_t item = 0; item < (uint32_t)items.Size(); item++)
+	{
+		if (items.IsOccluder(item))
+			occluders.push_back(items.Key(item));
+	}
+	CHECK(occluders == std::vector<BoundsKey>({ 0 }));
+	CHECK(items.IsDrawnMesh(items.IndexOf(3)));
+}
@@ -0,0 +1,85 @@
+// Checks of the Maya independent parts of the overlay pipeline.
+//
+//   GarlandTests [suite|Suite.Name ...]
+//
+// Runs every test, or the ones of the suites given. CTest runs one suite per test, see
+// CMakeLists.txt. Exits with 1 when a check failed or nothing matched.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "GarlandTests.h"
+
+
+struct RegisteredTest
+{
+	const char* suite;
+	const char* name;
+	TestFunction function;
+};
+
+// Filled by the static registrations of the test files, before main()
+static std::vector<RegisteredTest>& Tests()
+{
+	static std::vector<RegisteredTest> tests;
+	return tests;
+}
+
+static size_t s_failures = 0;
+
+TestRegistration::TestRegistration(const char* suite, const char* name, TestFunction function)
+{
+	Tests().push_back({ suite, name, function });
+}
+
+void TestFailed(const char* file, int line, const std::string& message)
+{
+	fprintf(stderr, "%s:%d: check failed: %s\n", file, line, message.c_str());
+	s_failures++;
+}
+
+// "Suite" selects the whole suite, "Suite.Name" one test
+static bool Selected(const RegisteredTest& test, int argc, char** argv)
+{
+	if (argc < 2)
+		return true;
+
+	size_t suiteLength = strlen(test.suite);
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		if (strncmp(arg, test.suite, suiteLength) != 0)
+			continue;
+		if (arg[suiteLength] == '\0' || (arg[suiteLength] == '.' && strcmp(arg + suiteLength + 1, test.name) == 0))
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	size_t run = 0, failed = 0;
+	for (const RegisteredTest& test : Tests())
+	{
+		if (!Selected(test, argc, argv))
+			continue;
+
+		size_t before = s_failures;
+		test.function();
+		run++;
+
+		bool ok = s_failures == before;
+		failed += !ok;
+		printf("%s.%s %s\n", test.suite, test.name, ok ? "ok" : "FAILED");
+		fflush(stdout);
+	}
+
+	if (run == 0)
+	{
+		fprintf(stderr, "no test matches\n");
+		return 1;
+	}
+	printf("%zu tests, %zu failed\n", run, failed);
+	return failed ? 1 : 0;
+}
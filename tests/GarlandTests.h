@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+
+
+// A test is a function registered as "Suite.Name". A failed CHECK prints the expression and
+// the test goes on, so one run shows everything that broke; GarlandTests then exits with 1.
+typedef void (*TestFunction)();
+
+struct TestRegistration
+{
+	TestRegistration(const char* suite, const char* name, TestFunction function);
+};
+
+void TestFailed(const char* file, int line, const std::string& message);
+
+template<class A, class B>
+void TestCheckEqual(const A& expected, const B& actual, const char* file, int line, const char* expression)
+{
+	if (expected == actual)
+		return;
+	TestFailed(file, line, std::string(expression) + " is " + std::to_string(actual) + ", expected " + std::to_string(expected));
+}
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static TestRegistration suite##_##name##_registration(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) TestFailed(__FILE__, __LINE__, #expression); } while (0)
+
+// Prints both values when they differ
+#define CHECK_EQUAL(expected, actual) \
+	TestCheckEqual((expected), (actual), __FILE__, __LINE__, #actual)
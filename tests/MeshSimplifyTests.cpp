@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "LodBuilder.h"
+#include "MeshSimplify.h"
+#include "SyntheticScene.h"
+
+
+// Indices in range, no collapsed or repeated triangle, and edges that are the unique
+// edges of the triangles
+static void CheckLod(const MeshLod& lod)
+{
+	size_t vertices = lod.positions.size() / 3;
+	CHECK_EQUAL(lod.indices.size(), (size_t)lod.triangleIndices + lod.edgeIndices);
+	CHECK_EQUAL(0u, lod.triangleIndices % 3);
+	CHECK_EQUAL(0u, lod.edgeIndices % 2);
+
+	size_t outOfRange = 0, collapsed = 0;
+	for (uint32_t index : lod.indices)
+		outOfRange += index >= vertices;
+	CHECK_EQUAL(0u, outOfRange);
+	if (outOfRange)
+		return;
+
+	std::vector<std::vector<uint32_t>> triangles;
+	std::vector<uint64_t> triangleEdges;
+	for (size_t t = 0; t < lod.triangleIndices; t += 3)
+	{
+		uint32_t a = lod.indices[t], b = lod.indices[t + 1], c = lod.indices[t + 2];
+		collapsed += a == b || b == c || a == c;
+		// Smallest index first, the winding kept: a fold can give both windings
+		std::vector<uint32_t> rotated = { a, b, c };
+		std::rotate(rotated.begin(), std::min_element(rotated.begin(), rotated.end()), rotated.end());
+		triangles.push_back(rotated);
+		for (uint32_t e = 0; e < 3; e++)
+		{
+			uint32_t x = lod.indices[t + e], y = lod.indices[t + (e + 1) % 3];
+			triangleEdges.push_back(((uint64_t)std::min(x, y) << 32) | std::max(x, y));
+		}
+	}
+	CHECK_EQUAL(0u, collapsed);
+	std::sort(triangles.begin(), triangles.end());
+	CHECK(std::adjacent_find(triangles.begin(), triangles.end()) == triangles.end());
+
+	std::sort(triangleEdges.begin(), triangleEdges.end());
+	triangleEdges.erase(std::unique(triangleEdges.begin(), triangleEdges.end()), triangleEdges.end());
+	std::vector<uint64_t> edges;
+	for (size_t e = lod.triangleIndices; e < lod.indices.size(); e += 2)
+	{
+		CHECK(lod.indices[e] < lod.indices[e + 1]);
+		edges.push_back(((uint64_t)lod.indices[e] << 32) | lod.indices[e + 1]);
+	}
+	std::sort(edges.begin(), edges.end());
+	CHECK(edges == triangleEdges);
+}
+
+TEST(MeshSimplify, LevelsAreValidAndSmaller)
+{
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	MakeSphere(20000, positions, indices);
+	size_t vertexCount = positions.size() / 3;
+
+	std::vector<MeshLod> levels;
+	BuildLods(positions.data(), vertexCount, indices.data(), indices.size(), levels);
+	CHECK_EQUAL((size_t)kLodLevelCount - 1, levels.size());
+
+	size_t previous = indices.size();
+	for (const MeshLod& lod : levels)
+	{
+		CheckLod(lod);
+		CHECK(lod.triangleIndices > 0);
+		CHECK(lod.triangleIndices < previous);
+		previous = lod.triangleIndices;
+
+		// The clusters are averages of the sphere's vertices
+		size_t outside = 0;
+		for (size_t v = 0; v < lod.positions.size(); v += 3)
+		{
+			double radius = sqrt(lod.positions[v] * lod.positions[v] + lod.positions[v + 1] * lod.positions[v + 1] +
+				lod.positions[v + 2] * lod.positions[v + 2]);
+			outside += radius > 10.31;
+		}
+		CHECK_EQUAL(0u, outside);
+	}
+}
+
+// A flat grid facing +z keeps facing +z
+TEST(MeshSimplify, KeepsTheWinding)
+{
+	const uint32_t size = 40;
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y <= size; y++)
+	{
+		for (uint32_t x = 0; x <= size; x++)
+			positions.insert(positions.end(), { (float)x, (float)y, 0.0f });
+	}
+	for (uint32_t y = 0; y < size; y++)
+	{
+		for (uint32_t x = 0; x < size; x++)
+		{
+			uint32_t a = y * (size + 1) + x, b = a + 1, c = a + size + 1, d = c + 1;
+			indices.insert(indices.end(), { a, b, d, a, d, c });
+		}
+	}
+
+	MeshLod lod;
+	SimplifyByClustering(positions.data(), positions.size() / 3, indices.data(), indices.size(), 10, lod);
+	CheckLod(lod);
+	CHECK(lod.triangleIndices > 0);
+	CHECK(lod.triangleIndices < indices.size());
+
+	size_t flipped = 0;
+	for (size_t t = 0; t < lod.triangleIndices; t += 3)
+	{
+		const float* p0 = &lod.positions[lod.indices[t] * 3];
+		const float* p1 = &lod.positions[lod.indices[t + 1] * 3];
+		const float* p2 = &lod.positions[lod.indices[t + 2] * 3];
+		float z = (p1[0] - p0[0]) * (p2[1] - p0[1]) - (p1[1] - p0[1]) * (p2[0] - p0[0]);
+		flipped += z <= 0.0f;
+	}
+	CHECK_EQUAL(0u, flipped);
+}
+
+TEST(MeshSimplify, EmptyMeshesGiveEmptyLevels)
+{
+	MeshLod lod;
+	lod.triangleIndices = 3;
+	SimplifyByClustering(nullptr, 0, nullptr, 0, 10, lod);
+	CHECK(lod.positions.empty() && lod.indices.empty());
+	CHECK_EQUAL(0u, lod.triangleIndices);
+
+	// One point: a single cluster without triangles
+	float point[3] = { 1.0f, 2.0f, 3.0f };
+	uint32_t triangle[3] = { 0, 0, 0 };
+	SimplifyByClustering(point, 1, triangle, 3, 10, lod);
+	CHECK_EQUAL(3u, lod.positions.size());
+	CHECK(lod.indices.empty());
+
+	SimplifyByClustering(point, 1, triangle, 3, 0, lod);
+	CHECK(lod.positions.empty());
+}
+
+TEST(MeshSimplify, SelectsTheLevelFromTheScreenSize)
+{
+	CHECK_EQUAL(kLodLevelCount - 1, SelectLod(0.0));
+	CHECK_EQUAL(kLodLevelCount - 1, SelectLod(2.0 * kLodGrids[kLodLevelCount - 1]));
+	CHECK_EQUAL(2, SelectLod(2.0 * kLodGrids[3] + 1.0));
+	CHECK_EQUAL(1, SelectLod(2.0 * kLodGrids[1]));
+	CHECK_EQUAL(0, SelectLod(2.0 * kLodGrids[1] + 1.0));
+	CHECK_EQUAL(0, SelectLod(DBL_MAX));
+
+	// A box of radius sqrt(3) 10 units in front of a perspective camera
+	const float minPt[3] = { -1.0f, -1.0f, -1.0f }, maxPt[3] = { 1.0f, 1.0f, 1.0f };
+	double world[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, -10, 1 } };
+	const double perspective[4][4] = { { 2, 0, 0, 0 }, { 0, 2, 0, 0 }, { 0, 0, -1, -1 }, { 0, 0, -0.1, 0 } };
+	double size = ProjectedSize(minPt, maxPt, world, perspective, 2.0, 100.0);
+	CHECK(fabs(size - sqrt(3.0) * 20.0) < 1e-6);
+
+	// Half the size twice as far, twice the size scaled by 2
+	world[3][2] = -20.0;
+	CHECK(fabs(ProjectedSize(minPt, maxPt, world, perspective, 2.0, 100.0) - size / 2.0) < 1e-6);
+	world[0][0] = world[1][1] = world[2][2] = 2.0;
+	CHECK(fabs(ProjectedSize(minPt, maxPt, world, perspective, 2.0, 100.0) - size) < 1e-6);
+
+	// Camera inside the bounding sphere
+	world[3][2] = -1.0;
+	CHECK(ProjectedSize(minPt, maxPt, world, perspective, 2.0, 100.0) == DBL_MAX);
+
+	// Orthographic, the distance does not matter
+	const double orthographic[4][4] = { { 0.1, 0, 0, 0 }, { 0, 0.1, 0, 0 }, { 0, 0, -0.01, 0 }, { 0, 0, 0, 1 } };
+	double near = ProjectedSize(minPt, maxPt, world, orthographic, 0.1, 100.0);
+	world[3][2] = -50.0;
+	CHECK(near < DBL_MAX);
+	CHECK(fabs(ProjectedSize(minPt, maxPt, world, orthographic, 0.1, 100.0) - near) < 1e-6);
+}
+
+// Every job gives one result with its key and generation, the same levels as BuildLods
+TEST(MeshSimplify, LodBuilderBuildsEveryJob)
+{
+	std::shared_ptr<LodSource> source = std::make_shared<LodSource>();
+	MakeSphere(5000, source->positions, source->triangles);
+	std::vector<MeshLod> expected;
+	BuildLods(source->positions.data(), source->positions.size() / 3, source->triangles.data(),
+		source->triangles.size(), expected);
+
+	for (unsigned threads : { 1u, 4u })
+	{
+		LodBuilder builder(threads);
+		CHECK_EQUAL(threads, builder.ThreadCount());
+		for (uint64_t key = 0; key < 12; key++)
+			builder.Submit(key, key + 100, source);
+		builder.Wait();
+		CHECK_EQUAL(0u, builder.Pending());
+
+		std::vector<LodResult> results;
+		CHECK_EQUAL(12u, builder.Collect(results));
+		CHECK_EQUAL(12u, results.size());
+		std::sort(results.begin(), results.end(), [](const LodResult& a, const LodResult& b) { return a.key < b.key; });
+		for (uint64_t key = 0; key < results.size(); key++)
+		{
+			const LodResult& result = results[(size_t)key];
+			CHECK(result.key == key && result.generation == key + 100);
+			CHECK_EQUAL(expected.size(), result.levels.size());
+			for (size_t level = 0; level < expected.size() && level < result.levels.size(); level++)
+			{
+				CHECK(result.levels[level].positions == expected[level].positions);
+				CHECK(result.levels[level].indices == expected[level].indices);
+			}
+		}
+
+		results.clear();
+		CHECK_EQUAL(0u, builder.Collect(results));
+	}
+
+	// Destroyed with jobs still queued
+	LodBuilder builder(1);
+	for (uint64_t key = 0; key < 50; key++)
+		builder.Submit(key, 1, source);
+}
@@ -0,0 +1,192 @@
+#include <cfloat>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "OcclusionBuffer.h"
+#include "SyntheticScene.h"
+#include "TransformBatch.h"
+
+
+// Camera at z = 300 looking down -z
+static const double kView[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, -300, 1 } };
+static const double kProjection[4][4] = { { 1.5, 0, 0, 0 }, { 0, 2.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+
+struct Occluders
+{
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+};
+
+// A sphere and random walls, the first wall is a 20 x 20 square centered at z = 100
+static Occluders MakeOccluders()
+{
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	Occluders occluders;
+	MakeSphere(1000, occluders.positions, occluders.indices);
+	for (size_t i = 0; i < occluders.positions.size(); i += 3)
+	{
+		occluders.positions[i] = occluders.positions[i] * 3.0f + 60.0f;
+		occluders.positions[i + 1] = occluders.positions[i + 1] * 3.0f - 40.0f;
+		occluders.positions[i + 2] = occluders.positions[i + 2] * 3.0f + 40.0f;
+	}
+
+	for (int w = 0; w < 16; w++)
+	{
+		float cx = w == 0 ? 0.0f : unit(rng) * 200.0f - 100.0f;
+		float cy = w == 0 ? 0.0f : unit(rng) * 200.0f - 100.0f;
+		float z = w == 0 ? 100.0f : unit(rng) * 100.0f;
+		float hx = w == 0 ? 10.0f : 10.0f + unit(rng) * 30.0f;
+		float hy = w == 0 ? 10.0f : 10.0f + unit(rng) * 30.0f;
+		uint32_t base = (uint32_t)(occluders.positions.size() / 3);
+		occluders.positions.insert(occluders.positions.end(),
+			{ cx - hx, cy - hy, z, cx + hx, cy - hy, z, cx + hx, cy + hy, z, cx - hx, cy + hy, z });
+		occluders.indices.insert(occluders.indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+	}
+	return occluders;
+}
+
+static void ViewProjection(float out[4][4])
+{
+	ComputeViewProjection(kView, kProjection, out);
+}
+
+static OcclusionBuffer Rasterize(const Occluders& occluders, TransformKernel kernel)
+{
+	float viewProjection[4][4];
+	ViewProjection(viewProjection);
+	OcclusionBuffer buffer(128, 64);
+	buffer.RasterizeMesh(occluders.positions.data(), occluders.positions.size() / 3, occluders.indices.data(),
+		occluders.indices.size(), viewProjection, kernel);
+	buffer.Finish();
+	return buffer;
+}
+
+// Brute force rasterization: every pixel against every triangle, with 64-bit edge
+// functions evaluated at each pixel center
+static std::vector<float> ReferenceRasterize(const OcclusionBuffer& buffer, const Occluders& occluders)
+{
+	float viewProjection[4][4];
+	ViewProjection(viewProjection);
+	size_t vertexCount = occluders.positions.size() / 3;
+	std::vector<float> clip(vertexCount * 4);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* p = &occluders.positions[i * 3];
+		for (int c = 0; c < 4; c++)
+			clip[i * 4 + c] = p[0] * viewProjection[0][c] + p[1] * viewProjection[1][c] + p[2] * viewProjection[2][c] + viewProjection[3][c];
+	}
+
+	int width = buffer.Width(), height = buffer.Height();
+	std::vector<float> depth((size_t)width * height, FLT_MAX);
+	const std::vector<uint32_t>& indices = occluders.indices;
+	for (size_t t = 0; t + 3 <= indices.size(); t += 3)
+	{
+		OcclusionTriangle tri;
+		if (!buffer.SetupTriangle(&clip[indices[t] * 4], &clip[indices[t + 1] * 4], &clip[indices[t + 2] * 4], tri))
+			continue;
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				int64_t px = x * OcclusionBuffer::kSubpixels + OcclusionBuffer::kSubpixels / 2;
+				int64_t py = y * OcclusionBuffer::kSubpixels + OcclusionBuffer::kSubpixels / 2;
+				bool inside = true;
+				for (int e = 0; e < 3; e++)
+					inside = inside && (int64_t)tri.a[e] * px + (int64_t)tri.b[e] * py + tri.c[e] >= 0;
+				float& d = depth[(size_t)y * width + x];
+				if (inside && tri.depth < d)
+					d = tri.depth;
+			}
+		}
+	}
+	return depth;
+}
+
+TEST(Occlusion, SizesAreWholeTiles)
+{
+	OcclusionBuffer buffer(100, 3);
+	CHECK_EQUAL(104, buffer.Width());
+	CHECK(buffer.Height() == OcclusionBuffer::kTileSize);
+
+	OcclusionBuffer large(4000, 4000);
+	CHECK(large.Width() == OcclusionBuffer::kMaxSize);
+	CHECK(large.Height() == OcclusionBuffer::kMaxSize);
+}
+
+// Bit for bit the same depths as the brute force rasterization, with every kernel
+TEST(Occlusion, RasterizersMatchTheReference)
+{
+	Occluders occluders = MakeOccluders();
+	OcclusionBuffer scalar = Rasterize(occluders, kTransformScalar);
+	std::vector<float> reference = ReferenceRasterize(scalar, occluders);
+	size_t pixels = (size_t)scalar.Width() * scalar.Height();
+
+	size_t covered = 0;
+	for (size_t p = 0; p < pixels; p++)
+		covered += reference[p] < FLT_MAX;
+	CHECK(covered > pixels / 10 && covered < pixels);
+	CHECK(scalar.TriangleCount() > 0);
+	CHECK(memcmp(scalar.Depth(), reference.data(), pixels * sizeof(float)) == 0);
+
+	if (OcclusionAVX2Compiled() && BestTransformKernel() == kTransformAVX2)
+	{
+		OcclusionBuffer avx2 = Rasterize(occluders, kTransformAVX2);
+		CHECK_EQUAL(scalar.TriangleCount(), avx2.TriangleCount());
+		CHECK(memcmp(avx2.Depth(), reference.data(), pixels * sizeof(float)) == 0);
+	}
+}
+
+// The tiled box test gives the same answers as reading every pixel
+TEST(Occlusion, TiledTestMatchesPerPixel)
+{
+	OcclusionBuffer buffer = Rasterize(MakeOccluders(), kTransformScalar);
+	float viewProjection[4][4];
+	ViewProjection(viewProjection);
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	size_t occluded = 0, mismatches = 0;
+	for (int b = 0; b < 5000; b++)
+	{
+		float size = 1.0f + unit(rng) * 4.0f;
+		float minPt[3] = { unit(rng) * 200.0f - 100.0f, unit(rng) * 200.0f - 100.0f, unit(rng) * 200.0f - 200.0f };
+		float maxPt[3] = { minPt[0] + size, minPt[1] + size, minPt[2] + size };
+		bool tiled = buffer.IsOccluded(minPt, maxPt, viewProjection);
+		occluded += tiled;
+		mismatches += tiled != buffer.IsOccludedReference(minPt, maxPt, viewProjection);
+	}
+	CHECK_EQUAL(0u, mismatches);
+	CHECK(occluded > 0);
+}
+
+TEST(Occlusion, BoxesAroundAWall)
+{
+	OcclusionBuffer buffer = Rasterize(MakeOccluders(), kTransformScalar);
+	float viewProjection[4][4];
+	ViewProjection(viewProjection);
+
+	// Behind the middle of the first wall, then in front of it
+	float behindMin[3] = { -2.0f, -2.0f, 80.0f }, behindMax[3] = { 2.0f, 2.0f, 84.0f };
+	float frontMin[3] = { -2.0f, -2.0f, 110.0f }, frontMax[3] = { 2.0f, 2.0f, 114.0f };
+	CHECK(buffer.IsOccluded(behindMin, behindMax, viewProjection));
+	CHECK(!buffer.IsOccluded(frontMin, frontMax, viewProjection));
+
+	// Larger than the wall, crossing the near plane, and off screen
+	float wideMin[3] = { -30.0f, -30.0f, 80.0f }, wideMax[3] = { 30.0f, 30.0f, 84.0f };
+	float nearMin[3] = { -2.0f, -2.0f, 250.0f }, nearMax[3] = { 2.0f, 2.0f, 350.0f };
+	float awayMin[3] = { 2000.0f, -2.0f, 80.0f }, awayMax[3] = { 2004.0f, 2.0f, 84.0f };
+	CHECK(!buffer.IsOccluded(wideMin, wideMax, viewProjection));
+	CHECK(!buffer.IsOccluded(nearMin, nearMax, viewProjection));
+	CHECK(!buffer.IsOccluded(awayMin, awayMax, viewProjection));
+
+	// Nothing is occluded once cleared
+	buffer.Clear();
+	buffer.Finish();
+	CHECK_EQUAL(0u, buffer.TriangleCount());
+	CHECK(!buffer.IsOccluded(behindMin, behindMax, viewProjection));
+}
@@ -0,0 +1,100 @@
+#include <cmath>
+
+#include "GarlandTests.h"
+#include "OverlayCache.h"
+
+
+static OverlaySignature MakeSignature(double cameraZ, uint64_t sceneVersion)
+{
+	OverlaySignature signature;
+	for (int i = 0; i < 4; i++)
+		signature.view[i][i] = signature.projection[i][i] = 1.0;
+	signature.view[3][2] = cameraZ;
+	signature.width = 1280;
+	signature.height = 720;
+	signature.sceneVersion = sceneVersion;
+	return signature;
+}
+
+TEST(OverlayCache, SignatureComparesEveryField)
+{
+	OverlaySignature base = MakeSignature(-300.0, 1);
+	CHECK(base == MakeSignature(-300.0, 1));
+
+	OverlaySignature other = base;
+	other.view[3][2] = std::nextafter(-300.0, 0.0);
+	CHECK(base != other);
+	other = base;
+	other.projection[2][3] = -1.0;
+	CHECK(base != other);
+	other = base;
+	other.width = 1281;
+	CHECK(base != other);
+	other = base;
+	other.height = 721;
+	CHECK(base != other);
+	other = base;
+	other.sceneVersion = 2;
+	CHECK(base != other);
+	other = base;
+	other.settings = 1;
+	CHECK(base != other);
+}
+
+TEST(OverlayCache, ReusedUntilTheSignatureChanges)
+{
+	OverlayCache cache;
+	OverlaySignature signature = MakeSignature(-300.0, 1);
+	CHECK(!cache.Valid());
+	CHECK(!cache.Matches(signature));
+
+	cache.Update(signature, true);
+	CHECK(cache.Valid());
+	CHECK(cache.Matches(signature));
+	CHECK(!cache.Matches(MakeSignature(-299.0, 1)));
+	CHECK(!cache.Matches(MakeSignature(-300.0, 2)));
+
+	cache.Invalidate();
+	CHECK(!cache.Matches(signature));
+}
+
+// An image drawn while uploads are in flight is redrawn next frame even if nothing moved
+TEST(OverlayCache, NotCacheableImagesAreRedrawn)
+{
+	OverlayCache cache;
+	OverlaySignature signature = MakeSignature(-300.0, 1);
+	int redraws = 0;
+	for (int frame = 0; frame < 10; frame++)
+	{
+		if (cache.Matches(signature))
+			continue;
+		redraws++;
+		cache.Update(signature, frame >= 4);
+	}
+	CHECK_EQUAL(5, redraws);
+}
+
+TEST(OverlayCache, HitRateOverTheWindow)
+{
+	CacheHitRate rate;
+	CHECK(rate.Rate() == 0.0);
+
+	for (int i = 0; i < 100; i++)
+		rate.Add(i % 4 == 0);
+	CHECK(rate.Rate() == 0.25);
+
+	// The first lookups leave the window, the totals keep them
+	for (size_t i = 0; i < CacheHitRate::kWindow; i++)
+		rate.Add(true);
+	CHECK(rate.Rate() == 1.0);
+	CHECK(rate.Hits() == 25 + CacheHitRate::kWindow);
+	CHECK(rate.Lookups() == 100 + CacheHitRate::kWindow);
+
+	for (size_t i = 0; i < CacheHitRate::kWindow / 2; i++)
+		rate.Add(false);
+	CHECK(rate.Rate() == 0.5);
+
+	rate.Reset();
+	CHECK_EQUAL(0u, (size_t)rate.Lookups());
+	CHECK(rate.Rate() == 0.0);
+}
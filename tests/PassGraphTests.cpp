@@ -0,0 +1,315 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "PassGraph.h"
+
+
+static const uint32_t kRgba8 = 0, kDepth = 1, kR8 = 3;
+
+static uint32_t AddTarget(PassGraph& graph, const char* name, uint32_t format, float scale, bool imported = false)
+{
+	PassTargetDesc desc;
+	desc.name = name;
+	desc.format = format;
+	desc.bytesPerPixel = format == 2 ? 8 : 4;
+	desc.scale = scale;
+	desc.imported = imported;
+	return graph.AddTarget(desc);
+}
+
+// Checks a compiled graph against its definition, returns the number of errors:
+//  - targets sharing a physical target have the same description and disjoint lifetimes,
+//    imported targets have their own
+//  - no later kept pass uses what a culled pass wrote, before it is overwritten
+//  - every kept pass without a side effect writes something imported or used later
+static size_t CheckPassGraph(const PassGraph& graph)
+{
+	size_t errors = 0;
+	for (uint32_t a = 0; a < graph.TargetCount(); a++)
+	{
+		if (graph.Physical(a) == PassGraph::kNone)
+			continue;
+		for (uint32_t b = a + 1; b < graph.TargetCount(); b++)
+		{
+			if (graph.Physical(b) != graph.Physical(a))
+				continue;
+			const PassTargetDesc& da = graph.Target(a);
+			const PassTargetDesc& db = graph.Target(b);
+			bool overlap = graph.FirstUse(a) <= graph.LastUse(b) && graph.FirstUse(b) <= graph.LastUse(a);
+			if (overlap || da.imported || db.imported || da.format != db.format || da.scale != db.scale)
+				errors++;
+		}
+	}
+
+	// Whether a kept pass after `pass` uses target before a kept pass overwrites it
+	auto usedLater = [&](uint32_t pass, uint32_t target)
+	{
+		for (uint32_t q = pass + 1; q < graph.PassCount(); q++)
+		{
+			if (graph.Culled(q))
+				continue;
+			bool overwrites = false;
+			for (const PassGraph::Use& use : graph.Uses(q))
+			{
+				if (use.target != target)
+					continue;
+				if (use.access != kAccessOverwrite)
+					return true;
+				overwrites = true;
+			}
+			if (overwrites)
+				return false;
+		}
+		return false;
+	};
+
+	for (uint32_t p = 0; p < graph.PassCount(); p++)
+	{
+		bool needed = graph.SideEffect(p);
+		for (const PassGraph::Use& use : graph.Uses(p))
+		{
+			if (use.access != kAccessRead && (graph.Target(use.target).imported || usedLater(p, use.target)))
+				needed = true;
+		}
+		if (graph.Culled(p) == needed)
+			errors++;
+	}
+	return errors;
+}
+
+// A pass graph of passCount passes over targetCount targets in three formats and two
+// sizes: each pass reads up to three targets written before and writes one or two
+static void RandomPassGraph(std::mt19937& rng, size_t passCount, size_t targetCount, PassGraph& graph)
+{
+	std::vector<bool> written(targetCount, false);
+	std::vector<uint32_t> writtenList;
+	for (size_t t = 0; t < targetCount; t++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "t%zu", t);
+		AddTarget(graph, name, (uint32_t)(rng() % 3), rng() % 2 ? 1.0f : 0.5f, t < 2);
+	}
+
+	for (size_t p = 0; p < passCount; p++)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "p%zu", p);
+		uint32_t pass = graph.AddPass(name, p + 1 == passCount);
+
+		size_t reads = writtenList.empty() ? 0 : rng() % 4;
+		for (size_t r = 0; r < reads; r++)
+			graph.Read(pass, writtenList[rng() % writtenList.size()]);
+
+		size_t writes = 1 + rng() % 2;
+		uint32_t first = PassGraph::kNone;
+		for (size_t w = 0; w < writes; w++)
+		{
+			uint32_t t = (uint32_t)(rng() % targetCount);
+			if (t == first)
+				continue;
+			first = t;
+			graph.Access(pass, t, written[t] && rng() % 2 ? kAccessWrite : kAccessOverwrite);
+			if (!written[t])
+				writtenList.push_back(t);
+			written[t] = true;
+		}
+	}
+}
+
+// The viewport's graph as GarlandRenderOverride declares it
+TEST(PassGraph, ViewportGraphKeepsEveryPass)
+{
+	PassGraph graph;
+	uint32_t color = AddTarget(graph, "color", kRgba8, 1.0f);
+	uint32_t depth = AddTarget(graph, "depth", kDepth, 1.0f);
+	uint32_t pass = graph.AddPass("Clear");
+	graph.Overwrite(pass, color);
+	graph.Overwrite(pass, depth);
+	for (const char* name : { "Scene", "CustomScene", "HUD" })
+	{
+		pass = graph.AddPass(name);
+		graph.Write(pass, color);
+		graph.Write(pass, depth);
+	}
+	pass = graph.AddPass("Present", true);
+	graph.Read(pass, color);
+	graph.Read(pass, depth);
+
+	CHECK(graph.Compile());
+	CHECK(graph.Compiled());
+	CHECK(graph.Error().empty());
+	CHECK_EQUAL(5u, graph.Order().size());
+	CHECK_EQUAL(2u, graph.PhysicalCount());
+	CHECK(graph.Physical(color) != graph.Physical(depth));
+	CHECK_EQUAL(0u, graph.FirstUse(color));
+	CHECK_EQUAL(4u, graph.LastUse(depth));
+	CHECK_EQUAL(2u * 1920 * 1080 * 4, graph.Bytes(1920, 1080));
+	CHECK_EQUAL(0u, CheckPassGraph(graph));
+}
+
+// The same with effect passes, and a debug view nothing presents
+TEST(PassGraph, EffectsGraphCullsAndAliases)
+{
+	PassGraph graph;
+	uint32_t color = AddTarget(graph, "color", kRgba8, 1.0f);
+	uint32_t depth = AddTarget(graph, "depth", kDepth, 1.0f);
+	uint32_t normals = AddTarget(graph, "normals", kRgba8, 1.0f);
+	uint32_t ao = AddTarget(graph, "ao", kR8, 0.5f);
+	uint32_t aoBlur = AddTarget(graph, "aoBlur", kR8, 0.5f);
+	uint32_t aoUp = AddTarget(graph, "aoUp", kR8, 1.0f);
+	uint32_t outline = AddTarget(graph, "outline", kRgba8, 1.0f);
+	uint32_t debug = AddTarget(graph, "debug", kRgba8, 1.0f);
+	uint32_t output = AddTarget(graph, "output", kRgba8, 1.0f);
+
+	uint32_t pass = graph.AddPass("Clear");
+	graph.Overwrite(pass, color);
+	graph.Overwrite(pass, depth);
+	pass = graph.AddPass("Scene");
+	graph.Write(pass, color);
+	graph.Write(pass, depth);
+	pass = graph.AddPass("Normals");
+	graph.Read(pass, depth);
+	graph.Overwrite(pass, normals);
+	pass = graph.AddPass("SSAO");
+	graph.Read(pass, depth);
+	graph.Read(pass, normals);
+	graph.Overwrite(pass, ao);
+	pass = graph.AddPass("SSAOBlurX");
+	graph.Read(pass, ao);
+	graph.Overwrite(pass, aoBlur);
+	pass = graph.AddPass("SSAOBlurY");
+	graph.Read(pass, aoBlur);
+	graph.Overwrite(pass, ao);
+	pass = graph.AddPass("SSAOUpsample");
+	graph.Read(pass, ao);
+	graph.Read(pass, depth);
+	graph.Overwrite(pass, aoUp);
+	uint32_t debugPass = graph.AddPass("DebugNormals");
+	graph.Read(debugPass, normals);
+	graph.Overwrite(debugPass, debug);
+	pass = graph.AddPass("Outline");
+	graph.Read(pass, depth);
+	graph.Overwrite(pass, outline);
+	pass = graph.AddPass("Composite");
+	graph.Read(pass, color);
+	graph.Read(pass, aoUp);
+	graph.Read(pass, outline);
+	graph.Overwrite(pass, output);
+	pass = graph.AddPass("HUD");
+	graph.Write(pass, output);
+	pass = graph.AddPass("Present", true);
+	graph.Read(pass, output);
+
+	CHECK(graph.Compile());
+	CHECK_EQUAL(0u, CheckPassGraph(graph));
+
+	// Only the debug view is culled, and its target is never allocated
+	CHECK_EQUAL(graph.PassCount() - 1, graph.Order().size());
+	CHECK(graph.Culled(debugPass));
+	CHECK(graph.Physical(debug) == PassGraph::kNone);
+
+	// The outline reuses the normals, dead after SSAO. The two halves of the blur are
+	// alive together, so are the output and the color it is composited from.
+	CHECK_EQUAL(graph.Physical(normals), graph.Physical(outline));
+	CHECK(graph.Physical(ao) != graph.Physical(aoBlur));
+	CHECK(graph.Physical(output) != graph.Physical(color));
+	CHECK(graph.Physical(aoUp) != graph.Physical(ao));
+	CHECK_EQUAL(7u, graph.PhysicalCount());
+	CHECK_EQUAL(graph.UnaliasedBytes(1920, 1080) - 1920u * 1080 * 4, graph.Bytes(1920, 1080));
+}
+
+// What a pass writes is only needed up to the next pass overwriting it
+TEST(PassGraph, OverwrittenPassesAreCulled)
+{
+	for (PassAccess access : { kAccessOverwrite, kAccessWrite })
+	{
+		PassGraph graph;
+		uint32_t color = AddTarget(graph, "color", kRgba8, 1.0f);
+		uint32_t first = graph.AddPass("First");
+		graph.Overwrite(first, color);
+		uint32_t second = graph.AddPass("Second");
+		graph.Access(second, color, access);
+		uint32_t present = graph.AddPass("Present", true);
+		graph.Read(present, color);
+
+		CHECK(graph.Compile());
+		CHECK_EQUAL(access == kAccessOverwrite, graph.Culled(first));
+		CHECK(!graph.Culled(second));
+		CHECK_EQUAL(0u, CheckPassGraph(graph));
+	}
+}
+
+// Writing an imported target keeps the pass, and imported targets are never aliased
+TEST(PassGraph, ImportedTargetsAreKeptApart)
+{
+	PassGraph graph;
+	uint32_t history = AddTarget(graph, "history", kRgba8, 1.0f, true);
+	uint32_t output = AddTarget(graph, "output", kRgba8, 1.0f, true);
+	uint32_t scratch = AddTarget(graph, "scratch", kRgba8, 1.0f);
+
+	// Reads what the previous frame left, nothing reads what it writes
+	uint32_t pass = graph.AddPass("History");
+	graph.Write(pass, history);
+	pass = graph.AddPass("Scratch");
+	graph.Overwrite(pass, scratch);
+	pass = graph.AddPass("Resolve");
+	graph.Read(pass, scratch);
+	graph.Overwrite(pass, output);
+	uint32_t unused = graph.AddPass("Unused");
+	graph.Overwrite(unused, scratch);
+
+	CHECK(graph.Compile());
+	CHECK_EQUAL(3u, graph.Order().size());
+	CHECK(graph.Culled(unused));
+	CHECK_EQUAL(3u, graph.PhysicalCount());
+	CHECK(graph.Physical(history) != graph.Physical(output));
+	CHECK_EQUAL(0u, CheckPassGraph(graph));
+}
+
+TEST(PassGraph, UsingATargetBeforeItIsWrittenFails)
+{
+	PassGraph graph;
+	uint32_t color = AddTarget(graph, "color", kRgba8, 1.0f);
+	uint32_t depth = AddTarget(graph, "depth", kDepth, 1.0f);
+	uint32_t pass = graph.AddPass("Clear");
+	graph.Overwrite(pass, color);
+	pass = graph.AddPass("Scene", true);
+	graph.Write(pass, color);
+	graph.Write(pass, depth);
+
+	CHECK(!graph.Compile());
+	CHECK(graph.Error() == "Scene uses depth before any pass writes it");
+
+	// A culled pass may, nothing runs it
+	PassGraph culled;
+	color = AddTarget(culled, "color", kRgba8, 1.0f);
+	depth = AddTarget(culled, "depth", kDepth, 1.0f);
+	pass = culled.AddPass("Unused");
+	culled.Read(pass, depth);
+	culled.Overwrite(pass, color);
+	pass = culled.AddPass("Present", true);
+	culled.Overwrite(pass, color);
+	CHECK(culled.Compile());
+	CHECK(culled.Culled(0));
+}
+
+TEST(PassGraph, RandomGraphsAreCulledAndAliasedCorrectly)
+{
+	std::mt19937 rng(11);
+	for (size_t passCount : { 50, 300 })
+	{
+		size_t aliased = 0;
+		for (int i = 0; i < 40; i++)
+		{
+			PassGraph graph;
+			RandomPassGraph(rng, passCount, passCount / 2, graph);
+			CHECK(graph.Compile());
+			CHECK_EQUAL(0u, CheckPassGraph(graph));
+			CHECK(graph.Bytes(1920, 1080) <= graph.UnaliasedBytes(1920, 1080));
+			aliased += graph.Bytes(1920, 1080) < graph.UnaliasedBytes(1920, 1080);
+		}
+		CHECK(aliased > 0);
+	}
+}
@@ -0,0 +1,227 @@
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "ImageWriterPool.h"
+#include "ReadbackQueue.h"
+
+
+// Stand-in for the staging textures: Copy() draws the frame into the slot with the capture
+// number in the first pixel, and the GPU gets to a copy `gpuLatency` captures later.
+// Mapping a copy the GPU has not reached waits for it. Copying into a mapped slot fails.
+class FakeReadbackSource : public ReadbackSource
+{
+public:
+	FakeReadbackSource(uint32_t slotCount, uint32_t gpuLatency) : _gpuLatency(gpuLatency)
+	{
+		_slots.resize(slotCount);
+		for (Slot& slot : _slots)
+			slot.pixels.resize((size_t)kWidth * kHeight * 4);
+	}
+
+	bool Copy(uint32_t slot) override
+	{
+		Slot& s = _slots[slot];
+		if (s.mapped || _copies == failCopy)
+		{
+			_copies++;
+			return false;
+		}
+
+		uint32_t frame = (uint32_t)_copies;
+		for (size_t i = 0; i < s.pixels.size(); i++)
+			s.pixels[i] = (uint8_t)(frame + i / (kWidth * 4));
+		memcpy(s.pixels.data(), &frame, sizeof(frame));
+		s.readyAt = _copies + _gpuLatency;
+		_copies++;
+		return true;
+	}
+
+	bool Map(uint32_t slot, bool wait, ReadbackImage& image) override
+	{
+		Slot& s = _slots[slot];
+		if (_copies < s.readyAt)
+		{
+			if (!wait)
+				return false;
+			gpuWaits++;
+		}
+		s.mapped = true;
+		image.pixels = s.pixels.data();
+		image.width = kWidth;
+		image.height = kHeight;
+		image.rowPitch = kWidth * 4;
+		return true;
+	}
+
+	void Unmap(uint32_t slot) override
+	{
+		_slots[slot].mapped = false;
+	}
+
+	static const uint32_t kWidth = 64, kHeight = 16;
+	uint64_t failCopy = ~0ull;
+	uint64_t gpuWaits = 0;
+
+protected:
+	struct Slot
+	{
+		std::vector<uint8_t> pixels;
+		uint64_t readyAt = 0;
+		bool mapped = false;
+	};
+
+	std::vector<Slot> _slots;
+	uint32_t _gpuLatency;
+	uint64_t _copies = 0;
+};
+
+// Encodes like the file sink and checks the image: the capture stamp of the first pixel
+// must be the job's frame before and after the encoding, otherwise the slot was reused
+// while it was being written. writeMs stands for the disk.
+class CheckingImageSink : public ImageSink
+{
+public:
+	CheckingImageSink(size_t frames, double writeMs) : _written(frames, 0), _writeMs(writeMs) {}
+
+	bool Write(const ImageWriteJob& job, std::vector<uint8_t>& scratch, size_t& bytes) override
+	{
+		uint32_t before, after;
+		memcpy(&before, job.image.pixels, sizeof(before));
+		EncodeTga(job.image, scratch);
+		if (_writeMs > 0.0)
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(_writeMs));
+		memcpy(&after, job.image.pixels, sizeof(after));
+		bool ok = before == (uint32_t)job.frame && after == before && job.frame != failFrame;
+		bytes = scratch.size();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (job.frame >= 0 && (size_t)job.frame < _written.size())
+			_written[(size_t)job.frame]++;
+		if (before != (uint32_t)job.frame || after != before)
+			_corrupt++;
+		return ok;
+	}
+
+	// Frames written exactly once
+	size_t Complete() const
+	{
+		size_t count = 0;
+		for (uint32_t n : _written)
+			count += n == 1;
+		return count;
+	}
+	inline size_t Corrupt() const { return _corrupt; }
+
+	int64_t failFrame = -1;
+
+protected:
+	std::mutex _mutex;
+	std::vector<uint32_t> _written;
+	size_t _corrupt = 0;
+	double _writeMs;
+};
+
+TEST(Readback, TgaIsBgraWithTheTopRowFirst)
+{
+	// Two rows of two pixels, rows padded to 12 bytes
+	const uint8_t pixels[24] = {
+		1, 2, 3, 4, 5, 6, 7, 8, 0xee, 0xee, 0xee, 0xee,
+		9, 10, 11, 12, 13, 14, 15, 16, 0xee, 0xee, 0xee, 0xee,
+	};
+	ReadbackImage image;
+	image.pixels = pixels;
+	image.width = 2;
+	image.height = 2;
+	image.rowPitch = 12;
+
+	std::vector<uint8_t> tga;
+	EncodeTga(image, tga);
+	CHECK_EQUAL(18u + 16, tga.size());
+	CHECK(tga[2] == 2 && tga[12] == 2 && tga[13] == 0 && tga[14] == 2 && tga[16] == 32 && tga[17] == 0x28);
+	const uint8_t expected[16] = { 3, 2, 1, 4, 7, 6, 5, 8, 11, 10, 9, 12, 15, 14, 13, 16 };
+	CHECK(memcmp(tga.data() + 18, expected, sizeof(expected)) == 0);
+}
+
+// Every frame written once, from the pixels it was captured with, whatever the ring,
+// the number of writers and the speed of the disk
+TEST(Readback, EveryFrameWrittenOnceUnchanged)
+{
+	const size_t frames = 40;
+	for (uint32_t ring : { 1u, 2u, 3u, 5u })
+	{
+		for (unsigned writers : { 1u, 3u })
+		{
+			for (double writeMs : { 0.0, 0.3 })
+			{
+				FakeReadbackSource source(ring, 2);
+				CheckingImageSink sink(frames, writeMs);
+				ReadbackQueue::Stats stats;
+				{
+					ImageWriterPool pool(sink, writers, ring);
+					ReadbackQueue queue(source, pool, ring);
+					for (size_t f = 0; f < frames; f++)
+						CHECK(queue.Capture((int64_t)f, std::string()));
+					queue.Flush();
+					stats = queue.GetStats();
+				}
+
+				CHECK_EQUAL(frames, sink.Complete());
+				CHECK_EQUAL(0u, sink.Corrupt());
+				CHECK_EQUAL(frames, (size_t)stats.captured);
+				CHECK_EQUAL(frames, (size_t)stats.written);
+				CHECK_EQUAL(0u, (size_t)stats.failed);
+				CHECK_EQUAL(frames * FakeReadbackSource::kWidth * FakeReadbackSource::kHeight * 4 + frames * 18, (size_t)stats.bytes);
+				CHECK(stats.maxInFlight <= ring);
+
+				// A ring of one waits for the GPU on every frame
+				if (ring == 1)
+					CHECK(stats.stalls >= frames - 1 && source.gpuWaits > 0);
+			}
+		}
+	}
+}
+
+TEST(Readback, LatencyIsLessThanTheRing)
+{
+	FakeReadbackSource source(4, 2);
+	CheckingImageSink sink(0, 0.0);
+	ImageWriterPool pool(sink, 1);
+
+	ReadbackQueue one(source, pool, 1);
+	CHECK_EQUAL(0u, one.Latency());
+	ReadbackQueue none(source, pool, 0);
+	CHECK_EQUAL(1u, none.SlotCount());
+	ReadbackQueue three(source, pool, 3, 5);
+	CHECK_EQUAL(2u, three.Latency());
+}
+
+// A failed copy or write loses that frame only
+TEST(Readback, FailuresLoseOneFrame)
+{
+	const size_t frames = 12;
+	FakeReadbackSource source(3, 2);
+	source.failCopy = 4;
+	CheckingImageSink sink(frames, 0.0);
+	sink.failFrame = 7;
+	ReadbackQueue::Stats stats;
+	{
+		ImageWriterPool pool(sink, 2, 3);
+		ReadbackQueue queue(source, pool, 3);
+		for (size_t f = 0; f < frames; f++)
+			CHECK(queue.Capture((int64_t)f, std::string()) == (f != 4));
+		queue.Flush();
+		stats = queue.GetStats();
+	}
+
+	// Frame 4 never reaches the writers, frame 7 is written but reported failed
+	CHECK_EQUAL(2u, (size_t)stats.failed);
+	CHECK_EQUAL(frames - 1, (size_t)stats.captured);
+	CHECK_EQUAL(frames - 2, (size_t)stats.written);
+	CHECK_EQUAL(frames - 1, sink.Complete());
+	CHECK_EQUAL(0u, sink.Corrupt());
+}
@@ -0,0 +1,118 @@
+#include <cmath>
+
+#include "GarlandTests.h"
+#include "RenderTargetSizing.h"
+
+
+static RenderTargetSizing MakeSizing(unsigned bucket, double shrinkDelay)
+{
+	RenderTargetSizing::Settings settings;
+	settings.bucket = bucket;
+	settings.shrinkDelay = shrinkDelay;
+	return RenderTargetSizing(settings);
+}
+
+TEST(RenderTargetSizing, RoundsUpToBuckets)
+{
+	CHECK_EQUAL(128u, RenderTargetSizing::RoundUp(0, 128));
+	CHECK_EQUAL(128u, RenderTargetSizing::RoundUp(1, 128));
+	CHECK_EQUAL(128u, RenderTargetSizing::RoundUp(128, 128));
+	CHECK_EQUAL(256u, RenderTargetSizing::RoundUp(129, 128));
+	CHECK_EQUAL(1920u, RenderTargetSizing::RoundUp(1900, 64));
+	CHECK_EQUAL(37u, RenderTargetSizing::RoundUp(37, 1));
+	CHECK_EQUAL(1u, RenderTargetSizing::RoundUp(0, 0));
+}
+
+TEST(RenderTargetSizing, GrowsRightAway)
+{
+	RenderTargetSizing sizing = MakeSizing(128, 2.0);
+	CHECK(sizing.Request(1000, 700, 0.0));
+	CHECK_EQUAL(1024u, sizing.Width());
+	CHECK_EQUAL(768u, sizing.Height());
+
+	// Only the width grows, the height stays
+	CHECK(sizing.Request(1100, 600, 0.1));
+	CHECK_EQUAL(1152u, sizing.Width());
+	CHECK_EQUAL(768u, sizing.Height());
+
+	CHECK(!sizing.Request(1100, 700, 0.2));
+	CHECK_EQUAL(2u, sizing.Reallocations());
+}
+
+TEST(RenderTargetSizing, ShrinksAfterTheDelay)
+{
+	RenderTargetSizing sizing = MakeSizing(128, 2.0);
+	sizing.Request(1920, 1080, 0.0);
+
+	// Smaller for less than the delay, then a full size request cancels the shrink
+	for (double now = 0.1; now < 1.5; now += 0.1)
+		CHECK(!sizing.Request(800, 600, now));
+	CHECK(!sizing.Request(1920, 1080, 1.5));
+	CHECK(!sizing.Request(800, 600, 1.6));
+	CHECK(!sizing.Request(800, 600, 3.5));
+	CHECK_EQUAL(1920u, sizing.Width());
+
+	// The largest request of the delay is kept
+	CHECK(!sizing.Request(900, 500, 3.55));
+	CHECK(sizing.Request(800, 600, 3.7));
+	CHECK_EQUAL(1024u, sizing.Width());
+	CHECK_EQUAL(640u, sizing.Height());
+	CHECK_EQUAL(2u, sizing.Reallocations());
+}
+
+// Panels of different sizes drawn alternately share one target at the largest size
+TEST(RenderTargetSizing, KeepsTheLargestOfSeveralPanels)
+{
+	RenderTargetSizing sizing = MakeSizing(128, 1.0);
+	for (int f = 0; f < 600; f++)
+	{
+		bool second = f % 2 == 1;
+		sizing.Request(second ? 1900 : 640, second ? 500 : 1000, f / 60.0);
+		if (f > 0)
+			CHECK(sizing.Width() >= 1900 && sizing.Height() >= 1000);
+	}
+	CHECK_EQUAL(2u, sizing.Reallocations());
+	CHECK_EQUAL(1920u, sizing.Width());
+	CHECK_EQUAL(1024u, sizing.Height());
+}
+
+// A drag of the panel edge: the target always covers the viewport, with far fewer
+// reallocations than a target of the viewport's size
+TEST(RenderTargetSizing, CoversTheViewportDuringADrag)
+{
+	for (unsigned bucket : { 64u, 128u, 256u })
+	{
+		RenderTargetSizing sizing = MakeSizing(bucket, 1.0);
+		size_t tooSmall = 0, exactReallocations = 0;
+		unsigned lastWidth = 0, lastHeight = 0;
+		for (int f = 0; f < 600; f++)
+		{
+			double t = std::fmin(f / 60.0, 3.0);
+			unsigned width = (unsigned)(1200.0 + 400.0 * std::sin(t * 4.0));
+			unsigned height = (unsigned)(900.0 - 100.0 * std::sin(t * 3.0));
+			exactReallocations += width != lastWidth || height != lastHeight;
+			lastWidth = width;
+			lastHeight = height;
+
+			sizing.Request(width, height, f / 60.0);
+			tooSmall += sizing.Width() < width || sizing.Height() < height;
+		}
+
+		CHECK_EQUAL(0u, tooSmall);
+		CHECK(sizing.Reallocations() * 10 < exactReallocations);
+
+		// Settled on the last size once the drag stopped
+		CHECK_EQUAL(RenderTargetSizing::RoundUp(lastWidth, bucket), sizing.Width());
+		CHECK_EQUAL(RenderTargetSizing::RoundUp(lastHeight, bucket), sizing.Height());
+	}
+}
+
+TEST(RenderTargetSizing, ResetStartsOver)
+{
+	RenderTargetSizing sizing = MakeSizing(128, 1.0);
+	sizing.Request(1920, 1080, 0.0);
+	sizing.Reset();
+	CHECK_EQUAL(0u, sizing.Width());
+	CHECK(sizing.Request(100, 100, 0.1));
+	CHECK_EQUAL(128u, sizing.Width());
+}
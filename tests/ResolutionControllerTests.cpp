@@ -0,0 +1,107 @@
+#include <cmath>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "ResolutionController.h"
+
+
+struct SimulatedMove
+{
+	std::vector<double> times, scales, frameMs;
+	double fullResAt = -1.0;
+};
+
+// A camera moving for `moveSeconds` then idle for a second. A frame takes a fixed part
+// plus an overlay part proportional to its pixel count; idle frames reuse the layer.
+static SimulatedMove Simulate(ResolutionController& controller, double fixedMs, double overlayMs, double moveSeconds)
+{
+	SimulatedMove move;
+	double now = 0.0, frameMs = 0.0;
+	while (now < moveSeconds + 1.0)
+	{
+		bool moving = now < moveSeconds;
+		double scale = controller.Update(frameMs, moving, now);
+		frameMs = moving ? fixedMs + overlayMs * scale * scale : 16.0;
+		if (moving)
+		{
+			move.times.push_back(now);
+			move.scales.push_back(scale);
+			move.frameMs.push_back(frameMs);
+		}
+		else if (scale == 1.0 && move.fullResAt < 0.0)
+		{
+			move.fullResAt = now;
+		}
+		now += frameMs / 1000.0;
+	}
+	return move;
+}
+
+static bool OnAStep(double scale, const ResolutionController::Settings& settings)
+{
+	double steps = scale / settings.step;
+	return scale == 1.0 || scale == settings.minScale || std::fabs(steps - std::round(steps)) < 1e-9;
+}
+
+TEST(ResolutionController, LightLoadStaysAtFullResolution)
+{
+	ResolutionController controller;
+	SimulatedMove move = Simulate(controller, 8.0, 10.0, 4.0);
+	for (double scale : move.scales)
+		CHECK(scale == 1.0);
+	CHECK_EQUAL(0u, (size_t)controller.Changes());
+}
+
+// Settles on a step under the budget within the first seconds, without hunting
+TEST(ResolutionController, HeavyLoadSettlesUnderTheBudget)
+{
+	ResolutionController controller;
+	const ResolutionController::Settings& settings = controller.GetSettings();
+	SimulatedMove move = Simulate(controller, 10.0, 90.0, 4.0);
+
+	size_t offStep = 0, overBudget = 0, lastSecond = 0;
+	double lowest = 1.0;
+	for (size_t f = 0; f < move.scales.size(); f++)
+	{
+		offStep += !OnAStep(move.scales[f], settings);
+		lowest = std::fmin(lowest, move.scales[f]);
+		if (move.times[f] >= 3.0)
+		{
+			lastSecond++;
+			overBudget += move.frameMs[f] > settings.budgetMs;
+		}
+	}
+	CHECK_EQUAL(0u, offStep);
+	CHECK(lastSecond > 0);
+	CHECK_EQUAL(0u, overBudget);
+	CHECK(move.scales.back() < 1.0 && move.scales.back() > settings.minScale);
+	CHECK(lowest >= 0.5 - settings.step);
+	CHECK(controller.Changes() < 10);
+
+	// Full resolution at the latest on the first idle frame past the delay, sooner when
+	// the cheap idle frames bring the loop back up. Idle frames take 16 ms.
+	CHECK(controller.Scale() == 1.0);
+	CHECK(move.fullResAt > 0.0 && move.fullResAt - move.times.back() < settings.idleDelay + 0.017);
+}
+
+TEST(ResolutionController, NeverBelowTheMinimumScale)
+{
+	ResolutionController controller;
+	SimulatedMove move = Simulate(controller, 40.0, 60.0, 4.0);
+	for (double scale : move.scales)
+		CHECK(scale >= controller.GetSettings().minScale);
+	CHECK(move.scales.back() == controller.GetSettings().minScale);
+}
+
+// The first frame of a move follows an idle gap, a long frame time then is ignored
+TEST(ResolutionController, FirstFrameOfAMoveIsIgnored)
+{
+	ResolutionController controller;
+	CHECK(controller.Update(0.0, false, 0.0) == 1.0);
+	CHECK(controller.Update(500.0, true, 5.0) == 1.0);
+	CHECK(controller.Update(500.0, true, 5.1) == 0.5);
+
+	controller.Reset();
+	CHECK(controller.Scale() == 1.0);
+	CHECK(controller.Update(500.0, true, 6.0) == 1.0);
+}
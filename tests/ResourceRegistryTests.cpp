@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "ResourceRegistry.h"
+
+
+// A cache of GPU buffers with CPU copies, tracked like MeshCache and evicted least recently
+// drawn first, except what the last keepFrames frames drew
+class FakeMeshCache : public ResourceEvictor
+{
+public:
+	FakeMeshCache(ResourceRegistry& registry, size_t objectCount, uint64_t keepFrames)
+		: _registry(registry), _entries(objectCount), _keepFrames(keepFrames) {}
+
+	~FakeMeshCache()
+	{
+		for (Entry& entry : _entries)
+		{
+			_registry.Untrack(entry.gpu);
+			_registry.Untrack(entry.cpu);
+		}
+	}
+
+	// True when the object was cached
+	bool Draw(uint32_t object, size_t bytes)
+	{
+		Entry& entry = _entries[object];
+		entry.lastFrame = _frame;
+		if (entry.gpu)
+			return true;
+		entry.gpu = _registry.Track(kResourceMeshes, bytes);
+		entry.cpu = _registry.Track(kResourceMeshData, bytes / 2);
+		entry.gpuBytes = bytes;
+		entry.cpuBytes = bytes / 2;
+		return false;
+	}
+
+	size_t Evict(ResourceMemory memory, size_t bytes) override
+	{
+		evictCalls++;
+		std::vector<std::pair<uint64_t, uint32_t>> order;
+		for (uint32_t i = 0; i < (uint32_t)_entries.size(); i++)
+		{
+			if (_entries[i].gpu && _frame - _entries[i].lastFrame >= _keepFrames)
+				order.push_back(std::make_pair(_entries[i].lastFrame, i));
+		}
+		std::sort(order.begin(), order.end());
+
+		size_t freed = 0;
+		for (const std::pair<uint64_t, uint32_t>& candidate : order)
+		{
+			if (freed >= bytes)
+				break;
+			Entry& entry = _entries[candidate.second];
+			size_t gpuBytes = _registry.Untrack(entry.gpu);
+			size_t cpuBytes = _registry.Untrack(entry.cpu);
+			entry.gpuBytes = 0;
+			entry.cpuBytes = 0;
+			freed += memory == kMemoryGpu ? gpuBytes : cpuBytes;
+		}
+		return freed;
+	}
+
+	// Bytes of the cached entries and of those that may be evicted
+	void Totals(size_t& gpu, size_t& cpu, size_t& evictableGpu) const
+	{
+		gpu = cpu = evictableGpu = 0;
+		for (const Entry& entry : _entries)
+		{
+			gpu += entry.gpuBytes;
+			cpu += entry.cpuBytes;
+			if (entry.gpu && _frame - entry.lastFrame >= _keepFrames)
+				evictableGpu += entry.gpuBytes;
+		}
+	}
+
+	inline void SetFrame(uint64_t frame) { _frame = frame; }
+
+	size_t evictCalls = 0;
+
+protected:
+	struct Entry
+	{
+		ResourceHandle gpu = 0;
+		ResourceHandle cpu = 0;
+		size_t gpuBytes = 0;
+		size_t cpuBytes = 0;
+		uint64_t lastFrame = 0;
+	};
+
+	ResourceRegistry& _registry;
+	std::vector<Entry> _entries;
+	uint64_t _keepFrames;
+	uint64_t _frame = 1;
+};
+
+TEST(ResourceRegistry, TracksByCategoryAndMemory)
+{
+	ResourceRegistry registry;
+	ResourceHandle target = registry.Track(kResourceRenderTargets, 1000);
+	ResourceHandle mesh = registry.Track(kResourceMeshes, 300);
+	ResourceHandle items = registry.Track(kResourceSceneItems, 50);
+	CHECK(target != 0 && mesh != 0 && items != 0);
+	CHECK(target != mesh);
+
+	CHECK_EQUAL(1300u, registry.Bytes(kMemoryGpu));
+	CHECK_EQUAL(50u, registry.Bytes(kMemoryCpu));
+	CHECK_EQUAL(300u, registry.Usage(kResourceMeshes).bytes);
+	CHECK_EQUAL(1u, registry.Usage(kResourceMeshes).count);
+
+	// Untracking clears the handle and gives back its bytes, once
+	CHECK_EQUAL(300u, registry.Untrack(mesh));
+	CHECK_EQUAL(0u, mesh);
+	CHECK_EQUAL(0u, registry.Untrack(mesh));
+	CHECK_EQUAL(1000u, registry.Bytes(kMemoryGpu));
+	CHECK_EQUAL(0u, registry.Usage(kResourceMeshes).count);
+	CHECK_EQUAL(300u, registry.Usage(kResourceMeshes).peakBytes);
+	CHECK_EQUAL(1300u, registry.PeakBytes(kMemoryGpu));
+
+	// The freed handle is reused
+	ResourceHandle shader = registry.Track(kResourceShaders, 20);
+	CHECK(shader != target && shader != items);
+	CHECK_EQUAL(1020u, registry.Bytes(kMemoryGpu));
+
+	registry.ResetPeaks();
+	CHECK_EQUAL(1020u, registry.PeakBytes(kMemoryGpu));
+	CHECK_EQUAL(0u, registry.Usage(kResourceMeshes).peakBytes);
+
+	registry.Untrack(target);
+	registry.Untrack(items);
+	registry.Untrack(shader);
+	CHECK_EQUAL(0u, registry.Bytes(kMemoryGpu));
+	CHECK_EQUAL(0u, registry.Bytes(kMemoryCpu));
+}
+
+// The churn of a frame is reported once it ended, a gauge set to a new size counts as a
+// free and an allocation
+TEST(ResourceRegistry, ChurnOfTheLastFrame)
+{
+	ResourceRegistry registry;
+	ResourceHandle arena = 0;
+	registry.Set(arena, kResourceFrameArena, 100);
+	CHECK(arena != 0);
+	ResourceHandle ring = registry.Track(kResourceBuffers, 64);
+	CHECK_EQUAL(0u, registry.LastFrame(kMemoryCpu).allocations);
+
+	registry.EndFrame();
+	ResourceChurn cpu = registry.LastFrame(kMemoryCpu);
+	CHECK_EQUAL(1u, cpu.allocations);
+	CHECK_EQUAL(100u, cpu.allocatedBytes);
+	CHECK_EQUAL(1u, registry.LastFrame(kMemoryGpu).allocations);
+
+	// The same size is no churn
+	registry.Set(arena, kResourceFrameArena, 100);
+	registry.EndFrame();
+	CHECK_EQUAL(0u, registry.LastFrame(kMemoryCpu).allocations);
+	CHECK_EQUAL(0u, registry.LastFrame(kMemoryCpu).frees);
+
+	registry.Set(arena, kResourceFrameArena, 250);
+	registry.Untrack(ring);
+	registry.EndFrame();
+	cpu = registry.LastFrame(kMemoryCpu);
+	CHECK_EQUAL(1u, cpu.allocations);
+	CHECK_EQUAL(1u, cpu.frees);
+	CHECK_EQUAL(250u, cpu.allocatedBytes);
+	CHECK_EQUAL(100u, cpu.freedBytes);
+	CHECK_EQUAL(1u, registry.Usage(kResourceFrameArena).count);
+	CHECK_EQUAL(250u, registry.Bytes(kMemoryCpu));
+	CHECK_EQUAL(64u, registry.LastFrame(kMemoryGpu).freedBytes);
+}
+
+// Evictors are asked in their order until the memory is within its budget, and never
+// without a budget
+TEST(ResourceRegistry, EvictorsAreAskedInOrder)
+{
+	ResourceRegistry registry;
+	FakeMeshCache first(registry, 10, 1);
+	FakeMeshCache second(registry, 10, 1);
+	registry.AddEvictor(kMemoryGpu, &first);
+	registry.AddEvictor(kMemoryGpu, &second);
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		first.Draw(i, 100);
+		second.Draw(i, 100);
+	}
+	first.SetFrame(2);
+	second.SetFrame(2);
+
+	CHECK_EQUAL(0u, registry.EnforceBudget());
+	CHECK_EQUAL(0u, first.evictCalls);
+
+	// The first cache frees enough
+	registry.SetBudget(kMemoryGpu, 1500);
+	CHECK_EQUAL(500u, registry.EnforceBudget());
+	CHECK_EQUAL(1u, first.evictCalls);
+	CHECK_EQUAL(0u, second.evictCalls);
+	CHECK_EQUAL(1500u, registry.Bytes(kMemoryGpu));
+	CHECK_EQUAL(500u, registry.EvictedBytes(kMemoryGpu));
+
+	// Then the second one is needed too
+	registry.SetBudget(kMemoryGpu, 700);
+	CHECK_EQUAL(800u, registry.EnforceBudget());
+	CHECK_EQUAL(1u, second.evictCalls);
+	CHECK_EQUAL(700u, registry.Bytes(kMemoryGpu));
+	CHECK_EQUAL(0u, registry.EvictedBytes(kMemoryCpu));
+
+	// A removed evictor is not asked
+	registry.RemoveEvictor(&first);
+	registry.SetBudget(kMemoryGpu, 100);
+	registry.EnforceBudget();
+	CHECK_EQUAL(2u, first.evictCalls);
+	CHECK_EQUAL(2u, second.evictCalls);
+	CHECK_EQUAL(100u, registry.Bytes(kMemoryGpu));
+	registry.RemoveEvictor(&second);
+}
+
+// Frames drawing a skewed working set out of objectCount meshes, the camera moving over
+// the scene, with a GPU budget and a fixed part (targets, rings) tracked beside the cache:
+// the registry agrees with the cache, and every frame ends within the budget unless only
+// the frame's own meshes are left
+TEST(ResourceRegistry, BudgetIsKeptOverManyFrames)
+{
+	const size_t kMB = 1024 * 1024;
+	const size_t objectCount = 3000, drawsPerFrame = 300;
+	const int frames = 400;
+
+	for (size_t budgetMB : { 4096u, 256u, 64u })
+	{
+		ResourceRegistry registry;
+		ResourceHandle targets = registry.Track(kResourceRenderTargets, 64 * kMB);
+		ResourceHandle rings = registry.Track(kResourceBuffers, 9 * kMB);
+		ResourceHandle arena = 0;
+		size_t mismatches = 0, overBudget = 0, overWithEvictable = 0, hits = 0;
+		{
+			FakeMeshCache cache(registry, objectCount, 1);
+			registry.AddEvictor(kMemoryGpu, &cache);
+			registry.SetBudget(kMemoryGpu, budgetMB * kMB);
+
+			std::mt19937 rng(7);
+			for (int frame = 1; frame <= frames; frame++)
+			{
+				cache.SetFrame((uint64_t)frame);
+				size_t center = (size_t)frame * objectCount / (size_t)(frames / 4 + 1);
+				std::normal_distribution<double> spread(0.0, objectCount / 40.0);
+				for (size_t d = 0; d < drawsPerFrame; d++)
+				{
+					size_t object = (size_t)(center + (int64_t)spread(rng) + objectCount * 4) % objectCount;
+					hits += cache.Draw((uint32_t)object, 64 * 1024 + (object * 2654435761u) % kMB);
+				}
+				registry.Set(arena, kResourceFrameArena, drawsPerFrame * 8 * (1 + frame % 7));
+
+				registry.EnforceBudget();
+				registry.EndFrame();
+
+				size_t gpu, cpu, evictable;
+				cache.Totals(gpu, cpu, evictable);
+				mismatches += registry.Usage(kResourceMeshes).bytes != gpu || registry.Usage(kResourceMeshData).bytes != cpu ||
+					registry.Bytes(kMemoryGpu) != gpu + 73 * kMB;
+				if (registry.Bytes(kMemoryGpu) > registry.Budget(kMemoryGpu))
+				{
+					overBudget++;
+					overWithEvictable += evictable > 0;
+				}
+			}
+			registry.RemoveEvictor(&cache);
+		}
+
+		CHECK_EQUAL(0u, mismatches);
+		CHECK_EQUAL(0u, overWithEvictable);
+		CHECK(hits > 0);
+
+		// Everything fits in the largest budget, the smallest is less than a frame draws
+		if (budgetMB == 4096)
+			CHECK_EQUAL(0u, registry.EvictedBytes(kMemoryGpu));
+		else
+			CHECK(registry.EvictedBytes(kMemoryGpu) > 0);
+		CHECK_EQUAL(budgetMB == 64, overBudget > 0);
+
+		registry.Untrack(targets);
+		registry.Untrack(rings);
+		registry.Untrack(arena);
+		CHECK_EQUAL(0u, registry.Bytes(kMemoryGpu));
+		CHECK_EQUAL(0u, registry.Bytes(kMemoryCpu));
+	}
+}
+
+// Track and Untrack from several threads at once, as the pipeline thread does while the
+// render thread draws. Every thread keeps a window of live handles.
+TEST(ResourceRegistry, ConcurrentTrackAndUntrack)
+{
+	ResourceRegistry registry;
+	std::atomic<size_t> mismatches{ 0 };
+	std::vector<std::thread> threads;
+	for (unsigned t = 0; t < 4; t++)
+	{
+		threads.emplace_back([&, t]
+		{
+			const size_t kWindow = 64;
+			ResourceHandle live[kWindow] = {};
+			size_t sizes[kWindow] = {};
+			ResourceCategory category = (ResourceCategory)(t % kResourceCategoryCount);
+			for (size_t i = 0; i < 50000; i++)
+			{
+				size_t slot = i % kWindow;
+				if (live[slot] && registry.Untrack(live[slot]) != sizes[slot])
+					mismatches++;
+				sizes[slot] = 256 + (i * 40503u) % 65536;
+				live[slot] = registry.Track(category, sizes[slot]);
+			}
+			for (size_t slot = 0; slot < kWindow; slot++)
+			{
+				if (registry.Untrack(live[slot]) != sizes[slot])
+					mismatches++;
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	CHECK_EQUAL(0u, mismatches.load());
+	CHECK_EQUAL(0u, registry.Bytes(kMemoryGpu));
+	CHECK_EQUAL(0u, registry.Bytes(kMemoryCpu));
+	for (int c = 0; c < kResourceCategoryCount; c++)
+		CHECK_EQUAL(0u, registry.Usage((ResourceCategory)c).count);
+}
+
+TEST(ResourceRegistry, SummaryShowsTheBudget)
+{
+	ResourceRegistry registry;
+	ResourceHandle target = registry.Track(kResourceRenderTargets, 3 * 1024 * 1024);
+	registry.EndFrame();
+	CHECK(registry.Summary() == "GPU 3.0 MB (peak 3.0)  CPU 0.0 MB (peak 0.0)  churn +1/-0");
+	registry.SetBudget(kMemoryGpu, 512 * 1024 * 1024);
+	CHECK(registry.Summary() == "GPU 3.0/512 MB (peak 3.0)  CPU 0.0 MB (peak 0.0)  churn +1/-0");
+	registry.Untrack(target);
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "RingAllocator.h"
+
+
+TEST(RingAllocator, RejectsEmptyAndOversizedAllocations)
+{
+	RingAllocator ring(1024);
+	CHECK(ring.Allocate(0, 16) == RingAllocator::kInvalidOffset);
+	CHECK(ring.Allocate(1025, 16) == RingAllocator::kInvalidOffset);
+	CHECK(ring.Allocate(1024, 16) == 0);
+	CHECK_EQUAL(1024u, ring.Used());
+
+	RingAllocator none;
+	CHECK(none.Allocate(16, 16) == RingAllocator::kInvalidOffset);
+}
+
+TEST(RingAllocator, AlignsOffsets)
+{
+	RingAllocator ring(4096);
+	size_t a = ring.Allocate(10, 1);
+	size_t b = ring.Allocate(10, 256);
+	size_t c = ring.Allocate(3, 64);
+	CHECK_EQUAL(0u, a);
+	CHECK_EQUAL(256u, b);
+	CHECK_EQUAL(320u, c);
+
+	// The padding counts as used
+	CHECK_EQUAL(323u, ring.Used());
+}
+
+// A full ring refuses allocations until the GPU is done with a frame, then wraps
+TEST(RingAllocator, WrapsOnceAFrameRetires)
+{
+	RingAllocator ring(1000);
+	CHECK(ring.Allocate(400, 1) == 0);
+	ring.EndFrame(0);
+	CHECK(ring.Allocate(400, 1) == 400);
+	ring.EndFrame(1);
+
+	// 200 left at the end, not enough
+	CHECK(ring.Allocate(300, 1) == RingAllocator::kInvalidOffset);
+	CHECK_EQUAL(2u, ring.FramesInFlight());
+
+	ring.Retire(0);
+	CHECK_EQUAL(1u, ring.FramesInFlight());
+	CHECK_EQUAL(400u, ring.Used());
+
+	// Wraps to the start, the end of the ring is wasted until this frame retires
+	CHECK(ring.Allocate(300, 1) == 0);
+	CHECK_EQUAL(900u, ring.Used());
+	CHECK(ring.Allocate(200, 1) == RingAllocator::kInvalidOffset);
+	ring.EndFrame(2);
+
+	ring.Retire(2);
+	CHECK_EQUAL(0u, ring.Used());
+	CHECK_EQUAL(0u, ring.FramesInFlight());
+	CHECK(ring.Allocate(1000, 1) == 0);
+}
+
+TEST(RingAllocator, ResetForgetsEverything)
+{
+	RingAllocator ring(1000);
+	ring.Allocate(600, 1);
+	ring.EndFrame(0);
+	ring.Reset(2000);
+	CHECK_EQUAL(2000u, ring.Capacity());
+	CHECK_EQUAL(0u, ring.Used());
+	CHECK_EQUAL(0u, ring.FramesInFlight());
+	CHECK(ring.Allocate(2000, 1) == 0);
+}
+
+// A GPU three frames behind: what the frames in flight allocated never overlaps, and a
+// failed allocation is handled like DxRingBuffer does, by discarding the ring
+TEST(RingAllocator, LiveAllocationsNeverOverlap)
+{
+	struct Live
+	{
+		size_t offset, size;
+		uint64_t frame;
+	};
+
+	const size_t capacity = 64 * 1024;
+	const uint64_t latency = 3;
+	RingAllocator ring(capacity);
+	std::vector<Live> live;
+	std::mt19937 rng(42);
+	size_t overlaps = 0, misaligned = 0, discards = 0;
+
+	for (uint64_t frame = 0; frame < 500; frame++)
+	{
+		if (frame >= latency)
+		{
+			ring.Retire(frame - latency);
+			live.erase(std::remove_if(live.begin(), live.end(),
+				[&](const Live& l) { return l.frame <= frame - latency; }), live.end());
+		}
+
+		// Some frames need more than a third of the ring
+		size_t count = 16 + rng() % (frame % 50 == 0 ? 200 : 60);
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t size = 16 + rng() % 512;
+			size_t offset = ring.Allocate(size, 256);
+			if (offset == RingAllocator::kInvalidOffset)
+			{
+				discards++;
+				ring.Reset(capacity);
+				live.clear();
+				offset = ring.Allocate(size, 256);
+			}
+
+			misaligned += offset % 256 != 0 || offset + size > capacity;
+			for (const Live& l : live)
+				overlaps += offset < l.offset + l.size && l.offset < offset + size;
+			live.push_back({ offset, size, frame });
+		}
+		ring.EndFrame(frame);
+		CHECK(ring.Used() <= capacity);
+	}
+
+	CHECK_EQUAL(0u, overlaps);
+	CHECK_EQUAL(0u, misaligned);
+	CHECK(discards > 0);
+
+	ring.Retire(~0ull);
+	CHECK_EQUAL(0u, ring.Used());
+}
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "SceneChangeQueue.h"
+
+
+TEST(SceneChangeQueue, CapacityIsAPowerOfTwo)
+{
+	CHECK_EQUAL(1024u, SceneChangeQueue(1000).Capacity());
+	CHECK_EQUAL(1024u, SceneChangeQueue(1024).Capacity());
+	CHECK_EQUAL(2u, SceneChangeQueue(0).Capacity());
+	CHECK(SceneChangeQueue().Capacity() == SceneChangeQueue::kDefaultCapacity);
+}
+
+// First in, first out; a full ring drops the record and reports it at the next drain
+TEST(SceneChangeQueue, FullRingDropsAndFlagsTheOverflow)
+{
+	SceneChangeQueue queue(4);
+	for (uint32_t i = 0; i < 4; i++)
+		CHECK(queue.Push(kChangeDirty, MakeBoundsKey(i, 0)));
+	CHECK(!queue.Push(kChangeDirty, MakeBoundsKey(4, 0)));
+	CHECK_EQUAL(1u, (size_t)queue.Dropped());
+
+	SceneChange change;
+	CHECK(queue.Pop(change));
+	CHECK(change.key == MakeBoundsKey(0, 0) && change.type == kChangeDirty);
+	CHECK(queue.Push(kChangeNodeRemoved, MakeBoundsKey(9, 0)));
+
+	SceneChangeBatch batch;
+	CHECK_EQUAL(4u, queue.Drain(batch));
+	CHECK(batch.overflowed);
+	CHECK(batch.dirty == std::vector<BoundsKey>({ MakeBoundsKey(1, 0), MakeBoundsKey(2, 0), MakeBoundsKey(3, 0) }));
+	CHECK(batch.removedNodes == std::vector<uint32_t>({ 9 }));
+
+	// The flag is cleared by the drain that reported it
+	CHECK_EQUAL(0u, queue.Drain(batch));
+	CHECK(!batch.overflowed);
+	CHECK(!queue.Pop(change));
+}
+
+// Every key and node once, in the order they first came, and the flags
+TEST(SceneChangeQueue, DrainCoalesces)
+{
+	SceneChangeQueue queue(64);
+	queue.Push(kChangeDirty, MakeBoundsKey(1, 0));
+	queue.Push(kChangeDirty, MakeBoundsKey(1, 1));
+	queue.Push(kChangeShapeDirty, MakeBoundsKey(2, 0));
+	queue.Push(kChangeDirty, MakeBoundsKey(1, 0));
+	queue.Push(kChangeShapeDirty, MakeBoundsKey(2, 1));
+	queue.Push(kChangeShapeDirty, MakeBoundsKey(1, 1));
+	queue.Push(kChangeNodeRemoved, MakeBoundsKey(7, 0));
+	queue.Push(kChangeNodeRemoved, MakeBoundsKey(7, 0));
+	queue.Push(kChangeNodeAdded);
+	queue.Push(kChangeActiveList);
+	queue.Push(kChangeAncestorDirty, 5);
+	queue.Push(kChangeAncestorDirty, 3);
+	queue.Push(kChangeAncestorDirty, 5);
+
+	SceneChangeBatch batch;
+	CHECK_EQUAL(13u, queue.Drain(batch));
+	CHECK_EQUAL(13u, batch.events);
+	CHECK(batch.dirty == std::vector<BoundsKey>({ MakeBoundsKey(1, 0), MakeBoundsKey(1, 1), MakeBoundsKey(2, 0), MakeBoundsKey(2, 1) }));
+	CHECK(batch.dirtyShapes == std::vector<uint32_t>({ 2, 1 }));
+	CHECK(batch.removedNodes == std::vector<uint32_t>({ 7 }));
+	CHECK(batch.dirtyAncestors == std::vector<uint64_t>({ 5, 3 }));
+	CHECK(batch.nodesAdded && batch.activeChanged);
+	CHECK(!batch.dagChanged && !batch.overflowed);
+
+	// A new drain starts from nothing
+	queue.Push(kChangeDagChanged);
+	queue.Push(kChangeDirty, MakeBoundsKey(1, 0));
+	CHECK_EQUAL(2u, queue.Drain(batch));
+	CHECK(batch.dirty == std::vector<BoundsKey>({ MakeBoundsKey(1, 0) }));
+	CHECK(batch.dagChanged && !batch.nodesAdded && !batch.activeChanged);
+	CHECK(batch.dirtyShapes.empty() && batch.removedNodes.empty() && batch.dirtyAncestors.empty());
+}
+
+// Producers push their own numbered records into a small ring, retrying while it is full:
+// every record arrives once, in each producer's order, while the ring wraps many times
+TEST(SceneChangeQueue, ConcurrentProducersKeepTheirOrder)
+{
+	const unsigned producers = 4;
+	const size_t eventsPerProducer = 20000;
+	SceneChangeQueue queue(64);
+
+	std::vector<std::thread> threads;
+	for (unsigned p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&queue, p]
+		{
+			for (size_t i = 0; i < eventsPerProducer; i++)
+			{
+				SceneChange change = { MakeBoundsKey(p, (uint32_t)i), (SceneChangeType)(i % 2) };
+				while (!queue.Push(change))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	std::vector<uint32_t> next(producers, 0);
+	size_t received = 0, orderErrors = 0;
+	SceneChange change;
+	while (received < producers * eventsPerProducer)
+	{
+		if (!queue.Pop(change))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		uint32_t p = BoundsKeyNode(change.key);
+		uint32_t i = (uint32_t)change.key;
+		if (p >= producers || i != next[p] || change.type != (SceneChangeType)(i % 2))
+			orderErrors++;
+		if (p < producers)
+			next[p] = i + 1;
+		received++;
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	CHECK_EQUAL(0u, orderErrors);
+	CHECK(!queue.Pop(change));
+}
+
+// The consumer drains while producers report a few objects over and over: every record is
+// counted, each drain lists an object once, and every object reported is seen
+TEST(SceneChangeQueue, ConcurrentDrainsCoalesce)
+{
+	const unsigned producers = 3;
+	const size_t eventsPerProducer = 50000;
+	const uint32_t objects = 500;
+	SceneChangeQueue queue(1024);
+	std::atomic<unsigned> running{ producers };
+
+	std::vector<std::thread> threads;
+	for (unsigned p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&, p]
+		{
+			for (size_t i = 0; i < eventsPerProducer; i++)
+			{
+				uint32_t object = (uint32_t)((i * producers + p) * 7919 % objects);
+				while (!queue.Push(kChangeDirty, MakeBoundsKey(object, 0)))
+					std::this_thread::yield();
+			}
+			running--;
+		});
+	}
+
+	SceneChangeBatch batch;
+	std::unordered_set<BoundsKey> seen;
+	size_t events = 0, duplicates = 0;
+	for (;;)
+	{
+		bool done = running.load() == 0;
+		if (queue.Drain(batch) > 0)
+		{
+			events += batch.events;
+			std::unordered_set<BoundsKey> keys(batch.dirty.begin(), batch.dirty.end());
+			duplicates += batch.dirty.size() - keys.size();
+			seen.insert(batch.dirty.begin(), batch.dirty.end());
+		}
+		else if (done)
+		{
+			break;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	CHECK_EQUAL(producers * eventsPerProducer, events);
+	CHECK_EQUAL(0u, duplicates);
+	CHECK_EQUAL((size_t)objects, seen.size());
+}
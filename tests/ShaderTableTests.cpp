@@ -0,0 +1,138 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "ShaderVariants.h"
+
+
+// A blob of random bytes for every shader of EnumerateShaders, sizes not multiples of 4
+static std::vector<ShaderBlob> RandomBlobs()
+{
+	std::mt19937 random(7);
+	std::vector<ShaderBlob> blobs;
+	for (const ShaderTableKey& shader : EnumerateShaders())
+	{
+		ShaderBlob blob;
+		blob.stage = shader.stage;
+		blob.key = shader.key;
+		blob.code.resize(101 + random() % 2000);
+		for (uint8_t& byte : blob.code)
+			byte = (uint8_t)random();
+		blobs.push_back(std::move(blob));
+	}
+	return blobs;
+}
+
+TEST(ShaderTable, KeysDropWhatAStageIgnores)
+{
+	for (uint32_t variant = 0; variant < kVariantCount; variant++)
+	{
+		uint32_t vertex = ShaderKey(kShaderVertex, variant);
+		uint32_t pixel = ShaderKey(kShaderPixel, variant);
+		CHECK((vertex & kVariantSolid) == 0);
+		CHECK(pixel == (variant & kVariantSolid));
+		if (variant & kVariantInstanced)
+			CHECK(vertex == (variant & (kVariantInstanced | kVariantConstantColor)));
+		else
+			CHECK(vertex == 0);
+	}
+
+	std::vector<std::string> defines = ShaderDefines(kShaderVertex, kVariantInstanced | kVariantConstantColor);
+	CHECK(defines == std::vector<std::string>({ "INSTANCED=1", "CONSTANT_COLOR=1" }));
+	CHECK(ShaderDefines(kShaderPixel, 0).empty());
+	CHECK(VariantName(kVariantInstanced | kVariantSolid) == "instanced|solid|status");
+}
+
+TEST(ShaderTable, EnumeratesEachShaderOnce)
+{
+	std::vector<ShaderTableKey> shaders = EnumerateShaders();
+
+	// Vertex: none, instanced, instanced|constant and the composite; pixel: line, solid
+	// and the composite
+	CHECK_EQUAL(7u, shaders.size());
+	for (size_t i = 1; i < shaders.size(); i++)
+	{
+		const ShaderTableKey& a = shaders[i - 1];
+		const ShaderTableKey& b = shaders[i];
+		CHECK(a.stage < b.stage || (a.stage == b.stage && a.key < b.key));
+	}
+
+	for (uint32_t stage = 0; stage < kShaderStageCount; stage++)
+	{
+		size_t composites = 0;
+		for (const ShaderTableKey& shader : shaders)
+			composites += shader.stage == stage && shader.key == kShaderKeyComposite;
+		CHECK_EQUAL(1u, composites);
+	}
+}
+
+// Every variant of every stage finds the bytes of its own blob
+TEST(ShaderTable, PackedTableFindsEveryVariant)
+{
+	std::vector<ShaderBlob> blobs = RandomBlobs();
+	std::vector<uint8_t> packed = PackShaderTable(blobs);
+	CHECK_EQUAL(0u, packed.size() % 4);
+
+	ShaderTable table;
+	CHECK(table.Parse(packed.data(), packed.size()));
+	CHECK_EQUAL(blobs.size(), table.Count());
+
+	for (uint32_t variant = 0; variant < kVariantCount; variant++)
+	{
+		for (uint32_t stage = 0; stage < kShaderStageCount; stage++)
+		{
+			uint32_t key = ShaderKey((ShaderStage)stage, variant);
+			const uint8_t* code = nullptr;
+			size_t size = 0;
+			CHECK(table.Find((ShaderStage)stage, key, code, size));
+			for (const ShaderBlob& blob : blobs)
+			{
+				if (blob.stage == stage && blob.key == key)
+					CHECK(size == blob.code.size() && memcmp(code, blob.code.data(), size) == 0);
+			}
+		}
+	}
+
+	const uint8_t* code = nullptr;
+	size_t size = 0;
+	CHECK(table.Find(kShaderPixel, kShaderKeyComposite, code, size));
+	CHECK(!table.Find(kShaderPixel, kVariantInstanced, code, size));
+}
+
+TEST(ShaderTable, MalformedTablesAreRejected)
+{
+	std::vector<uint8_t> packed = PackShaderTable(RandomBlobs());
+	ShaderTable table;
+	const uint8_t* code = nullptr;
+	size_t size = 0;
+
+	// The last blob runs past the end
+	CHECK(!table.Parse(packed.data(), packed.size() - 4));
+	CHECK_EQUAL(0u, table.Count());
+	CHECK(!table.Find(kShaderVertex, 0, code, size));
+
+	// Fewer bytes than the entries
+	CHECK(!table.Parse(packed.data(), 12 + 16));
+	CHECK(!table.Parse(packed.data(), 8));
+	CHECK(!table.Parse(nullptr, 0));
+
+	std::vector<uint8_t> badMagic = packed;
+	badMagic[0] ^= 0xff;
+	CHECK(!table.Parse(badMagic.data(), badMagic.size()));
+
+	std::vector<uint8_t> badVersion = packed;
+	badVersion[4] = ShaderTable::kVersion + 1;
+	CHECK(!table.Parse(badVersion.data(), badVersion.size()));
+
+	// The size of the first entry, out of range
+	std::vector<uint8_t> badSize = packed;
+	uint32_t huge = 0xfffffff0u;
+	memcpy(&badSize[12 + 12], &huge, 4);
+	CHECK(!table.Parse(badSize.data(), badSize.size()));
+
+	// An empty table is valid
+	std::vector<uint8_t> empty = PackShaderTable({});
+	CHECK(table.Parse(empty.data(), empty.size()));
+	CHECK_EQUAL(0u, table.Count());
+}
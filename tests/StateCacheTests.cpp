@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "StateCache.h"
+
+
+// Laid out like the D3D11 descriptions, with padding after the first field
+struct FakeDesc
+{
+	uint8_t fill;
+	uint32_t bias;
+	float clamp;
+};
+
+static FakeDesc MakeDesc(uint8_t fill, uint32_t bias)
+{
+	FakeDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.fill = fill;
+	desc.bias = bias;
+	return desc;
+}
+
+// Hands out fake state handles, 0 when the creation is made to fail
+struct FakeDevice
+{
+	int Create(const FakeDesc& desc)
+	{
+		created.push_back(desc.bias);
+		return fail ? 0 : (int)created.size();
+	}
+
+	std::vector<uint32_t> created;
+	std::vector<int> released;
+	bool fail = false;
+};
+
+using FakeStateCache = StateCache<FakeDesc, int>;
+
+TEST(StateCache, CreatesEachDescriptionOnce)
+{
+	FakeDevice device;
+	FakeStateCache cache([&](const FakeDesc& d) { return device.Create(d); }, [&](int s) { device.released.push_back(s); });
+
+	int a = cache.Acquire(MakeDesc(1, 10));
+	int b = cache.Acquire(MakeDesc(1, 20));
+	CHECK(a != 0 && b != 0 && a != b);
+	CHECK_EQUAL(2u, cache.Misses());
+	CHECK_EQUAL(0u, cache.Hits());
+
+	// A new description equal to an earlier one is a hit, however many times
+	for (int i = 0; i < 5; i++)
+	{
+		CHECK_EQUAL(a, cache.Acquire(MakeDesc(1, 10)));
+		CHECK_EQUAL(b, cache.Acquire(MakeDesc(1, 20)));
+	}
+	CHECK_EQUAL(10u, cache.Hits());
+	CHECK_EQUAL(2u, cache.Misses());
+	CHECK_EQUAL(2u, cache.Size());
+	CHECK(device.created == std::vector<uint32_t>({ 10, 20 }));
+	CHECK(device.released.empty());
+}
+
+TEST(StateCache, FailedCreationsAreRetried)
+{
+	FakeDevice device;
+	FakeStateCache cache([&](const FakeDesc& d) { return device.Create(d); }, [&](int s) { device.released.push_back(s); });
+
+	device.fail = true;
+	CHECK_EQUAL(0, cache.Acquire(MakeDesc(2, 1)));
+	CHECK_EQUAL(0u, cache.Size());
+
+	device.fail = false;
+	int state = cache.Acquire(MakeDesc(2, 1));
+	CHECK(state != 0);
+	CHECK_EQUAL(state, cache.Acquire(MakeDesc(2, 1)));
+	CHECK_EQUAL(2u, cache.Misses());
+	CHECK_EQUAL(1u, cache.Hits());
+	CHECK_EQUAL(2u, device.created.size());
+}
+
+// Clear() and the destructor release every state once, the next Acquire() creates again
+TEST(StateCache, ClearReleasesEveryState)
+{
+	FakeDevice device;
+	{
+		FakeStateCache cache([&](const FakeDesc& d) { return device.Create(d); }, [&](int s) { device.released.push_back(s); });
+		int a = cache.Acquire(MakeDesc(1, 10));
+		int b = cache.Acquire(MakeDesc(3, 10));
+		cache.Clear();
+		CHECK_EQUAL(0u, cache.Size());
+		CHECK_EQUAL(2u, device.released.size());
+		CHECK((device.released[0] == a && device.released[1] == b) || (device.released[0] == b && device.released[1] == a));
+
+		int c = cache.Acquire(MakeDesc(1, 10));
+		CHECK(c != a && c != b);
+		CHECK_EQUAL(3u, cache.Misses());
+	}
+	CHECK_EQUAL(3u, device.released.size());
+	CHECK_EQUAL(3, device.released[2]);
+}
+
+TEST(StateCache, HashCoversEveryByte)
+{
+	FakeDesc a = MakeDesc(1, 10);
+	FakeDesc b = a;
+	CHECK(FakeStateCache::Hash(a) == FakeStateCache::Hash(b));
+	b.clamp = 0.5f;
+	CHECK(FakeStateCache::Hash(a) != FakeStateCache::Hash(b));
+	b = MakeDesc(1, 11);
+	CHECK(FakeStateCache::Hash(a) != FakeStateCache::Hash(b));
+}
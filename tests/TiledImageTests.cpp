@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "ImageWriterPool.h"
+#include "ReadbackQueue.h"
+#include "StreamingImageWriter.h"
+#include "TileGrid.h"
+
+
+static const double kProjection[4][4] = { { 1.5, 0, 0, 0 }, { 0, 2.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+
+// The pixel (x, y) of the test image, RGBA
+static void ImagePixel(uint32_t x, uint32_t y, uint8_t* rgba)
+{
+	uint32_t h = x * 0x9e3779b1u ^ y * 0x85ebca77u;
+	h ^= h >> 15;
+	rgba[0] = (uint8_t)(x ^ (h & 0x0f));
+	rgba[1] = (uint8_t)(y ^ (h >> 8 & 0x0f));
+	rgba[2] = (uint8_t)(h >> 16);
+	rgba[3] = (uint8_t)(h >> 24 | 1);
+}
+
+static std::string TempPath(const char* name)
+{
+	const char* tmp = getenv("TMPDIR");
+	return std::string(tmp ? tmp : "/tmp") + "/" + name;
+}
+
+static std::vector<uint8_t> ReadFile(const std::string& path)
+{
+	std::vector<uint8_t> data;
+	if (FILE* file = fopen(path.c_str(), "rb"))
+	{
+		uint8_t buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			data.insert(data.end(), buffer, buffer + read);
+		fclose(file);
+	}
+	return data;
+}
+
+// Stand-in for the tile target and its staging textures: Draw() fills the target with the
+// tile's part of the image, whatever is past the image's edge with garbage, and Copy()
+// copies the target into the slot. Rows are padded like mapped textures.
+class FakeTileSource : public ReadbackSource
+{
+public:
+	FakeTileSource(uint32_t slotCount, const TileGrid& grid)
+		: _grid(grid), _pitch(grid.TileSize() * 4 + 64)
+	{
+		_target.resize((size_t)_pitch * grid.TileSize());
+		_slots.resize(slotCount);
+		for (std::vector<uint8_t>& slot : _slots)
+			slot.resize(_target.size());
+	}
+
+	void Draw(const Tile& tile)
+	{
+		uint32_t size = _grid.TileSize();
+		for (uint32_t y = 0; y < size; y++)
+		{
+			uint8_t* row = _target.data() + (size_t)y * _pitch;
+			for (uint32_t x = 0; x < size; x++, row += 4)
+			{
+				if (x < tile.width && y < tile.height)
+					ImagePixel(tile.x + x, tile.y + y, row);
+				else
+					memset(row, 0xcd, 4);
+			}
+		}
+	}
+
+	bool Copy(uint32_t slot) override
+	{
+		memcpy(_slots[slot].data(), _target.data(), _target.size());
+		return true;
+	}
+
+	bool Map(uint32_t slot, bool, ReadbackImage& image) override
+	{
+		image.pixels = _slots[slot].data();
+		image.width = _grid.TileSize();
+		image.height = _grid.TileSize();
+		image.rowPitch = _pitch;
+		return true;
+	}
+
+	void Unmap(uint32_t) override {}
+
+protected:
+	const TileGrid& _grid;
+	uint32_t _pitch;
+	std::vector<uint8_t> _target;
+	std::vector<std::vector<uint8_t>> _slots;
+};
+
+// Scanline order, clipped to the image, every pixel in exactly one tile
+TEST(TiledImage, TilesCoverTheImageOnce)
+{
+	const uint32_t sizes[][3] = { { 256, 128, 64 }, { 300, 200, 64 }, { 50, 40, 64 }, { 1, 1, 1 }, { 129, 65, 128 } };
+	for (const uint32_t* size : sizes)
+	{
+		TileGrid grid(size[0], size[1], size[2]);
+		CHECK_EQUAL((size[0] + size[2] - 1) / size[2], grid.Columns());
+		CHECK_EQUAL((size[1] + size[2] - 1) / size[2], grid.Rows());
+
+		std::vector<uint8_t> covered((size_t)size[0] * size[1], 0);
+		for (size_t i = 0; i < grid.Count(); i++)
+		{
+			Tile tile = grid.At(i);
+			CHECK(tile.index == i);
+			CHECK(tile.x == (i % grid.Columns()) * size[2] && tile.y == (i / grid.Columns()) * size[2]);
+			CHECK(tile.width > 0 && tile.width <= size[2] && tile.x + tile.width <= size[0]);
+			CHECK(tile.height > 0 && tile.height <= size[2] && tile.y + tile.height <= size[1]);
+			for (uint32_t y = tile.y; y < tile.y + tile.height; y++)
+			{
+				for (uint32_t x = tile.x; x < tile.x + tile.width; x++)
+					covered[(size_t)y * size[0] + x]++;
+			}
+		}
+		CHECK(std::all_of(covered.begin(), covered.end(), [](uint8_t n) { return n == 1; }));
+	}
+
+	// Empty sizes are one pixel
+	TileGrid empty(0, 0, 0);
+	CHECK_EQUAL(1u, empty.Count());
+}
+
+// A point lands on the same pixel through the image's projection and through the one of
+// its tile, so the tiles line up exactly
+TEST(TiledImage, TileProjectionsLineUp)
+{
+	TileGrid grid(1000, 700, 256);
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	double maxError = 0.0;
+	for (size_t i = 0; i < grid.Count(); i++)
+	{
+		Tile tile = grid.At(i);
+		double tileProjection[4][4];
+		grid.Projection(kProjection, tile, tileProjection);
+
+		// The vertical scale of the whole image on a tile sized target
+		CHECK(std::fabs(tileProjection[1][1] - kProjection[1][1] * 700.0 / 256.0) < 1e-12);
+
+		for (int p = 0; p < 64; p++)
+		{
+			double v[4] = { unit(rng) * 100.0, unit(rng) * 100.0, -150.0 - 100.0 * unit(rng), 1.0 };
+			double full[4] = {}, local[4] = {};
+			for (int c = 0; c < 4; c++)
+			{
+				for (int r = 0; r < 4; r++)
+				{
+					full[c] += v[r] * kProjection[r][c];
+					local[c] += v[r] * tileProjection[r][c];
+				}
+			}
+
+			// Pixels, y down: the image's, and the tile target's moved to the tile
+			double fx = (full[0] / full[3] * 0.5 + 0.5) * grid.Width();
+			double fy = (0.5 - full[1] / full[3] * 0.5) * grid.Height();
+			double lx = (local[0] / local[3] * 0.5 + 0.5) * grid.TileSize() + tile.x;
+			double ly = (0.5 - local[1] / local[3] * 0.5) * grid.TileSize() + tile.y;
+			maxError = std::max(maxError, std::max(std::fabs(fx - lx), std::fabs(fy - ly)));
+		}
+	}
+	CHECK(maxError < 1e-6);
+}
+
+// Drawn tile by tile, read back through the queue and streamed to the file: the same
+// file as EncodeTga() of the whole image
+TEST(TiledImage, StreamedFileMatchesTheUntiledOne)
+{
+	const uint32_t sizes[][3] = { { 256, 128, 64 }, { 300, 200, 64 }, { 50, 40, 64 } };
+	std::string path = TempPath("garland_tests_tiled.tga");
+	for (const uint32_t* size : sizes)
+	{
+		uint32_t width = size[0], height = size[1];
+		TileGrid grid(width, height, size[2]);
+		StreamingImageWriter image;
+		TileImageSink sink(image, grid);
+		FakeTileSource source(3, grid);
+		bool closed = false;
+		ReadbackQueue::Stats stats;
+		{
+			ImageWriterPool pool(sink, 2, 3);
+			ReadbackQueue queue(source, pool, 3);
+			CHECK(image.Open(path, width, height));
+			for (size_t i = 0; i < grid.Count(); i++)
+			{
+				Tile tile = grid.At(i);
+				source.Draw(tile);
+				queue.Capture(tile.index, path);
+			}
+			queue.Flush();
+			stats = queue.GetStats();
+			CHECK(image.PixelsWritten() == (uint64_t)width * height);
+			closed = image.Close();
+		}
+		CHECK(closed);
+		CHECK_EQUAL(0u, (size_t)stats.failed);
+
+		std::vector<uint8_t> pixels((size_t)width * height * 4);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+				ImagePixel(x, y, pixels.data() + ((size_t)y * width + x) * 4);
+		}
+		ReadbackImage full;
+		full.pixels = pixels.data();
+		full.width = width;
+		full.height = height;
+		full.rowPitch = width * 4;
+		std::vector<uint8_t> reference;
+		EncodeTga(full, reference);
+		CHECK(ReadFile(path) == reference);
+	}
+	remove(path.c_str());
+}
+
+TEST(TiledImage, IncompleteImagesFailToClose)
+{
+	std::string path = TempPath("garland_tests_incomplete.tga");
+	StreamingImageWriter image;
+	CHECK(!image.Open(path, 0, 10));
+	CHECK(!image.Open(path, 0x10000, 10));
+	CHECK(!image.IsOpen());
+	CHECK(!image.Close());
+
+	std::vector<uint8_t> pixels(8 * 8 * 4, 0x80), scratch;
+	ReadbackImage tile;
+	tile.pixels = pixels.data();
+	tile.width = 8;
+	tile.height = 8;
+	tile.rowPitch = 8 * 4;
+	size_t bytes = 0;
+
+	// Tiles past the edge are clipped, or dropped when they start outside
+	CHECK(image.Open(path, 12, 8));
+	CHECK(image.WriteTile(8, 0, tile, scratch, bytes));
+	CHECK_EQUAL(4u * 8 * 4, bytes);
+	CHECK(!image.WriteTile(12, 0, tile, scratch, bytes));
+	CHECK_EQUAL(32u, (size_t)image.PixelsWritten());
+	CHECK(!image.Close());
+
+	CHECK(image.Open(path, 12, 8));
+	CHECK(image.WriteTile(0, 0, tile, scratch, bytes));
+	CHECK(image.WriteTile(8, 0, tile, scratch, bytes));
+	CHECK(image.Close());
+	CHECK_EQUAL(18u + 12 * 8 * 4, ReadFile(path).size());
+	remove(path.c_str());
+
+	CHECK(!image.Open(TempPath("garland_no_such_directory/image.tga"), 8, 8));
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "InstanceBuffer.h"
+#include "SyntheticScene.h"
+#include "ThreadPool.h"
+#include "TransformBatch.h"
+
+
+static const double kView[4][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, -300, 1 } };
+static const double kProjection[4][4] = { { 1.5, 0, 0, 0 }, { 0, 2.0, 0, 0 }, { 0, 0, -1.0, -1 }, { 0, 0, -0.1, 0 } };
+
+// bounds * world * view * projection in double, the bounds matrix maps [-1, 1] to the box
+static void ReferenceTransform(const SyntheticObject& o, double out[16])
+{
+	double bounds[4][4] = {};
+	for (int a = 0; a < 3; a++)
+	{
+		bounds[a][a] = 0.5 * ((double)o.maxPt[a] - o.minPt[a]);
+		bounds[3][a] = 0.5 * ((double)o.maxPt[a] + o.minPt[a]);
+	}
+	bounds[3][3] = 1.0;
+
+	const double (*chain[])[4] = { o.world, kView, kProjection };
+	double m[4][4], t[4][4];
+	memcpy(m, bounds, sizeof(m));
+	for (const double (*next)[4] : chain)
+	{
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				t[r][c] = m[r][0] * next[0][c] + m[r][1] * next[1][c] + m[r][2] * next[2][c] + m[r][3] * next[3][c];
+		memcpy(m, t, sizeof(m));
+	}
+
+	for (int i = 0; i < 16; i++)
+		out[i] = m[i / 4][i % 4];
+}
+
+// Largest error relative to 1 + |reference| over all the objects
+static double MaxError(const std::vector<SyntheticObject>& objects, const std::vector<float>& out, size_t stride)
+{
+	double maxError = 0.0;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		double reference[16];
+		ReferenceTransform(objects[i], reference);
+		for (int e = 0; e < 16; e++)
+			maxError = std::max(maxError, std::fabs(out[i * stride + e] - reference[e]) / (1.0 + std::fabs(reference[e])));
+	}
+	return maxError;
+}
+
+static void Fill(const std::vector<SyntheticObject>& objects, TransformSoA& soa)
+{
+	for (const SyntheticObject& o : objects)
+		soa.Add(o.minPt, o.maxPt, o.world);
+}
+
+TEST(TransformBatch, ScalarMatchesDoublePrecision)
+{
+	for (int kind = 0; kind < kSceneKindCount; kind++)
+	{
+		std::vector<SyntheticObject> objects = GenerateScene((SceneKind)kind, 1000);
+		TransformSoA soa;
+		Fill(objects, soa);
+
+		float viewProjection[4][4];
+		ComputeViewProjection(kView, kProjection, viewProjection);
+		std::vector<float> out(objects.size() * 16);
+		TransformBounds(soa, viewProjection, out.data(), 16, kTransformScalar);
+		CHECK(MaxError(objects, out, 16) < 1e-4);
+	}
+}
+
+// Counts that are not a multiple of the 8 lanes exercise the tail
+TEST(TransformBatch, AVX2MatchesScalar)
+{
+	if (BestTransformKernel() != kTransformAVX2)
+		return;
+
+	for (size_t count : { 1, 7, 8, 9, 1003 })
+	{
+		std::vector<SyntheticObject> objects = GenerateScene(kSceneHierarchy, count);
+		TransformSoA soa;
+		Fill(objects, soa);
+
+		float viewProjection[4][4];
+		ComputeViewProjection(kView, kProjection, viewProjection);
+		std::vector<float> scalar(count * 16), avx2(count * 16);
+		TransformBounds(soa, viewProjection, scalar.data(), 16, kTransformScalar);
+		TransformBounds(soa, viewProjection, avx2.data(), 16, kTransformAVX2);
+
+		double maxError = 0.0;
+		for (size_t i = 0; i < scalar.size(); i++)
+			maxError = std::max(maxError, std::fabs((double)avx2[i] - scalar[i]) / (1.0 + std::fabs(scalar[i])));
+		CHECK(maxError < 1e-5);
+	}
+}
+
+// A range only writes its own objects, at their place in the strided output
+TEST(TransformBatch, RangeWritesOnlyItsObjects)
+{
+	std::vector<SyntheticObject> objects = GenerateScene(kSceneClustered, 100);
+	TransformSoA soa;
+	soa.Resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+		soa.Set(i, objects[i].minPt, objects[i].maxPt, objects[i].world);
+
+	float viewProjection[4][4];
+	ComputeViewProjection(kView, kProjection, viewProjection);
+
+	const size_t stride = 20;
+	const float kUntouched = -12345.0f;
+	std::vector<float> out(objects.size() * stride, kUntouched);
+	TransformBoundsRange(soa, 13, 61, viewProjection, out.data(), stride);
+
+	size_t outside = 0;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		for (size_t e = 0; e < stride; e++)
+		{
+			bool written = i >= 13 && i < 61 && e < 16;
+			if (!written)
+				outside += out[i * stride + e] != kUntouched;
+		}
+	}
+	CHECK_EQUAL(0u, outside);
+
+	std::vector<SyntheticObject> range(objects.begin() + 13, objects.begin() + 61);
+	std::vector<float> rangeOut(out.begin() + 13 * stride, out.begin() + 61 * stride);
+	CHECK(MaxError(range, rangeOut, stride) < 1e-4);
+}
+
+// The layout the input elements of DxPipelineCache.cpp and unlit_vs.hlsl expect: the
+// matrix rows then the color, 80 bytes per instance
+TEST(TransformBatch, InstanceLayoutMatchesTheShader)
+{
+	CHECK_EQUAL(80u, sizeof(BoundsInstance));
+	CHECK_EQUAL(0u, offsetof(BoundsInstance, wvp));
+	CHECK_EQUAL(64u, offsetof(BoundsInstance, color));
+}
+
+// The instances built with Add() and with Set() from a pool, against bounds * world *
+// view * projection in double, with the color of each object
+TEST(TransformBatch, InstanceBufferMatchesDoublePrecision)
+{
+	std::vector<SyntheticObject> objects = GenerateScene(kSceneHierarchy, 10007);
+	auto colorOf = [](size_t i, float color[3])
+	{
+		color[0] = (float)(i % 7) / 7.0f;
+		color[1] = (float)(i % 11) / 11.0f;
+		color[2] = (float)(i % 13) / 13.0f;
+	};
+
+	const size_t stride = sizeof(BoundsInstance) / sizeof(float);
+	ThreadPool pool(4);
+	for (TransformKernel kernel : { kTransformScalar, BestTransformKernel() })
+	{
+		for (bool parallel : { false, true })
+		{
+			InstanceBufferBuilder builder;
+			builder.Begin(kView, kProjection);
+			if (parallel)
+				builder.Resize(objects.size());
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				float color[3];
+				colorOf(i, color);
+				if (parallel)
+					builder.Set(i, objects[i].minPt, objects[i].maxPt, objects[i].world, color);
+				else
+					builder.Add(objects[i].minPt, objects[i].maxPt, objects[i].world, color);
+			}
+			builder.Finish(kernel, parallel ? &pool : nullptr);
+			CHECK_EQUAL(objects.size(), builder.Count());
+			CHECK_EQUAL(objects.size() * sizeof(BoundsInstance), builder.ByteSize());
+
+			const float* data = &builder.Data()[0].wvp[0][0];
+			std::vector<float> out(data, data + objects.size() * stride);
+			CHECK(MaxError(objects, out, stride) < 1e-4);
+
+			size_t wrongColors = 0;
+			for (size_t i = 0; i < objects.size(); i++)
+			{
+				float color[3];
+				colorOf(i, color);
+				const float* built = builder.Data()[i].color;
+				wrongColors += built[0] != color[0] || built[1] != color[1] || built[2] != color[2] || built[3] != 0.0f;
+			}
+			CHECK_EQUAL(0u, wrongColors);
+		}
+	}
+
+	// Begin() starts over
+	InstanceBufferBuilder builder;
+	builder.Begin(kView, kProjection);
+	float color[3] = { 1.0f, 0.0f, 0.0f };
+	builder.Add(objects[0].minPt, objects[0].maxPt, objects[0].world, color);
+	builder.Finish();
+	builder.Begin(kView, kProjection);
+	CHECK_EQUAL(0u, builder.Count());
+	builder.Finish();
+}
@@ -0,0 +1,208 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "GarlandTests.h"
+#include "UploadScheduler.h"
+
+
+static std::vector<MeshUpload> PlanFrame(UploadScheduler& scheduler, size_t budget)
+{
+	std::vector<MeshUpload> uploads;
+	scheduler.Plan(budget, uploads);
+	return uploads;
+}
+
+static bool IsUpload(const MeshUpload& upload, uint64_t key, MeshBufferKind buffer, bool allocate, size_t offset, size_t size)
+{
+	return upload.key == key && upload.buffer == buffer && upload.allocate == allocate &&
+		upload.offset == offset && upload.size == size;
+}
+
+// The indices then the vertices, in 4-byte aligned pieces except at the end of a buffer
+TEST(UploadScheduler, SplitsAMeshOverSeveralFrames)
+{
+	UploadScheduler scheduler;
+	scheduler.Request(1, kMeshTopologyChanged, 1500, 1001);
+	CHECK_EQUAL(1u, scheduler.QueuedCount());
+	CHECK_EQUAL(2501u, scheduler.PendingBytes());
+
+	std::vector<MeshUpload> uploads = PlanFrame(scheduler, 1000);
+	CHECK(uploads.size() == 1 && IsUpload(uploads[0], 1, kMeshIndices, true, 0, 1000));
+	CHECK(!scheduler.Ready(1));
+
+	uploads = PlanFrame(scheduler, 1000);
+	CHECK(uploads.size() == 2 &&
+		IsUpload(uploads[0], 1, kMeshIndices, false, 1000, 1) &&
+		IsUpload(uploads[1], 1, kMeshVertices, true, 0, 996));
+	CHECK(!scheduler.Ready(1));
+
+	uploads = PlanFrame(scheduler, 1000);
+	CHECK(uploads.size() == 1 && IsUpload(uploads[0], 1, kMeshVertices, false, 996, 504));
+	CHECK(scheduler.Ready(1));
+	CHECK_EQUAL(0u, scheduler.QueuedCount());
+	CHECK_EQUAL(0u, scheduler.PendingBytes());
+	CHECK_EQUAL(2501u, (size_t)scheduler.UploadedBytes());
+	CHECK(PlanFrame(scheduler, 1000).empty());
+}
+
+TEST(UploadScheduler, PointsChangeOnlyCopiesThePositions)
+{
+	UploadScheduler scheduler;
+	scheduler.Request(1, kMeshTopologyChanged, 800, 400);
+	PlanFrame(scheduler, 10000);
+	CHECK(scheduler.Ready(1));
+
+	// Stays drawable while the new positions are copied into the same buffer
+	scheduler.Request(1, kMeshPointsChanged, 800, 400);
+	CHECK(scheduler.Ready(1));
+	std::vector<MeshUpload> uploads = PlanFrame(scheduler, 10000);
+	CHECK(uploads.size() == 1 && IsUpload(uploads[0], 1, kMeshVertices, false, 0, 800));
+
+	// A different vertex size is a topology change
+	scheduler.Request(1, kMeshPointsChanged, 960, 400);
+	CHECK(!scheduler.Ready(1));
+	uploads = PlanFrame(scheduler, 10000);
+	CHECK(uploads.size() == 2 &&
+		IsUpload(uploads[0], 1, kMeshIndices, true, 0, 400) &&
+		IsUpload(uploads[1], 1, kMeshVertices, true, 0, 960));
+	CHECK(scheduler.Ready(1));
+}
+
+// A mesh deformed during its copy finishes the pass, lets the next mesh through and
+// is copied again
+TEST(UploadScheduler, MeshDeformedDuringItsCopyGoesToTheBack)
+{
+	UploadScheduler scheduler;
+	scheduler.Request(1, kMeshTopologyChanged, 800, 0);
+	scheduler.Request(2, kMeshTopologyChanged, 400, 0);
+
+	std::vector<MeshUpload> uploads = PlanFrame(scheduler, 500);
+	CHECK(uploads.size() == 1 && IsUpload(uploads[0], 1, kMeshVertices, true, 0, 500));
+	scheduler.Request(1, kMeshPointsChanged, 800, 0);
+
+	uploads = PlanFrame(scheduler, 500);
+	CHECK(uploads.size() == 2 &&
+		IsUpload(uploads[0], 1, kMeshVertices, false, 500, 300) &&
+		IsUpload(uploads[1], 2, kMeshVertices, true, 0, 200));
+	CHECK(scheduler.Ready(1));
+	CHECK_EQUAL(2u, scheduler.QueuedCount());
+
+	uploads = PlanFrame(scheduler, 5000);
+	CHECK(uploads.size() == 2 &&
+		IsUpload(uploads[0], 2, kMeshVertices, false, 200, 200) &&
+		IsUpload(uploads[1], 1, kMeshVertices, false, 0, 800));
+	CHECK(scheduler.Ready(2));
+	CHECK_EQUAL(0u, scheduler.QueuedCount());
+	CHECK_EQUAL(0u, scheduler.PendingBytes());
+}
+
+TEST(UploadScheduler, RemovedMeshesAreSkipped)
+{
+	UploadScheduler scheduler;
+	scheduler.Request(1, kMeshTopologyChanged, 100, 100);
+	scheduler.Request(2, kMeshTopologyChanged, 100, 100);
+	scheduler.Remove(1);
+	scheduler.Remove(3);
+	CHECK_EQUAL(1u, scheduler.MeshCount());
+	CHECK_EQUAL(1u, scheduler.QueuedCount());
+	CHECK_EQUAL(200u, scheduler.PendingBytes());
+
+	std::vector<MeshUpload> uploads = PlanFrame(scheduler, 1000);
+	CHECK_EQUAL(2u, uploads.size());
+	for (const MeshUpload& upload : uploads)
+		CHECK(upload.key == 2);
+	CHECK(!scheduler.Ready(1));
+	CHECK(scheduler.Ready(2));
+
+	scheduler.Clear();
+	CHECK_EQUAL(0u, scheduler.MeshCount());
+	CHECK(!scheduler.Ready(2));
+}
+
+// Random edits copied into simulated GPU buffers: no frame goes over the budget and
+// once the queue is empty every GPU copy is identical to its mesh
+TEST(UploadScheduler, GpuCopiesMatchTheMeshes)
+{
+	struct SimMesh
+	{
+		std::vector<uint8_t> vertices, indices;
+		std::vector<uint8_t> gpuVertices, gpuIndices;
+	};
+
+	std::mt19937 random(11);
+	auto fill = [&](std::vector<uint8_t>& data, size_t size)
+	{
+		uint32_t seed = random();
+		data.resize(size);
+		for (size_t i = 0; i < size; i++)
+			data[i] = (uint8_t)(seed + i * 31 + (i >> 8));
+	};
+	auto resize = [&](SimMesh& mesh)
+	{
+		size_t vertices = 10 + random() % 2000;
+		fill(mesh.vertices, vertices * 12);
+		fill(mesh.indices, vertices * 6 * 4);
+	};
+
+	const size_t meshCount = 40, budget = 64 * 1024;
+	std::vector<SimMesh> meshes(meshCount);
+	UploadScheduler scheduler;
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		resize(meshes[i]);
+		scheduler.Request(i, kMeshTopologyChanged, meshes[i].vertices.size(), meshes[i].indices.size());
+	}
+
+	int frame = 0;
+	for (; frame < 100 || scheduler.QueuedCount() != 0; frame++)
+	{
+		if (frame < 100)
+		{
+			// Two meshes deformed every frame and one random edit
+			for (size_t i = 0; i < 2; i++)
+			{
+				fill(meshes[i].vertices, meshes[i].vertices.size());
+				scheduler.Request(i, kMeshPointsChanged, meshes[i].vertices.size(), meshes[i].indices.size());
+			}
+
+			size_t edited = random() % meshCount;
+			SimMesh& mesh = meshes[edited];
+			if (random() % 5 == 0)
+			{
+				resize(mesh);
+				scheduler.Request(edited, kMeshTopologyChanged, mesh.vertices.size(), mesh.indices.size());
+			}
+			else
+			{
+				fill(mesh.vertices, mesh.vertices.size());
+				scheduler.Request(edited, kMeshPointsChanged, mesh.vertices.size(), mesh.indices.size());
+			}
+		}
+
+		size_t frameBytes = 0;
+		for (const MeshUpload& upload : PlanFrame(scheduler, budget))
+		{
+			SimMesh& mesh = meshes[upload.key];
+			const std::vector<uint8_t>& source = upload.buffer == kMeshVertices ? mesh.vertices : mesh.indices;
+			std::vector<uint8_t>& target = upload.buffer == kMeshVertices ? mesh.gpuVertices : mesh.gpuIndices;
+			if (upload.allocate)
+				target.assign(source.size(), 0xcd);
+			CHECK(upload.offset + upload.size <= target.size());
+			memcpy(target.data() + upload.offset, source.data() + upload.offset, upload.size);
+			frameBytes += upload.size;
+		}
+		CHECK(frameBytes <= budget);
+		CHECK(frame < 1000);
+	}
+
+	size_t mismatches = 0, notReady = 0;
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		mismatches += meshes[i].gpuVertices != meshes[i].vertices || meshes[i].gpuIndices != meshes[i].indices;
+		notReady += !scheduler.Ready(i);
+	}
+	CHECK_EQUAL(0u, mismatches);
+	CHECK_EQUAL(0u, notReady);
+	CHECK_EQUAL(0u, scheduler.PendingBytes());
+}